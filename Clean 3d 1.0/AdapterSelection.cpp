@@ -0,0 +1,115 @@
+#include "AdapterSelection.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <string>
+
+static const char* ADAPTER_CACHE_HEADER = "clean3d-adapter-cache 1";
+
+bool UseSystemDefaultAdapter(const char* envValue) {
+    return envValue && envValue[0] == '1';
+}
+
+int SelectBestAdapter(const std::vector<AdapterCandidate>& adapters) {
+    int best = -1;
+    for (size_t i = 0; i < adapters.size(); ++i) {
+        const AdapterCandidate& a = adapters[i];
+        if (a.software) continue;
+        if (a.featureRank < 0 || a.featureRank >= ADAPTER_FEATURE_RANK_COUNT) continue;
+
+        // Choose adapter: prefer better feature rank, then more VRAM
+        bool better = false;
+        if (best < 0) better = true;
+        else if (a.featureRank < adapters[best].featureRank) better = true;
+        else if (a.featureRank == adapters[best].featureRank && a.dedicatedVideoMemory > adapters[best].dedicatedVideoMemory) better = true;
+        if (better) best = static_cast<int>(i);
+    }
+    return best;
+}
+
+static uint64_t HashMix(uint64_t hash, uint64_t value) {
+    // FNV-1a over the 8 bytes of value
+    for (int i = 0; i < 8; ++i) {
+        hash ^= (value >> (i * 8)) & 0xFF;
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+uint64_t HashAdapterSet(const std::vector<AdapterCandidate>& adapters) {
+    uint64_t hash = 14695981039346656037ULL;
+    for (const AdapterCandidate& a : adapters) {
+        if (a.software) continue;
+        hash = HashMix(hash, (static_cast<uint64_t>(static_cast<uint32_t>(a.luidHigh)) << 32) | a.luidLow);
+        hash = HashMix(hash, (static_cast<uint64_t>(a.vendorId) << 32) | a.deviceId);
+        hash = HashMix(hash, a.dedicatedVideoMemory);
+        hash = HashMix(hash, a.driverVersion);
+    }
+    return hash;
+}
+
+int MatchAdapterCache(const AdapterCacheEntry& cache, const std::vector<AdapterCandidate>& adapters) {
+    if (cache.featureRank < 0 || cache.featureRank >= ADAPTER_FEATURE_RANK_COUNT) return -1;
+    if (cache.adapterSetHash != HashAdapterSet(adapters)) return -1;
+    for (size_t i = 0; i < adapters.size(); ++i) {
+        const AdapterCandidate& a = adapters[i];
+        if (a.software) continue;
+        if (a.luidLow == cache.luidLow && a.luidHigh == cache.luidHigh && a.driverVersion == cache.driverVersion) {
+            return static_cast<int>(i);
+        }
+    }
+    return -1;
+}
+
+AdapterCacheEntry MakeAdapterCacheEntry(const std::vector<AdapterCandidate>& adapters, int index) {
+    AdapterCacheEntry entry = {};
+    entry.featureRank = ADAPTER_FEATURE_RANK_UNKNOWN;
+    if (index < 0 || index >= static_cast<int>(adapters.size())) return entry;
+    const AdapterCandidate& a = adapters[index];
+    entry.luidLow = a.luidLow;
+    entry.luidHigh = a.luidHigh;
+    entry.featureRank = a.featureRank;
+    entry.driverVersion = a.driverVersion;
+    entry.adapterSetHash = HashAdapterSet(adapters);
+    return entry;
+}
+
+bool LoadAdapterCache(const char* path, AdapterCacheEntry* entry) {
+    if (!path || !entry) return false;
+    std::ifstream file(path);
+    if (!file) return false;
+
+    std::string line;
+    if (!std::getline(file, line) || line != ADAPTER_CACHE_HEADER) return false;
+
+    AdapterCacheEntry loaded = {};
+    loaded.featureRank = ADAPTER_FEATURE_RANK_UNKNOWN;
+    int fields = 0;
+    while (std::getline(file, line)) {
+        size_t eq = line.find('=');
+        if (eq == std::string::npos) continue;
+        std::string key = line.substr(0, eq);
+        const char* value = line.c_str() + eq + 1;
+        if (key == "luid_low") { loaded.luidLow = static_cast<uint32_t>(std::strtoul(value, nullptr, 16)); fields |= 1; }
+        else if (key == "luid_high") { loaded.luidHigh = static_cast<int32_t>(std::strtoul(value, nullptr, 16)); fields |= 2; }
+        else if (key == "feature_rank") { loaded.featureRank = static_cast<int>(std::strtol(value, nullptr, 10)); fields |= 4; }
+        else if (key == "driver_version") { loaded.driverVersion = std::strtoull(value, nullptr, 16); fields |= 8; }
+        else if (key == "adapter_set") { loaded.adapterSetHash = std::strtoull(value, nullptr, 16); fields |= 16; }
+    }
+    if (fields != 31) return false;
+    *entry = loaded;
+    return true;
+}
+
+bool SaveAdapterCache(const char* path, const AdapterCacheEntry& entry) {
+    if (!path) return false;
+    std::ofstream file(path, std::ios::trunc);
+    if (!file) return false;
+    char buffer[256];
+    snprintf(buffer, sizeof(buffer), "%s\nluid_low=%08x\nluid_high=%08x\nfeature_rank=%d\ndriver_version=%016llx\nadapter_set=%016llx\n",
+        ADAPTER_CACHE_HEADER, entry.luidLow, static_cast<uint32_t>(entry.luidHigh), entry.featureRank,
+        static_cast<unsigned long long>(entry.driverVersion), static_cast<unsigned long long>(entry.adapterSetHash));
+    file << buffer;
+    return static_cast<bool>(file);
+}
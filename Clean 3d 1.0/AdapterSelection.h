@@ -0,0 +1,55 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+// Adapter selection policy, kept free of DXGI types so it can be exercised with
+// fake adapter lists. D3D12Renderer::SelectAdapter fills the candidates from
+// DXGI_ADAPTER_DESC1 and only probes feature levels on a cache miss.
+
+// Feature ranks follow the renderer's feature level list: 0 == 12_1, 1 == 12_0,
+// 2 == 11_1, 3 == 11_0. Lower is better.
+const int ADAPTER_FEATURE_RANK_COUNT = 4;
+const int ADAPTER_FEATURE_RANK_UNKNOWN = -1;
+
+// Set to 1 to skip selection and let D3D12CreateDevice take the system default adapter
+const char* const ADAPTER_DEFAULT_ENV = "CLEAN3D_USE_SYSTEM_DEFAULT_ADAPTER";
+
+struct AdapterCandidate {
+    uint32_t luidLow;
+    int32_t luidHigh;
+    uint32_t vendorId;
+    uint32_t deviceId;
+    uint64_t dedicatedVideoMemory;
+    uint64_t driverVersion;   // user-mode driver version, 0 if unavailable
+    bool software;
+    int featureRank;          // ADAPTER_FEATURE_RANK_UNKNOWN until probed or taken from the cache
+};
+
+struct AdapterCacheEntry {
+    uint32_t luidLow;
+    int32_t luidHigh;
+    int featureRank;
+    uint64_t driverVersion;
+    uint64_t adapterSetHash;  // HashAdapterSet() of the adapters present when the entry was written
+};
+
+// True if the value of ADAPTER_DEFAULT_ENV, null when unset, asks for the system default
+bool UseSystemDefaultAdapter(const char* envValue);
+
+// Best hardware adapter with a known feature rank: lowest rank first, then most
+// dedicated VRAM; ties keep the earlier adapter. Returns -1 if none qualifies.
+int SelectBestAdapter(const std::vector<AdapterCandidate>& adapters);
+
+// Fingerprint of the hardware adapters present (LUID, ids, VRAM, driver version).
+// Feature ranks are excluded so the hash can be computed before probing.
+uint64_t HashAdapterSet(const std::vector<AdapterCandidate>& adapters);
+
+// Index of the cached adapter if the entry can still be trusted: the adapter set
+// is unchanged and the cached adapter's LUID and driver version still match.
+// Returns -1 otherwise.
+int MatchAdapterCache(const AdapterCacheEntry& cache, const std::vector<AdapterCandidate>& adapters);
+
+AdapterCacheEntry MakeAdapterCacheEntry(const std::vector<AdapterCandidate>& adapters, int index);
+
+bool LoadAdapterCache(const char* path, AdapterCacheEntry* entry);
+bool SaveAdapterCache(const char* path, const AdapterCacheEntry& entry);
@@ -0,0 +1,226 @@
+#include "AllocationTracker.h"
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#ifdef _MSC_VER
+#include <malloc.h>
+#endif
+
+// Each thread counts into its own cache line; only threads past ALLOCATION_MAX_THREADS share one
+struct alignas(64) AllocationSlot {
+    std::atomic<uint64_t> allocations;
+    std::atomic<uint64_t> bytes;
+    std::atomic<const char*> name;
+    std::atomic<int> state;   // SlotState
+};
+
+// A slot is claimed for the first time past slotsClaimed; only a released one is reused
+enum SlotState {
+    SlotUnclaimed,
+    SlotInUse,
+    SlotReleased
+};
+
+// All constant-initialised, so allocations made before main are counted safely
+static std::atomic<bool> trackingEnabled(false);
+static AllocationSlot slots[ALLOCATION_MAX_THREADS];
+static std::atomic<int> slotsClaimed(0);
+static thread_local int threadSlot = -1;
+static thread_local const char* threadName = nullptr;
+
+// Hands the thread's slot back when the thread exits. The counts stay in the slot, so
+// totals and per-slot counts never go backwards; the next thread to claim it adds to them.
+struct SlotRelease {
+    ~SlotRelease() {
+        if (threadSlot >= 0) slots[threadSlot].state.store(SlotReleased, std::memory_order_release);
+        // Allocations by later thread_local destructors go to the shared slot, unclaimed
+        threadSlot = ALLOCATION_MAX_THREADS - 1;
+    }
+};
+
+static AllocationSlot& ThreadSlot() {
+    if (threadSlot < 0) {
+        int claimed = slotsClaimed.load(std::memory_order_acquire);
+        int slot = -1;
+        for (int i = 0; i < claimed && i < ALLOCATION_MAX_THREADS - 1 && slot < 0; ++i) {
+            int released = SlotReleased;
+            if (slots[i].state.compare_exchange_strong(released, SlotInUse, std::memory_order_acq_rel)) slot = i;
+        }
+        if (slot < 0) {
+            slot = slotsClaimed.fetch_add(1);
+            if (slot >= ALLOCATION_MAX_THREADS) slot = ALLOCATION_MAX_THREADS - 1;
+            slots[slot].state.store(SlotInUse, std::memory_order_relaxed);
+        }
+        slots[slot].name.store(threadName, std::memory_order_relaxed);
+        threadSlot = slot;
+        // Only the thread's own slot is released; the shared last slot never is
+        if (slot < ALLOCATION_MAX_THREADS - 1) {
+            static thread_local SlotRelease release;
+            (void)release;
+        }
+    }
+    return slots[threadSlot];
+}
+
+static void CountAllocation(size_t bytes) {
+    if (!trackingEnabled.load(std::memory_order_relaxed)) return;
+    AllocationSlot& slot = ThreadSlot();
+    slot.allocations.fetch_add(1, std::memory_order_relaxed);
+    slot.bytes.fetch_add(bytes, std::memory_order_relaxed);
+}
+
+static AllocationCounts SlotCounts(const AllocationSlot& slot) {
+    AllocationCounts counts = { slot.allocations.load(std::memory_order_relaxed), slot.bytes.load(std::memory_order_relaxed) };
+    return counts;
+}
+
+void EnableAllocationTracking(bool enabled) {
+    trackingEnabled = enabled;
+}
+
+bool AllocationTrackingEnabled() {
+    return trackingEnabled;
+}
+
+AllocationCounts AllocationTotals() {
+    AllocationCounts totals = { 0, 0 };
+    for (int i = 0; i < AllocationThreadCount(); ++i) {
+        AllocationCounts counts = SlotCounts(slots[i]);
+        totals.allocations += counts.allocations;
+        totals.bytes += counts.bytes;
+    }
+    return totals;
+}
+
+AllocationCounts ThreadAllocations() {
+    if (threadSlot < 0 && !trackingEnabled.load(std::memory_order_relaxed)) {
+        AllocationCounts none = { 0, 0 };
+        return none;
+    }
+    return SlotCounts(ThreadSlot());
+}
+
+void NameAllocationThread(const char* name) {
+    threadName = name;
+    if (threadSlot >= 0) slots[threadSlot].name = name;
+}
+
+int AllocationThreadCount() {
+    int claimed = slotsClaimed;
+    return claimed < ALLOCATION_MAX_THREADS ? claimed : ALLOCATION_MAX_THREADS;
+}
+
+AllocationCounts AllocationThreadCounts(int thread, const char** name) {
+    if (name) *name = slots[thread].name;
+    return SlotCounts(slots[thread]);
+}
+
+AllocationWatch::AllocationWatch(int warmupFrames) : m_warmupFrames(warmupFrames) {
+    Reset();
+}
+
+void AllocationWatch::BeginFrame() {
+    m_threadBegin = ThreadAllocations();
+    m_allBegin = AllocationTotals();
+}
+
+void AllocationWatch::EndFrame() {
+    AllocationCounts thread = ThreadAllocations();
+    AllocationCounts all = AllocationTotals();
+    m_last.allocations = all.allocations - m_allBegin.allocations;
+    m_last.bytes = all.bytes - m_allBegin.bytes;
+    if (m_stats.frames++ < static_cast<uint64_t>(m_warmupFrames)) return;
+    m_stats.steadyFrames++;
+    m_stats.thread.allocations += thread.allocations - m_threadBegin.allocations;
+    m_stats.thread.bytes += thread.bytes - m_threadBegin.bytes;
+    m_stats.all.allocations += m_last.allocations;
+    m_stats.all.bytes += m_last.bytes;
+    if (m_last.allocations > 0) m_stats.allocatingFrames++;
+    if (m_last.allocations > m_stats.worst.allocations) m_stats.worst = m_last;
+}
+
+void AllocationWatch::Reset() {
+    AllocationCounts none = { 0, 0 };
+    m_threadBegin = none;
+    m_allBegin = none;
+    m_last = none;
+    AllocationFrameStats stats = { 0, 0, 0, none, none, none };
+    m_stats = stats;
+}
+
+// The replaced allocation functions: malloc, or the platform's aligned malloc, behind the
+// count. The nothrow and array forms go through these too, so every new is counted once.
+
+static void* AllocateCounted(size_t bytes) {
+    CountAllocation(bytes);
+    for (;;) {
+        void* data = malloc(bytes > 0 ? bytes : 1);
+        if (data) return data;
+        std::new_handler handler = std::get_new_handler();
+        if (!handler) throw std::bad_alloc();
+        handler();
+    }
+}
+
+static void* AllocateCountedAligned(size_t bytes, std::align_val_t alignment) {
+    CountAllocation(bytes);
+    size_t align = static_cast<size_t>(alignment);
+    for (;;) {
+#ifdef _MSC_VER
+        void* data = _aligned_malloc(bytes > 0 ? bytes : 1, align);
+#else
+        // aligned_alloc wants a whole number of alignments
+        void* data = aligned_alloc(align, bytes > 0 ? (bytes + align - 1) / align * align : align);
+#endif
+        if (data) return data;
+        std::new_handler handler = std::get_new_handler();
+        if (!handler) throw std::bad_alloc();
+        handler();
+    }
+}
+
+static void FreeAligned(void* data) {
+#ifdef _MSC_VER
+    _aligned_free(data);
+#else
+    free(data);
+#endif
+}
+
+void* operator new(size_t bytes) { return AllocateCounted(bytes); }
+void* operator new[](size_t bytes) { return AllocateCounted(bytes); }
+void* operator new(size_t bytes, std::align_val_t alignment) { return AllocateCountedAligned(bytes, alignment); }
+void* operator new[](size_t bytes, std::align_val_t alignment) { return AllocateCountedAligned(bytes, alignment); }
+
+void* operator new(size_t bytes, const std::nothrow_t&) noexcept {
+    try { return AllocateCounted(bytes); }
+    catch (...) { return nullptr; }
+}
+
+void* operator new[](size_t bytes, const std::nothrow_t&) noexcept {
+    try { return AllocateCounted(bytes); }
+    catch (...) { return nullptr; }
+}
+
+void* operator new(size_t bytes, std::align_val_t alignment, const std::nothrow_t&) noexcept {
+    try { return AllocateCountedAligned(bytes, alignment); }
+    catch (...) { return nullptr; }
+}
+
+void* operator new[](size_t bytes, std::align_val_t alignment, const std::nothrow_t&) noexcept {
+    try { return AllocateCountedAligned(bytes, alignment); }
+    catch (...) { return nullptr; }
+}
+
+void operator delete(void* data) noexcept { free(data); }
+void operator delete[](void* data) noexcept { free(data); }
+void operator delete(void* data, size_t) noexcept { free(data); }
+void operator delete[](void* data, size_t) noexcept { free(data); }
+void operator delete(void* data, const std::nothrow_t&) noexcept { free(data); }
+void operator delete[](void* data, const std::nothrow_t&) noexcept { free(data); }
+void operator delete(void* data, std::align_val_t) noexcept { FreeAligned(data); }
+void operator delete[](void* data, std::align_val_t) noexcept { FreeAligned(data); }
+void operator delete(void* data, size_t, std::align_val_t) noexcept { FreeAligned(data); }
+void operator delete[](void* data, size_t, std::align_val_t) noexcept { FreeAligned(data); }
+void operator delete(void* data, std::align_val_t, const std::nothrow_t&) noexcept { FreeAligned(data); }
+void operator delete[](void* data, std::align_val_t, const std::nothrow_t&) noexcept { FreeAligned(data); }
@@ -0,0 +1,70 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+// Heap allocations counted per thread and per frame, to hold the frame loops to none once
+// they are warm. AllocationTracker.cpp replaces the global operator new and delete, every
+// form, with malloc and free plus a count on the allocating thread; with tracking off the
+// count is one relaxed load. Direct malloc calls are not seen: the overlay and the CPU
+// passes only reach the heap through new (std::string, std::vector, exceptions' messages).
+
+// Threads counted separately at once; any past these share the last slot. A thread claims
+// a slot once tracking is on and it allocates or asks for its counts, and hands it back
+// when it exits, so threads that come and go reuse slots rather than run out of them.
+const int ALLOCATION_MAX_THREADS = 64;
+
+struct AllocationCounts {
+    uint64_t allocations;
+    uint64_t bytes;
+};
+
+// Runtime switch, off at startup; counts are kept across switching off and on
+void EnableAllocationTracking(bool enabled);
+bool AllocationTrackingEnabled();
+
+// Every thread's allocations while tracking was on
+AllocationCounts AllocationTotals();
+// The calling thread's slot's: its allocations and those of exited threads that held it
+AllocationCounts ThreadAllocations();
+
+// Names the calling thread in per-thread reports. 'name' must outlive the thread (a literal).
+// Claims no slot; the name is applied when the thread first counts an allocation.
+void NameAllocationThread(const char* name);
+// Slots that have counted allocations, in the order first claimed
+int AllocationThreadCount();
+// One slot's counts; 'name' gets its current or last thread's name, or null if it has none
+AllocationCounts AllocationThreadCounts(int thread, const char** name);
+
+struct AllocationFrameStats {
+    uint64_t frames;             // since construction or Reset
+    uint64_t steadyFrames;       // past the warm-up
+    uint64_t allocatingFrames;   // steady frames in which any thread allocated
+    AllocationCounts thread;     // the watching thread's allocations over the steady frames
+    AllocationCounts all;        // every thread's over the steady frames
+    AllocationCounts worst;      // the steady frame with the most allocations, every thread
+};
+
+// Allocations between BeginFrame and EndFrame, on the thread that calls them and on every
+// thread. Frames past the first 'warmupFrames' are steady, and a steady frame that allocates
+// fails the zero-allocation check. Counts nothing while tracking is off.
+class AllocationWatch {
+public:
+    explicit AllocationWatch(int warmupFrames = 0);
+
+    void BeginFrame();
+    void EndFrame();
+
+    // Every thread's allocations in the last frame
+    AllocationCounts LastFrame() const { return m_last; }
+    AllocationFrameStats Stats() const { return m_stats; }
+    bool Failed() const { return m_stats.allocatingFrames > 0; }
+    // Restarts the counts and the warm-up
+    void Reset();
+
+private:
+    int m_warmupFrames;
+    AllocationCounts m_threadBegin;
+    AllocationCounts m_allBegin;
+    AllocationCounts m_last;
+    AllocationFrameStats m_stats;
+};
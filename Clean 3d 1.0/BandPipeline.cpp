@@ -0,0 +1,188 @@
+#include "BandPipeline.h"
+#include <cstring>
+#include <thread>
+#include "DepthEstimation.h"
+#include "EdgeOutline.h"
+#include "ParallelFor.h"
+
+BandParams DefaultBandParams() {
+    BandParams params;
+    params.bandRows = 0;
+    params.sourceBgra = false;
+    params.views.eyeSeparationPx = 24.0f;
+    params.views.parallaxStrength = 1.0f;
+    params.views.convergence = VIEW_CONVERGENCE_DEPTH;
+    params.views.layerCount = 0;
+    params.barrier.viewCount = 2;
+    params.barrier.stripeWidthPx = 1.0f;
+    params.barrier.phasePx = 0.0f;
+    params.outlineWidthPx = 1.5f;
+    params.outlineInfluence = 1000.0f;
+    params.outlineIntensity = 0.6f;
+    params.outlineColor = 0xFFE6E6E6u;
+    return params;
+}
+
+void SwizzleRow(const uint32_t* src, int width, bool bgra, uint32_t* dst) {
+    if (!bgra) {
+        memcpy(dst, src, width * sizeof(uint32_t));
+        return;
+    }
+    for (int x = 0; x < width; ++x) {
+        uint32_t px = src[x];
+        dst[x] = (px & 0xFF00FF00u) | ((px >> 16) & 0xFFu) | ((px & 0xFFu) << 16);
+    }
+}
+
+static int BandHalo(const BandParams& params) {
+    return params.outlineIntensity > 0.0f ? OutlineOffset(params.outlineWidthPx) : 0;
+}
+
+int BandRows(const BandParams& params, int width) {
+    if (params.bandRows > 0) return params.bandRows;
+    int rows = static_cast<int>(BAND_CACHE_BYTES / (static_cast<size_t>(width > 0 ? width : 1) * BAND_BYTES_PER_PIXEL));
+    rows -= 2 * BandHalo(params);
+    return rows > BAND_MIN_ROWS ? rows : BAND_MIN_ROWS;
+}
+
+size_t FrameTrafficBytes(const BandParams& params, int width, int height, bool fused) {
+    size_t pixels = static_cast<size_t>(width) * height;
+    bool outline = params.outlineIntensity > 0.0f;
+    if (fused) {
+        // The halo rows are read again by the neighbouring band
+        int rows = BandRows(params, width);
+        int bands = (height + rows - 1) / rows;
+        size_t haloPixels = static_cast<size_t>(width) * 2 * BandHalo(params) * bands;
+        return (pixels + haloPixels) * 4 + pixels * 4;
+    }
+    size_t perPixel = 4 + 4;                 // copy: source in, colour out
+    perPixel += 4 + 1;                       // luminance: colour in, luma out
+    if (outline) perPixel += 1 + 1;          // Sobel: luma in, edges out
+    perPixel += 4 + 1 + 4;                   // views: colour and luma in, output out
+    perPixel += 4 + 4 + (outline ? 1 : 0);   // pack: output in and out, edges in
+    return pixels * perPixel;
+}
+
+void BandPipeline::PrepareColumns(const BandParams& params, int width) {
+    m_viewOfColumn.resize(width);
+    m_columnScale.resize(width);
+    BuildColumnViews(params.barrier, width, m_viewOfColumn.data());
+    BuildColumnScales(m_viewOfColumn.data(), width, params.barrier.viewCount, DisparityScaleQ8(params.views), m_columnScale.data());
+    BuildOutlineAlpha(params.outlineIntensity, m_outlineAlpha);
+}
+
+BandPipeline::BandScratch& BandPipeline::ClaimScratch() {
+    // ParallelFor makes no more pieces than there are scratches, so one is always free
+    // by the time a piece starts
+    for (;;) {
+        for (auto& scratch : m_scratch) {
+            bool expected = false;
+            if (scratch->busy.compare_exchange_strong(expected, true)) return *scratch;
+        }
+        std::this_thread::yield();
+    }
+}
+
+void BandPipeline::ProcessBand(const ImagePlane<const uint32_t>& source, const BandParams& params, int first, int last,
+    BandScratch& scratch, const ImagePlane<uint32_t>& out) {
+    int width = source.width;
+    int height = source.height;
+    int halo = BandHalo(params);
+    int top = first - halo > 0 ? first - halo : 0;
+    int bottom = last + halo < height ? last + halo : height;
+    for (int y = top; y < bottom; ++y) {
+        uint32_t* color = scratch.color.data() + static_cast<size_t>(y - top) * width;
+        SwizzleRow(source.Row(y), width, params.sourceBgra, color);
+        EstimateDepthRow(color, width, scratch.luma.data() + static_cast<size_t>(y - top) * width);
+    }
+    for (int y = first; y < last; ++y) {
+        const uint32_t* color = scratch.color.data() + static_cast<size_t>(y - top) * width;
+        const uint8_t* luma = scratch.luma.data() + static_cast<size_t>(y - top) * width;
+        uint32_t* dst = out.Row(y);
+        SynthesizeInterleavedRow(color, luma, m_columnScale.data(), params.views.convergence, width, dst);
+        if (halo > 0) {
+            const uint8_t* above = scratch.luma.data() + static_cast<size_t>((y - halo > 0 ? y - halo : 0) - top) * width;
+            const uint8_t* below = scratch.luma.data() + static_cast<size_t>((y + halo < height ? y + halo : height - 1) - top) * width;
+            OutlineEdgeLumaRow(above, luma, below, width, halo, params.outlineInfluence, scratch.edges.data());
+            BlendOutlineRow(dst, scratch.edges.data(), width, m_outlineAlpha, params.outlineColor);
+        }
+        else {
+            for (int x = 0; x < width; ++x) dst[x] |= 0xFF000000u;
+        }
+    }
+}
+
+void BandPipeline::Process(const ImagePlane<const uint32_t>& source, const BandParams& params, const ImagePlane<uint32_t>& out) {
+    int width = source.width;
+    int height = source.height;
+    if (width <= 0 || height <= 0) return;
+    int rows = BandRows(params, width);
+    int scratchRows = rows + 2 * BandHalo(params);
+    PrepareColumns(params, width);
+    unsigned pieces = TaskScheduler::Current().Concurrency() * TASK_SPLIT_FACTOR;
+    if (scratchRows != m_scratchRows || width != m_scratchWidth) {
+        m_scratch.clear();
+        m_scratchRows = scratchRows;
+        m_scratchWidth = width;
+    }
+    while (m_scratch.size() < pieces) {
+        std::unique_ptr<BandScratch> scratch(new BandScratch());
+        scratch->color.resize(static_cast<size_t>(scratchRows) * width);
+        scratch->luma.resize(static_cast<size_t>(scratchRows) * width);
+        scratch->edges.resize(width);
+        scratch->busy = false;
+        m_scratch.push_back(std::move(scratch));
+    }
+    int bands = (height + rows - 1) / rows;
+    ParallelFor(0, bands, [&](int first, int last) {
+        BandScratch& scratch = ClaimScratch();
+        for (int band = first; band < last; ++band) {
+            int end = (band + 1) * rows < height ? (band + 1) * rows : height;
+            ProcessBand(source, params, band * rows, end, scratch, out);
+        }
+        scratch.busy = false;
+    }, pieces);
+}
+
+void BandPipeline::ProcessStaged(const ImagePlane<const uint32_t>& source, const BandParams& params, const ImagePlane<uint32_t>& out) {
+    int width = source.width;
+    int height = source.height;
+    if (width <= 0 || height <= 0) return;
+    size_t pixels = static_cast<size_t>(width) * height;
+    m_color.resize(pixels);
+    m_luma.resize(pixels);
+    m_edges.resize(pixels);
+    PrepareColumns(params, width);
+    int halo = BandHalo(params);
+    ParallelFor(0, height, [&](int first, int last) {
+        for (int y = first; y < last; ++y) SwizzleRow(source.Row(y), width, params.sourceBgra, m_color.data() + static_cast<size_t>(y) * width);
+    });
+    ParallelFor(0, height, [&](int first, int last) {
+        for (int y = first; y < last; ++y) {
+            EstimateDepthRow(m_color.data() + static_cast<size_t>(y) * width, width, m_luma.data() + static_cast<size_t>(y) * width);
+        }
+    });
+    if (halo > 0) {
+        ParallelFor(0, height, [&](int first, int last) {
+            for (int y = first; y < last; ++y) {
+                const uint8_t* above = m_luma.data() + static_cast<size_t>(y - halo > 0 ? y - halo : 0) * width;
+                const uint8_t* below = m_luma.data() + static_cast<size_t>(y + halo < height ? y + halo : height - 1) * width;
+                OutlineEdgeLumaRow(above, m_luma.data() + static_cast<size_t>(y) * width, below, width, halo, params.outlineInfluence,
+                    m_edges.data() + static_cast<size_t>(y) * width);
+            }
+        });
+    }
+    ParallelFor(0, height, [&](int first, int last) {
+        for (int y = first; y < last; ++y) {
+            SynthesizeInterleavedRow(m_color.data() + static_cast<size_t>(y) * width, m_luma.data() + static_cast<size_t>(y) * width,
+                m_columnScale.data(), params.views.convergence, width, out.Row(y));
+        }
+    });
+    ParallelFor(0, height, [&](int first, int last) {
+        for (int y = first; y < last; ++y) {
+            uint32_t* dst = out.Row(y);
+            if (halo > 0) BlendOutlineRow(dst, m_edges.data() + static_cast<size_t>(y) * width, width, m_outlineAlpha, params.outlineColor);
+            else for (int x = 0; x < width; ++x) dst[x] |= 0xFF000000u;
+        }
+    });
+}
@@ -0,0 +1,91 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include "CpuImage.h"
+#include "ViewSynthesis.h"
+
+// Capture to output in one pass over row bands small enough to stay in L2. Each band
+// goes through every step before the next band starts:
+//
+//   copy       the captured rows, swizzled from B8G8R8A8 if the source is DXGI's
+//   luminance  EstimateDepthRow; depth is the luminance (DepthEstimation.h), so the
+//              same rows serve as the band's depth
+//   Sobel      OutlineEdgeLumaRow, over halo rows OutlineOffset above and below the band
+//   views      SynthesizeInterleavedRow: each column gathered for the view shown there
+//   pack       the outline blended over, opaque R8G8B8A8 into the output
+//
+// so a frame reads the capture and writes the output once, where running the steps
+// frame by frame (ProcessStaged, kept for comparison) passes every intermediate plane
+// through memory. Both produce the same output.
+
+// Working set a band aims for: half of a 1 MB L2, leaving room for the output rows and
+// the column tables
+const size_t BAND_CACHE_BYTES = 512 * 1024;
+
+// Fewest rows in a band, however wide the frame
+const int BAND_MIN_ROWS = 4;
+
+// Bytes of band scratch per pixel: colour and luminance
+const int BAND_BYTES_PER_PIXEL = 5;
+
+struct BandParams {
+    int bandRows;                // 0 for as many as fit in BAND_CACHE_BYTES
+    bool sourceBgra;             // the source is B8G8R8A8, as DXGI captures
+    ViewSynthesisParams views;
+    InterleavePattern barrier;
+    float outlineWidthPx;
+    float outlineInfluence;
+    float outlineIntensity;      // 0 skips the Sobel step
+    uint32_t outlineColor;       // R8G8B8A8
+};
+
+BandParams DefaultBandParams();
+
+// Copies a row to R8G8B8A8, swapping red and blue if 'bgra'
+void SwizzleRow(const uint32_t* src, int width, bool bgra, uint32_t* dst);
+
+// Rows in each band for a frame width, as Process chooses them
+int BandRows(const BandParams& params, int width);
+
+// Estimated bytes a frame moves to and from memory, counting each plane a step reads
+// or writes once: the fused pass only reads the source (plus the halo rows) and writes
+// the output; the staged one also writes and rereads each intermediate plane
+size_t FrameTrafficBytes(const BandParams& params, int width, int height, bool fused);
+
+class BandPipeline {
+public:
+    BandPipeline() : m_scratchRows(0), m_scratchWidth(0) {}
+
+    // Fused: bands in parallel, each on its own scratch. 'out' has the source's size.
+    void Process(const ImagePlane<const uint32_t>& source, const BandParams& params, const ImagePlane<uint32_t>& out);
+
+    // The same steps a whole frame at a time, each parallel across rows
+    void ProcessStaged(const ImagePlane<const uint32_t>& source, const BandParams& params, const ImagePlane<uint32_t>& out);
+
+private:
+    struct BandScratch {
+        std::vector<uint32_t> color;   // band plus halo rows
+        std::vector<uint8_t> luma;
+        std::vector<uint8_t> edges;    // one row
+        std::atomic<bool> busy;
+    };
+
+    void PrepareColumns(const BandParams& params, int width);
+    void ProcessBand(const ImagePlane<const uint32_t>& source, const BandParams& params, int first, int last,
+        BandScratch& scratch, const ImagePlane<uint32_t>& out);
+    BandScratch& ClaimScratch();
+
+    std::vector<std::unique_ptr<BandScratch>> m_scratch;
+    int m_scratchRows;
+    int m_scratchWidth;
+    std::vector<uint8_t> m_viewOfColumn;
+    std::vector<int32_t> m_columnScale;
+    int m_outlineAlpha[256];
+    // ProcessStaged's planes
+    std::vector<uint32_t> m_color;
+    std::vector<uint8_t> m_luma;
+    std::vector<uint8_t> m_edges;
+};
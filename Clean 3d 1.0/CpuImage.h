@@ -0,0 +1,27 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+// SSE2 is baseline on x64, which is what the project ships; 32-bit builds need /arch:SSE2
+#if defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2) || defined(__SSE2__)
+#include <emmintrin.h>
+#define CLEAN3D_SSE2 1
+#endif
+
+// Pitched view over a CPU image owned by someone else: a mapped upload buffer, a mapped
+// staging texture or a scratch vector. Pitch is in bytes, as D3D reports it. Color
+// planes are R8G8B8A8 packed into uint32_t, depth planes are uint8_t.
+
+template <typename T>
+struct ImagePlane {
+    T* data;
+    int width;
+    int height;
+    size_t pitch;
+
+    T* Row(int y) const {
+        typedef typename std::conditional<std::is_const<T>::value, const uint8_t, uint8_t>::type Byte;
+        return reinterpret_cast<T*>(reinterpret_cast<Byte*>(data) + static_cast<size_t>(y) * pitch);
+    }
+};
@@ -0,0 +1,44 @@
+#include "DepthEstimation.h"
+#include "ParallelFor.h"
+
+// Rec. 601 luma weights in 8-bit fixed point; they sum to 256
+static const int LUMA_R = 77;
+static const int LUMA_G = 150;
+static const int LUMA_B = 29;
+
+void EstimateDepthRow(const uint32_t* rgba, int width, uint8_t* depth) {
+    int x = 0;
+#ifdef CLEAN3D_SSE2
+    // 8 pixels per iteration. Each channel is isolated into the low half of a 32-bit lane,
+    // so 16-bit multiplies are exact and the weighted sum (at most 255 * 256) cannot carry.
+    const __m128i byteMask = _mm_set1_epi32(0xFF);
+    const __m128i wr = _mm_set1_epi32(LUMA_R);
+    const __m128i wg = _mm_set1_epi32(LUMA_G);
+    const __m128i wb = _mm_set1_epi32(LUMA_B);
+    for (; x + 8 <= width; x += 8) {
+        __m128i lumaPair[2];
+        for (int half = 0; half < 2; ++half) {
+            __m128i px = _mm_loadu_si128(reinterpret_cast<const __m128i*>(rgba + x + half * 4));
+            __m128i r = _mm_and_si128(px, byteMask);
+            __m128i g = _mm_and_si128(_mm_srli_epi32(px, 8), byteMask);
+            __m128i b = _mm_and_si128(_mm_srli_epi32(px, 16), byteMask);
+            __m128i sum = _mm_add_epi16(_mm_add_epi16(_mm_mullo_epi16(r, wr), _mm_mullo_epi16(g, wg)), _mm_mullo_epi16(b, wb));
+            lumaPair[half] = _mm_srli_epi32(sum, 8);
+        }
+        __m128i luma16 = _mm_packs_epi32(lumaPair[0], lumaPair[1]);
+        __m128i luma8 = _mm_packus_epi16(luma16, luma16);
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(depth + x), luma8);
+    }
+#endif
+    for (; x < width; ++x) {
+        uint32_t px = rgba[x];
+        uint32_t r = px & 0xFF, g = (px >> 8) & 0xFF, b = (px >> 16) & 0xFF;
+        depth[x] = static_cast<uint8_t>((r * LUMA_R + g * LUMA_G + b * LUMA_B) >> 8);
+    }
+}
+
+void EstimateDepth(const ImagePlane<const uint32_t>& frame, const ImagePlane<uint8_t>& depth) {
+    ParallelFor(0, frame.height, [&](int first, int last) {
+        for (int y = first; y < last; ++y) EstimateDepthRow(frame.Row(y), frame.width, depth.Row(y));
+    });
+}
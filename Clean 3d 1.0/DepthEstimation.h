@@ -0,0 +1,13 @@
+#pragma once
+#include <cstdint>
+#include "CpuImage.h"
+
+// Depth for view synthesis, estimated from the captured frame alone. Depth is 8-bit:
+// 0 is far, 255 is near. Brighter pixels are treated as closer, the same heuristic
+// DepthCompute.hlsl uses on the GPU.
+
+// One row of R8G8B8A8 pixels to depth (Rec. 601 luma, 8-bit fixed point).
+void EstimateDepthRow(const uint32_t* rgba, int width, uint8_t* depth);
+
+// Whole frame, parallel across rows. 'depth' must be at least frame.width x frame.height.
+void EstimateDepth(const ImagePlane<const uint32_t>& frame, const ImagePlane<uint8_t>& depth);
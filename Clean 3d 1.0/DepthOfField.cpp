@@ -0,0 +1,165 @@
+#include "DepthOfField.h"
+#include "FrameMemory.h"
+#include "ParallelFor.h"
+#include <cmath>
+#include <cstring>
+
+// One row of a summed-area table over the frame extended by 'pad' columns each side,
+// edge pixels repeated: entry i of 'row' holds the per-channel sums of all pixels left of
+// extended column i in the rows so far, four uint32 per entry, entry 0 being zero. 'row'
+// is 'above' plus the running sums of 'src'. Sums wrap modulo 2^32, which the box
+// differences undo.
+static void AccumulateTableRow(const uint32_t* src, int width, int pad, const uint32_t* above, uint32_t* row) {
+    int entries = width + 2 * pad;
+    row[0] = row[1] = row[2] = row[3] = 0;
+#ifdef CLEAN3D_SSE2
+    const __m128i zero = _mm_setzero_si128();
+    __m128i acc = zero;
+    for (int i = 0; i < entries; ++i) {
+        int x = i - pad < 0 ? 0 : (i - pad >= width ? width - 1 : i - pad);
+        __m128i px = _mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(static_cast<int>(src[x])), zero), zero);
+        acc = _mm_add_epi32(acc, px);
+        size_t at = (static_cast<size_t>(i) + 1) * 4;
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(row + at),
+            _mm_add_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(above + at)), acc));
+    }
+#else
+    uint32_t acc[4] = { 0, 0, 0, 0 };
+    for (int i = 0; i < entries; ++i) {
+        int x = i - pad < 0 ? 0 : (i - pad >= width ? width - 1 : i - pad);
+        size_t at = (static_cast<size_t>(i) + 1) * 4;
+        for (int c = 0; c < 4; ++c) {
+            acc[c] += (src[x] >> (8 * c)) & 0xFF;
+            row[at + c] = above[at + c] + acc[c];
+        }
+    }
+#endif
+}
+
+// What a depth value does to its pixel: box radius, red/blue shift, 1 / box area
+struct FocusStep {
+    int radius;
+    int shift;
+    float reciprocal;
+};
+
+static void BuildFocusSteps(const DepthOfFieldParams& params, int maxRadius, int maxShift, FocusStep* steps) {
+    int focus = params.focus < 0 ? 0 : (params.focus > 255 ? 255 : params.focus);
+    // Full radius at whichever end of the depth range lies farther from focus
+    float span = static_cast<float>(focus > 255 - focus ? focus : 255 - focus);
+    for (int d = 0; d < 256; ++d) {
+        float distance = (d > focus ? d - focus : focus - d) / span;
+        steps[d].radius = static_cast<int>(distance * maxRadius + 0.5f);
+        steps[d].shift = static_cast<int>(distance * maxShift + 0.5f);
+        int side = 2 * steps[d].radius + 1;
+        steps[d].reciprocal = 1.0f / (side * side);
+    }
+}
+
+#ifdef CLEAN3D_SSE2
+// Mean of the box between table rows a and b and table entries xa and xb, all channels
+static inline __m128 BoxMean(const uint32_t* a, const uint32_t* b, int xa, int xb, float reciprocal) {
+    const __m128i* pa = reinterpret_cast<const __m128i*>(a);
+    const __m128i* pb = reinterpret_cast<const __m128i*>(b);
+    __m128i sum = _mm_sub_epi32(_mm_add_epi32(_mm_loadu_si128(pb + xb), _mm_loadu_si128(pa + xa)),
+        _mm_add_epi32(_mm_loadu_si128(pb + xa), _mm_loadu_si128(pa + xb)));
+    return _mm_mul_ps(_mm_cvtepi32_ps(sum), _mm_set1_ps(reciprocal));
+}
+#else
+static inline void BoxMean(const uint32_t* a, const uint32_t* b, int xa, int xb, float reciprocal, float* mean) {
+    for (int c = 0; c < 4; ++c) {
+        uint32_t sum = b[xb * 4 + c] + a[xa * 4 + c] - b[xa * 4 + c] - a[xb * 4 + c];
+        mean[c] = sum * reciprocal;
+    }
+}
+#endif
+
+// rows[k] is the table row above extended frame row y + k, for -maxRadius <= k <= maxRadius + 1.
+// Table entries are offset by 'pad', so every box lies inside the table.
+static void FocusRow(const uint32_t* src, const uint8_t* depth, int width, int pad,
+    const uint32_t* const* rows, const FocusStep* steps, uint32_t* out) {
+#ifdef CLEAN3D_SSE2
+    const __m128 red = _mm_castsi128_ps(_mm_setr_epi32(-1, 0, 0, 0));
+    const __m128 blue = _mm_castsi128_ps(_mm_setr_epi32(0, 0, -1, 0));
+    const __m128 greenAlpha = _mm_castsi128_ps(_mm_setr_epi32(0, -1, 0, -1));
+#endif
+    for (int x = 0; x < width; ++x) {
+        const FocusStep& step = steps[depth[x]];
+        int r = step.radius, s = step.shift;
+        if (r == 0 && s == 0) {
+            out[x] = src[x];
+            continue;
+        }
+        const uint32_t* a = rows[-r];
+        const uint32_t* b = rows[r + 1];
+        int xa = x + pad - r, xb = x + pad + r + 1;
+#ifdef CLEAN3D_SSE2
+        __m128 mean = BoxMean(a, b, xa, xb, step.reciprocal);
+        if (s > 0) {
+            // Red from the box s to the right, blue from the box s to the left
+            __m128 meanRed = BoxMean(a, b, xa + s, xb + s, step.reciprocal);
+            __m128 meanBlue = BoxMean(a, b, xa - s, xb - s, step.reciprocal);
+            mean = _mm_or_ps(_mm_and_ps(mean, greenAlpha), _mm_or_ps(_mm_and_ps(meanRed, red), _mm_and_ps(meanBlue, blue)));
+        }
+        __m128i q = _mm_cvtps_epi32(mean);
+        q = _mm_packs_epi32(q, q);
+        out[x] = static_cast<uint32_t>(_mm_cvtsi128_si32(_mm_packus_epi16(q, q)));
+#else
+        float mean[4], meanRed[4], meanBlue[4];
+        BoxMean(a, b, xa, xb, step.reciprocal, mean);
+        if (s > 0) {
+            BoxMean(a, b, xa + s, xb + s, step.reciprocal, meanRed);
+            BoxMean(a, b, xa - s, xb - s, step.reciprocal, meanBlue);
+            mean[0] = meanRed[0];
+            mean[2] = meanBlue[2];
+        }
+        uint32_t pixel = 0;
+        for (int c = 0; c < 4; ++c) {
+            int value = static_cast<int>(mean[c] + 0.5f);
+            pixel |= static_cast<uint32_t>(value > 255 ? 255 : value) << (8 * c);
+        }
+        out[x] = pixel;
+#endif
+    }
+}
+
+void DepthOfField(const ImagePlane<const uint32_t>& frame, const ImagePlane<const uint8_t>& depth,
+    const DepthOfFieldParams& params, const ImagePlane<uint32_t>& out) {
+    int width = frame.width, height = frame.height;
+    if (width <= 0 || height <= 0) return;
+    int maxRadius = params.maxRadius < 0 ? 0 : (params.maxRadius > MAX_DOF_RADIUS ? MAX_DOF_RADIUS : params.maxRadius);
+    int maxShift = static_cast<int>(std::lround(params.separation));
+    maxShift = maxShift < 0 ? 0 : (maxShift > MAX_DOF_SEPARATION ? MAX_DOF_SEPARATION : maxShift);
+    if (maxRadius == 0 && maxShift == 0) {
+        for (int y = 0; y < height; ++y) memcpy(out.Row(y), frame.Row(y), sizeof(uint32_t) * width);
+        return;
+    }
+    FocusStep steps[256];
+    BuildFocusSteps(params, maxRadius, maxShift, steps);
+    int pad = maxRadius + maxShift;
+
+    FrameArena& arena = FrameArena::ThreadArena();
+    FrameArena::Scope scope(arena);
+    ParallelFor(0, height, [&](int first, int last) {
+        // Ring of table rows over the frame extended by maxRadius rows each side, edge rows
+        // repeated. Each is built just ahead of the output row that first reaches it and
+        // dropped once no later row does, so it is read back while still cached.
+        int ringSize = 2 * maxRadius + 2;
+        size_t stride = (static_cast<size_t>(width) + 2 * pad + 1) * 4;
+        uint32_t* ring = arena.AllocateArray<uint32_t>(stride * ringSize);
+        memset(ring, 0, sizeof(uint32_t) * stride * ringSize);
+        const uint32_t** window = arena.AllocateArray<const uint32_t*>(ringSize);
+        // Table row t sums the extended rows [first - maxRadius, t)
+        int top = first - maxRadius;
+        int built = top;
+        for (int y = first; y < last; ++y) {
+            for (; built <= y + maxRadius; ++built) {
+                int source = built < 0 ? 0 : (built >= height ? height - 1 : built);
+                const uint32_t* above = &ring[((built - top) % ringSize) * stride];
+                AccumulateTableRow(frame.Row(source), width, pad, above, &ring[((built + 1 - top) % ringSize) * stride]);
+            }
+            for (int k = 0; k < ringSize; ++k) window[k] = &ring[((y - maxRadius + k - top) % ringSize) * stride];
+            FocusRow(frame.Row(y), depth.Row(y), width, pad, window + maxRadius, steps, out.Row(y));
+        }
+    });
+}
@@ -0,0 +1,30 @@
+#pragma once
+#include <cstdint>
+#include "CpuImage.h"
+
+// Depth of field and chromatic separation for the captured frame, ahead of view
+// synthesis. Every pixel becomes the mean of a box around it whose radius grows with the
+// pixel's distance from the focal depth, so content on the screen plane stays sharp while
+// content in front of or behind it softens. Box means come from a summed-area table, four
+// lookups whatever the radius. The table is built per band of rows plus a halo of the
+// largest radius, so it takes a few MB per thread rather than 16 bytes per screen pixel.
+//
+// Chromatic separation reads red from a box shifted one way and blue from a box shifted
+// the other, by up to 'separation' pixels, also growing away from the focal depth. It
+// uses the same table and costs eight more lookups per pixel.
+
+const int MAX_DOF_RADIUS = 32;
+const int MAX_DOF_SEPARATION = 32;
+
+// Radius the tray menu switches to
+const int DEFAULT_DOF_RADIUS = 6;
+
+struct DepthOfFieldParams {
+    int maxRadius;      // box radius at the depth farthest from focus, 0..MAX_DOF_RADIUS; 0 = no blur
+    float separation;   // red/blue shift at that depth in pixels, 0..MAX_DOF_SEPARATION (color_separation); 0 = off
+    int focus;          // depth that stays sharp, normally the view convergence depth
+};
+
+// 'out' has the frame's size and must not overlap it. Parallel across rows.
+void DepthOfField(const ImagePlane<const uint32_t>& frame, const ImagePlane<const uint8_t>& depth,
+    const DepthOfFieldParams& params, const ImagePlane<uint32_t>& out);
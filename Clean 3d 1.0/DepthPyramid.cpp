@@ -0,0 +1,98 @@
+#include "DepthPyramid.h"
+#include "ParallelFor.h"
+
+// One row of the next level: min and max over 2x2 blocks of rows a and b. The last column
+// repeats when the source width is odd.
+static void ReduceRow(const uint8_t* minA, const uint8_t* minB, const uint8_t* maxA, const uint8_t* maxB,
+    int srcWidth, uint8_t* outMin, uint8_t* outMax, int width) {
+    int x = 0;
+#ifdef CLEAN3D_SSE2
+    const __m128i lowBytes = _mm_set1_epi16(0xFF);
+    for (; 2 * x + 16 <= srcWidth; x += 8) {
+        __m128i lo = _mm_min_epu8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(minA + 2 * x)),
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(minB + 2 * x)));
+        __m128i hi = _mm_max_epu8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(maxA + 2 * x)),
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(maxB + 2 * x)));
+        // Horizontal pairs: even bytes against odd bytes, per 16-bit lane
+        lo = _mm_min_epi16(_mm_and_si128(lo, lowBytes), _mm_srli_epi16(lo, 8));
+        hi = _mm_max_epi16(_mm_and_si128(hi, lowBytes), _mm_srli_epi16(hi, 8));
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(outMin + x), _mm_packus_epi16(lo, lo));
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(outMax + x), _mm_packus_epi16(hi, hi));
+    }
+#endif
+    for (; x < width; ++x) {
+        int x0 = 2 * x;
+        int x1 = x0 + 1 < srcWidth ? x0 + 1 : srcWidth - 1;
+        uint8_t lo = minA[x0] < minA[x1] ? minA[x0] : minA[x1];
+        uint8_t loB = minB[x0] < minB[x1] ? minB[x0] : minB[x1];
+        uint8_t hi = maxA[x0] > maxA[x1] ? maxA[x0] : maxA[x1];
+        uint8_t hiB = maxB[x0] > maxB[x1] ? maxB[x0] : maxB[x1];
+        outMin[x] = lo < loB ? lo : loB;
+        outMax[x] = hi > hiB ? hi : hiB;
+    }
+}
+
+DepthPyramid::DepthPyramid() : m_depth(), m_levelCount(0) {
+    for (int i = 0; i < MAX_DEPTH_PYRAMID_LEVELS; ++i) {
+        m_min[i] = ImagePlane<uint8_t>();
+        m_max[i] = ImagePlane<uint8_t>();
+    }
+}
+
+ImagePlane<const uint8_t> DepthPyramid::MinLevel(int level) const {
+    if (level <= 0 || m_levelCount <= 1) return m_depth;
+    const ImagePlane<uint8_t>& plane = m_min[level < m_levelCount ? level : m_levelCount - 1];
+    ImagePlane<const uint8_t> view = { plane.data, plane.width, plane.height, plane.pitch };
+    return view;
+}
+
+ImagePlane<const uint8_t> DepthPyramid::MaxLevel(int level) const {
+    if (level <= 0 || m_levelCount <= 1) return m_depth;
+    const ImagePlane<uint8_t>& plane = m_max[level < m_levelCount ? level : m_levelCount - 1];
+    ImagePlane<const uint8_t> view = { plane.data, plane.width, plane.height, plane.pitch };
+    return view;
+}
+
+void DepthPyramid::Build(const ImagePlane<const uint8_t>& depth) {
+    m_depth = depth;
+    m_levelCount = 1;
+    if (depth.width <= 0 || depth.height <= 0) return;
+
+    // Min and max planes of every level packed one after another, reallocated only when
+    // the depth size changes
+    size_t total = 0;
+    int width = depth.width, height = depth.height;
+    while ((width > 1 || height > 1) && m_levelCount < MAX_DEPTH_PYRAMID_LEVELS) {
+        width = (width + 1) / 2;
+        height = (height + 1) / 2;
+        ImagePlane<uint8_t> plane = { nullptr, width, height, static_cast<size_t>(width) };
+        m_min[m_levelCount] = plane;
+        m_max[m_levelCount] = plane;
+        total += 2 * static_cast<size_t>(width) * height;
+        m_levelCount++;
+    }
+    if (m_texels.size() != total) m_texels.assign(total, 0);
+    size_t offset = 0;
+    for (int level = 1; level < m_levelCount; ++level) {
+        size_t size = static_cast<size_t>(m_min[level].width) * m_min[level].height;
+        m_min[level].data = m_texels.data() + offset;
+        m_max[level].data = m_texels.data() + offset + size;
+        offset += 2 * size;
+    }
+
+    // Level 1 reads the whole depth plane and dominates; the rest shrink by four each,
+    // and the small ones are not worth starting threads for
+    for (int level = 1; level < m_levelCount; ++level) {
+        ImagePlane<const uint8_t> srcMin = MinLevel(level - 1);
+        ImagePlane<const uint8_t> srcMax = MaxLevel(level - 1);
+        const ImagePlane<uint8_t>& dstMin = m_min[level];
+        const ImagePlane<uint8_t>& dstMax = m_max[level];
+        ParallelFor(0, dstMin.height, [&](int first, int last) {
+            for (int y = first; y < last; ++y) {
+                int y1 = 2 * y + 1 < srcMin.height ? 2 * y + 1 : srcMin.height - 1;
+                ReduceRow(srcMin.Row(2 * y), srcMin.Row(y1), srcMax.Row(2 * y), srcMax.Row(y1), srcMin.width,
+                    dstMin.Row(y), dstMax.Row(y), dstMin.width);
+            }
+        }, dstMin.height >= 64 ? 0 : 1);
+    }
+}
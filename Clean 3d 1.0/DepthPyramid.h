@@ -0,0 +1,54 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include "CpuImage.h"
+
+// Min/max depth pyramid (Hi-Z) over a depth plane. Level k holds the smallest and the
+// largest depth of every 2^k x 2^k block, so a pass can learn what a whole tile holds
+// from one texel and skip the tiles where its per-pixel work cannot change anything.
+// Sizes round up and blocks cut by the edge repeat the last row and column, so every
+// depth pixel lies under exactly one texel of each level and the bounds are exact.
+
+const int MAX_DEPTH_PYRAMID_LEVELS = 16;
+
+// Tile size, as a level, that FogScatterTiles and Clean3dBench classify at: 16x16
+const int DEPTH_TILE_LEVEL = 4;
+
+enum DepthTileClass {
+    DepthTileEmpty,     // every pixel at depth 0: the fog march stops before its first step
+    DepthTileUniform,   // one depth throughout: per-pixel results are one value, and with
+                        // depth following luminance (DepthEstimation.h) there is no edge
+                        // for the outline to find inside the tile
+    DepthTileMixed
+};
+
+inline DepthTileClass ClassifyDepthTile(uint8_t minDepth, uint8_t maxDepth) {
+    if (maxDepth == 0) return DepthTileEmpty;
+    return minDepth == maxDepth ? DepthTileUniform : DepthTileMixed;
+}
+
+class DepthPyramid {
+public:
+    DepthPyramid();
+
+    // Rebuilds every level from 'depth', which becomes level 0 and is not copied: it must
+    // stay valid as long as level 0 is read. Parallel across rows.
+    void Build(const ImagePlane<const uint8_t>& depth);
+
+    // Levels down to a single texel, level 0 included
+    int LevelCount() const { return m_levelCount; }
+    ImagePlane<const uint8_t> MinLevel(int level) const;
+    ImagePlane<const uint8_t> MaxLevel(int level) const;
+
+    // Class of texel (x, y) of 'level', the 2^level tile at (x << level, y << level)
+    DepthTileClass Classify(int level, int x, int y) const {
+        return ClassifyDepthTile(MinLevel(level).Row(y)[x], MaxLevel(level).Row(y)[x]);
+    }
+
+private:
+    ImagePlane<const uint8_t> m_depth;
+    ImagePlane<uint8_t> m_min[MAX_DEPTH_PYRAMID_LEVELS];   // [0] unused
+    ImagePlane<uint8_t> m_max[MAX_DEPTH_PYRAMID_LEVELS];
+    std::vector<uint8_t> m_texels;
+    int m_levelCount;
+};
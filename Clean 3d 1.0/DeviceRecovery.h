@@ -0,0 +1,132 @@
+#pragma once
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+
+// Device-loss recovery state machine. It knows nothing about D3D: the renderer
+// implements IRecoverableDevice, and a mock implementation can inject
+// DXGI_ERROR_DEVICE_REMOVED and failing rebuild steps to drive every path.
+
+// HRESULT values the machine distinguishes, duplicated here so it builds without DXGI headers
+const int32_t RECOVERY_HR_DEVICE_REMOVED = static_cast<int32_t>(0x887A0005); // DXGI_ERROR_DEVICE_REMOVED
+const int32_t RECOVERY_HR_DEVICE_HUNG = static_cast<int32_t>(0x887A0006);    // DXGI_ERROR_DEVICE_HUNG
+const int32_t RECOVERY_HR_DEVICE_RESET = static_cast<int32_t>(0x887A0007);   // DXGI_ERROR_DEVICE_RESET
+const int32_t RECOVERY_HR_DRIVER_ERROR = static_cast<int32_t>(0x887A0020);   // DXGI_ERROR_DRIVER_INTERNAL_ERROR
+
+class IRecoverableDevice {
+public:
+    virtual ~IRecoverableDevice() {}
+    // Release only objects owned by the lost device. Config, compiled bytecode and
+    // the capture path are kept.
+    virtual void ReleaseDeviceObjects() = 0;
+    // Recreate device-dependent objects from the retained state.
+    virtual bool RebuildDeviceObjects() = 0;
+    // Re-prime GPU-side caches (screen texture, constant buffers) from the last
+    // CPU-side frame so the first frame after recovery is not blank.
+    virtual bool RestoreWarmState() = 0;
+    // Tear down and recreate everything, including the capture path. Used when the
+    // incremental rebuild fails.
+    virtual bool RebuildEverything() = 0;
+};
+
+enum RecoveryState {
+    RecoveryHealthy,
+    RecoveryLost,      // last attempt failed, a retry is allowed
+    RecoveryFallback   // attempts exhausted, render the fallback frame only
+};
+
+enum RecoveryOutcome {
+    RecoveryIncremental,
+    RecoveryFull,
+    RecoveryFailed
+};
+
+struct RecoveryStats {
+    int attempts;
+    int incremental;
+    int full;
+    int failed;
+    double lastReleaseMs;
+    double lastRebuildMs;
+    double lastWarmMs;
+    double lastTotalMs;
+    double maxTotalMs;
+};
+
+class DeviceRecoveryMachine {
+public:
+    typedef std::function<double()> Clock; // milliseconds, monotonic
+
+    DeviceRecoveryMachine(IRecoverableDevice& device, int maxAttempts, Clock clock = Clock())
+        : m_device(device), m_maxAttempts(maxAttempts), m_clock(clock ? clock : SteadyClockMs),
+        m_state(RecoveryHealthy), m_stats() {}
+
+    static bool IsDeviceLost(int32_t hr) {
+        return hr == RECOVERY_HR_DEVICE_REMOVED || hr == RECOVERY_HR_DEVICE_HUNG ||
+            hr == RECOVERY_HR_DEVICE_RESET || hr == RECOVERY_HR_DRIVER_ERROR;
+    }
+
+    RecoveryState State() const { return m_state; }
+    const RecoveryStats& Stats() const { return m_stats; }
+
+    // Runs one recovery attempt: incremental rebuild first, full rebuild if that fails.
+    RecoveryOutcome Recover() {
+        if (m_state == RecoveryFallback) return RecoveryFailed;
+        m_stats.attempts++;
+        if (m_stats.attempts > m_maxAttempts) {
+            m_state = RecoveryFallback;
+            m_stats.failed++;
+            return RecoveryFailed;
+        }
+
+        double start = m_clock();
+        m_device.ReleaseDeviceObjects();
+        double released = m_clock();
+        bool rebuilt = m_device.RebuildDeviceObjects();
+        double rebuiltAt = m_clock();
+
+        RecoveryOutcome outcome = RecoveryIncremental;
+        if (rebuilt) {
+            // A cold screen texture is not fatal; the next capture fills it
+            m_device.RestoreWarmState();
+        }
+        else {
+            outcome = m_device.RebuildEverything() ? RecoveryFull : RecoveryFailed;
+        }
+        double end = m_clock();
+
+        m_stats.lastReleaseMs = released - start;
+        m_stats.lastRebuildMs = rebuiltAt - released;
+        m_stats.lastWarmMs = rebuilt ? end - rebuiltAt : 0.0;
+        m_stats.lastTotalMs = end - start;
+        if (m_stats.lastTotalMs > m_stats.maxTotalMs) m_stats.maxTotalMs = m_stats.lastTotalMs;
+
+        switch (outcome) {
+        case RecoveryIncremental: m_stats.incremental++; m_state = RecoveryHealthy; break;
+        case RecoveryFull: m_stats.full++; m_state = RecoveryHealthy; break;
+        case RecoveryFailed: m_stats.failed++; m_state = RecoveryLost; break;
+        }
+        return outcome;
+    }
+
+    size_t Format(char* buffer, size_t size, RecoveryOutcome outcome) const {
+        static const char* names[] = { "incremental", "full", "failed" };
+        int n = snprintf(buffer, size,
+            "Device recovery %s in %.2f ms (release %.2f, rebuild %.2f, warm %.2f); attempts %d, incremental %d, full %d, failed %d, worst %.2f ms\n",
+            names[outcome], m_stats.lastTotalMs, m_stats.lastReleaseMs, m_stats.lastRebuildMs, m_stats.lastWarmMs,
+            m_stats.attempts, m_stats.incremental, m_stats.full, m_stats.failed, m_stats.maxTotalMs);
+        return n > 0 ? static_cast<size_t>(n) : 0;
+    }
+
+private:
+    static double SteadyClockMs() {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    IRecoverableDevice& m_device;
+    int m_maxAttempts;
+    Clock m_clock;
+    RecoveryState m_state;
+    RecoveryStats m_stats;
+};
@@ -0,0 +1,76 @@
+#include "EdgeOutline.h"
+#include "ParallelFor.h"
+#include <cmath>
+
+static inline float Luminance(uint32_t px) {
+    return ((px & 0xFF) * 0.299f + ((px >> 8) & 0xFF) * 0.587f + ((px >> 16) & 0xFF) * 0.114f) * (1.0f / 255.0f);
+}
+
+int OutlineOffset(float widthPx) {
+    return static_cast<int>((widthPx > 1.0f ? widthPx : 1.0f) + 0.5f);
+}
+
+void OutlineEdgeRow(const ImagePlane<const uint32_t>& frame, int y, float widthPx, float influence, uint8_t* mask) {
+    int offset = OutlineOffset(widthPx);
+    int last = frame.width - 1;
+    const uint32_t* above = frame.Row(y - offset < 0 ? 0 : y - offset);
+    const uint32_t* row = frame.Row(y);
+    const uint32_t* below = frame.Row(y + offset > frame.height - 1 ? frame.height - 1 : y + offset);
+    float scale = influence * 0.01f;
+    for (int x = 0; x < frame.width; ++x) {
+        int left = x - offset < 0 ? 0 : x - offset;
+        int right = x + offset > last ? last : x + offset;
+        float c00 = Luminance(above[left]), c10 = Luminance(above[x]), c20 = Luminance(above[right]);
+        float c01 = Luminance(row[left]), c21 = Luminance(row[right]);
+        float c02 = Luminance(below[left]), c12 = Luminance(below[x]), c22 = Luminance(below[right]);
+        float gx = -c00 - 2.0f * c01 - c02 + c20 + 2.0f * c21 + c22;
+        float gy = -c00 - 2.0f * c10 - c20 + c02 + 2.0f * c12 + c22;
+        float edge = std::sqrt(gx * gx + gy * gy) * scale;
+        mask[x] = static_cast<uint8_t>((edge > 1.0f ? 1.0f : edge) * 255.0f + 0.5f);
+    }
+}
+
+void OutlineEdges(const ImagePlane<const uint32_t>& frame, float widthPx, float influence, const ImagePlane<uint8_t>& mask) {
+    ParallelFor(0, frame.height, [&](int first, int last) {
+        for (int y = first; y < last; ++y) OutlineEdgeRow(frame, y, widthPx, influence, mask.Row(y));
+    });
+}
+
+void OutlineEdgeLumaRow(const uint8_t* above, const uint8_t* row, const uint8_t* below, int width, int offset,
+    float influence, uint8_t* mask) {
+    int last = width - 1;
+    float scale = influence * 0.01f * (1.0f / 255.0f);
+    for (int x = 0; x < width; ++x) {
+        int left = x - offset < 0 ? 0 : x - offset;
+        int right = x + offset > last ? last : x + offset;
+        int gx = -above[left] - 2 * row[left] - below[left] + above[right] + 2 * row[right] + below[right];
+        int gy = -above[left] - 2 * above[x] - above[right] + below[left] + 2 * below[x] + below[right];
+        float edge = std::sqrt(static_cast<float>(gx * gx + gy * gy)) * scale;
+        mask[x] = static_cast<uint8_t>((edge > 1.0f ? 1.0f : edge) * 255.0f + 0.5f);
+    }
+}
+
+void BuildOutlineAlpha(float intensity, int* alpha) {
+    for (int edge = 0; edge < 256; ++edge) {
+        float t = (edge / 255.0f - 0.02f) / (0.8f - 0.02f);
+        t = t < 0.0f ? 0.0f : (t > 1.0f ? 1.0f : t);
+        alpha[edge] = static_cast<int>(t * t * (3.0f - 2.0f * t) * intensity * 0.6f * 256.0f + 0.5f);
+    }
+}
+
+void BlendOutlineRow(uint32_t* row, const uint8_t* mask, int width, const int* alpha, uint32_t color) {
+    for (int x = 0; x < width; ++x) {
+        uint32_t pixel = row[x] | 0xFF000000u;
+        int weight = alpha[mask[x]];
+        if (weight > 0) {
+            uint32_t blended = 0xFF000000u;
+            for (int shift = 0; shift < 24; shift += 8) {
+                int under = (pixel >> shift) & 0xFF;
+                int over = (color >> shift) & 0xFF;
+                blended |= static_cast<uint32_t>(under + (((over - under) * weight) >> 8)) << shift;
+            }
+            pixel = blended;
+        }
+        row[x] = pixel;
+    }
+}
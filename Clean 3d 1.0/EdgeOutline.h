@@ -0,0 +1,36 @@
+#pragma once
+#include <cstdint>
+#include "CpuImage.h"
+
+// CPU reference for the outline in PixelShader.hlsl: EdgeSobel's Sobel magnitude over
+// luminance, its taps outline_width pixels apart (at least 1), scaled by
+// edge_depth_influence * 0.01 and saturated to 8 bits before the shader's smoothstep.
+// Taps past the edge clamp as the sampler does; fractional widths take the nearest
+// pixel instead of a bilinear blend.
+
+// Texture reads per pixel in the shader. It also reads the centre, which carries no
+// weight; the reference skips it.
+const int OUTLINE_TAPS = 9;
+
+// Row y. 'mask' has the frame's width.
+void OutlineEdgeRow(const ImagePlane<const uint32_t>& frame, int y, float widthPx, float influence, uint8_t* mask);
+
+// Whole frame, parallel across rows. 'mask' has the frame's size.
+void OutlineEdges(const ImagePlane<const uint32_t>& frame, float widthPx, float influence, const ImagePlane<uint8_t>& mask);
+
+// Rows apart of the taps above and below for an outline width
+int OutlineOffset(float widthPx);
+
+// OutlineEdgeRow over 8-bit luma rows (EstimateDepthRow's), for passes that already have
+// it: 'above' and 'below' are the rows OutlineOffset away, clamped to the frame. Differs
+// from the float luminance by the luma's rounding.
+void OutlineEdgeLumaRow(const uint8_t* above, const uint8_t* row, const uint8_t* below, int width, int offset,
+    float influence, uint8_t* mask);
+
+// The shader's blend weight for each mask value: smoothstep(0.02, 0.8), times intensity
+// and its 0.6, in 8-bit fixed point. 'alpha' has 256 entries.
+void BuildOutlineAlpha(float intensity, int* alpha);
+
+// Blends 'color' (R8G8B8A8) over a row by the weight of each mask value and sets alpha
+// to opaque. The shader's hue cycling and gamma-correct blend are left out.
+void BlendOutlineRow(uint32_t* row, const uint8_t* mask, int width, const int* alpha, uint32_t color);
@@ -0,0 +1,240 @@
+#include "EffectGovernor.h"
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <string>
+#include <utility>
+
+static const char* EFFECT_COSTS_HEADER = "clean3d-effect-costs-v1";
+
+// Weight of a new frame in the measured averages
+static const double EFFECT_SMOOTHING = 2.0 / (EFFECT_SETTLE_FRAMES + 1);
+
+static const int EFFECT_TERMS = 6;
+
+// The model's terms for one configuration, in EffectCostModel order
+static void EffectTerms(const EffectSet& effects, int viewCount, double* terms) {
+    int interval = effects.depthInterval < 1 ? 1 : effects.depthInterval;
+    terms[0] = 1.0;
+    terms[1] = viewCount > 2 ? viewCount - 2 : 0;
+    terms[2] = 1.0 / interval;
+    terms[3] = effects.fogSteps > 0 ? 1.0 : 0.0;
+    terms[4] = effects.fogSteps;
+    terms[5] = effects.outlineTaps;
+}
+
+double EffectCostMs(const EffectCostModel& model, const EffectSet& effects, int viewCount, EffectDomain domain) {
+    double terms[EFFECT_TERMS];
+    EffectTerms(effects, viewCount, terms);
+    if (domain == EffectCpu) return model.baseMs * terms[0] + model.viewMs * terms[1] + model.depthMs * terms[2];
+    return model.fogMs * terms[3] + model.fogStepMs * terms[4] + model.outlineTapMs * terms[5];
+}
+
+bool FitEffectCostModel(const std::vector<EffectSample>& samples, EffectCostModel* model) {
+    if (!model) return false;
+    // Normal equations of the relative error: a point weighs by its inverse squared cost,
+    // or the fog points, a hundred times dearer than the rest, would bury the small terms
+    // in their noise. Solved by Gaussian elimination with partial pivoting.
+    double a[EFFECT_TERMS][EFFECT_TERMS + 1] = {};
+    for (const EffectSample& sample : samples) {
+        if (sample.msPerMegapixel <= 0.0) continue;
+        double terms[EFFECT_TERMS];
+        EffectTerms(sample.effects, sample.viewCount, terms);
+        double weight = 1.0 / (sample.msPerMegapixel * sample.msPerMegapixel);
+        for (int i = 0; i < EFFECT_TERMS; ++i) {
+            for (int j = 0; j < EFFECT_TERMS; ++j) a[i][j] += weight * terms[i] * terms[j];
+            a[i][EFFECT_TERMS] += weight * terms[i] * sample.msPerMegapixel;
+        }
+    }
+    for (int column = 0; column < EFFECT_TERMS; ++column) {
+        int pivot = column;
+        for (int row = column + 1; row < EFFECT_TERMS; ++row) {
+            if (std::fabs(a[row][column]) > std::fabs(a[pivot][column])) pivot = row;
+        }
+        if (std::fabs(a[pivot][column]) < 1e-9) return false;
+        for (int j = 0; j <= EFFECT_TERMS; ++j) std::swap(a[column][j], a[pivot][j]);
+        for (int row = 0; row < EFFECT_TERMS; ++row) {
+            if (row == column) continue;
+            double factor = a[row][column] / a[column][column];
+            for (int j = column; j <= EFFECT_TERMS; ++j) a[row][j] -= factor * a[column][j];
+        }
+    }
+    double fitted[EFFECT_TERMS];
+    for (int i = 0; i < EFFECT_TERMS; ++i) {
+        double value = a[i][EFFECT_TERMS] / a[i][i];
+        fitted[i] = value > 0.0 ? value : 0.0;
+    }
+    EffectCostModel result = { fitted[0], fitted[1], fitted[2], fitted[3], fitted[4], fitted[5] };
+    *model = result;
+    return true;
+}
+
+bool LoadEffectCostModel(const char* path, EffectCostModel* model) {
+    if (!path || !model) return false;
+    std::ifstream file(path);
+    if (!file) return false;
+
+    std::string line;
+    if (!std::getline(file, line) || line != EFFECT_COSTS_HEADER) return false;
+
+    EffectCostModel loaded = {};
+    int fields = 0;
+    while (std::getline(file, line)) {
+        size_t eq = line.find('=');
+        if (eq == std::string::npos) continue;
+        std::string key = line.substr(0, eq);
+        double value = std::strtod(line.c_str() + eq + 1, nullptr);
+        if (key == "base_ms") { loaded.baseMs = value; fields |= 1; }
+        else if (key == "view_ms") { loaded.viewMs = value; fields |= 2; }
+        else if (key == "depth_ms") { loaded.depthMs = value; fields |= 4; }
+        else if (key == "fog_ms") { loaded.fogMs = value; fields |= 8; }
+        else if (key == "fog_step_ms") { loaded.fogStepMs = value; fields |= 16; }
+        else if (key == "outline_tap_ms") { loaded.outlineTapMs = value; fields |= 32; }
+    }
+    if (fields != 63) return false;
+    *model = loaded;
+    return true;
+}
+
+bool SaveEffectCostModel(const char* path, const EffectCostModel& model) {
+    if (!path) return false;
+    std::ofstream file(path, std::ios::trunc);
+    if (!file) return false;
+    char buffer[256];
+    snprintf(buffer, sizeof(buffer), "%s\nbase_ms=%.4f\nview_ms=%.4f\ndepth_ms=%.4f\nfog_ms=%.4f\nfog_step_ms=%.4f\noutline_tap_ms=%.4f\n",
+        EFFECT_COSTS_HEADER, model.baseMs, model.viewMs, model.depthMs, model.fogMs, model.fogStepMs, model.outlineTapMs);
+    file << buffer;
+    return static_cast<bool>(file);
+}
+
+EffectGovernor::EffectGovernor() : m_model(DEFAULT_EFFECT_COSTS), m_megapixels(0.0), m_viewCount(2) {
+    for (int d = 0; d < EFFECT_DOMAIN_COUNT; ++d) m_budgetMs[d] = 0.0;
+    // Matches no request, so this one builds the ladder
+    EffectSet invalid = { -1, -1, -1 };
+    m_requested = invalid;
+    EffectSet none = { 0, 0, 1 };
+    SetRequested(none);
+}
+
+void EffectGovernor::SetModel(const EffectCostModel& model, double megapixels, int viewCount) {
+    m_model = model;
+    m_megapixels = megapixels;
+    m_viewCount = viewCount;
+}
+
+void EffectGovernor::SetRequested(const EffectSet& effects) {
+    EffectSet requested = effects;
+    requested.fogSteps = requested.fogSteps < 0 ? 0 : requested.fogSteps;
+    requested.outlineTaps = requested.outlineTaps < 0 ? 0 : requested.outlineTaps;
+    requested.depthInterval = requested.depthInterval < 1 ? 1 : requested.depthInterval;
+    if (SameEffects(requested, m_requested)) return;
+    m_requested = requested;
+
+    // Each effect's settings, richest first
+    std::vector<int> fogSteps(1, requested.fogSteps);
+    while (fogSteps.back() > EFFECT_MIN_FOG_STEPS) {
+        int steps = fogSteps.back() - EFFECT_FOG_STEP_DROP;
+        fogSteps.push_back(steps < EFFECT_MIN_FOG_STEPS ? EFFECT_MIN_FOG_STEPS : steps);
+    }
+    if (fogSteps.back() > 0) fogSteps.push_back(0);
+    std::vector<int> outlineTaps(1, requested.outlineTaps);
+    if (requested.outlineTaps > 0) outlineTaps.push_back(0);
+    std::vector<int> depthIntervals(1, requested.depthInterval);
+    while (depthIntervals.back() < EFFECT_MAX_DEPTH_INTERVAL) depthIntervals.push_back(depthIntervals.back() * 2);
+
+    // Ranked by the depth interval, then the outline, then the fog
+    m_mixes.clear();
+    for (int interval : depthIntervals) {
+        for (int taps : outlineTaps) {
+            for (int steps : fogSteps) {
+                EffectSet mix = { steps, taps, interval };
+                m_mixes.push_back(mix);
+            }
+        }
+    }
+
+    m_mix = 0;
+    for (int d = 0; d < EFFECT_DOMAIN_COUNT; ++d) {
+        m_averageMs[d] = 0.0;
+        m_gain[d] = 0.0;
+        m_beforeMs[d] = 0.0;
+    }
+    m_beforeMix = -1;
+    m_samples = 0;
+}
+
+double EffectGovernor::ModelMs(int mix, EffectDomain domain) const {
+    return EffectCostMs(m_model, m_mixes[mix], m_viewCount, domain) * m_megapixels;
+}
+
+double EffectGovernor::PredictMs(int mix, EffectDomain domain) const {
+    return m_averageMs[domain] + m_gain[domain] * (ModelMs(mix, domain) - ModelMs(m_mix, domain));
+}
+
+bool EffectGovernor::Acceptable(int mix, const double* floorMs) const {
+    for (int d = 0; d < EFFECT_DOMAIN_COUNT; ++d) {
+        if (m_budgetMs[d] <= 0.0) continue;
+        double predicted = PredictMs(mix, static_cast<EffectDomain>(d));
+        if (predicted <= floorMs[d] + 1e-9) continue;
+        // Spending more needs the margin; spending the same or less only has to fit
+        double limit = predicted > m_averageMs[d] + 1e-9 ? m_budgetMs[d] * EFFECT_RESTORE_FRACTION : m_budgetMs[d];
+        if (predicted > limit) return false;
+    }
+    return true;
+}
+
+void EffectGovernor::ChangeMix(int mix) {
+    for (int d = 0; d < EFFECT_DOMAIN_COUNT; ++d) {
+        m_beforeMs[d] = m_averageMs[d];
+        // Stands in for the new mix's average until its first frame
+        m_averageMs[d] = PredictMs(mix, static_cast<EffectDomain>(d));
+    }
+    m_beforeMix = m_mix;
+    m_mix = mix;
+    m_samples = 0;
+}
+
+bool EffectGovernor::Update(double cpuMs, double gpuMs) {
+    double measured[EFFECT_DOMAIN_COUNT] = { cpuMs, gpuMs };
+    for (int d = 0; d < EFFECT_DOMAIN_COUNT; ++d) {
+        if (m_samples == 0) m_averageMs[d] = measured[d];
+        else m_averageMs[d] += (measured[d] - m_averageMs[d]) * EFFECT_SMOOTHING;
+    }
+    if (++m_samples < EFFECT_SETTLE_FRAMES) return false;
+
+    if (m_samples == EFFECT_SETTLE_FRAMES) {
+        // Settled on this mix: calibrate each domain's gain
+        for (int d = 0; d < EFFECT_DOMAIN_COUNT; ++d) {
+            EffectDomain domain = static_cast<EffectDomain>(d);
+            double model = ModelMs(m_mix, domain);
+            if (m_beforeMix >= 0) {
+                double modelChange = model - ModelMs(m_beforeMix, domain);
+                double measuredChange = m_averageMs[d] - m_beforeMs[d];
+                if (std::fabs(modelChange) > 1e-6 && measuredChange / modelChange > 0.0) m_gain[d] = measuredChange / modelChange;
+            }
+            else if (m_gain[d] == 0.0 && model > 0.0) {
+                m_gain[d] = m_averageMs[d] / model;
+            }
+        }
+        m_beforeMix = -1;
+    }
+
+    // The cheapest each domain can get; a domain that cannot fit its budget is held there
+    int count = static_cast<int>(m_mixes.size());
+    double floorMs[EFFECT_DOMAIN_COUNT];
+    for (int d = 0; d < EFFECT_DOMAIN_COUNT; ++d) {
+        floorMs[d] = m_averageMs[d];
+        for (int mix = 0; mix < count; ++mix) {
+            double predicted = PredictMs(mix, static_cast<EffectDomain>(d));
+            floorMs[d] = predicted < floorMs[d] ? predicted : floorMs[d];
+        }
+    }
+    for (int mix = 0; mix < count; ++mix) {
+        if (!Acceptable(mix, floorMs)) continue;
+        if (mix == m_mix) return false;
+        ChangeMix(mix);
+        return true;
+    }
+    return false;
+}
@@ -0,0 +1,121 @@
+#pragma once
+#include <vector>
+
+// Effects shed under load, most expendable first: the fog march loses steps one
+// processing_quality level (EFFECT_FOG_STEP_DROP steps) at a time, then the fog goes;
+// then the outline's taps go; then the temporal depth pass refreshes its rows over twice
+// as many frames, up to EFFECT_MAX_DEPTH_INTERVAL. EffectGovernor ranks every mix of
+// these below what the config asks for, a later effect's loss weighing more than any
+// loss of an earlier one, and grants the richest mix that fits what is left of the
+// budget once ResolutionController has scaled its stages. Fog and outline are GPU work
+// and the depth pass CPU work, so a CPU overload sheds depth passes and keeps the fog.
+//
+// Costs come from EffectCostModel, fitted offline by Clean3dBench --sweep from the CPU
+// references of the passes. The model ranks the mixes by cost; a gain per domain turns
+// model milliseconds into measured ones. It starts as measured over modelled, as if the
+// model covered all of the domain's work, and is re-fitted from the measured change in
+// cost around every change of mix.
+
+// Steps per processing_quality level (FogStepCount); never below its 8-step floor
+const int EFFECT_FOG_STEP_DROP = 4;
+const int EFFECT_MIN_FOG_STEPS = 8;
+
+const int EFFECT_MAX_DEPTH_INTERVAL = 8;
+
+// Frames after a change before the next; also the span of the measured averages
+const int EFFECT_SETTLE_FRAMES = 60;
+
+// A richer mix is taken only if every domain's prediction stays under this share of its budget
+const float EFFECT_RESTORE_FRACTION = 0.8f;
+
+struct EffectSet {
+    int fogSteps;        // 0 = fog off, else steps per march (FogStepCount)
+    int outlineTaps;     // 0 = outline off, else OUTLINE_TAPS (EdgeOutline.h)
+    int depthInterval;   // depth rows refreshed 1 in this many per frame (TemporalDepth), 1 = all
+};
+
+inline bool SameEffects(const EffectSet& a, const EffectSet& b) {
+    return a.fogSteps == b.fogSteps && a.outlineTaps == b.outlineTaps && a.depthInterval == b.depthInterval;
+}
+
+enum EffectDomain {
+    EffectCpu,    // a capture thread: depth and view synthesis
+    EffectGpu     // the command list: fog compute and the composite
+};
+
+const int EFFECT_DOMAIN_COUNT = 2;
+
+// Milliseconds per megapixel of each term
+struct EffectCostModel {
+    double baseMs;        // CPU: view synthesis for 2 views
+    double viewMs;        // CPU: each view past 2
+    double depthMs;       // CPU: the depth pass over every row; interval N costs depthMs / N
+    double fogMs;         // GPU: fog on, whatever its steps
+    double fogStepMs;     // GPU: each march step
+    double outlineTapMs;  // GPU: each outline tap
+};
+
+// Clean3dBench --sweep on one core of an x64 CPU, for when no fitted model is on disk. The
+// sweep's noise hid the depth term; its value is the bench's own TemporalDepth timing.
+const EffectCostModel DEFAULT_EFFECT_COSTS = { 15.7, 0.6, 1.4, 31.0, 3.9, 3.4 };
+
+// Cost of one domain's share of 'effects' at 'viewCount' views, per megapixel
+double EffectCostMs(const EffectCostModel& model, const EffectSet& effects, int viewCount, EffectDomain domain);
+
+// One configuration of the sweep and what its passes took
+struct EffectSample {
+    EffectSet effects;
+    int viewCount;
+    double msPerMegapixel;
+};
+
+// Least squares of the relative error over the samples, terms clamped to 0 and up. False
+// if the samples do not pin every term down.
+bool FitEffectCostModel(const std::vector<EffectSample>& samples, EffectCostModel* model);
+
+bool LoadEffectCostModel(const char* path, EffectCostModel* model);
+bool SaveEffectCostModel(const char* path, const EffectCostModel& model);
+
+class EffectGovernor {
+public:
+    EffectGovernor();
+
+    // The frame the effects run on
+    void SetModel(const EffectCostModel& model, double megapixels, int viewCount);
+
+    // What the effects may take per frame in a domain; 0 leaves the domain out
+    void SetBudget(EffectDomain domain, double ms) { m_budgetMs[domain] = ms; }
+
+    // What the config asks for. A change starts again from it, forgetting the measurements.
+    void SetRequested(const EffectSet& effects);
+
+    // Closes a frame run with Granted(): what it took in each domain, 0 where unmeasured.
+    // Returns true if Granted changed.
+    bool Update(double cpuMs, double gpuMs);
+
+    const EffectSet& Granted() const { return m_mixes[m_mix]; }
+    // Rank of Granted among the mixes, richest first; 0 is the requested set
+    int Rank() const { return m_mix; }
+    double MeasuredMs(EffectDomain domain) const { return m_averageMs[domain]; }
+
+private:
+    double ModelMs(int mix, EffectDomain domain) const;
+    double PredictMs(int mix, EffectDomain domain) const;
+    // Whether 'mix' may be granted: in every budgeted domain it fits the budget, with the
+    // restore margin if it spends more there than now, or costs no more than floorMs
+    bool Acceptable(int mix, const double* floorMs) const;
+    void ChangeMix(int mix);
+
+    EffectCostModel m_model;
+    double m_megapixels;
+    int m_viewCount;
+    EffectSet m_requested;
+    std::vector<EffectSet> m_mixes;           // richest first
+    int m_mix;
+    double m_budgetMs[EFFECT_DOMAIN_COUNT];
+    double m_averageMs[EFFECT_DOMAIN_COUNT];
+    double m_gain[EFFECT_DOMAIN_COUNT];       // measured ms per model ms, 0 until known
+    double m_beforeMs[EFFECT_DOMAIN_COUNT];   // average on the mix before the last change
+    int m_beforeMix;                          // -1 if there is nothing to fit
+    int m_samples;                            // since the last change
+};
@@ -0,0 +1,50 @@
+#include "FileFrameSource.h"
+#include <cstdio>
+#include <cstring>
+#include "FramePacer.h"
+
+FileFrameSource::FileFrameSource(const char* path, int width, int height, double intervalMs)
+    : m_path(path ? path : ""), m_width(width), m_height(height), m_intervalMs(intervalMs), m_frameCount(0), m_next(0),
+    m_nextDueMs(0.0) {
+    Reopen();
+}
+
+bool FileFrameSource::Reopen() {
+    m_pixels.clear();
+    m_frameCount = 0;
+    m_next = 0;
+    m_nextDueMs = 0.0;
+    size_t framePixels = static_cast<size_t>(m_width) * m_height;
+    if (framePixels == 0) return false;
+    FILE* file = fopen(m_path.c_str(), "rb");
+    if (!file) return false;
+    std::vector<uint32_t> frame(framePixels);
+    while (fread(frame.data(), sizeof(uint32_t), framePixels, file) == framePixels) {
+        m_pixels.insert(m_pixels.end(), frame.begin(), frame.end());
+        m_frameCount++;
+    }
+    fclose(file);
+    return m_frameCount > 0;
+}
+
+FrameStatus FileFrameSource::CaptureInto(int slot, uint32_t timeoutMs) {
+    if (m_frameCount == 0) return FrameLost;
+    if (slot < 0 || slot >= static_cast<int>(m_slots.size())) return FrameFailed;
+    const ImagePlane<uint32_t>& target = m_slots[slot];
+    if (target.width < m_width || target.height < m_height) return FrameFailed;
+    if (m_intervalMs > 0.0) {
+        double now = SteadyClockMs();
+        if (m_nextDueMs == 0.0) m_nextDueMs = now;
+        if (m_nextDueMs - now > timeoutMs) {
+            ThreadSleepMs(timeoutMs);
+            return FrameTimeout;
+        }
+        if (m_nextDueMs > now) ThreadSleepMs(m_nextDueMs - now);
+        // Like a display, a late frame does not make the next one early
+        m_nextDueMs = m_nextDueMs + m_intervalMs > now ? m_nextDueMs + m_intervalMs : now + m_intervalMs;
+    }
+    const uint32_t* source = m_pixels.data() + static_cast<size_t>(m_next) * m_width * m_height;
+    for (int y = 0; y < m_height; ++y) memcpy(target.Row(y), source + static_cast<size_t>(y) * m_width, m_width * sizeof(uint32_t));
+    m_next = (m_next + 1) % m_frameCount;
+    return FrameReady;
+}
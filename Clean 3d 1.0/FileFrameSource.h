@@ -0,0 +1,41 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "CpuImage.h"
+#include "FrameSource.h"
+
+// FrameSource over a file of raw captures, for headless runs: back-to-back R8G8B8A8
+// frames of one size with no header, as the bench reads a capture. The file is read
+// into memory when opened and its frames are handed out in a loop, at most one per
+// frame interval if one is set.
+//
+// The consumer tells the source where each slot lives with Bind; slots must be at
+// least the frame size.
+
+class FileFrameSource : public FrameSource {
+public:
+    // intervalMs = 0 hands out frames as fast as they are asked for
+    FileFrameSource(const char* path, int width, int height, double intervalMs = 0.0);
+
+    // False if the file could not be read or holds no whole frame
+    bool IsOpen() const { return m_frameCount > 0; }
+    int FrameCount() const { return m_frameCount; }
+
+    // Where slot i is written. Only while nothing is capturing.
+    void Bind(const std::vector<ImagePlane<uint32_t>>& slots) { m_slots = slots; }
+
+    FrameStatus CaptureInto(int slot, uint32_t timeoutMs) override;
+    bool Reopen() override;
+
+private:
+    std::string m_path;
+    int m_width;
+    int m_height;
+    double m_intervalMs;
+    std::vector<uint32_t> m_pixels;
+    int m_frameCount;
+    int m_next;
+    double m_nextDueMs;
+    std::vector<ImagePlane<uint32_t>> m_slots;
+};
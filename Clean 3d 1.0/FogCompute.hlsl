@@ -1,6 +1,7 @@
 #define THREAD_GROUP_SIZE_X 16
 #define THREAD_GROUP_SIZE_Y 16
 
+// GpuConfig in Main.cpp; the same declaration as PixelShader.hlsl, which shares the buffer
 cbuffer IllusionConfig : register(b0)
 {
     float depth_intensity;
@@ -17,8 +18,23 @@ cbuffer IllusionConfig : register(b0)
     float time;
     float occlusion_strength;
     float wiggle_frequency;
+
+    // Volumetric fog params
+    float fog_density;
+    float fog_color_r;
+    float fog_color_g;
+    float fog_color_b;
+    float fog_scatter;
+    float fog_anisotropy;
+    float fog_height_falloff;
+    float temporal_blend;
+
+    // New outline controls
+    float outline_width;
+    float outline_intensity;
     uint enable_parallax_barrier;
     uint enable_lenticular;
+    uint enable_volumetric_fog;
     float strip_width;
     float barrier_width;
     float lens_width;
@@ -26,15 +42,25 @@ cbuffer IllusionConfig : register(b0)
     float screen_width;
     float screen_height;
     float head_offset_x;
-    float fog_density;
-    float fog_color_r;
-    float fog_color_g;
-    float fog_color_b;
-    float fog_scatter;
-    uint enable_volumetric_fog;
-    uint enable_raytracing;
+
+    // Test pattern toggle
+    uint enable_test_pattern; // 0 = normal, 1 = test pattern
+
+    // Parallax-barrier specific controls
+    float barrier_opacity; // 0.0 = no darkening, 1.0 = full black
+    float pixel_pitch_mm; // physical pixel pitch in mm
+
+    // Software stripe controls (pixels)
+    float stripe_width_px;   // width of one stripe in pixels
+    float stripe_offset_px;  // horizontal offset of stripes in pixels
 };
 
+// FOG_VIEW_DISTANCE and FOG_MAX_ANISOTROPY in FogScatter.h
+static const float FOG_VIEW_DISTANCE = 1.0;
+static const float FOG_MAX_ANISOTROPY = 0.95;
+
+// Compiled, but not dispatched yet: Main.cpp creates no output texture or depth view for
+// it. FogScatter.cpp runs the same march on the CPU, for Clean3dBench only.
 Texture2D<float> DepthTexture : register(t0);
 RWTexture2D<float4> FogScatteringTexture : register(u0);
 SamplerState LinearSampler : register(s0);
@@ -44,16 +70,29 @@ void FogCSMain(uint3 dispatchThreadID : SV_DispatchThreadID)
 {
     uint2 pixelCoord = dispatchThreadID.xy;
     
+    // The fog texture may be smaller than the screen (ProcessingScale in
+    // ReducedResolution.h). Sampling at the texel centre averages the depth under it.
     uint width, height;
-    DepthTexture.GetDimensions(width, height);
+    FogScatteringTexture.GetDimensions(width, height);
     
     if (pixelCoord.x >= width || pixelCoord.y >= height)
         return;
 
-    float2 uv = float2(pixelCoord.x / (float) width, pixelCoord.y / (float) height);
+    float2 uv = (float2(pixelCoord) + 0.5) / float2(width, height);
     float depth = DepthTexture.SampleLevel(LinearSampler, uv, 0);
     float3 fog_color = float3(fog_color_r, fog_color_g, fog_color_b);
 
+    // Density thins with height above the bottom of the screen. Light leaves the screen
+    // toward a viewer one screen width in front of its centre; the Henyey-Greenstein phase
+    // weights the turn it takes to get there, times 4 pi so even fog weighs 1. As
+    // FogScatter.cpp, which also tabulates all of this (FogLut).
+    float density = fog_density * exp(-fog_height_falloff * (1.0 - uv.y));
+    float g = clamp(fog_anisotropy, -FOG_MAX_ANISOTROPY, FOG_MAX_ANISOTROPY);
+    float2 viewOffset = float2(uv.x - 0.5, (uv.y - 0.5) * float(height) / float(width));
+    float cosTheta = FOG_VIEW_DISTANCE * rsqrt(FOG_VIEW_DISTANCE * FOG_VIEW_DISTANCE + dot(viewOffset, viewOffset));
+    float phaseDenominator = 1.0 + g * g - 2.0 * g * cosTheta;
+    float phase = (1.0 - g * g) / (phaseDenominator * sqrt(phaseDenominator));
+
     float scatter = 0.0;
     int numSteps = clamp(8 + processing_quality * 4, 8, 24);
     float stepSize = 1.0 / numSteps;
@@ -72,9 +111,11 @@ void FogCSMain(uint3 dispatchThreadID : SV_DispatchThreadID)
         if (sampleDepth < pos.z)
             break;
 
-        scatter += fog_density * exp(-sampleDepth * 2.0) * stepSize;
+        // Light scattered at t is dimmed by the fog in front of it
+        scatter += density * exp(-sampleDepth * 2.0) * exp(-density * t) * stepSize;
         pos += lightDir * stepSize;
     }
 
+    scatter *= phase;
     FogScatteringTexture[pixelCoord] = float4(fog_color * fog_scatter * scatter, scatter);
 }
\ No newline at end of file
@@ -0,0 +1,181 @@
+#include "FogScatter.h"
+#include "ParallelFor.h"
+#include <cmath>
+#include <cstring>
+
+// What a row's fog shares whatever the depth
+struct FogRow {
+    float density;      // at the row's height
+    float anisotropy;   // clamped
+    float offsetY2;     // squared vertical view offset, screen widths^2
+    float widthInverse;
+    int steps;
+};
+
+static FogRow MakeFogRow(const FogParams& params, int y, int width, int height) {
+    FogRow row;
+    float v = (y + 0.5f) / height;
+    row.density = params.density * std::exp(-params.heightFalloff * (1.0f - v));
+    float g = params.anisotropy;
+    row.anisotropy = g < -FOG_MAX_ANISOTROPY ? -FOG_MAX_ANISOTROPY : (g > FOG_MAX_ANISOTROPY ? FOG_MAX_ANISOTROPY : g);
+    float offsetY = (v - 0.5f) * height / width;
+    row.offsetY2 = offsetY * offsetY;
+    row.widthInverse = 1.0f / width;
+    row.steps = params.stepCount < 1 ? 1 : params.stepCount;
+    return row;
+}
+
+static inline float ViewOffset2(const FogRow& row, int x) {
+    float offsetX = (x + 0.5f) * row.widthInverse - 0.5f;
+    return offsetX * offsetX + row.offsetY2;
+}
+
+// Henyey-Greenstein phase times 4 pi, for light leaving the screen straight toward the
+// viewer and turning to reach the viewer from a point 'offset2' away from the centre
+static float FogPhase(float g, float offset2) {
+    float cosTheta = FOG_VIEW_DISTANCE / std::sqrt(FOG_VIEW_DISTANCE * FOG_VIEW_DISTANCE + offset2);
+    float denominator = 1.0f + g * g - 2.0f * g * cosTheta;
+    return (1.0f - g * g) / (denominator * std::sqrt(denominator));
+}
+
+// Scatter summed along the march to depth d (0..1), before the phase
+static float FogMarch(float d, float density, int steps) {
+    float stepSize = 1.0f / steps;
+    float sum = 0.0f;
+    for (int i = 0; i < steps; ++i) {
+        float t = i * stepSize;
+        if (t >= d) break;
+        // The shader's occlusion test (sample depth < ray depth) cannot fire: the ray
+        // only moves away from the screen and the sample is this pixel's depth
+        sum += density * std::exp(-d * 2.0f) * std::exp(-density * t) * stepSize;
+    }
+    return sum;
+}
+
+static inline uint8_t FogByte(float value) {
+    return static_cast<uint8_t>((value > 1.0f ? 1.0f : value) * 255.0f + 0.5f);
+}
+
+static void FogScatterSpan(const uint8_t* depth, int first, int last, const FogRow& row, uint8_t* scatter) {
+    for (int x = first; x < last; ++x) {
+        float march = FogMarch(depth[x] * (1.0f / 255.0f), row.density, row.steps);
+        scatter[x] = FogByte(march * FogPhase(row.anisotropy, ViewOffset2(row, x)));
+    }
+}
+
+void FogScatterRow(const uint8_t* depth, int width, int y, int height, const FogParams& params, uint8_t* scatter) {
+    FogScatterSpan(depth, 0, width, MakeFogRow(params, y, width, height), scatter);
+}
+
+void FogScatter(const ImagePlane<const uint8_t>& depth, const FogParams& params, const ImagePlane<uint8_t>& scatter) {
+    ParallelFor(0, depth.height, [&](int first, int last) {
+        for (int y = first; y < last; ++y) FogScatterRow(depth.Row(y), depth.width, y, depth.height, params, scatter.Row(y));
+    });
+}
+
+void FogScatterTiles(const ImagePlane<const uint8_t>& depth, const DepthPyramid& pyramid, const FogParams& params,
+    const ImagePlane<uint8_t>& scatter) {
+    int level = DEPTH_TILE_LEVEL < pyramid.LevelCount() ? DEPTH_TILE_LEVEL : pyramid.LevelCount() - 1;
+    int tile = 1 << level;
+    ImagePlane<const uint8_t> minLevel = pyramid.MinLevel(level);
+    ImagePlane<const uint8_t> maxLevel = pyramid.MaxLevel(level);
+    ParallelFor(0, minLevel.height, [&](int first, int last) {
+        for (int ty = first; ty < last; ++ty) {
+            int y0 = ty * tile;
+            int y1 = y0 + tile < depth.height ? y0 + tile : depth.height;
+            for (int y = y0; y < y1; ++y) {
+                FogRow row = MakeFogRow(params, y, depth.width, depth.height);
+                const uint8_t* depthRow = depth.Row(y);
+                uint8_t* scatterRow = scatter.Row(y);
+                for (int tx = 0; tx < minLevel.width; ++tx) {
+                    int x0 = tx * tile;
+                    int x1 = x0 + tile < depth.width ? x0 + tile : depth.width;
+                    uint8_t minDepth = minLevel.Row(ty)[tx];
+                    DepthTileClass tileClass = ClassifyDepthTile(minDepth, maxLevel.Row(ty)[tx]);
+                    if (tileClass == DepthTileEmpty) {
+                        memset(scatterRow + x0, 0, x1 - x0);
+                    }
+                    else if (tileClass == DepthTileUniform) {
+                        // Only the phase still varies across the tile
+                        float march = FogMarch(minDepth * (1.0f / 255.0f), row.density, row.steps);
+                        for (int x = x0; x < x1; ++x) scatterRow[x] = FogByte(march * FogPhase(row.anisotropy, ViewOffset2(row, x)));
+                    }
+                    else {
+                        FogScatterSpan(depthRow, x0, x1, row, scatterRow);
+                    }
+                }
+            }
+        }
+    });
+}
+
+FogLut::FogLut() : m_params(), m_built(false), m_densityScale(0.0f),
+    m_scatter(static_cast<size_t>(FOG_LUT_DENSITIES) * 256), m_transmittance(m_scatter.size()), m_phase(FOG_PHASE_ENTRIES) {
+}
+
+bool FogLut::Update(const FogParams& params) {
+    bool march = !m_built || params.density != m_params.density || params.stepCount != m_params.stepCount ||
+        params.heightFalloff != m_params.heightFalloff;
+    bool phase = !m_built || params.anisotropy != m_params.anisotropy;
+    if (!march && !phase) return false;
+    m_params = params;
+    m_built = true;
+
+    if (march) {
+        // Rows span 0 to the densest height: the bottom, or the top if density rises
+        float maxDensity = params.density * (params.heightFalloff < 0.0f ? std::exp(-params.heightFalloff) : 1.0f);
+        m_densityScale = maxDensity > 0.0f ? (FOG_LUT_DENSITIES - 1) / maxDensity : 0.0f;
+        int steps = params.stepCount < 1 ? 1 : params.stepCount;
+        for (int r = 0; r < FOG_LUT_DENSITIES; ++r) {
+            float density = maxDensity * r / (FOG_LUT_DENSITIES - 1);
+            for (int d = 0; d < 256; ++d) {
+                m_scatter[r * 256 + d] = FogMarch(d * (1.0f / 255.0f), density, steps);
+                m_transmittance[r * 256 + d] = std::exp(-density * d * (1.0f / 255.0f));
+            }
+        }
+    }
+    if (phase) {
+        FogRow row = MakeFogRow(params, 0, 1, 1);
+        for (int i = 0; i < FOG_PHASE_ENTRIES; ++i) {
+            m_phase[i] = FogPhase(row.anisotropy, static_cast<float>(i) / (FOG_PHASE_ENTRIES - 1));
+        }
+    }
+    return true;
+}
+
+void FogLut::ScatterRow(const uint8_t* depth, int width, int y, int height, uint8_t* scatter, uint8_t* transmittance) const {
+    FogRow row = MakeFogRow(m_params, y, width, height);
+    // The row's density falls between two table rows; blend them once for all its pixels
+    float position = row.density * m_densityScale;
+    int below = static_cast<int>(position);
+    below = below < 0 ? 0 : (below > FOG_LUT_DENSITIES - 2 ? FOG_LUT_DENSITIES - 2 : below);
+    float weight = position - below;
+    weight = weight < 0.0f ? 0.0f : (weight > 1.0f ? 1.0f : weight);
+    float rowScatter[256];
+    const float* lower = &m_scatter[below * 256];
+    const float* upper = lower + 256;
+    for (int d = 0; d < 256; ++d) rowScatter[d] = lower[d] + (upper[d] - lower[d]) * weight;
+
+    // The phase is steep near the centre when anisotropy nears its limit: interpolated
+    for (int x = 0; x < width; ++x) {
+        float entry = ViewOffset2(row, x) * (FOG_PHASE_ENTRIES - 1);
+        entry = entry < FOG_PHASE_ENTRIES - 1 ? entry : FOG_PHASE_ENTRIES - 1;
+        int i = static_cast<int>(entry);
+        i = i > FOG_PHASE_ENTRIES - 2 ? FOG_PHASE_ENTRIES - 2 : i;
+        float phase = m_phase[i] + (m_phase[i + 1] - m_phase[i]) * (entry - i);
+        scatter[x] = FogByte(rowScatter[depth[x]] * phase);
+    }
+    if (transmittance) {
+        uint8_t rowTransmittance[256];
+        const float* lowerT = &m_transmittance[below * 256];
+        const float* upperT = lowerT + 256;
+        for (int d = 0; d < 256; ++d) rowTransmittance[d] = FogByte(lowerT[d] + (upperT[d] - lowerT[d]) * weight);
+        for (int x = 0; x < width; ++x) transmittance[x] = rowTransmittance[depth[x]];
+    }
+}
+
+void FogLut::Scatter(const ImagePlane<const uint8_t>& depth, const ImagePlane<uint8_t>& scatter) const {
+    ParallelFor(0, depth.height, [&](int first, int last) {
+        for (int y = first; y < last; ++y) ScatterRow(depth.Row(y), depth.width, y, depth.height, scatter.Row(y), nullptr);
+    });
+}
@@ -0,0 +1,85 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include "CpuImage.h"
+#include "DepthPyramid.h"
+
+// CPU reference for FogCompute.hlsl: the scatter it writes to FogScatteringTexture.w,
+// computed from a depth plane. depth / 255 stands in for the shader's DepthTexture
+// sample. The march steps along the light direction, straight into the screen, so every
+// step samples the pixel's own depth; exp() is still taken per step, as the shader does.
+// Scatter is stored saturated to 8 bits, as PixelShader.hlsl blends it. Only Clean3dBench
+// runs this; the overlay has no CPU fog path.
+//
+// Density thins with height above the bottom of the screen (fog_height_falloff), and
+// light scattered at step t is dimmed by the fog in front of it, exp(-density * t). The
+// light comes out of the screen toward a viewer FOG_VIEW_DISTANCE screen widths in front
+// of its centre; a Henyey-Greenstein phase over fog_anisotropy weights the angle it turns
+// through, scaled so that even scattering (anisotropy 0) weighs 1.
+
+// Viewer distance from the screen centre, in screen widths
+const float FOG_VIEW_DISTANCE = 1.0f;
+
+// |anisotropy| is clamped here; the phase peaks at (1 + g) / (1 - g)^2
+const float FOG_MAX_ANISOTROPY = 0.95f;
+
+struct FogParams {
+    float density;          // fog_density
+    int stepCount;          // FogStepCount(processing_quality)
+    float anisotropy;       // fog_anisotropy: > 0 brightens fog toward the screen centre; 0 = even
+    float heightFalloff;    // fog_height_falloff: density * exp(-heightFalloff * height), height 0..1
+};
+
+// Steps per march for a processing_quality level, as FogCompute.hlsl picks them
+inline int FogStepCount(int processingQuality) {
+    int steps = 8 + processingQuality * 4;
+    return steps < 8 ? 8 : (steps > 24 ? 24 : steps);
+}
+
+// Row y of a plane 'height' rows high; 'width' is the plane's width.
+void FogScatterRow(const uint8_t* depth, int width, int y, int height, const FogParams& params, uint8_t* scatter);
+
+// Whole plane, parallel across rows. 'scatter' has the size of 'depth'.
+void FogScatter(const ImagePlane<const uint8_t>& depth, const FogParams& params, const ImagePlane<uint8_t>& scatter);
+
+// FogScatter over DEPTH_TILE_LEVEL tiles of 'pyramid', built from 'depth': empty tiles
+// are cleared without a march and uniform ones march once per row. Same output.
+void FogScatterTiles(const ImagePlane<const uint8_t>& depth, const DepthPyramid& pyramid, const FogParams& params,
+    const ImagePlane<uint8_t>& scatter);
+
+// Density rows of the FogLut tables, spanning 0 to the densest row of the screen
+const int FOG_LUT_DENSITIES = 64;
+
+// Phase table entries over the squared view offset from the screen centre, 0..1 screen
+// widths^2, read with linear interpolation
+const int FOG_PHASE_ENTRIES = 1024;
+
+// The same fog from lookup tables instead of a march: scatter and transmittance over
+// (depth, density), and the phase over the view offset for the current anisotropy.
+// A row blends the two density rows around its own density once, after which a pixel
+// costs one table read for its depth and two for its phase. The tables are rebuilt
+// only when the fog parameters change.
+class FogLut {
+public:
+    FogLut();
+
+    // Rebuilds the tables if 'params' differ from those they were built for. Returns
+    // whether it did.
+    bool Update(const FogParams& params);
+
+    // As FogScatterRow, for the parameters of the last Update. 'transmittance' is
+    // optional: exp(-density * depth / 255) to 8 bits, the share of the surface that shows
+    // through the fog.
+    void ScatterRow(const uint8_t* depth, int width, int y, int height, uint8_t* scatter, uint8_t* transmittance) const;
+
+    // Whole plane, parallel across rows
+    void Scatter(const ImagePlane<const uint8_t>& depth, const ImagePlane<uint8_t>& scatter) const;
+
+private:
+    FogParams m_params;
+    bool m_built;
+    float m_densityScale;                // density to table row
+    std::vector<float> m_scatter;        // FOG_LUT_DENSITIES rows of 256 depths
+    std::vector<float> m_transmittance;  // same layout
+    std::vector<float> m_phase;          // FOG_PHASE_ENTRIES
+};
@@ -0,0 +1,83 @@
+#include "FrameAccounting.h"
+#include <algorithm>
+
+FrameAccounting::FrameAccounting() {
+    Reset();
+}
+
+void FrameAccounting::Reset() {
+    FrameCounts none = {};
+    m_counts = none;
+    m_firstSequence = 0;
+    m_firstDesktopFrames = 0;
+    m_firstDesktopCaptures = 0;
+    m_lastSequence = 0;
+    for (int span = 0; span < FRAME_SPAN_COUNT; ++span) {
+        m_samples[span].assign(FRAME_ACCOUNTING_HISTORY, 0.0);
+        m_next[span] = 0;
+        m_filled[span] = 0;
+    }
+}
+
+void FrameAccounting::AddSample(FrameSpan span, double from, double to) {
+    // An unstamped end leaves the span out
+    if (from <= 0.0 || to <= 0.0) return;
+    m_samples[span][m_next[span]] = to - from;
+    m_next[span] = (m_next[span] + 1) % FRAME_ACCOUNTING_HISTORY;
+    if (m_filled[span] < FRAME_ACCOUNTING_HISTORY) m_filled[span]++;
+}
+
+void FrameAccounting::AddFrame(const FrameRecord& frame, bool fresh) {
+    if (frame.sequence == 0) return;
+    if (m_firstSequence == 0) {
+        // Counting starts at the first frame seen; what came before it is not ours
+        m_firstSequence = frame.sequence;
+        m_firstDesktopFrames = frame.desktopFrames;
+        m_firstDesktopCaptures = frame.desktopCaptures;
+        m_lastSequence = frame.sequence - 1;
+        fresh = true;
+    }
+    m_counts.presented++;
+    if (frame.sequence + 1 - m_firstSequence > m_counts.captured) m_counts.captured = frame.sequence + 1 - m_firstSequence;
+    m_counts.desktopFrames = frame.desktopFrames - m_firstDesktopFrames;
+    uint64_t desktopCaptures = frame.desktopCaptures - m_firstDesktopCaptures;
+    m_counts.desktopSkipped = m_counts.desktopFrames > desktopCaptures ? m_counts.desktopFrames - desktopCaptures : 0;
+
+    double origin = frame.desktopPresentMs > 0.0 ? frame.desktopPresentMs : frame.acquiredMs;
+    double shown = frame.gpuDoneMs > frame.presentedMs ? frame.gpuDoneMs : frame.presentedMs;
+    if (fresh && frame.sequence > m_lastSequence) {
+        m_counts.shown++;
+        m_counts.dropped += frame.sequence - m_lastSequence - 1;
+        m_lastSequence = frame.sequence;
+        AddSample(SpanAcquire, frame.desktopPresentMs, frame.acquiredMs);
+        AddSample(SpanProcess, frame.acquiredMs, frame.uploadedMs);
+        AddSample(SpanQueue, frame.uploadedMs, frame.presentedMs);
+        AddSample(SpanGpu, frame.presentedMs, frame.gpuDoneMs);
+        AddSample(SpanCapture, origin, shown);
+    }
+    else {
+        m_counts.reused++;
+    }
+    AddSample(SpanAge, origin, shown);
+}
+
+FrameCounts FrameAccounting::Counts() const {
+    return m_counts;
+}
+
+SpanStats FrameAccounting::Span(FrameSpan span) const {
+    SpanStats stats = {};
+    int count = m_filled[span];
+    if (count == 0) return stats;
+    std::vector<double> samples(m_samples[span].begin(), m_samples[span].begin() + count);
+    std::sort(samples.begin(), samples.end());
+    double sum = 0.0;
+    for (double sample : samples) sum += sample;
+    stats.samples = count;
+    stats.meanMs = sum / count;
+    stats.p50Ms = samples[(count - 1) * 50 / 100];
+    stats.p95Ms = samples[(count - 1) * 95 / 100];
+    stats.p99Ms = samples[(count - 1) * 99 / 100];
+    stats.maxMs = samples.back();
+    return stats;
+}
@@ -0,0 +1,80 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+// How stale the overlay is. Every capture carries a FrameRecord: its place in the
+// capture sequence and the desktop's, and timestamps from the desktop's own present to
+// the overlay's. The render thread hands each frame it presents to FrameAccounting,
+// which counts captures shown, dropped before they could be, and shown again for want
+// of a new one, and keeps the latest spans between the stamps as distributions.
+//
+// Stamps are milliseconds on one clock, whichever it is; 0 means not stamped.
+
+struct FrameRecord {
+    uint64_t sequence;         // captures on this output so far, this one included
+    uint64_t desktopFrames;    // desktop presents so far: the sum of AccumulatedFrames
+    uint64_t desktopCaptures;  // captures so far that carried a new desktop image
+    double desktopPresentMs;   // LastPresentTime, 0 if only the pointer moved
+    double acquiredMs;         // AcquireNextFrame returned
+    double uploadedMs;         // written into the upload slot
+    double gpuDoneMs;          // the command list that drew it finished
+    double presentedMs;        // Present returned
+};
+
+enum FrameSpan {
+    SpanAcquire,      // desktop present to acquire
+    SpanProcess,      // acquire to upload slot: copy, depth and view synthesis
+    SpanQueue,        // upload slot to Present: waiting for the render thread, and rendering
+    SpanGpu,          // Present to the GPU finishing
+    SpanCapture,      // desktop present (acquire if unknown) to the later of Present and the GPU
+    SpanAge           // the same for every frame shown, reused ones included
+};
+
+const int FRAME_SPAN_COUNT = 6;
+
+// Samples per span in the distributions
+const int FRAME_ACCOUNTING_HISTORY = 512;
+
+struct FrameCounts {
+    uint64_t presented;       // frames presented, fresh or reused
+    uint64_t captured;        // captures made, by the newest sequence seen
+    uint64_t shown;           // captures presented at least once
+    uint64_t reused;          // presents that repeated the last capture
+    uint64_t dropped;         // captures overwritten before they were presented
+    uint64_t desktopFrames;   // desktop presents while capturing
+    uint64_t desktopSkipped;  // desktop presents folded into a later capture (AccumulatedFrames > 1)
+};
+
+struct SpanStats {
+    int samples;
+    double meanMs;
+    double p50Ms;
+    double p95Ms;
+    double p99Ms;
+    double maxMs;
+};
+
+class FrameAccounting {
+public:
+    FrameAccounting();
+
+    void Reset();
+
+    // A presented frame; 'fresh' if this is the first time its capture is shown
+    void AddFrame(const FrameRecord& frame, bool fresh);
+
+    FrameCounts Counts() const;
+    SpanStats Span(FrameSpan span) const;
+
+private:
+    void AddSample(FrameSpan span, double from, double to);
+
+    FrameCounts m_counts;
+    uint64_t m_firstSequence;    // 0 before the first frame
+    uint64_t m_firstDesktopFrames;
+    uint64_t m_firstDesktopCaptures;
+    uint64_t m_lastSequence;     // of the last fresh frame
+    std::vector<double> m_samples[FRAME_SPAN_COUNT];   // rings of FRAME_ACCOUNTING_HISTORY
+    int m_next[FRAME_SPAN_COUNT];
+    int m_filled[FRAME_SPAN_COUNT];
+};
@@ -0,0 +1,152 @@
+#include "FrameMemory.h"
+#include <new>
+#ifdef __linux__
+#include <sys/mman.h>
+#endif
+
+FrameBuffer AllocateFrameBuffer(size_t bytes, bool hugePages) {
+    FrameBuffer buffer = { nullptr, bytes, false };
+    if (bytes == 0) return buffer;
+#ifdef __linux__
+    if (hugePages && bytes >= FRAME_HUGE_PAGE_BYTES) {
+        size_t mappedBytes = (bytes + FRAME_HUGE_PAGE_BYTES - 1) / FRAME_HUGE_PAGE_BYTES * FRAME_HUGE_PAGE_BYTES;
+        void* data = mmap(nullptr, mappedBytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (data == MAP_FAILED) {
+            // No reserved huge pages: ordinary pages the kernel may collapse into huge ones
+            data = mmap(nullptr, mappedBytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            if (data != MAP_FAILED) madvise(data, mappedBytes, MADV_HUGEPAGE);
+        }
+        if (data != MAP_FAILED) {
+            buffer.data = data;
+            buffer.mapped = true;
+            return buffer;
+        }
+    }
+#else
+    (void)hugePages;
+#endif
+    buffer.data = ::operator new(bytes, std::align_val_t(FRAME_ALIGNMENT), std::nothrow);
+    return buffer;
+}
+
+void FreeFrameBuffer(FrameBuffer& buffer) {
+    if (!buffer.data) return;
+#ifdef __linux__
+    if (buffer.mapped) {
+        munmap(buffer.data, (buffer.bytes + FRAME_HUGE_PAGE_BYTES - 1) / FRAME_HUGE_PAGE_BYTES * FRAME_HUGE_PAGE_BYTES);
+        buffer.data = nullptr;
+        return;
+    }
+#endif
+    ::operator delete(buffer.data, std::align_val_t(FRAME_ALIGNMENT));
+    buffer.data = nullptr;
+}
+
+FrameArena::FrameArena(size_t bytes, bool hugePages)
+    : m_hugePages(hugePages), m_used(0), m_highWater(0), m_depth(0), m_overflows(0) {
+    m_block = AllocateFrameBuffer(bytes, hugePages);
+    if (!m_block.data) m_block.bytes = 0;
+}
+
+FrameArena::~FrameArena() {
+    for (FrameBuffer& buffer : m_overflow) FreeFrameBuffer(buffer);
+    FreeFrameBuffer(m_block);
+}
+
+FrameArena& FrameArena::ThreadArena() {
+    static thread_local FrameArena arena;
+    return arena;
+}
+
+void* FrameArena::Allocate(size_t bytes, size_t alignment) {
+    // Every allocation is a whole number of FRAME_ALIGNMENT units from an aligned block,
+    // so each one starts aligned; larger alignments take the slack from the allocation
+    size_t slack = alignment > FRAME_ALIGNMENT ? alignment - FRAME_ALIGNMENT : 0;
+    size_t size = (bytes + slack + FRAME_ALIGNMENT - 1) / FRAME_ALIGNMENT * FRAME_ALIGNMENT;
+    if (size == 0) size = FRAME_ALIGNMENT;
+    size_t offset = m_used.fetch_add(size);
+    uint8_t* data;
+    if (offset + size <= m_block.bytes) {
+        data = static_cast<uint8_t*>(m_block.data) + offset;
+    }
+    else {
+        FrameBuffer buffer = AllocateFrameBuffer(size, m_hugePages);
+        if (!buffer.data) throw std::bad_alloc();
+        m_overflows++;
+        std::lock_guard<std::mutex> lock(m_overflowMutex);
+        m_overflow.push_back(buffer);
+        data = buffer.As<uint8_t>();
+    }
+    if (slack > 0) {
+        uintptr_t address = reinterpret_cast<uintptr_t>(data);
+        data += (alignment - address % alignment) % alignment;
+    }
+    return data;
+}
+
+void FrameArena::EndFrame() {
+    size_t used = m_used;
+    if (used > m_highWater) m_highWater = used;
+    if (!m_overflow.empty()) {
+        for (FrameBuffer& buffer : m_overflow) FreeFrameBuffer(buffer);
+        m_overflow.clear();
+    }
+    if (used > m_block.bytes) {
+        // One block big enough for the frame that outgrew this one
+        FreeFrameBuffer(m_block);
+        m_block = AllocateFrameBuffer(static_cast<size_t>(used * FRAME_ARENA_GROWTH), m_hugePages);
+        if (!m_block.data) m_block.bytes = 0;
+    }
+    m_used = 0;
+}
+
+FrameBufferPool::FrameBufferPool(size_t capacity, bool hugePages)
+    : m_capacity(capacity), m_hugePages(hugePages), m_hits(0), m_misses(0) {
+    m_idle.reserve(capacity + 1);
+}
+
+FrameBufferPool::~FrameBufferPool() {
+    Clear();
+}
+
+FrameBuffer FrameBufferPool::Acquire(size_t bytes) {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        // Newest first: the likeliest to still be in cache
+        for (size_t i = m_idle.size(); i-- > 0;) {
+            if (m_idle[i].bytes != bytes) continue;
+            FrameBuffer buffer = m_idle[i];
+            m_idle.erase(m_idle.begin() + i);
+            m_hits++;
+            return buffer;
+        }
+    }
+    m_misses++;
+    return AllocateFrameBuffer(bytes, m_hugePages);
+}
+
+void FrameBufferPool::Release(FrameBuffer& buffer) {
+    if (!buffer.data) return;
+    FrameBuffer evicted = { nullptr, 0, false };
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_idle.push_back(buffer);
+        if (m_idle.size() > m_capacity) {
+            evicted = m_idle.front();
+            m_idle.erase(m_idle.begin());
+        }
+    }
+    FreeFrameBuffer(evicted);
+    buffer.data = nullptr;
+}
+
+void FrameBufferPool::Clear() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (FrameBuffer& buffer : m_idle) FreeFrameBuffer(buffer);
+    m_idle.clear();
+}
+
+size_t FrameBufferPool::Idle() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_idle.size();
+}
@@ -0,0 +1,125 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+// Memory for the CPU passes that does not come from the heap once frames are steady.
+//
+// FrameArena hands out transient buffers (row scratch, intermediate planes) by bumping
+// an offset into one block, and takes them all back when the frame's outermost Scope
+// ends. A frame that needs more than the block gets the rest from the heap, and the
+// block grows to what that frame used, so after the first frames nothing is allocated.
+// Each thread has one (ThreadArena); a kernel takes its arena on the calling thread and
+// its ParallelFor pieces allocate from it on whichever thread runs them.
+//
+// FrameBufferPool keeps whole frame buffers by size, as SurfacePool does for textures,
+// so reallocating planes on a resolution change, or flipping back, reuses what is there.
+
+// Alignment of every arena allocation and pooled buffer: a cache line, and enough for any SIMD load
+const size_t FRAME_ALIGNMENT = 64;
+
+// Initial block of each thread's arena
+const size_t FRAME_ARENA_BYTES = 4 * 1024 * 1024;
+
+// Buffers this large or larger may be backed by huge pages
+const size_t FRAME_HUGE_PAGE_BYTES = 2 * 1024 * 1024;
+
+// Headroom over the frame that outgrew the arena when its block grows
+const double FRAME_ARENA_GROWTH = 1.25;
+
+struct FrameBuffer {
+    void* data;
+    size_t bytes;
+    bool mapped;     // from mmap, not the heap
+
+    template <typename T>
+    T* As() const { return static_cast<T*>(data); }
+};
+
+// FRAME_ALIGNMENT-aligned memory. With hugePages, on Linux, buffers of FRAME_HUGE_PAGE_BYTES
+// or more are mapped from the reserved huge pages (MAP_HUGETLB) if there are any, or
+// else mapped and marked for transparent huge pages (madvise MADV_HUGEPAGE). Elsewhere,
+// and for smaller buffers, they come from aligned operator new. data is null on failure.
+FrameBuffer AllocateFrameBuffer(size_t bytes, bool hugePages);
+void FreeFrameBuffer(FrameBuffer& buffer);
+
+class FrameArena {
+public:
+    explicit FrameArena(size_t bytes = FRAME_ARENA_BYTES, bool hugePages = false);
+    ~FrameArena();
+
+    // The calling thread's arena, created on first use
+    static FrameArena& ThreadArena();
+
+    // Everything allocated inside the outermost Scope is released when it ends. Scopes
+    // are opened and closed on the thread that owns the arena; inner ones release nothing.
+    class Scope {
+    public:
+        explicit Scope(FrameArena& arena) : m_arena(arena) { m_arena.m_depth++; }
+        ~Scope() { if (--m_arena.m_depth == 0) m_arena.EndFrame(); }
+    private:
+        Scope(const Scope&);
+        Scope& operator=(const Scope&);
+        FrameArena& m_arena;
+    };
+
+    // From any thread while a Scope is open. Never fails; the memory is uninitialised.
+    void* Allocate(size_t bytes, size_t alignment = FRAME_ALIGNMENT);
+
+    template <typename T>
+    T* AllocateArray(size_t count) {
+        return static_cast<T*>(Allocate(count * sizeof(T), alignof(T) > FRAME_ALIGNMENT ? alignof(T) : FRAME_ALIGNMENT));
+    }
+
+    size_t Capacity() const { return m_block.bytes; }
+    size_t Used() const { return m_used; }
+    size_t HighWater() const { return m_highWater; }
+    // Allocations that did not fit and went to the heap, since construction
+    uint64_t Overflows() const { return m_overflows; }
+
+private:
+    FrameArena(const FrameArena&);
+    FrameArena& operator=(const FrameArena&);
+
+    void EndFrame();
+
+    FrameBuffer m_block;
+    bool m_hugePages;
+    std::atomic<size_t> m_used;     // past Capacity when the frame overflowed: what it needed
+    size_t m_highWater;
+    int m_depth;
+    std::mutex m_overflowMutex;
+    std::vector<FrameBuffer> m_overflow;
+    std::atomic<uint64_t> m_overflows;
+};
+
+// Idle frame buffers by size. Thread safe.
+class FrameBufferPool {
+public:
+    // Keeps at most 'capacity' idle buffers, freeing the oldest past it
+    explicit FrameBufferPool(size_t capacity = 16, bool hugePages = false);
+    ~FrameBufferPool();
+
+    // An idle buffer of exactly 'bytes', or a new one; contents are undefined
+    FrameBuffer Acquire(size_t bytes);
+    // Takes the buffer back; null buffers are ignored
+    void Release(FrameBuffer& buffer);
+    void Clear();
+
+    size_t Idle() const;
+    size_t Hits() const { return m_hits; }
+    size_t Misses() const { return m_misses; }
+
+private:
+    FrameBufferPool(const FrameBufferPool&);
+    FrameBufferPool& operator=(const FrameBufferPool&);
+
+    size_t m_capacity;
+    bool m_hugePages;
+    mutable std::mutex m_mutex;
+    std::vector<FrameBuffer> m_idle;    // oldest first, reserved to capacity + 1
+    std::atomic<size_t> m_hits;
+    std::atomic<size_t> m_misses;
+};
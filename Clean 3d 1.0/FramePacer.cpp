@@ -0,0 +1,156 @@
+#include "FramePacer.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <thread>
+
+// Weight of a new frame in the work and refresh averages
+static const double PACER_SMOOTHING = 0.05;
+
+// Work is predicted as its mean plus this many mean deviations
+static const double PACER_WORK_DEVIATIONS = 2.0;
+
+// The spin window shrinks by this much per sleep that overshoots less than it
+static const double PACER_SPIN_DECAY = 0.99;
+
+void ThreadSleepMs(double ms) {
+    std::this_thread::sleep_for(std::chrono::duration<double, std::milli>(ms));
+}
+
+FramePacer::FramePacer(double periodMs, ResolutionClock clock, PacerSleep sleep)
+    : m_clock(clock), m_sleep(sleep), m_periodMs(periodMs), m_refreshMs(0.0), m_vblankMs(0.0),
+    m_deadlineMs(0.0), m_wakeMs(0.0), m_wokeMs(0.0), m_workMs(0.0), m_workDeviationMs(0.0),
+    m_spinMs(PACER_MAX_SPIN_MS) {
+    ResetStats();
+}
+
+void FramePacer::SetPeriod(double periodMs) {
+    m_periodMs = periodMs > 0.0 ? periodMs : m_periodMs;
+}
+
+void FramePacer::OnVblank(double ms, double refreshMs) {
+    if (refreshMs > 0.0) {
+        m_refreshMs = refreshMs;
+    }
+    else if (m_vblankMs > 0.0 && ms > m_vblankMs) {
+        // The vblanks in between may have been missed: the spacing is a whole number of refreshes
+        double spacing = ms - m_vblankMs;
+        if (m_refreshMs <= 0.0) {
+            m_refreshMs = spacing;
+        }
+        else {
+            double refreshes = std::floor(spacing / m_refreshMs + 0.5);
+            if (refreshes >= 1.0) m_refreshMs += (spacing / refreshes - m_refreshMs) * PACER_SMOOTHING;
+        }
+    }
+    m_vblankMs = ms;
+}
+
+double FramePacer::FrameIntervalMs() const {
+    if (m_refreshMs <= 0.0) return m_periodMs;
+    double refreshes = std::floor(m_periodMs / m_refreshMs + 0.5);
+    return m_refreshMs * (refreshes < 1.0 ? 1.0 : refreshes);
+}
+
+double FramePacer::SnapDeadline(double ms) const {
+    if (m_refreshMs <= 0.0 || m_vblankMs <= 0.0) return ms;
+    double refreshes = std::floor((ms - m_vblankMs) / m_refreshMs + 0.5);
+    return m_vblankMs + refreshes * m_refreshMs;
+}
+
+void FramePacer::WaitForFrame() {
+    double now = m_clock();
+    double interval = FrameIntervalMs();
+    double lead = m_workMs + PACER_WORK_DEVIATIONS * m_workDeviationMs + PACER_LATE_MARGIN_MS;
+    bool first = m_deadlineMs <= 0.0;
+    // From the last deadline, so late wakes do not push the schedule back. Snapping pulls
+    // it onto the display when the refresh estimate drifts.
+    m_deadlineMs = SnapDeadline(first ? now + lead : m_deadlineMs + interval);
+    if (m_deadlineMs < now + lead) {
+        // Too late for it: skip to the first deadline the frame can still make
+        int skipped = static_cast<int>(std::ceil((now + lead - m_deadlineMs) / interval));
+        m_deadlineMs = SnapDeadline(m_deadlineMs + skipped * interval);
+        if (m_deadlineMs < now + lead) {
+            m_deadlineMs += interval;
+            skipped++;
+        }
+        if (!first) m_missed += skipped;
+    }
+    m_wakeMs = m_deadlineMs - lead;
+    WaitUntil(m_wakeMs);
+
+    double woke = m_clock();
+    if (m_wokeMs > 0.0) m_intervals[m_next] = woke - m_wokeMs;
+    m_errors[m_next] = woke - m_wakeMs;
+    m_next = (m_next + 1) % PACER_HISTORY;
+    m_wokeMs = woke;
+}
+
+void FramePacer::EndFrame() {
+    double work = m_clock() - m_wokeMs;
+    if (m_workMs <= 0.0) {
+        m_workMs = work;
+    }
+    else {
+        m_workDeviationMs += (std::fabs(work - m_workMs) - m_workDeviationMs) * PACER_SMOOTHING;
+        m_workMs += (work - m_workMs) * PACER_SMOOTHING;
+    }
+}
+
+void FramePacer::WaitUntil(double ms) {
+    double now = m_clock();
+    while (ms - now > m_spinMs) {
+        double request = ms - now - m_spinMs;
+        m_sleep(request);
+        double slept = m_clock();
+        // The window covers the worst recent overshoot and forgets it slowly
+        double overshoot = slept - now - request;
+        m_spinMs = std::max(overshoot, m_spinMs * PACER_SPIN_DECAY);
+        m_spinMs = std::min(std::max(m_spinMs, PACER_MIN_SPIN_MS), PACER_MAX_SPIN_MS);
+        now = slept;
+    }
+    while (now < ms) now = m_clock();
+}
+
+PacerStats FramePacer::Stats() const {
+    PacerStats stats = {};
+    std::vector<double> errors, intervals;
+    for (int i = 0; i < PACER_HISTORY; ++i) {
+        // Unfilled entries are negative: a wake cannot come before its time, nor a frame before the last
+        if (m_errors[i] >= 0.0) errors.push_back(m_errors[i]);
+        if (m_intervals[i] >= 0.0) intervals.push_back(m_intervals[i]);
+    }
+    stats.frames = static_cast<int>(errors.size());
+    stats.missed = m_missed;
+    stats.spinMs = m_spinMs;
+    stats.workMs = m_workMs + PACER_WORK_DEVIATIONS * m_workDeviationMs;
+    if (!errors.empty()) {
+        double sum = 0.0, squares = 0.0;
+        for (double error : errors) {
+            sum += error;
+            squares += error * error;
+        }
+        stats.meanErrorMs = sum / errors.size();
+        stats.jitterMs = std::sqrt(std::max(0.0, squares / errors.size() - stats.meanErrorMs * stats.meanErrorMs));
+        std::sort(errors.begin(), errors.end());
+        stats.p99ErrorMs = errors[(errors.size() - 1) * 99 / 100];
+        stats.maxErrorMs = errors.back();
+    }
+    if (!intervals.empty()) {
+        double sum = 0.0, squares = 0.0;
+        for (double interval : intervals) {
+            sum += interval;
+            squares += interval * interval;
+        }
+        stats.intervalMs = sum / intervals.size();
+        stats.intervalJitterMs = std::sqrt(std::max(0.0, squares / intervals.size() - stats.intervalMs * stats.intervalMs));
+    }
+    return stats;
+}
+
+void FramePacer::ResetStats() {
+    m_errors.assign(PACER_HISTORY, -1.0);
+    m_intervals.assign(PACER_HISTORY, -1.0);
+    m_next = 0;
+    m_missed = 0;
+}
@@ -0,0 +1,93 @@
+#pragma once
+#include <vector>
+#include "ResolutionController.h"
+
+// Paces the render loop. Each frame has a deadline, the moment its Present should be
+// in; WaitForFrame returns a predicted frame's work (plus PACER_LATE_MARGIN_MS) before
+// it, so the frame latches the newest capture as late as it can and still makes it.
+//
+// Deadlines follow one another by the period, each from the last rather than from when
+// the frame ended, so errors do not add up; a frame that overruns skips the deadlines it
+// can no longer make. Once OnVblank has seen the display, the period becomes a whole
+// number of refreshes and every deadline snaps to a predicted vblank.
+//
+// Waits sleep until the spin window before the wake time and spin the rest. The window
+// follows how far the sleeps overshoot what they asked for.
+//
+// Time comes only from the injected clock and sleep, so a simulated clock drives the
+// pacer through the same code.
+
+// Sleeps for about 'ms'; may overshoot
+typedef void (*PacerSleep)(double ms);
+
+// std::this_thread::sleep_for
+void ThreadSleepMs(double ms);
+
+// Lead over the predicted work
+const double PACER_LATE_MARGIN_MS = 0.5;
+
+// Spin window bounds
+const double PACER_MIN_SPIN_MS = 0.2;
+const double PACER_MAX_SPIN_MS = 3.0;
+
+// Frames in the jitter statistics
+const int PACER_HISTORY = 240;
+
+struct PacerStats {
+    int frames;              // in the statistics, at most PACER_HISTORY
+    double meanErrorMs;      // woken minus wake time
+    double jitterMs;         // standard deviation of the wake error
+    double p99ErrorMs;       // of the absolute wake error
+    double maxErrorMs;
+    double intervalMs;       // mean between wakes
+    double intervalJitterMs; // standard deviation between wakes
+    int missed;              // deadlines skipped since ResetStats
+    double spinMs;           // current spin window
+    double workMs;           // predicted work per frame
+};
+
+class FramePacer {
+public:
+    explicit FramePacer(double periodMs, ResolutionClock clock = SteadyClockMs, PacerSleep sleep = ThreadSleepMs);
+
+    // Time between frames without a display to lock to, or the shortest with one
+    void SetPeriod(double periodMs);
+
+    // A display vblank at 'ms' on the pacer's clock; 'refreshMs' is the display's refresh
+    // period if known, else 0 to take it from the spacing of the vblanks
+    void OnVblank(double ms, double refreshMs);
+
+    // Waits until the next frame should start
+    void WaitForFrame();
+    // The frame's work is done, Present returned
+    void EndFrame();
+
+    double NextDeadlineMs() const { return m_deadlineMs; }
+    // Time between deadlines
+    double FrameIntervalMs() const;
+    bool VblankLocked() const { return m_refreshMs > 0.0; }
+
+    PacerStats Stats() const;
+    void ResetStats();
+
+private:
+    void WaitUntil(double ms);
+    // The predicted vblank nearest 'ms', or 'ms' if not locked
+    double SnapDeadline(double ms) const;
+
+    ResolutionClock m_clock;
+    PacerSleep m_sleep;
+    double m_periodMs;
+    double m_refreshMs;       // 0 until the display is known
+    double m_vblankMs;        // last vblank seen
+    double m_deadlineMs;      // of the frame being waited for or run, 0 before the first
+    double m_wakeMs;          // when that frame should have started
+    double m_wokeMs;          // when it did
+    double m_workMs;          // mean work per frame
+    double m_workDeviationMs; // mean absolute deviation of the work
+    double m_spinMs;
+    std::vector<double> m_errors;     // wake errors, a ring of PACER_HISTORY
+    std::vector<double> m_intervals;  // between wakes, a ring of PACER_HISTORY
+    int m_next;
+    int m_missed;
+};
@@ -0,0 +1,288 @@
+#include "FramePipeline.h"
+#include <chrono>
+#include <cstring>
+#include <new>
+#include "AllocationTracker.h"
+#include "DepthEstimation.h"
+#include "EdgeOutline.h"
+#include "ParallelFor.h"
+#include "ResolutionController.h"
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+static int64_t NowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Pinning is a hint: where it is not supported or fails, the thread runs unpinned
+static void PinThread(std::thread& thread, int core) {
+    if (core < 0) return;
+#ifdef __linux__
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(core, &set);
+    pthread_setaffinity_np(thread.native_handle(), sizeof(set), &set);
+#else
+    (void)thread;
+#endif
+}
+
+static void WaitBackoff(int attempt) {
+    if (attempt < PIPELINE_WAIT_SPINS) std::this_thread::yield();
+    else std::this_thread::sleep_for(std::chrono::microseconds(static_cast<int>(PIPELINE_WAIT_SLEEP_MS * 1000.0)));
+}
+
+PipelineParams DefaultPipelineParams() {
+    PipelineParams params;
+    params.queueDepth = 1;
+    for (int stage = 0; stage < PIPELINE_STAGE_COUNT; ++stage) params.cores[stage] = -1;
+    params.serialStages = false;
+    params.hugePages = false;
+    params.views.eyeSeparationPx = 24.0f;
+    params.views.parallaxStrength = 1.0f;
+    params.views.convergence = VIEW_CONVERGENCE_DEPTH;
+    params.views.layerCount = 0;
+    params.barrier.viewCount = 2;
+    params.barrier.stripeWidthPx = 1.0f;
+    params.barrier.phasePx = 0.0f;
+    params.outlineWidthPx = 1.5f;
+    params.outlineInfluence = 1000.0f;
+    params.outlineIntensity = 0.6f;
+    params.outlineColor = 0xFFE6E6E6u;
+    return params;
+}
+
+// Bytes of one plane in a frame buffer, rounded up so the next plane starts aligned
+static size_t PlaneBytes(size_t pixels, size_t pixelBytes) {
+    return (pixels * pixelBytes + FRAME_ALIGNMENT - 1) / FRAME_ALIGNMENT * FRAME_ALIGNMENT;
+}
+
+FramePipeline::FramePipeline(int width, int height, const PipelineParams& params, FrameBufferPool* pool)
+    : m_width(width), m_height(height), m_params(params), m_ownPool(0, params.hugePages), m_pool(pool ? pool : &m_ownPool), m_latencyNs(0), m_sourceTimeouts(0), m_sourceFailures(0),
+    m_statsSinceNs(NowNs()), m_sequence(0), m_serialScheduler(0), m_source(nullptr), m_sink(nullptr), m_sinkContext(nullptr),
+    m_running(false) {
+    if (m_params.queueDepth < 1) m_params.queueDepth = 1;
+    m_params.barrier.viewCount = 2;
+    // Enough frames for one in every stage and every queue full: only the stages, never
+    // the pool, hold the pipeline up
+    int frameCount = PIPELINE_STAGE_COUNT + (PIPELINE_STAGE_COUNT - 1) * m_params.queueDepth;
+    // One buffer per frame holds its planes
+    size_t pixels = static_cast<size_t>(width) * height;
+    size_t colorBytes = PlaneBytes(pixels, sizeof(uint32_t));
+    size_t byteBytes = PlaneBytes(pixels, 1);
+    m_frames.resize(frameCount);
+    for (PipelineFrame& frame : m_frames) {
+        frame.sequence = 0;
+        frame.ingestedMs = frame.compositedMs = 0.0;
+        frame.buffer = m_pool->Acquire(colorBytes * 3 + byteBytes * 2);
+        if (!frame.buffer.data) throw std::bad_alloc();
+        uint8_t* data = frame.buffer.As<uint8_t>();
+        frame.color = reinterpret_cast<uint32_t*>(data);
+        frame.left = reinterpret_cast<uint32_t*>(data + colorBytes);
+        frame.right = reinterpret_cast<uint32_t*>(data + colorBytes * 2);
+        frame.depth = data + colorBytes * 3;
+        frame.edges = frame.depth + byteBytes;
+        memset(frame.color, 0, colorBytes * 3 + byteBytes * 2);
+    }
+    m_viewOfColumn.resize(width);
+    BuildColumnViews(m_params.barrier, width, m_viewOfColumn.data());
+    BuildOutlineAlpha(m_params.outlineIntensity, m_outlineAlpha);
+    ResetStats();
+}
+
+FramePipeline::~FramePipeline() {
+    Stop();
+    for (PipelineFrame& frame : m_frames) m_pool->Release(frame.buffer);
+}
+
+std::vector<ImagePlane<uint32_t>> FramePipeline::IngestPlanes() {
+    std::vector<ImagePlane<uint32_t>> planes;
+    for (PipelineFrame& frame : m_frames) {
+        ImagePlane<uint32_t> plane = { frame.color, m_width, m_height, m_width * sizeof(uint32_t) };
+        planes.push_back(plane);
+    }
+    return planes;
+}
+
+void FramePipeline::Start(FrameSource* source, PipelineSink sink, void* context) {
+    if (m_running || !source) return;
+    m_source = source;
+    m_sink = sink;
+    m_sinkContext = context;
+    m_queues[0].Reset(m_frames.size());
+    for (int stage = 1; stage < PIPELINE_STAGE_COUNT; ++stage) m_queues[stage].Reset(m_params.queueDepth);
+    for (int frame = 0; frame < FrameCount(); ++frame) m_queues[0].Push(frame);
+    ResetStats();
+    m_running = true;
+    for (int stage = 0; stage < PIPELINE_STAGE_COUNT; ++stage) {
+        m_threads[stage] = std::thread(&FramePipeline::StageLoop, this, stage);
+        PinThread(m_threads[stage], m_params.cores[stage]);
+    }
+}
+
+void FramePipeline::Stop() {
+    if (!m_running) return;
+    m_running = false;
+    for (std::thread& thread : m_threads) {
+        if (thread.joinable()) thread.join();
+    }
+}
+
+bool FramePipeline::Take(int stage, int* frame) {
+    StageCounters& counters = m_counters[stage];
+    int64_t begin = NowNs();
+    for (int attempt = 0; ; ++attempt) {
+        size_t queued = m_queues[stage].Size();
+        if (m_queues[stage].Pop(frame)) {
+            counters.queued += queued;
+            counters.starvedNs += static_cast<uint64_t>(NowNs() - begin);
+            return true;
+        }
+        if (!m_running) return false;
+        WaitBackoff(attempt);
+    }
+}
+
+bool FramePipeline::Pass(int stage, int frame) {
+    SpscQueue<int>& output = m_queues[(stage + 1) % PIPELINE_STAGE_COUNT];
+    int64_t begin = NowNs();
+    for (int attempt = 0; ; ++attempt) {
+        if (output.Push(frame)) {
+            m_counters[stage].blockedNs += static_cast<uint64_t>(NowNs() - begin);
+            return true;
+        }
+        if (!m_running) return false;
+        WaitBackoff(attempt);
+    }
+}
+
+void FramePipeline::StageLoop(int stage) {
+    static const char* const threadNames[PIPELINE_STAGE_COUNT] = { "ingest", "analysis", "views", "composite" };
+    NameAllocationThread(threadNames[stage]);
+    if (m_params.serialStages) TaskScheduler::SetCurrent(&m_serialScheduler);
+    StageCounters& counters = m_counters[stage];
+    FrameArena& arena = FrameArena::ThreadArena();
+    int index;
+    while (Take(stage, &index)) {
+        PipelineFrame& frame = m_frames[index];
+        FrameArena::Scope scope(arena);
+        int64_t begin = NowNs();
+        switch (stage) {
+        case PipelineIngest:
+            // Busy time includes waiting on the source
+            if (!Ingest(frame)) return;
+            break;
+        case PipelineAnalysis:
+            Analyse(frame);
+            break;
+        case PipelineViews:
+            SynthesizeViews(frame);
+            break;
+        case PipelineComposite:
+            Composite(frame);
+            frame.compositedMs = SteadyClockMs();
+            m_latencyNs += static_cast<uint64_t>((frame.compositedMs - frame.ingestedMs) * 1e6);
+            if (m_sink) m_sink(m_sinkContext, frame);
+            break;
+        }
+        counters.busyNs += static_cast<uint64_t>(NowNs() - begin);
+        counters.frames++;
+        if (!Pass(stage, index)) return;
+    }
+}
+
+bool FramePipeline::Ingest(PipelineFrame& frame) {
+    int index = static_cast<int>(&frame - m_frames.data());
+    while (m_running) {
+        switch (m_source->CaptureInto(index, PIPELINE_CAPTURE_TIMEOUT_MS)) {
+        case FrameReady:
+            frame.sequence = ++m_sequence;
+            frame.ingestedMs = SteadyClockMs();
+            return true;
+        case FrameTimeout:
+            m_sourceTimeouts++;
+            break;
+        case FrameLost:
+            if (m_source->Reopen()) break;
+            m_sourceFailures++;
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            break;
+        case FrameFailed:
+            m_sourceFailures++;
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            break;
+        }
+    }
+    return false;
+}
+
+void FramePipeline::Analyse(PipelineFrame& frame) {
+    ImagePlane<const uint32_t> color = { frame.color, m_width, m_height, m_width * sizeof(uint32_t) };
+    ImagePlane<uint8_t> depth = { frame.depth, m_width, m_height, static_cast<size_t>(m_width) };
+    EstimateDepth(color, depth);
+    if (m_params.outlineIntensity > 0.0f) {
+        ImagePlane<uint8_t> edges = { frame.edges, m_width, m_height, static_cast<size_t>(m_width) };
+        OutlineEdges(color, m_params.outlineWidthPx, m_params.outlineInfluence, edges);
+    }
+}
+
+void FramePipeline::SynthesizeViews(PipelineFrame& frame) {
+    ImagePlane<const uint32_t> color = { frame.color, m_width, m_height, m_width * sizeof(uint32_t) };
+    ImagePlane<const uint8_t> depth = { frame.depth, m_width, m_height, static_cast<size_t>(m_width) };
+    ImagePlane<uint32_t> left = { frame.left, m_width, m_height, m_width * sizeof(uint32_t) };
+    ImagePlane<uint32_t> right = { frame.right, m_width, m_height, m_width * sizeof(uint32_t) };
+    SynthesizeStereo(color, depth, m_params.views, left, right);
+}
+
+void FramePipeline::Composite(PipelineFrame& frame) {
+    bool outline = m_params.outlineIntensity > 0.0f;
+    const uint8_t* viewOfColumn = m_viewOfColumn.data();
+    int width = m_width;
+    ParallelFor(0, m_height, [&](int first, int last) {
+        for (int y = first; y < last; ++y) {
+            size_t row = static_cast<size_t>(y) * width;
+            const uint32_t* left = frame.left + row;
+            const uint32_t* right = frame.right + row;
+            uint32_t* out = frame.color + row;
+            for (int x = 0; x < width; ++x) out[x] = (viewOfColumn[x] == 0 ? left[x] : right[x]) | 0xFF000000u;
+            if (outline) BlendOutlineRow(out, frame.edges + row, width, m_outlineAlpha, m_params.outlineColor);
+        }
+    });
+}
+
+PipelineStats FramePipeline::Stats() const {
+    PipelineStats stats = {};
+    double wallMs = (NowNs() - m_statsSinceNs) / 1e6;
+    for (int stage = 0; stage < PIPELINE_STAGE_COUNT; ++stage) {
+        const StageCounters& counters = m_counters[stage];
+        PipelineStageStats& entry = stats.stages[stage];
+        entry.frames = counters.frames;
+        entry.busyMs = counters.busyNs / 1e6;
+        entry.starvedMs = counters.starvedNs / 1e6;
+        entry.blockedMs = counters.blockedNs / 1e6;
+        entry.occupancy = entry.frames > 0 ? static_cast<double>(counters.queued) / entry.frames : 0.0;
+        entry.utilisation = wallMs > 0.0 ? entry.busyMs / wallMs : 0.0;
+    }
+    stats.frames = stats.stages[PipelineComposite].frames;
+    stats.framesPerSecond = wallMs > 0.0 ? stats.frames * 1000.0 / wallMs : 0.0;
+    stats.latencyMs = stats.frames > 0 ? m_latencyNs / 1e6 / stats.frames : 0.0;
+    stats.sourceTimeouts = m_sourceTimeouts;
+    stats.sourceFailures = m_sourceFailures;
+    return stats;
+}
+
+void FramePipeline::ResetStats() {
+    for (StageCounters& counters : m_counters) {
+        counters.frames = 0;
+        counters.busyNs = 0;
+        counters.starvedNs = 0;
+        counters.blockedNs = 0;
+        counters.queued = 0;
+    }
+    m_latencyNs = 0;
+    m_sourceTimeouts = 0;
+    m_sourceFailures = 0;
+    m_statsSinceNs = NowNs();
+}
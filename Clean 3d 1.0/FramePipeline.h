@@ -0,0 +1,164 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <thread>
+#include <vector>
+#include "CpuImage.h"
+#include "FrameMemory.h"
+#include "FrameSource.h"
+#include "SpscQueue.h"
+#include "TaskScheduler.h"
+#include "ViewSynthesis.h"
+
+// CPU frame engine that runs the stages of a frame on dedicated threads, one frame per
+// stage at a time, so a steady stream of frames goes through at the pace of the slowest
+// stage rather than of all of them together:
+//
+//   ingest     FrameSource::CaptureInto into the frame's colour plane
+//   analysis   EstimateDepth (luminance to depth) and OutlineEdges (Sobel over luminance)
+//   views      SynthesizeStereo into the left and right planes
+//   composite  the two views interleaved by the barrier pattern, outline blended over,
+//              back into the colour plane, then handed to the sink
+//
+// Frames are a fixed set of buffers the constructor takes from a FrameBufferPool, and
+// gives back when the pipeline goes, so one rebuilt at the same size reuses them. Stages
+// pass frame indices along SpscQueues, the last stage back to the first through the free
+// queue, and each stage's kernels take their scratch from its thread's FrameArena, so a
+// running pipeline allocates nothing. A stage waits when its input is empty (starved) or its
+// output is full (blocked, the back-pressure of a slower stage further on); the queues
+// between stages hold PipelineParams::queueDepth frames, which bounds the latency.
+
+enum PipelineStage {
+    PipelineIngest,
+    PipelineAnalysis,
+    PipelineViews,
+    PipelineComposite
+};
+
+const int PIPELINE_STAGE_COUNT = 4;
+
+// Spins on an empty or full queue before a stage starts sleeping between tries
+const int PIPELINE_WAIT_SPINS = 64;
+
+// Sleep between tries once past the spins
+const double PIPELINE_WAIT_SLEEP_MS = 0.1;
+
+// Ingest's CaptureInto timeout, after which it checks for Stop
+const uint32_t PIPELINE_CAPTURE_TIMEOUT_MS = 16;
+
+struct PipelineParams {
+    int queueDepth;                      // frames between two stages, at least 1
+    int cores[PIPELINE_STAGE_COUNT];     // core each stage's thread is pinned to, -1 for none
+    bool serialStages;                   // stages run their kernels on their own thread, not the TaskScheduler
+    bool hugePages;                      // frame buffers from the pipeline's own pool may use huge pages
+    ViewSynthesisParams views;
+    InterleavePattern barrier;           // 2 views
+    float outlineWidthPx;
+    float outlineInfluence;
+    float outlineIntensity;              // 0 skips the outline pass
+    uint32_t outlineColor;               // R8G8B8A8
+};
+
+PipelineParams DefaultPipelineParams();
+
+// One pooled frame
+struct PipelineFrame {
+    uint64_t sequence;                   // frames ingested so far, this one included
+    double ingestedMs;                   // SteadyClockMs when the source returned it
+    double compositedMs;
+    uint32_t* color;                     // source frame, then the composite
+    uint32_t* left;
+    uint32_t* right;
+    uint8_t* depth;
+    uint8_t* edges;
+    FrameBuffer buffer;                  // holds the planes above, each width x height
+};
+
+struct PipelineStageStats {
+    uint64_t frames;
+    double busyMs;           // running the stage's work
+    double starvedMs;        // waiting for a frame from the stage before (ingest: a free frame)
+    double blockedMs;        // waiting for room in the queue to the next stage
+    double occupancy;        // mean frames queued at its input when it took one
+    double utilisation;      // busyMs over the time since Start or ResetStats
+};
+
+struct PipelineStats {
+    PipelineStageStats stages[PIPELINE_STAGE_COUNT];
+    uint64_t frames;         // composited
+    double framesPerSecond;
+    double latencyMs;        // mean ingest to composite
+    uint64_t sourceTimeouts;
+    uint64_t sourceFailures; // FrameFailed, and FrameLost with a failed Reopen
+};
+
+// Called on the composite thread with each finished frame; the frame goes back to the
+// pool when it returns
+typedef void (*PipelineSink)(void* context, const PipelineFrame& frame);
+
+class FramePipeline {
+public:
+    // Frame buffers come from 'pool', or from a pool of the pipeline's own if null
+    FramePipeline(int width, int height, const PipelineParams& params, FrameBufferPool* pool = nullptr);
+    ~FramePipeline();
+
+    int Width() const { return m_width; }
+    int Height() const { return m_height; }
+    int FrameCount() const { return static_cast<int>(m_frames.size()); }
+
+    // Colour plane of each pooled frame: where a source must write slot i
+    std::vector<ImagePlane<uint32_t>> IngestPlanes();
+
+    // Frames in flight are dropped by Stop; the pool is whole again by the next Start
+    void Start(FrameSource* source, PipelineSink sink = nullptr, void* context = nullptr);
+    void Stop();
+    bool IsRunning() const { return m_running; }
+
+    PipelineStats Stats() const;
+    void ResetStats();
+
+private:
+    FramePipeline(const FramePipeline&);
+    FramePipeline& operator=(const FramePipeline&);
+
+    struct StageCounters {
+        std::atomic<uint64_t> frames;
+        std::atomic<uint64_t> busyNs;
+        std::atomic<uint64_t> starvedNs;
+        std::atomic<uint64_t> blockedNs;
+        std::atomic<uint64_t> queued;    // sum of input queue sizes seen
+    };
+
+    void StageLoop(int stage);
+    // Waits for a frame on the stage's input; false once stopped
+    bool Take(int stage, int* frame);
+    // Waits for room on the stage's output; false once stopped
+    bool Pass(int stage, int frame);
+    bool Ingest(PipelineFrame& frame);
+    void Analyse(PipelineFrame& frame);
+    void SynthesizeViews(PipelineFrame& frame);
+    void Composite(PipelineFrame& frame);
+
+    int m_width;
+    int m_height;
+    PipelineParams m_params;
+    FrameBufferPool m_ownPool;
+    FrameBufferPool* m_pool;
+    std::vector<PipelineFrame> m_frames;
+    std::vector<uint8_t> m_viewOfColumn;
+    int m_outlineAlpha[256];             // BuildOutlineAlpha
+    // Input of each stage: queue 0 is the free list into ingest, queue i feeds stage i
+    SpscQueue<int> m_queues[PIPELINE_STAGE_COUNT];
+    StageCounters m_counters[PIPELINE_STAGE_COUNT];
+    std::atomic<uint64_t> m_latencyNs;
+    std::atomic<uint64_t> m_sourceTimeouts;
+    std::atomic<uint64_t> m_sourceFailures;
+    std::atomic<int64_t> m_statsSinceNs;
+    uint64_t m_sequence;
+    TaskScheduler m_serialScheduler;     // no workers: ParallelFor runs inline
+    FrameSource* m_source;
+    PipelineSink m_sink;
+    void* m_sinkContext;
+    std::atomic<bool> m_running;
+    std::thread m_threads[PIPELINE_STAGE_COUNT];
+};
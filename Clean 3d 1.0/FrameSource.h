@@ -0,0 +1,26 @@
+#pragma once
+#include <cstdint>
+
+// A producer of captured frames for one output. The renderer's implementation wraps
+// DXGI desktop duplication; headless code can substitute a synthetic source.
+//
+// Frames are written into one of FRAME_SOURCE_SLOTS buffers owned by the consumer;
+// OutputScheduler decides which slot each capture goes to.
+
+const int FRAME_SOURCE_SLOTS = 3;
+
+enum FrameStatus {
+    FrameReady,     // a new frame was written into the slot
+    FrameTimeout,   // nothing new within the timeout, not an error
+    FrameLost,      // the source must be reopened (mode change, secure desktop)
+    FrameFailed     // transient failure, the frame is skipped
+};
+
+class FrameSource {
+public:
+    virtual ~FrameSource() {}
+    // Blocks for at most timeoutMs waiting for the next frame and writes it into 'slot'.
+    virtual FrameStatus CaptureInto(int slot, uint32_t timeoutMs) = 0;
+    // Called after FrameLost. Returns false if the source is still unavailable.
+    virtual bool Reopen() = 0;
+};
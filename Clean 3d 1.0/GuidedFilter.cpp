@@ -0,0 +1,253 @@
+#include "GuidedFilter.h"
+#include "FrameMemory.h"
+#include "ParallelFor.h"
+#include <algorithm>
+#include <cstring>
+
+// Pixels of a window clipped to [0, size) along one axis
+static inline int WindowCount(int centre, int radius, int size) {
+    int first = centre - radius < 0 ? 0 : centre - radius;
+    int last = centre + radius >= size ? size - 1 : centre + radius;
+    return last - first + 1;
+}
+
+// Adds one row of guide and input to (or removes it from) the column sums of I, p,
+// I * I and I * p. Sums stay within int32 up to MAX_GUIDED_FILTER_RADIUS. When the
+// input is the guide, sumP and sumIP are null: they would repeat sumI and sumII.
+static void AccumulateRow(const uint8_t* guide, const uint8_t* input, int count, bool add,
+    int32_t* sumI, int32_t* sumP, int32_t* sumII, int32_t* sumIP) {
+    int x = 0;
+#ifdef CLEAN3D_SSE2
+    const __m128i zero = _mm_setzero_si128();
+    for (; x + 8 <= count; x += 8) {
+        __m128i i16 = _mm_unpacklo_epi8(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(guide + x)), zero);
+        __m128i p16 = _mm_unpacklo_epi8(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(input + x)), zero);
+        // 16 x 16 -> 32 bit products from the low and high halves
+        __m128i iiLo = _mm_mullo_epi16(i16, i16), iiHi = _mm_mulhi_epu16(i16, i16);
+        __m128i ipLo = _mm_mullo_epi16(i16, p16), ipHi = _mm_mulhi_epu16(i16, p16);
+        __m128i values[4][2] = {
+            { _mm_unpacklo_epi16(i16, zero), _mm_unpackhi_epi16(i16, zero) },
+            { _mm_unpacklo_epi16(p16, zero), _mm_unpackhi_epi16(p16, zero) },
+            { _mm_unpacklo_epi16(iiLo, iiHi), _mm_unpackhi_epi16(iiLo, iiHi) },
+            { _mm_unpacklo_epi16(ipLo, ipHi), _mm_unpackhi_epi16(ipLo, ipHi) }
+        };
+        int32_t* sums[4] = { sumI, sumP, sumII, sumIP };
+        for (int s = 0; s < 4; ++s) {
+            if (!sums[s]) continue;
+            for (int half = 0; half < 2; ++half) {
+                __m128i* target = reinterpret_cast<__m128i*>(sums[s] + x + half * 4);
+                __m128i current = _mm_loadu_si128(target);
+                _mm_storeu_si128(target, add ? _mm_add_epi32(current, values[s][half]) : _mm_sub_epi32(current, values[s][half]));
+            }
+        }
+    }
+#endif
+    int sign = add ? 1 : -1;
+    for (; x < count; ++x) {
+        int i = guide[x], p = input[x];
+        sumI[x] += sign * i;
+        sumII[x] += sign * i * i;
+        if (sumP) {
+            sumP[x] += sign * p;
+            sumIP[x] += sign * i * p;
+        }
+    }
+}
+
+// Adds one row of a and b to (or removes it from) their column sums
+static void AccumulateCoefficients(const float* a, const float* b, int count, bool add, float* sumA, float* sumB) {
+    int x = 0;
+#ifdef CLEAN3D_SSE2
+    for (; x + 4 <= count; x += 4) {
+        __m128 va = _mm_loadu_ps(a + x), vb = _mm_loadu_ps(b + x);
+        __m128 sa = _mm_loadu_ps(sumA + x), sb = _mm_loadu_ps(sumB + x);
+        _mm_storeu_ps(sumA + x, add ? _mm_add_ps(sa, va) : _mm_sub_ps(sa, va));
+        _mm_storeu_ps(sumB + x, add ? _mm_add_ps(sb, vb) : _mm_sub_ps(sb, vb));
+    }
+#endif
+    float sign = add ? 1.0f : -1.0f;
+    for (; x < count; ++x) {
+        sumA[x] += sign * a[x];
+        sumB[x] += sign * b[x];
+    }
+}
+
+// Horizontal window sums of 'column' (which starts at image column 'origin') for the
+// image columns [first, last), written to 'window' from index 0
+template <typename T>
+static void SlideWindow(const T* column, int origin, int first, int last, int radius, int width, T* window) {
+    T sum = 0;
+    int lo = first - radius < 0 ? 0 : first - radius;
+    int hi = first + radius >= width ? width - 1 : first + radius;
+    for (int x = lo; x <= hi; ++x) sum += column[x - origin];
+    // Interior columns, where one column enters and one leaves, without the edge tests;
+    // one dependent add per column
+    int interiorFirst = radius > first ? radius : first;
+    int interiorLast = width - radius - 1 < last ? width - radius - 1 : last;
+    int x = first;
+    for (; x < interiorFirst && x < last; ++x) {
+        window[x - first] = sum;
+        if (x + radius + 1 < width) sum += column[x + radius + 1 - origin];
+        if (x - radius >= 0) sum -= column[x - radius - origin];
+    }
+    const T* enter = column + radius + 1 - origin;
+    const T* leave = column - radius - origin;
+    for (; x < interiorLast; ++x) {
+        window[x - first] = sum;
+        sum += enter[x] - leave[x];
+    }
+    for (; x < last; ++x) {
+        window[x - first] = sum;
+        if (x + radius + 1 < width) sum += column[x + radius + 1 - origin];
+        if (x - radius >= 0) sum -= column[x - radius - origin];
+    }
+}
+
+void GuidedFilter(const ImagePlane<const uint8_t>& guide, const ImagePlane<const uint8_t>& input,
+    const GuidedFilterParams& params, const ImagePlane<uint8_t>& output) {
+    int width = guide.width, height = guide.height;
+    int r = params.radius < 1 ? 1 : (params.radius > MAX_GUIDED_FILTER_RADIUS ? MAX_GUIDED_FILTER_RADIUS : params.radius);
+    float epsilon = params.epsilon > 0.0f ? params.epsilon : 1.0f;
+    if (width <= 0 || height <= 0) return;
+    bool selfGuided = guide.data == input.data && guide.pitch == input.pitch;
+
+    // One column strip per thread. Rows stream top to bottom through running column
+    // sums, so a strip only needs O(width) state plus a ring of 2r + 2 rows of a and b.
+    unsigned threads = std::thread::hardware_concurrency();
+    int strips = threads == 0 ? 1 : static_cast<int>(threads);
+    if (strips > width / 64) strips = width / 64 > 0 ? width / 64 : 1;
+
+    FrameArena& arena = FrameArena::ThreadArena();
+    FrameArena::Scope scope(arena);
+    float* inverseColumns = arena.AllocateArray<float>(width);
+    for (int x = 0; x < width; ++x) inverseColumns[x] = 1.0f / static_cast<float>(WindowCount(x, r, width));
+
+    ParallelFor(0, strips, [&](int firstStrip, int lastStrip) {
+        for (int strip = firstStrip; strip < lastStrip; ++strip) {
+            // Output [x0, x1) needs a and b on [s0, s1), which need the sums on [i0, i1)
+            int x0 = static_cast<int>(static_cast<int64_t>(width) * strip / strips);
+            int x1 = static_cast<int>(static_cast<int64_t>(width) * (strip + 1) / strips);
+            int s0 = x0 - r < 0 ? 0 : x0 - r, s1 = x1 + r > width ? width : x1 + r;
+            int i0 = s0 - r < 0 ? 0 : s0 - r, i1 = s1 + r > width ? width : s1 + r;
+            int inputCount = i1 - i0, coefficientCount = s1 - s0, outputCount = x1 - x0;
+
+            int32_t* sumI = arena.AllocateArray<int32_t>(static_cast<size_t>(inputCount) * 4);
+            memset(sumI, 0, sizeof(int32_t) * inputCount * 4);
+            int32_t* sumII = sumI + inputCount;
+            int32_t* sumP = selfGuided ? nullptr : sumII + inputCount;
+            int32_t* sumIP = selfGuided ? nullptr : sumII + inputCount * 2;
+            int32_t* winI = arena.AllocateArray<int32_t>(static_cast<size_t>(coefficientCount) * 4);
+            int32_t* winII = winI + coefficientCount;
+            int32_t* winP = selfGuided ? winI : winII + coefficientCount;
+            int32_t* winIP = selfGuided ? winII : winII + coefficientCount * 2;
+
+            int ringRows = 2 * r + 2;
+            float* ring = arena.AllocateArray<float>(static_cast<size_t>(ringRows) * coefficientCount * 2);
+            float* sumA = arena.AllocateArray<float>(static_cast<size_t>(coefficientCount) * 2);
+            std::fill(sumA, sumA + coefficientCount * 2, 0.0f);
+            float* sumB = sumA + coefficientCount;
+            float* winA = arena.AllocateArray<float>(static_cast<size_t>(outputCount) * 2);
+            float* winB = winA + outputCount;
+
+            auto ringA = [&](int y) { return &ring[static_cast<size_t>(y % ringRows) * coefficientCount * 2]; };
+
+            // q = (sum(a) * I + sum(b)) / count for output row y; the coefficient sums
+            // hold rows [y - r, y + r]
+            auto emitRow = [&](int y) {
+                SlideWindow(sumA, s0, x0, x1, r, width, winA);
+                SlideWindow(sumB, s0, x0, x1, r, width, winB);
+                float inverseRows = 1.0f / static_cast<float>(WindowCount(y, r, height));
+                const uint8_t* g = guide.Row(y) + x0;
+                uint8_t* q = output.Row(y) + x0;
+                const float* inverse = &inverseColumns[x0];
+                int x = 0;
+#ifdef CLEAN3D_SSE2
+                const __m128 rows = _mm_set1_ps(inverseRows);
+                const __m128 half = _mm_set1_ps(0.5f);
+                const __m128i zero = _mm_setzero_si128();
+                for (; x + 8 <= outputCount; x += 8) {
+                    __m128i g16 = _mm_unpacklo_epi8(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(g + x)), zero);
+                    __m128i result[2];
+                    for (int h = 0; h < 2; ++h) {
+                        __m128 gv = _mm_cvtepi32_ps(h == 0 ? _mm_unpacklo_epi16(g16, zero) : _mm_unpackhi_epi16(g16, zero));
+                        __m128 scale = _mm_mul_ps(rows, _mm_loadu_ps(inverse + x + h * 4));
+                        __m128 value = _mm_mul_ps(_mm_add_ps(_mm_mul_ps(_mm_loadu_ps(winA + x + h * 4), gv), _mm_loadu_ps(winB + x + h * 4)), scale);
+                        result[h] = _mm_cvttps_epi32(_mm_add_ps(_mm_max_ps(value, _mm_setzero_ps()), half));
+                    }
+                    __m128i packed = _mm_packs_epi32(result[0], result[1]);
+                    _mm_storel_epi64(reinterpret_cast<__m128i*>(q + x), _mm_packus_epi16(packed, packed));
+                }
+#endif
+                for (; x < outputCount; ++x) {
+                    float value = (winA[x] * g[x] + winB[x]) * inverseRows * inverse[x];
+                    int rounded = static_cast<int>(value + 0.5f);
+                    q[x] = static_cast<uint8_t>(rounded < 0 ? 0 : (rounded > 255 ? 255 : rounded));
+                }
+            };
+
+            for (int y = 0; y < r && y < height; ++y) {
+                AccumulateRow(guide.Row(y) + i0, input.Row(y) + i0, inputCount, true, sumI, sumP, sumII, sumIP);
+            }
+            for (int y = 0; y < height; ++y) {
+                // Input sums for the window around row y
+                if (y + r < height) AccumulateRow(guide.Row(y + r) + i0, input.Row(y + r) + i0, inputCount, true, sumI, sumP, sumII, sumIP);
+                if (y - r - 1 >= 0) AccumulateRow(guide.Row(y - r - 1) + i0, input.Row(y - r - 1) + i0, inputCount, false, sumI, sumP, sumII, sumIP);
+                SlideWindow(sumI, i0, s0, s1, r, width, winI);
+                SlideWindow(sumII, i0, s0, s1, r, width, winII);
+                if (!selfGuided) {
+                    SlideWindow(sumP, i0, s0, s1, r, width, winP);
+                    SlideWindow(sumIP, i0, s0, s1, r, width, winIP);
+                }
+
+                // Linear coefficients of row y
+                float* a = ringA(y);
+                float* b = a + coefficientCount;
+                float inverseRows = 1.0f / static_cast<float>(WindowCount(y, r, height));
+                const float* inverse = &inverseColumns[s0];
+                int x = 0;
+#ifdef CLEAN3D_SSE2
+                const __m128 rows = _mm_set1_ps(inverseRows);
+                const __m128 eps = _mm_set1_ps(epsilon);
+                for (; x + 4 <= coefficientCount; x += 4) {
+                    __m128 scale = _mm_mul_ps(rows, _mm_loadu_ps(inverse + x));
+                    __m128 meanI = _mm_mul_ps(_mm_cvtepi32_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(winI + x))), scale);
+                    __m128 meanP = _mm_mul_ps(_mm_cvtepi32_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(winP + x))), scale);
+                    __m128 meanII = _mm_mul_ps(_mm_cvtepi32_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(winII + x))), scale);
+                    __m128 meanIP = _mm_mul_ps(_mm_cvtepi32_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(winIP + x))), scale);
+                    __m128 variance = _mm_sub_ps(meanII, _mm_mul_ps(meanI, meanI));
+                    __m128 covariance = _mm_sub_ps(meanIP, _mm_mul_ps(meanI, meanP));
+                    __m128 va = _mm_div_ps(covariance, _mm_add_ps(variance, eps));
+                    _mm_storeu_ps(a + x, va);
+                    _mm_storeu_ps(b + x, _mm_sub_ps(meanP, _mm_mul_ps(va, meanI)));
+                }
+#endif
+                for (; x < coefficientCount; ++x) {
+                    float scale = inverseRows * inverse[x];
+                    float meanI = winI[x] * scale, meanP = winP[x] * scale;
+                    float variance = winII[x] * scale - meanI * meanI;
+                    float covariance = winIP[x] * scale - meanI * meanP;
+                    a[x] = covariance / (variance + epsilon);
+                    b[x] = meanP - a[x] * meanI;
+                }
+
+                // Coefficient sums lag r rows behind: row y - r is complete now
+                AccumulateCoefficients(a, b, coefficientCount, true, sumA, sumB);
+                int ready = y - r;
+                if (ready >= 0) {
+                    if (ready - r - 1 >= 0) {
+                        float* old = ringA(ready - r - 1);
+                        AccumulateCoefficients(old, old + coefficientCount, coefficientCount, false, sumA, sumB);
+                    }
+                    emitRow(ready);
+                }
+            }
+            for (int ready = height - r < 0 ? 0 : height - r; ready < height; ++ready) {
+                if (ready - r - 1 >= 0) {
+                    float* old = ringA(ready - r - 1);
+                    AccumulateCoefficients(old, old + coefficientCount, coefficientCount, false, sumA, sumB);
+                }
+                emitRow(ready);
+            }
+        }
+    });
+}
@@ -0,0 +1,37 @@
+#pragma once
+#include <cstdint>
+#include "CpuImage.h"
+
+// Edge-aware smoothing of depth (He et al., guided image filter). Within every window
+// the output is a linear function of the guide, fitted to the input:
+//
+//   a = cov(I, p) / (var(I) + epsilon),  b = mean(p) - a * mean(I)
+//   q = mean(a) * I + mean(b)
+//
+// Where the guide is flat the depth is averaged over the window; across a guide edge
+// whose contrast is well above sqrt(epsilon) it stays sharp. Thin, dense detail such as
+// text falls below that and is evened out, so glyphs no longer get disparities of their
+// own and tear away from their background.
+//
+// All window means are box filters over running sums, updated by one row in and one
+// row out vertically and one column in and one out horizontally, so the cost per pixel
+// does not depend on the radius.
+
+const int MAX_GUIDED_FILTER_RADIUS = 64;
+
+struct GuidedFilterParams {
+    int radius;         // window is (2 * radius + 1)^2 pixels, 1..MAX_GUIDED_FILTER_RADIUS
+    float epsilon;      // regularization in squared 8-bit units; larger smooths stronger edges
+};
+
+// Default for depth refinement: edges above roughly a quarter of full contrast survive
+const float GUIDED_FILTER_EPSILON = 64.0f * 64.0f;
+
+// Radius the tray menu switches to: about one line of body text
+const int DEFAULT_GUIDED_FILTER_RADIUS = 8;
+
+// Filters 'input' guided by 'guide' into 'output'. All planes share one size and
+// 'output' must not overlap the others. Parallel across column strips. Passing the
+// same plane as guide and input (depth guiding itself) skips half of the sums.
+void GuidedFilter(const ImagePlane<const uint8_t>& guide, const ImagePlane<const uint8_t>& input,
+    const GuidedFilterParams& params, const ImagePlane<uint8_t>& output);
@@ -0,0 +1,133 @@
+#include "LayeredViews.h"
+#include "FrameMemory.h"
+#include "ParallelFor.h"
+#include <cstring>
+
+static inline int ClampLayerCount(int layerCount) {
+    return layerCount < 1 ? 1 : (layerCount > MAX_DEPTH_LAYERS ? MAX_DEPTH_LAYERS : layerCount);
+}
+
+void QuantizeDepthRow(const uint8_t* depth, int width, int layerCount, uint8_t* layer) {
+    // depth * layerCount <= 255 * 64, within 16 bits
+    int x = 0;
+#ifdef CLEAN3D_SSE2
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i count = _mm_set1_epi16(static_cast<short>(layerCount));
+    for (; x + 16 <= width; x += 16) {
+        __m128i d = _mm_loadu_si128(reinterpret_cast<const __m128i*>(depth + x));
+        __m128i lo = _mm_srli_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(d, zero), count), 8);
+        __m128i hi = _mm_srli_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(d, zero), count), 8);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(layer + x), _mm_packus_epi16(lo, hi));
+    }
+#endif
+    for (; x < width; ++x) layer[x] = static_cast<uint8_t>((depth[x] * layerCount) >> 8);
+}
+
+void BuildLayerShifts(int layerCount, int scaleQ8, int convergence, uint8_t* layerDepth, int16_t* layerShift) {
+    for (int k = 0; k < layerCount; ++k) {
+        int centre = ((2 * k + 1) * 256) / (2 * layerCount);
+        layerDepth[k] = static_cast<uint8_t>(centre > 255 ? 255 : centre);
+        layerShift[k] = static_cast<int16_t>(((layerDepth[k] - convergence) * scaleQ8) >> 9);
+    }
+}
+
+// Range of planes present in a layer row, so that flat rows take one or two passes
+static void LayerRange(const uint8_t* layer, int width, int& lowest, int& highest) {
+    uint8_t lo = 255, hi = 0;
+    int x = 0;
+#ifdef CLEAN3D_SSE2
+    if (width >= 16) {
+        __m128i vlo = _mm_set1_epi8(static_cast<char>(0xFF)), vhi = _mm_setzero_si128();
+        for (; x + 16 <= width; x += 16) {
+            __m128i l = _mm_loadu_si128(reinterpret_cast<const __m128i*>(layer + x));
+            vlo = _mm_min_epu8(vlo, l);
+            vhi = _mm_max_epu8(vhi, l);
+        }
+        uint8_t lanes[32];
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(lanes), vlo);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(lanes + 16), vhi);
+        for (int i = 0; i < 16; ++i) {
+            if (lanes[i] < lo) lo = lanes[i];
+            if (lanes[16 + i] > hi) hi = lanes[16 + i];
+        }
+    }
+#endif
+    for (; x < width; ++x) {
+        if (layer[x] < lo) lo = layer[x];
+        if (layer[x] > hi) hi = layer[x];
+    }
+    lowest = lo;
+    highest = hi;
+}
+
+// One plane: every source pixel in plane k is copied to x + shift, the rest of 'dst' is kept
+static void CompositePlaneRow(const uint32_t* src, const uint8_t* layer, uint8_t k, int shift, int depth, int width,
+    uint32_t* dst, int16_t* zrow) {
+    // Source range whose targets land inside the row
+    int first = shift < 0 ? -shift : 0;
+    int end = shift > 0 ? width - shift : width;
+    int x = first;
+#ifdef CLEAN3D_SSE2
+    const __m128i plane = _mm_set1_epi8(static_cast<char>(k));
+    const __m128i z = _mm_set1_epi16(static_cast<short>(depth));
+    for (; x + 16 <= end; x += 16) {
+        __m128i mask = _mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(layer + x)), plane);
+        if (_mm_movemask_epi8(mask) == 0) continue;
+        __m128i mask16[2] = { _mm_unpacklo_epi8(mask, mask), _mm_unpackhi_epi8(mask, mask) };
+        for (int half = 0; half < 2; ++half) {
+            __m128i* zt = reinterpret_cast<__m128i*>(zrow + x + shift + half * 8);
+            __m128i zold = _mm_loadu_si128(zt);
+            _mm_storeu_si128(zt, _mm_or_si128(_mm_and_si128(mask16[half], z), _mm_andnot_si128(mask16[half], zold)));
+            __m128i mask32[2] = { _mm_unpacklo_epi16(mask16[half], mask16[half]), _mm_unpackhi_epi16(mask16[half], mask16[half]) };
+            for (int quarter = 0; quarter < 2; ++quarter) {
+                int offset = x + half * 8 + quarter * 4;
+                __m128i pixels = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + offset));
+                __m128i* target = reinterpret_cast<__m128i*>(dst + offset + shift);
+                __m128i old = _mm_loadu_si128(target);
+                _mm_storeu_si128(target, _mm_or_si128(_mm_and_si128(mask32[quarter], pixels), _mm_andnot_si128(mask32[quarter], old)));
+            }
+        }
+    }
+#endif
+    for (; x < end; ++x) {
+        if (layer[x] != k) continue;
+        dst[x + shift] = src[x];
+        zrow[x + shift] = static_cast<int16_t>(depth);
+    }
+}
+
+void CompositeLayersRow(const uint32_t* src, const uint8_t* layer, const uint8_t* layerDepth, const int16_t* layerShift,
+    int direction, int width, uint32_t* dst, int16_t* zrow) {
+    // Back to front: plane 0 is the farthest, so nearer planes overwrite it
+    int lowest, highest;
+    LayerRange(layer, width, lowest, highest);
+    for (int k = lowest; k <= highest; ++k) {
+        CompositePlaneRow(src, layer, static_cast<uint8_t>(k), direction * layerShift[k], layerDepth[k], width, dst, zrow);
+    }
+}
+
+void SynthesizeLayeredStereo(const ImagePlane<const uint32_t>& frame, const ImagePlane<const uint8_t>& depth,
+    const ViewSynthesisParams& params, const ImagePlane<uint32_t>& left, const ImagePlane<uint32_t>& right) {
+    int layerCount = ClampLayerCount(params.layerCount);
+    uint8_t layerDepth[MAX_DEPTH_LAYERS];
+    int16_t layerShift[MAX_DEPTH_LAYERS];
+    BuildLayerShifts(layerCount, DisparityScaleQ8(params), params.convergence, layerDepth, layerShift);
+    int width = frame.width;
+    FrameArena& arena = FrameArena::ThreadArena();
+    FrameArena::Scope scope(arena);
+    ParallelFor(0, frame.height, [&](int first, int last) {
+        int16_t* zLeft = arena.AllocateArray<int16_t>(static_cast<size_t>(width) * 2);
+        uint8_t* layer = arena.AllocateArray<uint8_t>(width);
+        int16_t* zRight = zLeft + width;
+        for (int y = first; y < last; ++y) {
+            const uint32_t* src = frame.Row(y);
+            QuantizeDepthRow(depth.Row(y), width, layerCount, layer);
+            // -1 in every int16 is all bits set
+            memset(zLeft, 0xFF, sizeof(int16_t) * width * 2);
+            CompositeLayersRow(src, layer, layerDepth, layerShift, 1, width, left.Row(y), zLeft);
+            CompositeLayersRow(src, layer, layerDepth, layerShift, -1, width, right.Row(y), zRight);
+            FillHolesRow(left.Row(y), zLeft, width);
+            FillHolesRow(right.Row(y), zRight, width);
+        }
+    });
+}
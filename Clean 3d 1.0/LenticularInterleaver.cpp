@@ -0,0 +1,144 @@
+#include "LenticularInterleaver.h"
+#include "FrameMemory.h"
+#include "ParallelFor.h"
+#include "ViewSynthesis.h"
+#include <cmath>
+
+// Fraction of a lens as a 16-bit phase; wraps the same way the uint16 sums do
+static inline uint16_t PhaseQ16(double lenses) {
+    double fraction = lenses - std::floor(lenses);
+    return static_cast<uint16_t>(static_cast<uint32_t>(std::lround(fraction * 65536.0)) & 0xFFFF);
+}
+
+static inline int ClampViewCount(int viewCount) {
+    return viewCount < 1 ? 1 : (viewCount > MAX_INTERLEAVED_VIEWS ? MAX_INTERLEAVED_VIEWS : viewCount);
+}
+
+// Lens pitch in subpixels; pixels have three subpixels across
+static inline double LensSubpixels(const LenticularParams& params) {
+    double pixelPitch = params.pixelPitchMm > 0.001f ? params.pixelPitchMm : 0.001;
+    double lens = params.lensPitchMm * 3.0 / pixelPitch;
+    return lens < 1.0 ? 1.0 : lens;
+}
+
+// Position of a memory channel (0 = R, 1 = G, 2 = B) within its pixel, in subpixels
+static inline int SubpixelIndex(SubpixelLayout layout, int channel) {
+    return layout == SubpixelBGR ? 2 - channel : channel;
+}
+
+void LenticularMap::Build(const LenticularParams& params, int width, int height) {
+    m_params = params;
+    m_width = width;
+    m_height = height;
+    m_viewCount = ClampViewCount(params.viewCount);
+    double lens = LensSubpixels(params);
+    m_lensSubpixels = static_cast<float>(lens);
+
+    m_columnPhase.resize(static_cast<size_t>(width) * 3);
+    for (int x = 0; x < width; ++x) {
+        for (int c = 0; c < 3; ++c) {
+            // Subpixel centres
+            m_columnPhase[static_cast<size_t>(x) * 3 + c] = PhaseQ16((3 * x + SubpixelIndex(params.layout, c) + 0.5) / lens);
+        }
+    }
+    m_rowPhase.resize(height);
+    for (int y = 0; y < height; ++y) m_rowPhase[y] = PhaseQ16(-3.0 * y * params.slant / lens);
+    SetPhase(params.phasePx);
+}
+
+bool LenticularMap::Update(const LenticularParams& params, int width, int height) {
+    bool sameGeometry = width == m_width && height == m_height && !m_columnPhase.empty() &&
+        params.viewCount == m_params.viewCount && params.lensPitchMm == m_params.lensPitchMm &&
+        params.pixelPitchMm == m_params.pixelPitchMm && params.slant == m_params.slant && params.layout == m_params.layout;
+    if (sameGeometry) {
+        if (params.phasePx != m_params.phasePx) SetPhase(params.phasePx);
+        return false;
+    }
+    Build(params, width, height);
+    return true;
+}
+
+void LenticularMap::SetPhase(float phasePx) {
+    m_params.phasePx = phasePx;
+    m_headPhase = m_lensSubpixels > 0.0f ? PhaseQ16(3.0 * phasePx / m_lensSubpixels) : 0;
+}
+
+void LenticularMap::ViewRow(int y, uint8_t* view, uint8_t* weight) const {
+    // With the phase p as a 16-bit fraction, p * N has the view in its high 16 bits and
+    // the position within the view in the low ones
+    const uint16_t* column = m_columnPhase.data();
+    uint16_t row = RowPhase(y);
+    int count = m_width * 3;
+    int s = 0;
+#ifdef CLEAN3D_SSE2
+    const __m128i rowPhase = _mm_set1_epi16(static_cast<short>(row));
+    const __m128i views = _mm_set1_epi16(static_cast<short>(m_viewCount));
+    for (; s + 16 <= count; s += 16) {
+        __m128i p0 = _mm_add_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(column + s)), rowPhase);
+        __m128i p1 = _mm_add_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(column + s + 8)), rowPhase);
+        __m128i v = _mm_packus_epi16(_mm_mulhi_epu16(p0, views), _mm_mulhi_epu16(p1, views));
+        __m128i w = _mm_packus_epi16(_mm_srli_epi16(_mm_mullo_epi16(p0, views), 8), _mm_srli_epi16(_mm_mullo_epi16(p1, views), 8));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(view + s), v);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(weight + s), w);
+    }
+#endif
+    for (; s < count; ++s) {
+        uint32_t scaled = static_cast<uint16_t>(column[s] + row) * static_cast<uint32_t>(m_viewCount);
+        view[s] = static_cast<uint8_t>(scaled >> 16);
+        weight[s] = static_cast<uint8_t>(scaled >> 8);
+    }
+}
+
+void Interleave(const ImagePlane<const uint32_t>* views, const LenticularMap& map, bool blend, const ImagePlane<uint32_t>& out) {
+    int width = map.Width();
+    int viewCount = map.ViewCount();
+    FrameArena& arena = FrameArena::ThreadArena();
+    FrameArena::Scope scope(arena);
+    ParallelFor(0, map.Height(), [&](int first, int last) {
+        uint8_t* view = arena.AllocateArray<uint8_t>(static_cast<size_t>(width) * 6);
+        uint8_t* weight = view + width * 3;
+        const uint32_t* rows[MAX_INTERLEAVED_VIEWS];
+        for (int y = first; y < last; ++y) {
+            map.ViewRow(y, view, weight);
+            for (int v = 0; v < viewCount; ++v) rows[v] = views[v].Row(y);
+            uint32_t* dst = out.Row(y);
+            if (!blend) {
+                for (int x = 0; x < width; ++x) {
+                    const uint8_t* v = view + x * 3;
+                    dst[x] = 0xFF000000u | (rows[v[0]][x] & 0xFFu) | (rows[v[1]][x] & 0xFF00u) | (rows[v[2]][x] & 0xFF0000u);
+                }
+                continue;
+            }
+            for (int x = 0; x < width; ++x) {
+                uint32_t px = 0xFF000000u;
+                for (int c = 0; c < 3; ++c) {
+                    int s = x * 3 + c;
+                    int shiftBits = c * 8;
+                    int next = view[s] + 1 == viewCount ? 0 : view[s] + 1;
+                    int a = static_cast<int>((rows[view[s]][x] >> shiftBits) & 0xFF);
+                    int b = static_cast<int>((rows[next][x] >> shiftBits) & 0xFF);
+                    px |= static_cast<uint32_t>(a + (((b - a) * weight[s]) >> 8)) << shiftBits;
+                }
+                dst[x] = px;
+            }
+        }
+    });
+}
+
+void InterleaveReference(const ImagePlane<const uint32_t>* views, const LenticularParams& params, const ImagePlane<uint32_t>& out) {
+    int viewCount = ClampViewCount(params.viewCount);
+    double lens = LensSubpixels(params);
+    for (int y = 0; y < out.height; ++y) {
+        uint32_t* dst = out.Row(y);
+        for (int x = 0; x < out.width; ++x) {
+            uint32_t px = 0xFF000000u;
+            for (int c = 0; c < 3; ++c) {
+                double position = (3 * x + SubpixelIndex(params.layout, c) + 0.5 - 3.0 * y * params.slant + 3.0 * params.phasePx) / lens;
+                int view = static_cast<int>((position - std::floor(position)) * viewCount);
+                if (view >= viewCount) view = viewCount - 1;
+                px |= ((views[view].Row(y)[x] >> (c * 8)) & 0xFF) << (c * 8);
+            }
+            dst[x] = px;
+        }
+    }
+}
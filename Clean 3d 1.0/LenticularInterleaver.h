@@ -0,0 +1,76 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include "CpuImage.h"
+
+// N-view interleaving for slanted lenticular sheets (and barriers, which are the same
+// pattern without the lens). Every subpixel sits at some phase across its lens; the
+// phase picks which of the N views it shows:
+//
+//   phase = frac((subpixel x - 3 * y * slant + 3 * phasePx) / lens pitch in subpixels)
+//   view  = floor(N * phase), weight towards view + 1 = frac(N * phase)
+//
+// LenticularMap stores this as 16-bit fractions of a lens, split into one row of
+// per-subpixel phases, a per-row slant offset and a global head phase. Sizes stay small
+// (24 KB of phases for a 4096 pixel row), a head-tracking update only touches the head
+// phase, and a view index is one add and one high multiply per subpixel.
+
+enum SubpixelLayout {
+    SubpixelRGB,    // red is the leftmost subpixel
+    SubpixelBGR
+};
+
+struct LenticularParams {
+    int viewCount;          // views per lens, 1..MAX_INTERLEAVED_VIEWS
+    float lensPitchMm;      // lens_width
+    float pixelPitchMm;     // pixel_pitch_mm
+    float slant;            // horizontal lens shift per pixel row, in pixels (tangent of the slant angle)
+    SubpixelLayout layout;
+    float phasePx;          // stripe_offset_px + head_offset_x
+};
+
+class LenticularMap {
+public:
+    LenticularMap() : m_width(0), m_height(0), m_viewCount(0), m_headPhase(0), m_lensSubpixels(0.0f) {}
+
+    // Full rebuild of the phase tables. Only needed when the geometry or size changes.
+    void Build(const LenticularParams& params, int width, int height);
+
+    // Rebuilds if the geometry or size differs from the last Build, otherwise only moves
+    // the head phase. Returns true if the tables were rebuilt.
+    bool Update(const LenticularParams& params, int width, int height);
+
+    // Head tracking: shifts every subpixel by the same phase; O(1).
+    void SetPhase(float phasePx);
+
+    int Width() const { return m_width; }
+    int Height() const { return m_height; }
+    int ViewCount() const { return m_viewCount; }
+
+    // Phase of each memory channel (R, G, B) of each pixel in row 0: 3 * width entries
+    const uint16_t* ColumnPhases() const { return m_columnPhase.data(); }
+    // Phase added for row y, including the head phase
+    uint16_t RowPhase(int y) const { return static_cast<uint16_t>(m_rowPhase[y] + m_headPhase); }
+
+    // View index and Q8 weight towards the next view for the 3 * width subpixels of row y
+    void ViewRow(int y, uint8_t* view, uint8_t* weight) const;
+
+private:
+    std::vector<uint16_t> m_columnPhase;
+    std::vector<uint16_t> m_rowPhase;
+    int m_width;
+    int m_height;
+    int m_viewCount;
+    uint16_t m_headPhase;
+    float m_lensSubpixels;
+    LenticularParams m_params;
+};
+
+// Table gather: each subpixel of 'out' is copied from the view the map assigns to it,
+// blended with the next view by the map's weight if 'blend' is set. All planes must
+// match the map's size. Parallel across rows.
+void Interleave(const ImagePlane<const uint32_t>* views, const LenticularMap& map, bool blend, const ImagePlane<uint32_t>& out);
+
+// The same selection computed per subpixel in floating point, without a map. Slow;
+// kept as the reference for the table version and for benchmarking.
+void InterleaveReference(const ImagePlane<const uint32_t>* views, const LenticularParams& params, const ImagePlane<uint32_t>& out);
@@ -5,6 +5,7 @@
 #include <d3d12.h>
 #include <dxgi1_6.h>
 #include <d3dcompiler.h>
+#include <algorithm>
 #include <vector>
 #include <chrono>
 #include <thread>
@@ -17,8 +18,31 @@
 #include <dxgidebug.h>
 #include <wrl.h>
 #include <d3d11.h>
+#include <ShellScalingApi.h>
+#include <dwmapi.h>
 #include <fstream>
+#include <cstddef>
 #include <cstdlib>
+#include <future>
+#include "StartupProfiler.h"
+#include "AdapterSelection.h"
+#include "DeviceRecovery.h"
+#include "SurfacePool.h"
+#include "OutputScheduler.h"
+#include "ParallelFor.h"
+#include "ViewSynthesis.h"
+#include "DepthOfField.h"
+#include "LayeredViews.h"
+#include "LenticularInterleaver.h"
+#include "MipPyramid.h"
+#include "ReducedResolution.h"
+#include "ResolutionController.h"
+#include "EffectGovernor.h"
+#include "FrameAccounting.h"
+#include "FramePacer.h"
+#include "EdgeOutline.h"
+#include "FogScatter.h"
+#include "AllocationTracker.h"
 
 #pragma comment(lib, "gdi32.lib")
 #pragma comment(lib, "user32.lib")
@@ -28,6 +52,9 @@
 #pragma comment(lib, "dxguid.lib")
 #pragma comment(lib, "d3d12.lib")
 #pragma comment(lib, "d3d11.lib")
+#pragma comment(lib, "Shcore.lib")
+#pragma comment(lib, "dwmapi.lib")
+#pragma comment(lib, "winmm.lib")
 
 #define CHECK_HR(hr, msg) \
     if (FAILED(hr)) { \
@@ -39,17 +66,28 @@
 
 #define SAFE_RELEASE(p) if (p) { (p)->Release(); (p) = nullptr; }
 
+template <typename T>
+static void ReleaseComObject(T* object) { object->Release(); }
+
 static UINT SCREEN_WIDTH = 4096;  // Updated for your 4096x2160 screen
 static UINT SCREEN_HEIGHT = 2160;
 const UINT TARGET_FPS = 140;
+const double STAGE_BUDGET_SHARE = 0.75;   // of a TARGET_FPS frame, for depth and view synthesis; the rest is map, copy and upload
 const UINT FRAME_COUNT = 3;
 const int MAX_RECOVERY_ATTEMPTS = 3;
+const size_t SURFACE_POOL_CAPACITY = 2 + FRAME_SOURCE_SLOTS;   // both eye textures + upload slots for the previous mode
+const size_t STAGING_POOL_CAPACITY = 2;
+static const char* ADAPTER_CACHE_FILE = "adapter_cache.txt";
+static const char* EFFECT_COSTS_FILE = "effect_costs.txt";   // written by Clean3dBench --sweep
 
 static std::ofstream logFile("debug_log.txt", std::ios::app);
+static std::mutex logMutex; // Log is called from the render thread and init workers
 static bool enableLogging = true;
+static StartupProfiler startupProfiler;
 
 void Log(const char* msg) {
     if (enableLogging) {
+        std::lock_guard<std::mutex> lock(logMutex);
         logFile << msg;
         logFile.flush();
         OutputDebugStringA(msg);
@@ -87,20 +125,159 @@ struct IllusionConfig {
     uint8_t enable_parallax_barrier;
     uint8_t enable_lenticular;
     uint8_t enable_volumetric_fog;
-    uint8_t padding[41];
+    // View synthesis
+    float eye_separation;    // disparity between the eyes across the full depth range, in pixels
+    // Barrier/lenticular stripe pattern, in pixels: PSMain shows the view of stripe
+    // floor((x + stripe_offset_px + head_offset_x) / stripe_width_px) at screen column x
+    float stripe_width_px;
+    float stripe_offset_px;
+    float head_offset_x;
+    // Lenticular sheet geometry (see LenticularInterleaver.h)
+    float pixel_pitch_mm;    // 0 = from the monitor's DPI
+    float lens_width;        // lens pitch in mm, 0 = lens_view_count stripes of stripe_width_px
+    float lens_slant;        // horizontal lens shift per pixel row, in pixels
+    uint8_t lens_view_count;
+    uint8_t subpixel_layout; // SubpixelLayout
+    uint8_t depth_layers;    // 0 = per-pixel view warp, else depth planes shifted as blocks (LayeredViews.h)
+    uint8_t depth_update_interval; // 0 = fresh depth every frame, else accumulated with temporal_blend (TemporalDepth.h)
+    uint8_t depth_refine_radius;   // 0 = off, else guided filter radius in pixels (GuidedFilter.h)
+    uint8_t dof_radius;            // blur radius in pixels away from focus with enable_dof (DepthOfField.h)
+    uint8_t adaptive_resolution;   // 0 = depth at ProcessingScale(processing_quality), else as ResolutionController picks
+    uint8_t shed_effects;          // 0 = effects as configured, else EffectGovernor drops fog steps, outline and depth passes under load
+    float barrier_opacity;         // darkening of the stripes the other eye sees, 0..1 (PixelShader.hlsl)
+    uint8_t padding[1];
 };
 #pragma pack(pop)
 static_assert(sizeof(IllusionConfig) == 128, "IllusionConfig must be 128 bytes");
 
+// The constant buffer as PixelShader.hlsl and FogCompute.hlsl declare it. Every field takes
+// 4 bytes in cbuffer order, so its offsets are the HLSL ones; IllusionConfig is packed with
+// byte flags and cannot be uploaded as it is.
+struct GpuConfig {
+    float depth_intensity;
+    float parallax_strength;
+    float alpha;
+    float edge_depth_influence;
+    float color_separation;
+    float perspective_strength;
+    uint32_t enable_gpu;
+    int32_t processing_quality;
+    uint32_t enable_chromatic;
+    uint32_t enable_parallax;
+    uint32_t enable_dof;
+    float time;
+    float occlusion_strength;
+    float wiggle_frequency;
+    float fog_density;
+    float fog_color_r;
+    float fog_color_g;
+    float fog_color_b;
+    float fog_scatter;
+    float fog_anisotropy;
+    float fog_height_falloff;
+    float temporal_blend;
+    float outline_width;
+    float outline_intensity;
+    uint32_t enable_parallax_barrier;
+    uint32_t enable_lenticular;
+    uint32_t enable_volumetric_fog;
+    float strip_width;
+    float barrier_width;
+    float lens_width;
+    float eye_separation;
+    float screen_width;
+    float screen_height;
+    float head_offset_x;
+    uint32_t enable_test_pattern;
+    float barrier_opacity;
+    float pixel_pitch_mm;
+    float stripe_width_px;
+    float stripe_offset_px;
+};
+// Offsets of the fields the shaders read, as the HLSL packing places them
+static_assert(offsetof(GpuConfig, alpha) == 8, "GpuConfig::alpha must match the cbuffer");
+static_assert(offsetof(GpuConfig, edge_depth_influence) == 12, "GpuConfig::edge_depth_influence must match the cbuffer");
+static_assert(offsetof(GpuConfig, processing_quality) == 28, "GpuConfig::processing_quality must match the cbuffer");
+static_assert(offsetof(GpuConfig, time) == 44, "GpuConfig::time must match the cbuffer");
+static_assert(offsetof(GpuConfig, wiggle_frequency) == 52, "GpuConfig::wiggle_frequency must match the cbuffer");
+static_assert(offsetof(GpuConfig, fog_density) == 56, "GpuConfig::fog_density must match the cbuffer");
+static_assert(offsetof(GpuConfig, fog_color_r) == 60, "GpuConfig::fog_color_r must match the cbuffer");
+static_assert(offsetof(GpuConfig, fog_color_g) == 64, "GpuConfig::fog_color_g must match the cbuffer");
+static_assert(offsetof(GpuConfig, fog_color_b) == 68, "GpuConfig::fog_color_b must match the cbuffer");
+static_assert(offsetof(GpuConfig, fog_scatter) == 72, "GpuConfig::fog_scatter must match the cbuffer");
+static_assert(offsetof(GpuConfig, fog_anisotropy) == 76, "GpuConfig::fog_anisotropy must match the cbuffer");
+static_assert(offsetof(GpuConfig, fog_height_falloff) == 80, "GpuConfig::fog_height_falloff must match the cbuffer");
+static_assert(offsetof(GpuConfig, temporal_blend) == 84, "GpuConfig::temporal_blend must match the cbuffer");
+static_assert(offsetof(GpuConfig, outline_width) == 88, "GpuConfig::outline_width must match the cbuffer");
+static_assert(offsetof(GpuConfig, outline_intensity) == 92, "GpuConfig::outline_intensity must match the cbuffer");
+static_assert(offsetof(GpuConfig, enable_volumetric_fog) == 104, "GpuConfig::enable_volumetric_fog must match the cbuffer");
+static_assert(offsetof(GpuConfig, screen_width) == 124, "GpuConfig::screen_width must match the cbuffer");
+static_assert(offsetof(GpuConfig, screen_height) == 128, "GpuConfig::screen_height must match the cbuffer");
+static_assert(offsetof(GpuConfig, head_offset_x) == 132, "GpuConfig::head_offset_x must match the cbuffer");
+static_assert(offsetof(GpuConfig, barrier_opacity) == 140, "GpuConfig::barrier_opacity must match the cbuffer");
+static_assert(offsetof(GpuConfig, stripe_width_px) == 148, "GpuConfig::stripe_width_px must match the cbuffer");
+static_assert(offsetof(GpuConfig, stripe_offset_px) == 152, "GpuConfig::stripe_offset_px must match the cbuffer");
+static_assert(sizeof(GpuConfig) == 156, "GpuConfig must end where the cbuffer does");
+
+// The per-output config as the shaders take it, for a width x height output
+static GpuConfig MakeGpuConfig(const IllusionConfig& source, UINT width, UINT height) {
+    GpuConfig gpu = {};
+    gpu.depth_intensity = source.depth_intensity;
+    gpu.parallax_strength = source.parallax_strength;
+    gpu.alpha = source.alpha;
+    gpu.edge_depth_influence = source.edge_depth_influence;
+    gpu.color_separation = source.color_separation;
+    gpu.perspective_strength = source.perspective_strength;
+    gpu.enable_gpu = source.enable_gpu;
+    gpu.processing_quality = source.processing_quality;
+    gpu.enable_chromatic = source.enable_chromatic;
+    gpu.enable_parallax = source.enable_parallax;
+    gpu.enable_dof = source.enable_dof;
+    gpu.time = source.time;
+    gpu.occlusion_strength = source.occlusion_strength;
+    gpu.wiggle_frequency = source.wiggle_frequency;
+    gpu.fog_density = source.fog_density;
+    gpu.fog_color_r = source.fog_color_r;
+    gpu.fog_color_g = source.fog_color_g;
+    gpu.fog_color_b = source.fog_color_b;
+    gpu.fog_scatter = source.fog_scatter;
+    gpu.fog_anisotropy = source.fog_anisotropy;
+    gpu.fog_height_falloff = source.fog_height_falloff;
+    gpu.temporal_blend = source.temporal_blend;
+    gpu.outline_width = source.outline_width;
+    gpu.outline_intensity = source.outline_intensity;
+    gpu.enable_parallax_barrier = source.enable_parallax_barrier;
+    gpu.enable_lenticular = source.enable_lenticular;
+    gpu.enable_volumetric_fog = source.enable_volumetric_fog;
+    gpu.lens_width = source.lens_width;
+    gpu.eye_separation = source.eye_separation;
+    gpu.screen_width = static_cast<float>(width);
+    gpu.screen_height = static_cast<float>(height);
+    gpu.head_offset_x = source.head_offset_x;
+    gpu.barrier_opacity = source.barrier_opacity;
+    gpu.pixel_pitch_mm = source.pixel_pitch_mm;
+    gpu.stripe_width_px = source.stripe_width_px;
+    gpu.stripe_offset_px = source.stripe_offset_px;
+    return gpu;
+}
+
 static const IllusionConfig defaultConfig = {
     1200.0f, 1260.0f, 0.95f, 1000.0f, 12.0f, 160.0f,
-    1, 3, 1, 1, 1,
+    1, 3, 0, 1, 0,
     0.016f, 0.75f, 12.0f,
     // fog defaults
     100.02f, 0.6f, 0.65f, 0.7f, 0.5f, 1000.0f, 1.0f, 0.9f,
     // outline defaults
     2.06f, 1000.85f,
     1, 1, 1,
+    // view synthesis defaults
+    24.0f,
+    1.0f, 0.0f, 0.0f,
+    // lenticular defaults
+    0.0f, 0.0f, 0.0f, 2, SubpixelRGB,
+    0, 0, 0, DEFAULT_DOF_RADIUS,
+    1, 1,
+    1.0f,
     {0}
 };
 
@@ -120,61 +297,611 @@ private:
     HRESULT m_hr;
 };
 
-class D3D12Renderer {
+// QPC ticks (LastPresentTime, DWM timing, D3D12 clock calibration) to SteadyClockMs,
+// through the current time on both clocks
+static double QpcToSteadyMs(LONGLONG qpc) {
+    LARGE_INTEGER now, frequency;
+    if (!QueryPerformanceCounter(&now) || !QueryPerformanceFrequency(&frequency)) return 0.0;
+    return SteadyClockMs() - (now.QuadPart - qpc) * 1000.0 / frequency.QuadPart;
+}
+
+enum DuplicationStatus {
+    DuplicationReady,        // duplication (or at least the staging texture) is set up
+    DuplicationNoOutput,     // no IDXGIOutput1, use the checkerboard fallback
+    DuplicationDeviceFailed  // D3D11 device creation failed
+};
+
+// A monitor the overlay covers, as found by EnumDisplayMonitors. The primary monitor comes first.
+struct MonitorTarget {
+    HMONITOR monitor;
+    RECT rect;
+};
+
+// Everything that belongs to one monitor. The capture side (D3D11 device, duplication,
+// staging texture) is driven by this output's capture thread through FrameSource; the
+// D3D12 side (swap chain, screen texture, upload slots, constant buffers) is only touched
+// by the render thread, or while the output's capture is paused. The D3D12 device, queue,
+// root signatures and PSOs are shared by all outputs and live in D3D12Renderer.
+struct OutputContext : public FrameSource {
+    OutputContext(int outputIndex, const MonitorTarget& target)
+        : index(outputIndex), monitor(target.monitor), monitorRect(target.rect), hwnd(nullptr), dpi(96),
+        width(target.rect.right - target.rect.left), height(target.rect.bottom - target.rect.top),
+        pixelScale(1.0f), swapChain(nullptr), rtvHeap(nullptr), srvHeap(nullptr), screenTexture(nullptr), rightEyeTexture(nullptr), frameIndex(0),
+        fenceValue(0), pendingSlot(-1), uploadPitch(0), d3d11Device(nullptr), d3d11Context(nullptr),
+        duplication(nullptr), stagingTexture(nullptr), stagingPool(STAGING_POOL_CAPACITY, ReleaseComObject<ID3D11Texture2D>),
+        timestampHeap(nullptr), timestampReadback(nullptr), timestampsPending(false), gpuFrameMs(0.0f),
+        cpuFrameMs(0.0f), grantedDepthInterval(1), shownFresh(false), presentedFresh(false), presentedPending(false), gpuDoneMs(0.0),
+        captureSequence(0), desktopFrames(0), desktopCaptures(0),
+        captureWidth(0), captureHeight(0), duplicationStatus(DuplicationDeviceFailed), reopenRequested(false), resizePending(false) {
+        for (UINT i = 0; i < FRAME_COUNT; i++) {
+            renderTargets[i] = nullptr;
+            commandAllocators[i] = nullptr;
+            constantBuffers[i] = nullptr;
+            mappedConstantData[i] = nullptr;
+        }
+        for (int i = 0; i < FRAME_SOURCE_SLOTS; i++) {
+            uploadBuffers[i] = nullptr;
+            mappedUpload[i] = nullptr;
+            slotInterleaved[i] = false;
+            slotFrames[i] = FrameRecord();
+        }
+        shownFrame = FrameRecord();
+        presentedFrame = FrameRecord();
+        frameConfig = config;
+    }
+
+    ~OutputContext() { ReleaseCaptureObjects(); }
+
+    // Runs on a worker thread at start-up: D3D11 device on the adapter that drives this
+    // monitor, then the duplication and staging texture. One D3D11 device per output keeps
+    // the capture threads off each other's immediate context.
+    DuplicationStatus SetupDuplication() {
+        auto begin = StartupProfiler::Now();
+        IDXGIAdapter1* adapter = NULL;
+        IDXGIOutput1* output = NULL;
+        FindDxgiOutput(&adapter, &output);
+        SAFE_RELEASE(output);
+
+        D3D_FEATURE_LEVEL featureLevels[] = { D3D_FEATURE_LEVEL_11_0 };
+        HRESULT hr = D3D11CreateDevice(adapter, adapter ? D3D_DRIVER_TYPE_UNKNOWN : D3D_DRIVER_TYPE_HARDWARE, NULL, D3D11_CREATE_DEVICE_BGRA_SUPPORT,
+            featureLevels, 1, D3D11_SDK_VERSION, &d3d11Device, NULL, &d3d11Context);
+        SAFE_RELEASE(adapter);
+        if (FAILED(hr)) {
+            Log("Failed to create D3D11 device for desktop duplication\n");
+            return DuplicationDeviceFailed;
+        }
+
+        DuplicationStatus status = DuplicateDesktop();
+        if (status == DuplicationReady) startupProfiler.Record("D3D11 duplication setup", begin, true);
+        return status;
+    }
+
+    // Output duplication and the staging texture on the existing D3D11 device. Also used
+    // by the capture thread to re-duplicate after DXGI_ERROR_ACCESS_LOST.
+    DuplicationStatus DuplicateDesktop() {
+        IDXGIAdapter1* adapter = NULL;
+        IDXGIOutput1* output1 = NULL;
+        FindDxgiOutput(&adapter, &output1);
+        SAFE_RELEASE(adapter);
+        if (!output1) {
+            Log("Failed to get IDXGIOutput1, using fallback checkerboard\n");
+            return DuplicationNoOutput;
+        }
+
+        captureWidth = monitorRect.right - monitorRect.left;
+        captureHeight = monitorRect.bottom - monitorRect.top;
+        duplication = NULL;
+        HRESULT hr = output1->DuplicateOutput(d3d11Device, &duplication);
+        SAFE_RELEASE(output1);
+        if (FAILED(hr)) {
+            Log("DuplicateOutput failed, falling back to checkerboard\n");
+        }
+        else {
+            DXGI_OUTDUPL_DESC duplDesc;
+            duplication->GetDesc(&duplDesc);
+            captureWidth = duplDesc.ModeDesc.Width;
+            captureHeight = duplDesc.ModeDesc.Height;
+        }
+
+        SurfaceKey stagingKey = { captureWidth, captureHeight, 0 };
+        stagingTexture = stagingPool.Acquire(stagingKey);
+        if (!stagingTexture) {
+            D3D11_TEXTURE2D_DESC stagingDesc = {};
+            stagingDesc.Width = captureWidth;
+            stagingDesc.Height = captureHeight;
+            stagingDesc.MipLevels = 1;
+            stagingDesc.ArraySize = 1;
+            stagingDesc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+            stagingDesc.SampleDesc.Count = 1;
+            stagingDesc.Usage = D3D11_USAGE_STAGING;
+            stagingDesc.CPUAccessFlags = D3D11_CPU_ACCESS_READ;
+            CHECK_HR(d3d11Device->CreateTexture2D(&stagingDesc, NULL, &stagingTexture), "Create D3D11 staging texture failed");
+        }
+        return DuplicationReady;
+    }
+
+    // FrameSource: capture thread. Copies the next desktop frame into upload slot 'slot'.
+    FrameStatus CaptureInto(int slot, uint32_t timeoutMs) override {
+        if (resizePending) {
+            // The render thread has not resized the upload slots to the new mode yet
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            return FrameTimeout;
+        }
+        if (reopenRequested.exchange(false)) return FrameLost;
+        if (!duplication || !stagingTexture || !mappedUpload[slot]) return FrameLost;
+
+        DXGI_OUTDUPL_FRAME_INFO frameInfo;
+        IDXGIResource* desktopResource = NULL;
+        HRESULT hr = duplication->AcquireNextFrame(timeoutMs, &frameInfo, &desktopResource);
+        double acquiredMs = SteadyClockMs();
+        if (FAILED(hr)) {
+            // Do not call ReleaseFrame() here because AcquireNextFrame failed and no frame has been acquired
+            if (hr == DXGI_ERROR_WAIT_TIMEOUT) return FrameTimeout;
+            if (hr == DXGI_ERROR_ACCESS_LOST) {
+                // Mode change, desktop switch or full-screen app: duplication must be recreated
+                Log("Desktop duplication access lost\n");
+                return FrameLost;
+            }
+            char buf[128];
+            sprintf_s(buf, "AcquireNextFrame failed on output %d (HR: 0x%08X)\n", index, hr);
+            Log(buf);
+            return FrameFailed;
+        }
+
+        if (!desktopResource) {
+            Log("AcquireNextFrame returned no desktop resource\n");
+            duplication->ReleaseFrame();
+            return FrameFailed;
+        }
+
+        ID3D11Texture2D* d3d11Texture = NULL;
+        hr = desktopResource->QueryInterface(IID_PPV_ARGS(&d3d11Texture));
+        SAFE_RELEASE(desktopResource);
+        if (FAILED(hr) || !d3d11Texture) {
+            duplication->ReleaseFrame();
+            Log("Desktop resource QueryInterface failed\n");
+            return FrameFailed;
+        }
+
+        D3D11_TEXTURE2D_DESC desktopDesc;
+        d3d11Texture->GetDesc(&desktopDesc);
+        if (desktopDesc.Width != captureWidth || desktopDesc.Height != captureHeight) {
+            SAFE_RELEASE(d3d11Texture);
+            duplication->ReleaseFrame();
+            Log("Desktop size changed\n");
+            return FrameLost;
+        }
+
+        d3d11Context->CopyResource(stagingTexture, d3d11Texture);
+        SAFE_RELEASE(d3d11Texture);
+        CollectFrameChanges(frameInfo);
+        bool copied = CopyStagingToSlot(slot);
+        duplication->ReleaseFrame();
+        if (!copied) return FrameFailed;
+        StampCapture(slot, frameInfo, acquiredMs);
+        return FrameReady;
+    }
+
+    // The slot's FrameRecord, as far as the capture thread can fill it in
+    void StampCapture(int slot, const DXGI_OUTDUPL_FRAME_INFO& frameInfo, double acquiredMs) {
+        desktopFrames += frameInfo.AccumulatedFrames;
+        if (frameInfo.LastPresentTime.QuadPart != 0) desktopCaptures++;
+        FrameRecord& record = slotFrames[slot];
+        record.sequence = ++captureSequence;
+        record.desktopFrames = desktopFrames;
+        record.desktopCaptures = desktopCaptures;
+        record.desktopPresentMs = frameInfo.LastPresentTime.QuadPart != 0 ? QpcToSteadyMs(frameInfo.LastPresentTime.QuadPart) : 0.0;
+        record.acquiredMs = acquiredMs;
+        record.uploadedMs = SteadyClockMs();
+        record.gpuDoneMs = 0.0;
+        record.presentedMs = 0.0;
+    }
+
+    // Reads the acquired frame's move and dirty rects into frameChanges. Without them the
+    // depth history has to look at the whole frame.
+    void CollectFrameChanges(const DXGI_OUTDUPL_FRAME_INFO& frameInfo) {
+        frameChanges.moves.clear();
+        frameChanges.dirty.clear();
+        frameChanges.dirtyKnown = false;
+        if (frameInfo.LastPresentTime.QuadPart == 0) {
+            // Only the pointer changed; the desktop image is the same
+            frameChanges.dirtyKnown = true;
+            return;
+        }
+        if (frameInfo.TotalMetadataBufferSize == 0) return;
+        if (frameMetadata.size() < frameInfo.TotalMetadataBufferSize) frameMetadata.resize(frameInfo.TotalMetadataBufferSize);
+
+        UINT moveBytes = 0;
+        DXGI_OUTDUPL_MOVE_RECT* moves = reinterpret_cast<DXGI_OUTDUPL_MOVE_RECT*>(frameMetadata.data());
+        if (FAILED(duplication->GetFrameMoveRects(static_cast<UINT>(frameMetadata.size()), moves, &moveBytes))) return;
+        for (UINT i = 0; i < moveBytes / sizeof(DXGI_OUTDUPL_MOVE_RECT); ++i) {
+            const RECT& r = moves[i].DestinationRect;
+            DepthMove move = { { r.left, r.top, r.right, r.bottom }, moves[i].SourcePoint.x, moves[i].SourcePoint.y };
+            frameChanges.moves.push_back(move);
+        }
+        UINT dirtyBytes = 0;
+        RECT* dirty = reinterpret_cast<RECT*>(frameMetadata.data() + moveBytes);
+        if (FAILED(duplication->GetFrameDirtyRects(static_cast<UINT>(frameMetadata.size() - moveBytes), dirty, &dirtyBytes))) return;
+        for (UINT i = 0; i < dirtyBytes / sizeof(RECT); ++i) {
+            DepthRect rect = { dirty[i].left, dirty[i].top, dirty[i].right, dirty[i].bottom };
+            frameChanges.dirty.push_back(rect);
+        }
+        frameChanges.dirtyKnown = true;
+    }
+
+    // FrameSource: capture thread, after FrameLost.
+    bool Reopen() override {
+        synthesizer.ResetDepthHistory();
+        if (!d3d11Device || FAILED(d3d11Device->GetDeviceRemovedReason())) {
+            // The capture device went with a driver reset; start over on a new one
+            ReleaseCaptureObjects();
+            duplicationStatus = SetupDuplication();
+        }
+        else {
+            SAFE_RELEASE(duplication);
+            SurfaceKey stagingKey = { captureWidth, captureHeight, 0 };
+            stagingPool.Release(stagingKey, stagingTexture);
+            stagingTexture = nullptr;
+            duplicationStatus = DuplicateDesktop();
+        }
+        if (!duplication) return false;
+        if (captureWidth != width || captureHeight != height) {
+            resizePending = true;
+        }
+        return true;
+    }
+
+    // Copies the staging texture into an upload slot using the slot's aligned row pitch.
+    // With parallax on, the slot's two eye planes get views synthesized from the frame's
+    // estimated depth; otherwise both get the frame as is. Behind a barrier only the view
+    // visible in each column is synthesized, behind a lenticular sheet the view visible at
+    // each subpixel, into the left plane alone.
+    bool CopyStagingToSlot(int slot) {
+        if (!d3d11Context || !stagingTexture || !mappedUpload[slot]) return false;
+        D3D11_MAPPED_SUBRESOURCE mappedResource;
+        if (FAILED(d3d11Context->Map(stagingTexture, 0, D3D11_MAP_READ, 0, &mappedResource))) {
+            Log("Map staging texture failed\n");
+            return false;
+        }
+        uint8_t* left = mappedUpload[slot];
+        uint8_t* right = mappedUpload[slot] + EyePlaneBytes();
+        slotInterleaved[slot] = false;
+        if (config.enable_parallax && captureWidth == width && captureHeight == height) {
+            ImagePlane<const uint32_t> frame = { static_cast<const uint32_t*>(mappedResource.pData), static_cast<int>(width), static_cast<int>(height), mappedResource.RowPitch };
+            ImagePlane<uint32_t> leftPlane = { reinterpret_cast<uint32_t*>(left), static_cast<int>(width), static_cast<int>(height), uploadPitch };
+            synthesizer.SetDepthHistory(DepthHistoryParams(), &frameChanges);
+            synthesizer.SetDepthRefinement(DepthRefinementParams());
+            UpdateResolutionLimits();
+            synthesizer.SetProcessingScale(resolution.Scale(ResolutionDepth));
+            synthesizer.SetStageTimer(&resolution);
+            synthesizer.SetDepthOfField(FocusParams());
+            if (config.enable_lenticular) {
+                lenticularMap.Update(LensParams(), static_cast<int>(width), static_cast<int>(height));
+                synthesizer.ProcessLenticular(frame, ViewParams(), lenticularMap, leftPlane);
+                slotInterleaved[slot] = true;
+            }
+            else if (config.enable_parallax_barrier) {
+                synthesizer.ProcessInterleaved(frame, ViewParams(), InterleaveParams(), leftPlane);
+                slotInterleaved[slot] = true;
+            }
+            else {
+                ImagePlane<uint32_t> rightPlane = { reinterpret_cast<uint32_t*>(right), static_cast<int>(width), static_cast<int>(height), uploadPitch };
+                synthesizer.Process(frame, ViewParams(), leftPlane, rightPlane);
+            }
+            d3d11Context->Unmap(stagingTexture, 0);
+            bool rescaled = resolution.EndFrame();
+            cpuFrameMs.store(static_cast<float>(resolution.FrameMs()));
+            if (rescaled) {
+                char buffer[128];
+                sprintf_s(buffer, "Output %d depth at 1/%d (depth %.2f ms, views %.2f ms, budget %.2f ms)\n", index,
+                    resolution.Scale(ResolutionDepth), resolution.StageMs(ResolutionDepth), resolution.StageMs(ResolutionViews),
+                    resolution.Budget());
+                Log(buffer);
+            }
+            return true;
+        }
+
+        // The history would miss this frame's changes
+        synthesizer.ResetDepthHistory();
+        cpuFrameMs.store(0.0f);
+
+        // Safe pitch-aware copy (use min of row sizes)
+        size_t rowBytes = static_cast<size_t>(width) * 4;
+        UINT rows = captureHeight < height ? captureHeight : height;
+        ParallelFor(0, static_cast<int>(rows), [&](int first, int last) {
+            for (int y = first; y < last; y++) {
+                uint8_t* src = static_cast<uint8_t*>(mappedResource.pData) + static_cast<size_t>(y) * mappedResource.RowPitch;
+                uint8_t* dst = left + static_cast<size_t>(y) * uploadPitch;
+                size_t copyBytes = (mappedResource.RowPitch < static_cast<UINT>(rowBytes)) ? mappedResource.RowPitch : rowBytes;
+                memcpy(dst, src, copyBytes);
+                if (copyBytes < rowBytes) {
+                    // zero remaining bytes to avoid garbage
+                    memset(dst + copyBytes, 0, rowBytes - copyBytes);
+                }
+                memcpy(right + static_cast<size_t>(y) * uploadPitch, dst, rowBytes);
+            }
+        });
+        d3d11Context->Unmap(stagingTexture, 0);
+        return true;
+    }
+
+    // Only depth has a reduced path in the overlay: view synthesis stays at full resolution
+    // and its time counts against the budget. The overlay runs no fog (FogAvailable), so
+    // ResolutionFog is never timed and stays at its finest scale, costing nothing.
+    void UpdateResolutionLimits() {
+        int quality = ProcessingScale(config.processing_quality);
+        resolution.SetBudget(STAGE_BUDGET_SHARE * 1000.0 / TARGET_FPS);
+        if (config.adaptive_resolution) resolution.SetStageLimits(ResolutionDepth, 1, RESOLUTION_MAX_SCALE);
+        else resolution.SetStageLimits(ResolutionDepth, quality, quality);
+        resolution.SetStageLimits(ResolutionViews, 1, 1);
+    }
+
+    // Bytes of one eye's image in an upload slot. The right eye follows the left, at an
+    // offset CopyTextureRegion accepts.
+    size_t EyePlaneBytes() const {
+        size_t bytes = static_cast<size_t>(uploadPitch) * height;
+        return (bytes + D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT - 1) & ~static_cast<size_t>(D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT - 1);
+    }
+
+    ViewSynthesisParams ViewParams() const {
+        ViewSynthesisParams params;
+        params.eyeSeparationPx = config.eye_separation * pixelScale;
+        params.parallaxStrength = config.parallax_strength / defaultConfig.parallax_strength;
+        params.convergence = VIEW_CONVERGENCE_DEPTH;
+        params.layerCount = config.depth_layers;
+        return params;
+    }
+
+    // Two views, the same stripes PixelShader.hlsl selects between
+    InterleavePattern InterleaveParams() const {
+        InterleavePattern pattern;
+        pattern.viewCount = 2;
+        pattern.stripeWidthPx = config.stripe_width_px * pixelScale;
+        pattern.phasePx = (config.stripe_offset_px + config.head_offset_x) * pixelScale;
+        return pattern;
+    }
+
+    TemporalDepthParams DepthHistoryParams() const {
+        TemporalDepthParams params;
+        // EffectGovernor may stretch the refresh; 1 leaves the config's choice, fresh depth included
+        int interval = grantedDepthInterval.load();
+        params.updateInterval = interval > 1 ? interval : config.depth_update_interval;
+        params.historyWeight = config.temporal_blend < 0.0f ? 0.0f : (config.temporal_blend > 0.99f ? 0.99f : config.temporal_blend);
+        params.changeThreshold = DEPTH_CHANGE_THRESHOLD;
+        return params;
+    }
+
+    // Blur and color fringes grow away from the screen plane, so text on it stays crisp
+    DepthOfFieldParams FocusParams() const {
+        DepthOfFieldParams params;
+        params.maxRadius = config.enable_dof ? static_cast<int>(config.dof_radius * pixelScale + 0.5f) : 0;
+        params.separation = config.enable_chromatic ? config.color_separation * pixelScale : 0.0f;
+        params.focus = VIEW_CONVERGENCE_DEPTH;
+        return params;
+    }
+
+    GuidedFilterParams DepthRefinementParams() const {
+        GuidedFilterParams params;
+        int radius = static_cast<int>(config.depth_refine_radius * pixelScale + 0.5f);
+        params.radius = radius > MAX_GUIDED_FILTER_RADIUS ? MAX_GUIDED_FILTER_RADIUS : radius;
+        params.epsilon = GUIDED_FILTER_EPSILON;
+        return params;
+    }
+
+    // Lens geometry is physical, so only the pixel-sized stripe values follow pixelScale
+    LenticularParams LensParams() const {
+        LenticularParams params;
+        params.viewCount = config.lens_view_count;
+        params.pixelPitchMm = config.pixel_pitch_mm > 0.0f ? config.pixel_pitch_mm : 25.4f / static_cast<float>(dpi);
+        params.lensPitchMm = config.lens_width > 0.0f ? config.lens_width :
+            config.lens_view_count * config.stripe_width_px * pixelScale * params.pixelPitchMm;
+        params.slant = config.lens_slant;
+        params.layout = config.subpixel_layout == SubpixelBGR ? SubpixelBGR : SubpixelRGB;
+        params.phasePx = (config.stripe_offset_px + config.head_offset_x) * pixelScale;
+        return params;
+    }
+
+    bool CaptureDeviceRemoved() const {
+        return d3d11Device && FAILED(d3d11Device->GetDeviceRemovedReason());
+    }
+
+    void ReleaseCaptureObjects() {
+        SAFE_RELEASE(duplication);
+        SAFE_RELEASE(stagingTexture);
+        stagingPool.Clear();
+        SAFE_RELEASE(d3d11Context);
+        SAFE_RELEASE(d3d11Device);
+    }
+
+    int index;
+    HMONITOR monitor;
+    RECT monitorRect;
+    HWND hwnd;
+    UINT dpi;                 // raw (physical) DPI of the monitor
+    float pixelScale;         // dpi relative to the primary output, for pixel-sized parameters
+    UINT width, height;       // swap chain and screen texture size
+
+    // Render thread
+    IDXGISwapChain3* swapChain;
+    ID3D12DescriptorHeap* rtvHeap;
+    ID3D12DescriptorHeap* srvHeap;
+    ID3D12Resource* renderTargets[FRAME_COUNT];
+    ID3D12CommandAllocator* commandAllocators[FRAME_COUNT];
+    ID3D12Resource* constantBuffers[FRAME_COUNT];
+    uint8_t* mappedConstantData[FRAME_COUNT];
+    ID3D12Resource* screenTexture;    // left eye (t0)
+    ID3D12Resource* rightEyeTexture;  // right eye (t1)
+    ID3D12Resource* uploadBuffers[FRAME_SOURCE_SLOTS];
+    UINT frameIndex;
+    UINT64 fenceValue;        // last submission that touched this output
+    int pendingSlot;          // upload slot to copy into the screen texture before the next draw, -1 if none
+    IllusionConfig frameConfig;
+    ID3D12QueryHeap* timestampHeap;       // start and end of the output's command list, null if unsupported
+    ID3D12Resource* timestampReadback;
+    bool timestampsPending;   // the last submission resolved its timestamps into timestampReadback
+    float gpuFrameMs;         // the last submission's GPU time
+    EffectGovernor effects;
+    FrameRecord shownFrame;       // capture in the screen texture
+    bool shownFresh;              // shownFrame has not been presented yet
+    FrameRecord presentedFrame;   // the last submission's, waiting for its GPU time
+    bool presentedFresh;
+    bool presentedPending;
+    double gpuDoneMs;             // the last submission finished, 0 if unmeasured
+    FrameAccounting accounting;
+
+    // Shared: written by one thread, read by the other
+    std::atomic<float> cpuFrameMs;          // capture thread: depth and view synthesis of the last frame
+    std::atomic<int> grantedDepthInterval;  // render thread: EffectGovernor's depth refresh interval
+
+    // Shared: written by the capture thread, (re)allocated by the render thread while paused
+    uint8_t* mappedUpload[FRAME_SOURCE_SLOTS];   // left eye plane, then right eye plane
+    bool slotInterleaved[FRAME_SOURCE_SLOTS];    // slot holds one interleaved image for both eyes
+    FrameRecord slotFrames[FRAME_SOURCE_SLOTS];  // stamps of the capture in each slot
+    UINT uploadPitch;         // row pitch of the upload slots, 256-byte aligned for CopyTextureRegion
+
+    // Capture thread
+    ID3D11Device* d3d11Device;
+    ID3D11DeviceContext* d3d11Context;
+    IDXGIOutputDuplication* duplication;
+    ID3D11Texture2D* stagingTexture;
+    SurfacePool<ID3D11Texture2D*> stagingPool;   // staging textures from previous modes
+    ViewSynthesizer synthesizer;
+    ResolutionController resolution;             // times the synthesizer and picks its depth scale
+    uint64_t captureSequence;                    // FrameRecord counters
+    uint64_t desktopFrames;
+    uint64_t desktopCaptures;
+    LenticularMap lenticularMap;                 // rebuilt only when the lens geometry changes
+    FrameChanges frameChanges;                   // dirty and move rects of the frame being copied
+    std::vector<uint8_t> frameMetadata;
+    UINT captureWidth, captureHeight;
+    DuplicationStatus duplicationStatus;
+    std::future<DuplicationStatus> duplicationJob;
+    std::atomic<bool> reopenRequested;   // WM_DISPLAYCHANGE
+    std::atomic<bool> resizePending;     // capture size no longer matches width x height
+
+private:
+    OutputContext(const OutputContext&);
+    OutputContext& operator=(const OutputContext&);
+
+    // DXGI output (and its adapter) that drives this monitor. Both are null if none matches.
+    void FindDxgiOutput(IDXGIAdapter1** adapterOut, IDXGIOutput1** outputOut) {
+        *adapterOut = NULL;
+        *outputOut = NULL;
+        IDXGIFactory1* factory = NULL;
+        HRESULT hr = CreateDXGIFactory1(IID_PPV_ARGS(&factory));
+        CHECK_HR(hr, "CreateDXGIFactory1 failed for D3D11");
+
+        IDXGIAdapter1* adapter = NULL;
+        for (UINT a = 0; !*outputOut && factory->EnumAdapters1(a, &adapter) != DXGI_ERROR_NOT_FOUND; ++a) {
+            IDXGIOutput* output = NULL;
+            for (UINT o = 0; !*outputOut && adapter->EnumOutputs(o, &output) != DXGI_ERROR_NOT_FOUND; ++o) {
+                DXGI_OUTPUT_DESC desc;
+                if (SUCCEEDED(output->GetDesc(&desc)) && desc.Monitor == monitor) {
+                    monitorRect = desc.DesktopCoordinates;
+                    output->QueryInterface(IID_PPV_ARGS(outputOut));
+                }
+                SAFE_RELEASE(output);
+            }
+            if (*outputOut) *adapterOut = adapter;
+            else SAFE_RELEASE(adapter);
+        }
+        SAFE_RELEASE(factory);
+    }
+};
+
+class D3D12Renderer : public IRecoverableDevice {
 public:
-    D3D12Renderer() : m_device(nullptr), m_commandQueue(nullptr), m_swapChain(nullptr),
-        m_frameIndex(0), m_fenceValue(0), m_fence(nullptr), m_fenceEvent(nullptr),
+    D3D12Renderer() : m_device(nullptr), m_commandQueue(nullptr),
+        m_fenceValue(0), m_fence(nullptr), m_fenceEvent(nullptr),
         m_commandList(nullptr), m_computePso(nullptr), m_constantBufferSize(0),
         m_depthTexture(nullptr), m_graphicsPso(nullptr), m_rootSignature(nullptr),
-        m_rtvHeap(nullptr), m_screenTexture(nullptr), m_srvHeap(nullptr),
         m_samplerHeap(nullptr), m_vertexBuffer(nullptr), m_rtvDescriptorSize(0),
-        m_featureLevel(D3D_FEATURE_LEVEL_12_0), m_adapter(nullptr), m_factory(nullptr),
-        m_d3d11Device(nullptr), m_d3d11Context(nullptr), m_d3d11Duplication(nullptr),
-        m_d3d11StagingTexture(nullptr), m_d3d12UploadBuffer(nullptr), m_time(0.0f),
-        m_recoveryCount(0), m_fallbackMode(false), m_hwnd(nullptr) {
-        for (UINT i = 0; i < FRAME_COUNT; i++) {
-            m_renderTargets[i] = nullptr;
-            m_commandAllocators[i] = nullptr;
-            m_constantBuffers[i] = nullptr;
-            m_mappedConstantData[i] = nullptr;
-        }
+        m_featureLevel(D3D_FEATURE_LEVEL_12_0), m_adapter(nullptr), m_factory(nullptr), m_time(0.0f),
+        m_fallbackMode(false), m_disparityTexture(nullptr),
+        m_computeRootSignature(nullptr), m_mipPso(nullptr), m_mipRootSignature(nullptr),
+        m_probeDevice(nullptr), m_probeFeatureLevel(D3D_FEATURE_LEVEL_11_0),
+        m_fogShader(nullptr), m_mipShader(nullptr), m_vertexShader(nullptr), m_pixelShader(nullptr),
+        m_adapterFeatureRank(ADAPTER_FEATURE_RANK_UNKNOWN), m_recovery(*this, MAX_RECOVERY_ATTEMPTS),
+        m_surfacePool(SURFACE_POOL_CAPACITY, ReleaseComObject<ID3D12Resource>),
+        m_timestampFrequency(0), m_effectCosts(DEFAULT_EFFECT_COSTS) {
     }
 
     ~D3D12Renderer() { Cleanup(); }
 
-    bool Initialize(HWND hwnd) {
-        m_hwnd = hwnd;
+    // Creates one output per monitor and starts the init work that does not need the
+    // D3D12 device: shader compilation and each output's D3D11 desktop duplication setup.
+    // These run on worker threads while the adapter, device, swap chains and heaps are
+    // created, and are joined in CreatePipelines and CreateResources. Safe to call more than once.
+    void BeginAsyncInitialization(const std::vector<MonitorTarget>& monitors) {
+        if (m_outputs.empty()) {
+            for (size_t i = 0; i < monitors.size(); ++i) {
+                m_outputs.push_back(std::unique_ptr<OutputContext>(new OutputContext(static_cast<int>(i), monitors[i])));
+            }
+        }
+        if (!m_vertexShaderJob.valid()) StartShaderCompilation();
+        for (auto& out : m_outputs) {
+            if (!out->duplicationJob.valid() && !out->d3d11Device) StartDuplicationSetup(*out);
+        }
+    }
+
+    // 'windows' holds one overlay window per monitor passed to BeginAsyncInitialization, in the same order.
+    bool Initialize(const std::vector<HWND>& windows) {
         try {
             Log("Initializing D3D12Renderer...\n");
+            if (windows.empty() || windows.size() != m_outputs.size()) throw ToolException("Window count does not match the output count");
+            for (size_t i = 0; i < windows.size(); ++i) {
+                OutputContext& out = *m_outputs[i];
+                out.hwnd = windows[i];
+                UINT dpiX = 0, dpiY = 0;
+                if (SUCCEEDED(GetDpiForMonitor(out.monitor, MDT_RAW_DPI, &dpiX, &dpiY)) && dpiX > 0) out.dpi = dpiX;
+                char buffer[128];
+                sprintf_s(buffer, "Output %zu: %ux%u at (%ld, %ld), %u dpi\n", i, out.width, out.height,
+                    out.monitorRect.left, out.monitorRect.top, out.dpi);
+                Log(buffer);
+            }
+            for (auto& out : m_outputs) out->pixelScale = static_cast<float>(out->dpi) / static_cast<float>(m_outputs[0]->dpi);
+            if (LoadEffectCostModel(EFFECT_COSTS_FILE, &m_effectCosts)) Log("Effect costs loaded\n");
+
+            auto phase = StartupProfiler::Now();
             HRESULT hr = CreateDXGIFactory2(0, IID_PPV_ARGS(&m_factory));
             CHECK_HR(hr, "CreateDXGIFactory2 failed");
+            startupProfiler.Record("CreateDXGIFactory2", phase);
 
             // Select adapter using configurable selection logic
+            phase = StartupProfiler::Now();
             if (!SelectAdapter()) {
                 throw ToolException("No suitable hardware adapter found");
             }
+            startupProfiler.Record("SelectAdapter", phase);
 
-            return CreateDeviceAndResources();
+            if (!CreateDeviceAndResources()) return false;
+
+            // One capture thread per output from here on
+            if (m_scheduler.OutputCount() == 0) {
+                for (auto& out : m_outputs) m_scheduler.AddOutput(out.get());
+            }
+            m_scheduler.Start();
+            return true;
         }
         catch (const ToolException& e) {
             Log(e.what());
             return false;
         }
     }
-
     // SelectAdapter: configurable selection
     // If environment variable CLEAN3D_USE_SYSTEM_DEFAULT_ADAPTER=1 is set,
     // use system default by leaving m_adapter == nullptr and letting
     // D3D12CreateDevice select the adapter. Otherwise enumerate adapters
     // and pick the one with the highest D3D12 feature level support; tie-breaker by VRAM.
+    // The choice is cached in ADAPTER_CACHE_FILE keyed by LUID and driver version, and
+    // the feature level probing is skipped entirely when the cache still matches.
     bool SelectAdapter() {
-        //const char* useDefaultEnv = std::getenv("CLEAN3D_USE_SYSTEM_DEFAULT_ADAPTER");
         char* useDefaultEnv = nullptr;
         size_t envLen = 0;
-        if (_dupenv_s(&useDefaultEnv, &envLen, "CLEAN3D_USE_SYSTEM_DEFAULT_ADAPTER") != 0) {
+        if (_dupenv_s(&useDefaultEnv, &envLen, ADAPTER_DEFAULT_ENV) != 0) {
             useDefaultEnv = nullptr;
         }
-        if (useDefaultEnv && useDefaultEnv[0] == '1') {
+        if (UseSystemDefaultAdapter(useDefaultEnv)) {
             Log("Adapter selection: using system default adapter (D3D12CreateDevice fallback)\n");
             if (useDefaultEnv) free(useDefaultEnv);
             // leave m_adapter as nullptr to let D3D12CreateDevice pick
@@ -182,12 +909,27 @@ public:
         }
         if (useDefaultEnv) { free(useDefaultEnv); useDefaultEnv = nullptr; }
 
-        IDXGIAdapter1* bestAdapter = nullptr;
-        int bestFeatureRank = -1;
-        uint64_t bestMemory = 0;
-
-        UINT adapterIndex = 0;
+        // Enumerating and describing adapters is cheap; only device creation is not
+        std::vector<IDXGIAdapter1*> adapters;
+        std::vector<AdapterCandidate> candidates;
         IDXGIAdapter1* adapter = nullptr;
+        for (UINT adapterIndex = 0; m_factory->EnumAdapters1(adapterIndex, &adapter) != DXGI_ERROR_NOT_FOUND; adapterIndex++) {
+            DXGI_ADAPTER_DESC1 desc;
+            adapter->GetDesc1(&desc);
+            LARGE_INTEGER umdVersion = {};
+            AdapterCandidate candidate = {};
+            candidate.luidLow = desc.AdapterLuid.LowPart;
+            candidate.luidHigh = desc.AdapterLuid.HighPart;
+            candidate.vendorId = desc.VendorId;
+            candidate.deviceId = desc.DeviceId;
+            candidate.dedicatedVideoMemory = desc.DedicatedVideoMemory;
+            candidate.driverVersion = SUCCEEDED(adapter->CheckInterfaceSupport(__uuidof(IDXGIDevice), &umdVersion)) ? (uint64_t)umdVersion.QuadPart : 0;
+            candidate.software = (desc.Flags & DXGI_ADAPTER_FLAG_SOFTWARE) != 0;
+            candidate.featureRank = ADAPTER_FEATURE_RANK_UNKNOWN;
+            adapters.push_back(adapter);
+            candidates.push_back(candidate);
+            adapter = nullptr;
+        }
 
         // Feature levels in descending order; lower index => better
         D3D_FEATURE_LEVEL featureLevels[] = {
@@ -196,65 +938,62 @@ public:
             D3D_FEATURE_LEVEL_11_1,
             D3D_FEATURE_LEVEL_11_0
         };
-
-        while (m_factory->EnumAdapters1(adapterIndex, &adapter) != DXGI_ERROR_NOT_FOUND) {
-            DXGI_ADAPTER_DESC1 desc;
-            adapter->GetDesc1(&desc);
-
-            // skip software adapters
-            if (desc.Flags & DXGI_ADAPTER_FLAG_SOFTWARE) {
-                SAFE_RELEASE(adapter);
-                adapterIndex++;
-                continue;
-            }
-
-            // Determine highest supported feature level for this adapter
-            int featureRank = -1;
-            for (int i = 0; i < _countof(featureLevels); ++i) {
-                ID3D12Device* tmpDevice = nullptr;
-                HRESULT hr = D3D12CreateDevice(adapter, featureLevels[i], IID_PPV_ARGS(&tmpDevice));
-                if (SUCCEEDED(hr)) {
-                    featureRank = (int)i; // lower is better (0 == 12_1)
-                    SAFE_RELEASE(tmpDevice);
-                    break;
+        static_assert(_countof(featureLevels) == ADAPTER_FEATURE_RANK_COUNT, "feature ranks must match the level list");
+
+        std::vector<ID3D12Device*> probeDevices(adapters.size(), nullptr);
+        AdapterCacheEntry cache;
+        int best = LoadAdapterCache(ADAPTER_CACHE_FILE, &cache) ? MatchAdapterCache(cache, candidates) : -1;
+        if (best >= 0) {
+            candidates[best].featureRank = cache.featureRank;
+            Log("Adapter selection: cache hit, skipping feature level probing\n");
+        }
+        else {
+            for (size_t i = 0; i < adapters.size(); ++i) {
+                if (candidates[i].software) continue;
+
+                // Determine highest supported feature level for this adapter. Create a single
+                // device at the minimum level and query the maximum, rather than creating one
+                // device per feature level.
+                HRESULT hr = D3D12CreateDevice(adapters[i], featureLevels[_countof(featureLevels) - 1], IID_PPV_ARGS(&probeDevices[i]));
+                if (FAILED(hr)) {
+                    // adapter doesn't support minimum required feature levels
+                    Log("Adapter skipped: insufficient feature level\n");
+                    continue;
+                }
+                D3D12_FEATURE_DATA_FEATURE_LEVELS levels = {};
+                levels.NumFeatureLevels = _countof(featureLevels);
+                levels.pFeatureLevelsRequested = featureLevels;
+                candidates[i].featureRank = (int)_countof(featureLevels) - 1;
+                if (SUCCEEDED(probeDevices[i]->CheckFeatureSupport(D3D12_FEATURE_FEATURE_LEVELS, &levels, sizeof(levels)))) {
+                    for (int level = 0; level < (int)_countof(featureLevels); ++level) {
+                        if (featureLevels[level] == levels.MaxSupportedFeatureLevel) {
+                            candidates[i].featureRank = level; // lower is better (0 == 12_1)
+                            break;
+                        }
+                    }
                 }
             }
-
-            if (featureRank == -1) {
-                // adapter doesn't support minimum required feature levels
-                Log("Adapter skipped: insufficient feature level\n");
-                SAFE_RELEASE(adapter);
-                adapterIndex++;
-                continue;
-            }
-
-            uint64_t vram = desc.DedicatedVideoMemory;
-
-            // Choose adapter: prefer better feature rank, then more VRAM
-            bool better = false;
-            if (bestAdapter == nullptr) better = true;
-            else if (featureRank < bestFeatureRank) better = true;
-            else if (featureRank == bestFeatureRank && vram > bestMemory) better = true;
-
-            if (better) {
-                SAFE_RELEASE(bestAdapter);
-                bestAdapter = adapter; // keep reference
-                bestFeatureRank = featureRank;
-                bestMemory = vram;
-                // do not release 'adapter' here; it's now bestAdapter
-            } else {
-                SAFE_RELEASE(adapter);
+            best = SelectBestAdapter(candidates);
+            if (best >= 0 && !SaveAdapterCache(ADAPTER_CACHE_FILE, MakeAdapterCacheEntry(candidates, best))) {
+                Log("Failed to write adapter cache\n");
             }
+        }
 
-            adapterIndex++;
+        for (size_t i = 0; i < adapters.size(); ++i) {
+            if ((int)i == best) continue;
+            SAFE_RELEASE(probeDevices[i]);
+            SAFE_RELEASE(adapters[i]);
         }
 
-        if (bestAdapter) {
-            m_adapter = bestAdapter; // adopt best adapter
+        if (best >= 0) {
+            m_adapter = adapters[best]; // adopt best adapter
+            m_probeDevice = probeDevices[best]; // null on a cache hit
+            m_adapterFeatureRank = candidates[best].featureRank;
+            m_probeFeatureLevel = featureLevels[m_adapterFeatureRank];
             DXGI_ADAPTER_DESC1 chosenDesc;
             m_adapter->GetDesc1(&chosenDesc);
             char buf[512];
-            sprintf_s(buf, "Selected adapter: %ls (VRAM: %llu MB), feature rank: %d\n", chosenDesc.Description, (unsigned long long)(chosenDesc.DedicatedVideoMemory / (1024 * 1024)), bestFeatureRank);
+            sprintf_s(buf, "Selected adapter: %ls (VRAM: %llu MB), feature rank: %d\n", chosenDesc.Description, (unsigned long long)(chosenDesc.DedicatedVideoMemory / (1024 * 1024)), m_adapterFeatureRank);
             Log(buf);
             return true;
         }
@@ -271,7 +1010,20 @@ public:
             D3D_FEATURE_LEVEL_11_1,
             D3D_FEATURE_LEVEL_11_0
         };
-        for (auto level : featureLevels) {
+        auto phase = StartupProfiler::Now();
+        if (m_probeDevice) {
+            // SelectAdapter already created a device on the chosen adapter; adopt it
+            m_device = m_probeDevice;
+            m_probeDevice = nullptr;
+            m_featureLevel = m_probeFeatureLevel;
+            char buffer[64];
+            sprintf_s(buffer, "Reused probe device with feature level %d.%d\n", m_featureLevel / 0x1000, (m_featureLevel % 0x1000) / 0x100);
+            Log(buffer);
+        }
+        // Start at the adapter's known rank (from probing or the cache) instead of at 12_1
+        for (int i = (m_adapter && m_adapterFeatureRank > 0) ? m_adapterFeatureRank : 0; i < (int)_countof(featureLevels); ++i) {
+            if (m_device) break;
+            D3D_FEATURE_LEVEL level = featureLevels[i];
             hr = D3D12CreateDevice(m_adapter, level, IID_PPV_ARGS(&m_device));
             if (SUCCEEDED(hr)) {
                 m_featureLevel = level;
@@ -282,261 +1034,268 @@ public:
             }
         }
         if (!m_device) throw ToolException("Failed to create D3D12 device");
+        startupProfiler.Record("D3D12CreateDevice", phase);
 
+        phase = StartupProfiler::Now();
         D3D12_COMMAND_QUEUE_DESC queueDesc = {};
         queueDesc.Type = D3D12_COMMAND_LIST_TYPE_DIRECT;
         CHECK_HR(m_device->CreateCommandQueue(&queueDesc, IID_PPV_ARGS(&m_commandQueue)), "CreateCommandQueue failed");
+        if (FAILED(m_commandQueue->GetTimestampFrequency(&m_timestampFrequency))) m_timestampFrequency = 0;
+        startupProfiler.Record("CreateCommandQueue", phase);
 
-        DXGI_SWAP_CHAIN_DESC1 swapChainDesc = {};
-        swapChainDesc.Width = SCREEN_WIDTH;
-        swapChainDesc.Height = SCREEN_HEIGHT;
-        swapChainDesc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
-        swapChainDesc.BufferCount = FRAME_COUNT;
-        swapChainDesc.BufferUsage = DXGI_USAGE_RENDER_TARGET_OUTPUT;
-        swapChainDesc.SwapEffect = DXGI_SWAP_EFFECT_FLIP_DISCARD;
-        swapChainDesc.SampleDesc.Count = 1;
-        IDXGISwapChain1* swapChain1 = nullptr;
-        hr = m_factory->CreateSwapChainForHwnd(m_commandQueue, m_hwnd, &swapChainDesc, nullptr, nullptr, &swapChain1);
-        CHECK_HR(hr, "CreateSwapChainForHwnd failed");
-        CHECK_HR(swapChain1->QueryInterface(IID_PPV_ARGS(&m_swapChain)), "SwapChain QueryInterface failed");
-        SAFE_RELEASE(swapChain1);
-
-        D3D12_DESCRIPTOR_HEAP_DESC rtvHeapDesc = {};
-        rtvHeapDesc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_RTV;
-        rtvHeapDesc.NumDescriptors = FRAME_COUNT;
-        CHECK_HR(m_device->CreateDescriptorHeap(&rtvHeapDesc, IID_PPV_ARGS(&m_rtvHeap)), "Create RTV Heap failed");
-
-        D3D12_DESCRIPTOR_HEAP_DESC srvHeapDesc = {};
-        srvHeapDesc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV;
-        srvHeapDesc.NumDescriptors = 3;
-        srvHeapDesc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE;
-        CHECK_HR(m_device->CreateDescriptorHeap(&srvHeapDesc, IID_PPV_ARGS(&m_srvHeap)), "Create SRV Heap failed");
+        phase = StartupProfiler::Now();
+        m_rtvDescriptorSize = m_device->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_RTV);
+        for (auto& out : m_outputs) CreateOutputSwapChain(*out);
+        startupProfiler.Record("Swap chains, descriptor heaps and RTVs", phase);
 
+        phase = StartupProfiler::Now();
         D3D12_DESCRIPTOR_HEAP_DESC samplerHeapDesc = {};
         samplerHeapDesc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_SAMPLER;
         samplerHeapDesc.NumDescriptors = 1;
         samplerHeapDesc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE;
         CHECK_HR(m_device->CreateDescriptorHeap(&samplerHeapDesc, IID_PPV_ARGS(&m_samplerHeap)), "Create Sampler Heap failed");
 
-        m_rtvDescriptorSize = m_device->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_RTV);
-        CD3DX12_CPU_DESCRIPTOR_HANDLE rtvHandle(m_rtvHeap->GetCPUDescriptorHandleForHeapStart());
-        for (UINT i = 0; i < FRAME_COUNT; i++) {
-            CHECK_HR(m_swapChain->GetBuffer(i, IID_PPV_ARGS(&m_renderTargets[i])), "GetSwapChainBuffer failed");
-            m_device->CreateRenderTargetView(m_renderTargets[i], NULL, rtvHandle);
-            rtvHandle.Offset(1, m_rtvDescriptorSize);
-        }
-
-        for (UINT i = 0; i < FRAME_COUNT; i++) {
-            CHECK_HR(m_device->CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE_DIRECT, IID_PPV_ARGS(&m_commandAllocators[i])), "CreateCommandAllocator failed");
-        }
-
-        CHECK_HR(m_device->CreateCommandList(0, D3D12_COMMAND_LIST_TYPE_DIRECT, m_commandAllocators[0], NULL, IID_PPV_ARGS(&m_commandList)), "CreateCommandList failed");
+        // One command list shared by all outputs; each output records with its own allocators
+        CHECK_HR(m_device->CreateCommandList(0, D3D12_COMMAND_LIST_TYPE_DIRECT, m_outputs[0]->commandAllocators[0], NULL, IID_PPV_ARGS(&m_commandList)), "CreateCommandList failed");
         CHECK_HR(m_commandList->Close(), "Close initial CommandList failed");
 
         CHECK_HR(m_device->CreateFence(0, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(&m_fence)), "CreateFence failed");
         m_fenceEvent = CreateEvent(NULL, FALSE, FALSE, NULL);
         if (!m_fenceEvent) throw ToolException("Fence event creation failed", HRESULT_FROM_WIN32(GetLastError()));
+        startupProfiler.Record("Command objects and fence", phase);
 
         if (!CreateResources() || !CreatePipelines()) {
             Log("Resource or pipeline creation failed\n");
             return false;
         }
 
+        // CreateResources may have adopted the duplication size; keep the swap chains in step
+        for (auto& out : m_outputs) {
+            DXGI_SWAP_CHAIN_DESC1 currentDesc;
+            out->swapChain->GetDesc1(&currentDesc);
+            if (currentDesc.Width != out->width || currentDesc.Height != out->height) {
+                if (!ResizeSwapChain(*out, out->width, out->height)) return false;
+            }
+        }
+
         Log("Device and resources created successfully\n");
         return true;
     }
 
     void Cleanup(bool preserveEssentials = false) {
+        m_scheduler.Clear();
+        WaitForAsyncInitialization();
+        ReleaseDeviceObjects();
+        for (auto& out : m_outputs) out->ReleaseCaptureObjects();
+        ReleaseShaderBytecode();
+        if (!preserveEssentials) {
+            m_outputs.clear();
+            SAFE_RELEASE(m_adapter);
+            SAFE_RELEASE(m_factory);
+        }
+        Log("Cleanup completed\n");
+    }
+
+    // IRecoverableDevice: only objects owned by the D3D12 device. The D3D11 capture path,
+    // compiled shader bytecode, adapter, factory and config survive a device loss. Capture
+    // threads are paused because they write into the upload slots released here.
+    void ReleaseDeviceObjects() override {
+        m_scheduler.PauseAll();
         if (m_commandQueue && m_fence) WaitForGPU();
-        for (UINT i = 0; i < FRAME_COUNT; i++) {
-            SAFE_RELEASE(m_renderTargets[i]);
-            SAFE_RELEASE(m_commandAllocators[i]);
-            if (m_constantBuffers[i]) {
-                m_constantBuffers[i]->Unmap(0, NULL);
-                SAFE_RELEASE(m_constantBuffers[i]);
-                m_mappedConstantData[i] = NULL;
+        for (auto& out : m_outputs) {
+            for (UINT i = 0; i < FRAME_COUNT; i++) {
+                SAFE_RELEASE(out->renderTargets[i]);
+                SAFE_RELEASE(out->commandAllocators[i]);
+                if (out->constantBuffers[i]) {
+                    out->constantBuffers[i]->Unmap(0, NULL);
+                    SAFE_RELEASE(out->constantBuffers[i]);
+                    out->mappedConstantData[i] = NULL;
+                }
+            }
+            SAFE_RELEASE(out->timestampHeap);
+            SAFE_RELEASE(out->timestampReadback);
+            out->timestampsPending = false;
+            SAFE_RELEASE(out->screenTexture);
+            SAFE_RELEASE(out->rightEyeTexture);
+            for (int i = 0; i < FRAME_SOURCE_SLOTS; i++) {
+                SAFE_RELEASE(out->uploadBuffers[i]);
+                out->mappedUpload[i] = NULL;
             }
+            SAFE_RELEASE(out->srvHeap);
+            SAFE_RELEASE(out->rtvHeap);
+            SAFE_RELEASE(out->swapChain);
+            out->fenceValue = 0;
+            out->pendingSlot = -1;
         }
-        SAFE_RELEASE(m_screenTexture);
         SAFE_RELEASE(m_depthTexture);
         SAFE_RELEASE(m_vertexBuffer);
-        SAFE_RELEASE(m_d3d11Duplication);
-        SAFE_RELEASE(m_d3d11StagingTexture);
-        SAFE_RELEASE(m_d3d12UploadBuffer);
         SAFE_RELEASE(m_computePso);
+        SAFE_RELEASE(m_mipPso);
         SAFE_RELEASE(m_graphicsPso);
         SAFE_RELEASE(m_rootSignature);
         SAFE_RELEASE(m_commandList);
-        SAFE_RELEASE(m_srvHeap);
         SAFE_RELEASE(m_samplerHeap);
-        SAFE_RELEASE(m_rtvHeap);
-        SAFE_RELEASE(m_swapChain);
         SAFE_RELEASE(m_commandQueue);
         SAFE_RELEASE(m_device);
         SAFE_RELEASE(m_fence);
+        m_fenceValue = 0;
         SAFE_RELEASE(m_disparityTexture);
         SAFE_RELEASE(m_computeRootSignature);
+        SAFE_RELEASE(m_mipRootSignature);
+        SAFE_RELEASE(m_probeDevice);
+        m_surfacePool.Clear();
         if (m_fenceEvent) { CloseHandle(m_fenceEvent); m_fenceEvent = NULL; }
-        if (!preserveEssentials) {
-            SAFE_RELEASE(m_adapter);
-            SAFE_RELEASE(m_factory);
-            m_hwnd = NULL;
-        }
-        Log("Cleanup completed\n");
     }
 
-    bool RecoverDevice() {
-        m_recoveryCount++;
-        char buffer[64];
-        sprintf_s(buffer, "Attempting device recovery (count: %d)\n", m_recoveryCount);
-        Log(buffer);
-
-        if (m_recoveryCount > MAX_RECOVERY_ATTEMPTS) {
-            Log("Exceeded maximum recovery attempts, switching to fallback mode\n");
-            m_fallbackMode = true;
-            return false;
-        }
-
-        IDXGIFactory6* tempFactory = m_factory;
-        IDXGIAdapter1* tempAdapter = m_adapter;
-        HWND tempHwnd = m_hwnd;
-        m_factory = NULL;
-        m_adapter = NULL;
-
-        Cleanup(true);
-
-        m_factory = tempFactory;
-        m_adapter = tempAdapter;
-        m_hwnd = tempHwnd;
-
-        if (!m_factory || !m_adapter || !m_hwnd) {
-            SAFE_RELEASE(m_factory);
-            SAFE_RELEASE(m_adapter);
-            m_hwnd = NULL;
+    // IRecoverableDevice: recreate the D3D12 objects from the retained state. An output's
+    // capture path is only rebuilt if the loss took its D3D11 device down as well.
+    bool RebuildDeviceObjects() override {
+        if (!m_factory || !m_adapter || m_outputs.empty()) {
             Log("Device recovery failed: Essential components missing\n");
             return false;
         }
+        for (auto& out : m_outputs) {
+            if (out->CaptureDeviceRemoved()) {
+                Log("Capture device was removed as well, restarting duplication setup\n");
+                out->ReleaseCaptureObjects();
+            }
+            if (!out->d3d11Device && !out->duplicationJob.valid()) StartDuplicationSetup(*out);
+        }
 
         try {
-            bool success = CreateDeviceAndResources();
-            if (success) {
-                config = defaultConfig;
-                Log("Device recovered, restored default config\n");
-            }
-            Log(success ? "Device recovered successfully\n" : "Device recovery failed\n");
-            return success;
+            return CreateDeviceAndResources();
         }
         catch (const ToolException& e) {
-            Log(("Recovery failed: " + std::string(e.what()) + "\n").c_str());
+            Log(("Incremental rebuild failed: " + std::string(e.what()) + "\n").c_str());
             return false;
         }
     }
 
-    bool ValidateResources() {
-        bool valid = m_device && m_swapChain && m_commandQueue && m_commandList &&
-            m_graphicsPso && m_srvHeap && m_samplerHeap && m_vertexBuffer &&
-            m_rtvHeap && m_screenTexture && (m_constantBuffers[0] != NULL);
-        if (!valid) Log("Resource validation failed\n");
-        return valid;
+    // IRecoverableDevice: each staging texture still holds its output's last captured frame,
+    // so stage it for upload instead of showing an empty texture until the desktop changes.
+    bool RestoreWarmState() override {
+        bool restored = false;
+        for (auto& out : m_outputs) {
+            if (out->duplication && out->CopyStagingToSlot(FRAME_MAILBOX_INITIAL_READ_SLOT)) {
+                out->pendingSlot = FRAME_MAILBOX_INITIAL_READ_SLOT;
+                restored = true;
+            }
+        }
+        if (restored) Log("Restored last captured frames after recovery\n");
+        return restored;
     }
 
-    bool CreateResources() {
-        if (!m_device) return false;
+    // IRecoverableDevice: full rebuild including the capture path, used when the
+    // incremental rebuild fails.
+    bool RebuildEverything() override {
+        Log("Rebuilding device and capture path\n");
+        WaitForAsyncInitialization();
+        ReleaseDeviceObjects();
+        for (auto& out : m_outputs) out->ReleaseCaptureObjects();
+        return RebuildDeviceObjects();
+    }
 
-        Log("Creating resources...\n");
-        D3D12_HEAP_PROPERTIES defaultHeapProps = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT);
-        D3D12_RESOURCE_DESC texDesc = CD3DX12_RESOURCE_DESC::Tex2D(DXGI_FORMAT_R8G8B8A8_UNORM, SCREEN_WIDTH, SCREEN_HEIGHT, 1, 1);
-        CHECK_HR(m_device->CreateCommittedResource(&defaultHeapProps, D3D12_HEAP_FLAG_NONE, &texDesc, D3D12_RESOURCE_STATE_COMMON, NULL, IID_PPV_ARGS(&m_screenTexture)), "Create screen texture failed");
+    bool RecoverDevice() {
+        char buffer[256];
+        sprintf_s(buffer, "Attempting device recovery (attempt %d)\n", m_recovery.Stats().attempts + 1);
+        Log(buffer);
+        if (m_device) {
+            sprintf_s(buffer, "Device removed reason: 0x%08X\n", m_device->GetDeviceRemovedReason());
+            Log(buffer);
+        }
 
-        // Create D3D11 device for desktop duplication (unchanged)
-        D3D_FEATURE_LEVEL featureLevels[] = { D3D_FEATURE_LEVEL_11_0 };
-        HRESULT hr = D3D11CreateDevice(NULL, D3D_DRIVER_TYPE_HARDWARE, NULL, D3D11_CREATE_DEVICE_BGRA_SUPPORT, featureLevels, 1, D3D11_SDK_VERSION,
-            &m_d3d11Device, NULL, &m_d3d11Context);
-        if (FAILED(hr)) {
-            Log("Failed to create D3D11 device for desktop duplication\n");
+        RecoveryOutcome outcome = m_recovery.Recover();
+        if (m_recovery.State() == RecoveryFallback) {
+            Log("Exceeded maximum recovery attempts, switching to fallback mode\n");
+            m_fallbackMode = true;
             return false;
         }
+        if (outcome != RecoveryFailed) m_scheduler.ResumeAll();
+        // Config is deliberately left alone: a driver reset should not undo the user's settings
+        m_recovery.Format(buffer, sizeof(buffer), outcome);
+        Log(buffer);
+        return outcome != RecoveryFailed;
+    }
 
-        IDXGIFactory1* factory = NULL;
-        hr = CreateDXGIFactory1(IID_PPV_ARGS(&factory));
-        CHECK_HR(hr, "CreateDXGIFactory1 failed for D3D11");
-
-        IDXGIAdapter* adapter = NULL;
-        factory->EnumAdapters(0, &adapter);
-        IDXGIOutput* output = NULL;
-        adapter->EnumOutputs(0, &output);
-        IDXGIOutput1* output1 = NULL;
-        hr = output->QueryInterface(IID_PPV_ARGS(&output1));
-        if (FAILED(hr) || !output1) {
-            SAFE_RELEASE(output);
-            SAFE_RELEASE(adapter);
-            SAFE_RELEASE(factory);
-            Log("Failed to get IDXGIOutput1, using fallback checkerboard\n");
+    // Called from the window procedure on WM_DISPLAYCHANGE; each capture thread re-duplicates
+    // its output and flags a resize if the mode changed.
+    void NotifyDisplayChange() {
+        for (auto& out : m_outputs) out->reopenRequested = true;
+    }
 
-            D3D12_HEAP_PROPERTIES uploadHeapProps = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD);
-            D3D12_RESOURCE_DESC bufferDesc = CD3DX12_RESOURCE_DESC::Buffer(SCREEN_WIDTH * SCREEN_HEIGHT * 4);
-            CHECK_HR(m_device->CreateCommittedResource(&uploadHeapProps, D3D12_HEAP_FLAG_NONE, &bufferDesc, D3D12_RESOURCE_STATE_GENERIC_READ, NULL, IID_PPV_ARGS(&m_d3d12UploadBuffer)), "Create upload buffer failed");
+    // Live mode change for one output: only its swap chain buffers and size-dependent
+    // surfaces are replaced. Device, queue, root signatures, PSOs, constant buffers and
+    // the other outputs are untouched. The output's capture must be paused.
+    bool ResizeOutput(OutputContext& out, UINT width, UINT height) {
+        if (!m_device || !out.swapChain || width == 0 || height == 0) return false;
+        auto begin = std::chrono::steady_clock::now();
+        UINT oldWidth = out.width, oldHeight = out.height;
+
+        if (!ResizeSwapChain(out, width, height)) return false;
+        ReleaseOutputSurfaces(out);
+        out.width = width;
+        out.height = height;
+        AcquireOutputSurfaces(out);
+        CreateScreenTextureView(out);
+
+        // The overlay lives on the render thread; do not block on the window's message loop
+        if (out.hwnd) {
+            SetWindowPos(out.hwnd, HWND_TOPMOST, out.monitorRect.left, out.monitorRect.top, width, height,
+                SWP_ASYNCWINDOWPOS | SWP_NOACTIVATE);
+        }
 
-            UINT8* data;
-            CHECK_HR(m_d3d12UploadBuffer->Map(0, NULL, reinterpret_cast<void**>(&data)), "Map upload buffer failed");
-            CreateCheckerboardPattern(reinterpret_cast<uint32_t*>(data));
-            m_d3d12UploadBuffer->Unmap(0, NULL);
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+        char buffer[192];
+        sprintf_s(buffer, "Output %d resized %ux%u -> %ux%u in %.2f ms (surface pool hits %zu, misses %zu)\n",
+            out.index, oldWidth, oldHeight, width, height, ms, m_surfacePool.Hits(), m_surfacePool.Misses());
+        Log(buffer);
+        return true;
+    }
 
-            CHECK_HR(m_commandList->Reset(m_commandAllocators[0], NULL), "Reset command list failed");
-            CD3DX12_RESOURCE_BARRIER barrier = CD3DX12_RESOURCE_BARRIER::Transition(m_screenTexture, D3D12_RESOURCE_STATE_COMMON, D3D12_RESOURCE_STATE_COPY_DEST);
-            m_commandList->ResourceBarrier(1, &barrier);
-            D3D12_SUBRESOURCE_DATA subresourceData = { data, static_cast<LONG_PTR>(SCREEN_WIDTH * 4), static_cast<LONG_PTR>(SCREEN_WIDTH * SCREEN_HEIGHT * 4) };
-            ::UpdateSubresources<1>(m_commandList, m_screenTexture, m_d3d12UploadBuffer, 0, 0, 1, &subresourceData);
-            barrier = CD3DX12_RESOURCE_BARRIER::Transition(m_screenTexture, D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
-            m_commandList->ResourceBarrier(1, &barrier);
-            CHECK_HR(m_commandList->Close(), "Close command list failed");
-            ID3D12CommandList* cmdLists[] = { m_commandList };
-            m_commandQueue->ExecuteCommandLists(1, cmdLists);
-            WaitForGPU();
+    bool ValidateResources() {
+        bool valid = m_device && m_commandQueue && m_commandList && m_graphicsPso &&
+            m_samplerHeap && m_vertexBuffer && m_fence && !m_outputs.empty();
+        for (size_t i = 0; valid && i < m_outputs.size(); ++i) {
+            const OutputContext& out = *m_outputs[i];
+            valid = out.swapChain && out.rtvHeap && out.srvHeap && out.screenTexture && out.rightEyeTexture && (out.constantBuffers[0] != NULL);
         }
-        else {
-            DXGI_OUTDUPL_DESC duplDesc;
-            m_d3d11Duplication = NULL;
-            hr = output1->DuplicateOutput(m_d3d11Device, &m_d3d11Duplication);
-            if (FAILED(hr)) {
-                Log("DuplicateOutput failed, falling back to checkerboard\n");
-            }
-            else {
-                m_d3d11Duplication->GetDesc(&duplDesc);
-                SCREEN_WIDTH = duplDesc.ModeDesc.Width;
-                SCREEN_HEIGHT = duplDesc.ModeDesc.Height;
-            }
-
-            D3D11_TEXTURE2D_DESC stagingDesc = {};
-            stagingDesc.Width = SCREEN_WIDTH;
-            stagingDesc.Height = SCREEN_HEIGHT;
-            stagingDesc.MipLevels = 1;
-            stagingDesc.ArraySize = 1;
-            stagingDesc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
-            stagingDesc.SampleDesc.Count = 1;
-            stagingDesc.Usage = D3D11_USAGE_STAGING;
-            stagingDesc.CPUAccessFlags = D3D11_CPU_ACCESS_READ;
-            CHECK_HR(m_d3d11Device->CreateTexture2D(&stagingDesc, NULL, &m_d3d11StagingTexture), "Create D3D11 staging texture failed");
+        if (!valid) Log("Resource validation failed\n");
+        return valid;
+    }
 
-            D3D12_HEAP_PROPERTIES uploadHeapProps = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD);
-            D3D12_RESOURCE_DESC bufferDesc = CD3DX12_RESOURCE_DESC::Buffer(SCREEN_WIDTH * SCREEN_HEIGHT * 4);
-            CHECK_HR(m_device->CreateCommittedResource(&uploadHeapProps, D3D12_HEAP_FLAG_NONE, &bufferDesc, D3D12_RESOURCE_STATE_GENERIC_READ, NULL, IID_PPV_ARGS(&m_d3d12UploadBuffer)), "Create D3D12 upload buffer failed");
+    bool CreateResources() {
+        if (!m_device) return false;
 
-            SAFE_RELEASE(output1);
-            SAFE_RELEASE(output);
-            SAFE_RELEASE(adapter);
-            SAFE_RELEASE(factory);
+        Log("Creating resources...\n");
+        // Join the duplication workers; they also decide the capture sizes. After an
+        // incremental recovery the capture paths are still alive and there is nothing to join.
+        auto phase = StartupProfiler::Now();
+        for (auto& out : m_outputs) {
+            if (out->duplicationJob.valid() || !out->d3d11Device) {
+                if (!out->duplicationJob.valid()) StartDuplicationSetup(*out);
+                out->duplicationStatus = out->duplicationJob.get();
+            }
+        }
+        startupProfiler.Record("Wait for duplication setup", phase);
+
+        phase = StartupProfiler::Now();
+        for (auto& out : m_outputs) {
+            if (out->duplicationStatus == DuplicationDeviceFailed) return false;
+            if (out->duplication) {
+                out->width = out->captureWidth;
+                out->height = out->captureHeight;
+            }
+            AcquireOutputSurfaces(*out);
+            if (out->duplicationStatus == DuplicationNoOutput) {
+                // Nothing to capture on this output; stage a checkerboard for the first frame
+                uint8_t* slot = out->mappedUpload[FRAME_MAILBOX_INITIAL_READ_SLOT];
+                CreateCheckerboardPattern(reinterpret_cast<uint32_t*>(slot), out->width, out->height, out->uploadPitch / 4);
+                memcpy(slot + out->EyePlaneBytes(), slot, out->EyePlaneBytes());
+                out->slotInterleaved[FRAME_MAILBOX_INITIAL_READ_SLOT] = false;
+                out->pendingSlot = FRAME_MAILBOX_INITIAL_READ_SLOT;
+            }
+            CreateScreenTextureView(*out);
         }
-
-        // Create SRV and sampler (unchanged)
-        UINT descriptorSize = m_device->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
-        CD3DX12_CPU_DESCRIPTOR_HANDLE srvHandle(m_srvHeap->GetCPUDescriptorHandleForHeapStart());
-        D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
-        srvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
-        srvDesc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
-        srvDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2D;
-        srvDesc.Texture2D.MipLevels = 1;
-        m_device->CreateShaderResourceView(m_screenTexture, &srvDesc, srvHandle);
 
         CD3DX12_CPU_DESCRIPTOR_HANDLE samplerHandle(m_samplerHeap->GetCPUDescriptorHandleForHeapStart());
         D3D12_SAMPLER_DESC samplerDesc = {};
@@ -544,17 +1303,21 @@ public:
         samplerDesc.AddressU = samplerDesc.AddressV = samplerDesc.AddressW = D3D12_TEXTURE_ADDRESS_MODE_CLAMP;
         m_device->CreateSampler(&samplerDesc, samplerHandle);
 
-        // Create per-frame constant buffers, 256-byte aligned
-        m_constantBufferSize = (sizeof(IllusionConfig) + 255) & ~255ULL;
+        // Create per-frame constant buffers for each output, 256-byte aligned
+        m_constantBufferSize = (sizeof(GpuConfig) + 255) & ~255ULL;
         D3D12_HEAP_PROPERTIES uploadHeapProps = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD);
-        for (UINT i = 0; i < FRAME_COUNT; ++i) {
-            D3D12_RESOURCE_DESC cbDesc = CD3DX12_RESOURCE_DESC::Buffer(m_constantBufferSize);
-            CHECK_HR(m_device->CreateCommittedResource(&uploadHeapProps, D3D12_HEAP_FLAG_NONE, &cbDesc, D3D12_RESOURCE_STATE_GENERIC_READ, NULL, IID_PPV_ARGS(&m_constantBuffers[i])), "Create constant buffer failed");
-            // Persistently map
-            CHECK_HR(m_constantBuffers[i]->Map(0, NULL, reinterpret_cast<void**>(&m_mappedConstantData[i])), "Map constant buffer failed");
-            // Initialize with current config
-            memcpy(m_mappedConstantData[i], &config, sizeof(IllusionConfig));
-            // Do not Unmap for upload heaps (keep mapped)
+        for (auto& out : m_outputs) {
+            for (UINT i = 0; i < FRAME_COUNT; ++i) {
+                D3D12_RESOURCE_DESC cbDesc = CD3DX12_RESOURCE_DESC::Buffer(m_constantBufferSize);
+                CHECK_HR(m_device->CreateCommittedResource(&uploadHeapProps, D3D12_HEAP_FLAG_NONE, &cbDesc, D3D12_RESOURCE_STATE_GENERIC_READ, NULL, IID_PPV_ARGS(&out->constantBuffers[i])), "Create constant buffer failed");
+                // Persistently map
+                CHECK_HR(out->constantBuffers[i]->Map(0, NULL, reinterpret_cast<void**>(&out->mappedConstantData[i])), "Map constant buffer failed");
+                // Initialize with current config
+                UpdateOutputConfig(*out);
+                WriteConstants(*out, i);
+                // Do not Unmap for upload heaps (keep mapped)
+            }
+            CreateTimestampQueries(*out);
         }
 
         // Create vertex buffer (unchanged)
@@ -567,20 +1330,22 @@ public:
         memcpy(vbData, vertices, sizeof(vertices));
         m_vertexBuffer->Unmap(0, NULL);
 
+        startupProfiler.Record("Textures, buffers and views", phase);
         Log("Resources created successfully\n");
         return true;
     }
 
-    void CreateCheckerboardPattern(uint32_t* data) {
+    void CreateCheckerboardPattern(uint32_t* data, UINT width, UINT height, UINT pitchPixels) {
         const uint32_t white = 0xFFFFFFFF;
         const uint32_t gray = 0xFF808080;
         const int squareSize = 32;
-        for (UINT y = 0; y < SCREEN_HEIGHT; y++) {
-            for (UINT x = 0; x < SCREEN_WIDTH; x++) {
-                bool isWhiteSquare = ((x / squareSize) + (y / squareSize)) % 2 == 0;
-                data[y * SCREEN_WIDTH + x] = isWhiteSquare ? white : gray;
+        // One square per tile, filled with a single color
+        ParallelForTiles(static_cast<int>(width), static_cast<int>(height), squareSize, squareSize, [&](int x0, int y0, int x1, int y1) {
+            uint32_t color = ((x0 / squareSize) + (y0 / squareSize)) % 2 == 0 ? white : gray;
+            for (int y = y0; y < y1; y++) {
+                std::fill(data + static_cast<size_t>(y) * pitchPixels + x0, data + static_cast<size_t>(y) * pitchPixels + x1, color);
             }
-        }
+        });
     }
 
     bool CreatePipelines() {
@@ -589,7 +1354,7 @@ public:
         Log("Creating pipelines...\n");
 
         CD3DX12_ROOT_PARAMETER rootParams[3] = {};
-        CD3DX12_DESCRIPTOR_RANGE srvRange(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 1, 0);
+        CD3DX12_DESCRIPTOR_RANGE srvRange(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 2, 0); // t0-t1: left and right eye
         rootParams[0].InitAsDescriptorTable(1, &srvRange, D3D12_SHADER_VISIBILITY_PIXEL);
         CD3DX12_DESCRIPTOR_RANGE samplerRange(D3D12_DESCRIPTOR_RANGE_TYPE_SAMPLER, 1, 0);
         rootParams[1].InitAsDescriptorTable(1, &samplerRange, D3D12_SHADER_VISIBILITY_PIXEL);
@@ -620,7 +1385,10 @@ public:
             computeParams[0].InitAsDescriptorTable(1, &srvRange, D3D12_SHADER_VISIBILITY_ALL);
             computeParams[1].InitAsDescriptorTable(1, &uavRange, D3D12_SHADER_VISIBILITY_ALL);
             computeParams[2].InitAsConstantBufferView(0);
-            CD3DX12_ROOT_SIGNATURE_DESC computeRootDesc(3, computeParams);
+            // FogCompute.hlsl's LinearSampler (s0)
+            CD3DX12_STATIC_SAMPLER_DESC linearSampler(0, D3D12_FILTER_MIN_MAG_MIP_LINEAR, D3D12_TEXTURE_ADDRESS_MODE_CLAMP,
+                D3D12_TEXTURE_ADDRESS_MODE_CLAMP, D3D12_TEXTURE_ADDRESS_MODE_CLAMP);
+            CD3DX12_ROOT_SIGNATURE_DESC computeRootDesc(3, computeParams, 1, &linearSampler);
             ID3DBlob* compSig = nullptr;
             ID3DBlob* compErr = nullptr;
             HRESULT hrSig = D3D12SerializeRootSignature(&computeRootDesc, D3D_ROOT_SIGNATURE_VERSION_1, &compSig, &compErr);
@@ -633,100 +1401,89 @@ public:
             SAFE_RELEASE(compSig);
         }
 
-        // Compile compute shader FogCompute.hlsl
-        ID3DBlob* csBlob = nullptr;
-        ID3DBlob* csCompiled = nullptr;
-        Log("Loading FogCompute.hlsl...\n");
-        hr = D3DReadFileToBlob(L"FogCompute.hlsl", &csBlob);
-        if (FAILED(hr)) {
-            Log("Failed to load FogCompute.hlsl, compute fog disabled\n");
-            SAFE_RELEASE(csBlob);
-        }
-        else {
-            ID3DBlob* error = nullptr;
-            hr = D3DCompile(csBlob->GetBufferPointer(), csBlob->GetBufferSize(), "FogCompute.hlsl", nullptr, nullptr, "CSMain", "cs_5_0", 0, 0, &csCompiled, &error);
-            if (FAILED(hr)) {
-                if (error) { Log((const char*)error->GetBufferPointer()); SAFE_RELEASE(error); }
-                SAFE_RELEASE(csBlob);
-            }
-            else {
-                SAFE_RELEASE(csBlob);
-                D3D12_COMPUTE_PIPELINE_STATE_DESC cpsd = {};
-                cpsd.pRootSignature = m_computeRootSignature;
-                cpsd.CS = { csCompiled->GetBufferPointer(), csCompiled->GetBufferSize() };
-                CHECK_HR(m_device->CreateComputePipelineState(&cpsd, IID_PPV_ARGS(&m_computePso)), "CreateComputePipelineState failed");
-                SAFE_RELEASE(csCompiled);
+        // Mip chain root signature: level k - 1 as SRV t0, level k as UAV u0
+        {
+            CD3DX12_DESCRIPTOR_RANGE srvRange(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 1, 0);
+            CD3DX12_DESCRIPTOR_RANGE uavRange(D3D12_DESCRIPTOR_RANGE_TYPE_UAV, 1, 0);
+            CD3DX12_ROOT_PARAMETER mipParams[2];
+            mipParams[0].InitAsDescriptorTable(1, &srvRange, D3D12_SHADER_VISIBILITY_ALL);
+            mipParams[1].InitAsDescriptorTable(1, &uavRange, D3D12_SHADER_VISIBILITY_ALL);
+            CD3DX12_ROOT_SIGNATURE_DESC mipRootDesc(2, mipParams);
+            ID3DBlob* mipSig = nullptr;
+            ID3DBlob* mipErr = nullptr;
+            HRESULT hrSig = D3D12SerializeRootSignature(&mipRootDesc, D3D_ROOT_SIGNATURE_VERSION_1, &mipSig, &mipErr);
+            if (FAILED(hrSig)) {
+                if (mipErr) { Log((const char*)mipErr->GetBufferPointer()); SAFE_RELEASE(mipErr); }
+                SAFE_RELEASE(mipSig);
+                return false;
             }
+            CHECK_HR(m_device->CreateRootSignature(0, mipSig->GetBufferPointer(), mipSig->GetBufferSize(), IID_PPV_ARGS(&m_mipRootSignature)), "Create mip root signature failed");
+            SAFE_RELEASE(mipSig);
         }
 
-        ID3DBlob* vsBlob = nullptr;
-        ID3DBlob* psBlob = nullptr;
-        Log("Loading VertexShader.hlsl...\n");
-        hr = D3DReadFileToBlob(L"VertexShader.hlsl", &vsBlob);
-        if (FAILED(hr)) {
-            char buffer[256];
-            sprintf_s(buffer, "Failed to load VertexShader.hlsl (HR: 0x%08X)\n", hr);
-            Log(buffer);
-            SAFE_RELEASE(vsBlob);
-            return false;
+        // Shader bytecode comes from the compile workers started in BeginAsyncInitialization.
+        // It is kept after PSO creation so device recovery rebuilds the PSOs without recompiling.
+        auto phase = StartupProfiler::Now();
+        HRESULT fogHr = m_fogShader ? S_OK : E_FAIL;
+        HRESULT mipHr = m_mipShader ? S_OK : E_FAIL;
+        HRESULT vsHr = m_vertexShader ? S_OK : E_FAIL;
+        HRESULT psHr = m_pixelShader ? S_OK : E_FAIL;
+        if (m_vertexShaderJob.valid() || FAILED(vsHr) || FAILED(psHr)) {
+            if (!m_vertexShaderJob.valid()) {
+                ReleaseShaderBytecode();
+                StartShaderCompilation();
+            }
+            fogHr = m_fogShaderJob.get();
+            mipHr = m_mipShaderJob.get();
+            vsHr = m_vertexShaderJob.get();
+            psHr = m_pixelShaderJob.get();
+            startupProfiler.Record("Wait for shader compilation", phase);
         }
-        Log("VertexShader.hlsl loaded successfully\n");
-
-        Log("Loading PixelShader.hlsl...\n");
-        hr = D3DReadFileToBlob(L"PixelShader.hlsl", &psBlob);
-        if (FAILED(hr)) {
-            char buffer[256];
-            sprintf_s(buffer, "Failed to load PixelShader.hlsl (HR: 0x%08X)\n", hr);
-            Log(buffer);
-            SAFE_RELEASE(vsBlob);
-            SAFE_RELEASE(psBlob);
-            return false;
+        else {
+            Log("Reusing compiled shader bytecode\n");
         }
-        Log("PixelShader.hlsl loaded successfully\n");
 
-        ID3DBlob* vsCompiled = nullptr;
-        ID3DBlob* psCompiled = nullptr;
-        hr = D3DCompile(vsBlob->GetBufferPointer(), vsBlob->GetBufferSize(), "VertexShader.hlsl", nullptr, nullptr, "VSMain", "vs_5_0", 0, 0, &vsCompiled, &error);
-        if (FAILED(hr)) {
-            if (error) {
-                Log("Vertex shader compilation error: ");
-                Log(static_cast<const char*>(error->GetBufferPointer()));
-                SAFE_RELEASE(error);
+        phase = StartupProfiler::Now();
+        if (FAILED(fogHr)) {
+            Log("FogCompute.hlsl unavailable, compute fog disabled\n");
+        }
+        else {
+            D3D12_COMPUTE_PIPELINE_STATE_DESC cpsd = {};
+            cpsd.pRootSignature = m_computeRootSignature;
+            cpsd.CS = { m_fogShader->GetBufferPointer(), m_fogShader->GetBufferSize() };
+            if (FAILED(m_device->CreateComputePipelineState(&cpsd, IID_PPV_ARGS(&m_computePso)))) {
+                Log("Fog pipeline state creation failed, compute fog disabled\n");
+                m_computePso = nullptr;
             }
-            SAFE_RELEASE(vsBlob);
-            SAFE_RELEASE(psBlob);
-            return false;
+        }
+        if (FAILED(mipHr)) {
+            Log("MipCompute.hlsl unavailable, eye texture mips not built\n");
+        }
+        else {
+            D3D12_COMPUTE_PIPELINE_STATE_DESC cpsd = {};
+            cpsd.pRootSignature = m_mipRootSignature;
+            cpsd.CS = { m_mipShader->GetBufferPointer(), m_mipShader->GetBufferSize() };
+            CHECK_HR(m_device->CreateComputePipelineState(&cpsd, IID_PPV_ARGS(&m_mipPso)), "Create mip pipeline state failed");
         }
 
-        hr = D3DCompile(psBlob->GetBufferPointer(), psBlob->GetBufferSize(), "PixelShader.hlsl", nullptr, nullptr, "PSMain", "ps_5_0", 0, 0, &psCompiled, &error);
-        if (FAILED(hr)) {
-            if (error) {
-                Log("Pixel shader compilation error: ");
-                Log(static_cast<const char*>(error->GetBufferPointer()));
-                SAFE_RELEASE(error);
-            }
-            SAFE_RELEASE(vsBlob);
-            SAFE_RELEASE(psBlob);
-            SAFE_RELEASE(vsCompiled);
+        if (FAILED(vsHr) || FAILED(psHr)) {
+            ReleaseShaderBytecode();
             return false;
         }
 
-        SAFE_RELEASE(vsBlob);
-        SAFE_RELEASE(psBlob);
-
         D3D12_INPUT_ELEMENT_DESC inputLayout[] = {
             { "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
             { "TEXCOORD", 0, DXGI_FORMAT_R32G32_FLOAT, 0, 12, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 }
         };
 
         DXGI_SWAP_CHAIN_DESC1 swapChainDesc;
-        m_swapChain->GetDesc1(&swapChainDesc);
+        m_outputs[0]->swapChain->GetDesc1(&swapChainDesc);
         DXGI_FORMAT swapChainFormat = swapChainDesc.Format;
 
         D3D12_GRAPHICS_PIPELINE_STATE_DESC psoDesc = {};
         psoDesc.pRootSignature = m_rootSignature;
-        psoDesc.VS = { vsCompiled->GetBufferPointer(), vsCompiled->GetBufferSize() };
-        psoDesc.PS = { psCompiled->GetBufferPointer(), psCompiled->GetBufferSize() };
+        psoDesc.VS = { m_vertexShader->GetBufferPointer(), m_vertexShader->GetBufferSize() };
+        psoDesc.PS = { m_pixelShader->GetBufferPointer(), m_pixelShader->GetBufferSize() };
         psoDesc.InputLayout = { inputLayout, 2 };
         psoDesc.PrimitiveTopologyType = D3D12_PRIMITIVE_TOPOLOGY_TYPE_TRIANGLE;
         psoDesc.RTVFormats[0] = swapChainFormat;
@@ -745,135 +1502,158 @@ public:
 
         Log("Creating Graphics PSO...\n");
         hr = m_device->CreateGraphicsPipelineState(&psoDesc, IID_PPV_ARGS(&m_graphicsPso));
-        SAFE_RELEASE(vsCompiled);
-        SAFE_RELEASE(psCompiled);
         CHECK_HR(hr, "CreateGraphicsPipelineState failed");
+        startupProfiler.Record("Pipeline state objects", phase);
 
         Log("Pipelines created successfully\n");
         return true;
     }
 
-    bool CaptureDesktop() {
-        if (!ValidateResources() || !m_d3d11Duplication || !m_d3d11StagingTexture || !m_d3d12UploadBuffer) {
-            Log("CaptureDesktop skipped due to invalid resources\n");
+    // Renders every output whose previous frame has retired on the GPU. Outputs that are
+    // still busy, or whose present queue is full, are skipped this round rather than
+    // waited on, so one slow display does not hold back the others.
+    bool Render() {
+        if (!ValidateResources()) {
+            Log("Render failed: Invalid resources\n");
+            if (m_fallbackMode) return RenderFallback();
             return false;
         }
 
-        Log("Capturing desktop...\n");
-        DXGI_OUTDUPL_FRAME_INFO frameInfo;
-        IDXGIResource* desktopResource = NULL;
-        HRESULT hr = m_d3d11Duplication->AcquireNextFrame(16, &frameInfo, &desktopResource);
-        if (FAILED(hr)) {
-            // Do not call ReleaseFrame() here because AcquireNextFrame failed and no frame has been acquired
-            if (hr == DXGI_ERROR_WAIT_TIMEOUT) {
-                // No new frame available within timeout - this isn't fatal
-                Log("AcquireNextFrame timed out (no new frame)\n");
-                return false;
+        Log("Rendering frame...\n");
+        m_time += 0.016f;
+        for (auto& outPtr : m_outputs) {
+            OutputContext& out = *outPtr;
+            if (out.resizePending) {
+                m_scheduler.Pause(out.index);
+                WaitForGPU();
+                bool resized = ResizeOutput(out, out.captureWidth, out.captureHeight);
+                out.resizePending = false;
+                m_scheduler.Resume(out.index);
+                if (!resized) return false;
             }
-            char buf[128];
-            sprintf_s(buf, "AcquireNextFrame failed (HR: 0x%08X)\n", hr);
-            Log(buf);
-            return false;
-        }
+            if (m_fence->GetCompletedValue() < out.fenceValue) continue;
 
-        if (!desktopResource) {
-            Log("AcquireNextFrame returned no desktop resource\n");
-            // Ensure we release the frame slot if we somehow acquired one
-            m_d3d11Duplication->ReleaseFrame();
-            return false;
+            int slot = m_scheduler.TakeLatest(out.index);
+            if (slot >= 0) {
+                out.pendingSlot = slot;
+                out.shownFrame = out.slotFrames[slot];
+                out.shownFresh = true;
+            }
+            if (!RenderOutput(out)) return false;
         }
+        return true;
+    }
 
-        ID3D11Texture2D* d3d11Texture = NULL;
-        hr = desktopResource->QueryInterface(IID_PPV_ARGS(&d3d11Texture));
-        if (FAILED(hr) || !d3d11Texture) {
-            SAFE_RELEASE(desktopResource);
-            m_d3d11Duplication->ReleaseFrame();
-            Log("Desktop resource QueryInterface failed\n");
-            return false;
-        }
+    bool RenderFallback() {
+        Log("Rendering in fallback mode...\n");
+        if (!m_commandQueue || !m_commandList) return false;
 
-        m_d3d11Context->CopyResource(m_d3d11StagingTexture, d3d11Texture);
+        for (auto& outPtr : m_outputs) {
+            OutputContext& out = *outPtr;
+            if (!out.swapChain || !out.rtvHeap) return false;
+            out.frameIndex = out.swapChain->GetCurrentBackBufferIndex();
+            HRESULT hr = out.commandAllocators[out.frameIndex]->Reset();
+            CHECK_HR(hr, "Fallback allocator reset failed");
 
-        D3D11_MAPPED_SUBRESOURCE mappedResource;
-        hr = m_d3d11Context->Map(m_d3d11StagingTexture, 0, D3D11_MAP_READ, 0, &mappedResource);
-        if (FAILED(hr)) {
-            SAFE_RELEASE(d3d11Texture);
-            SAFE_RELEASE(desktopResource);
-            m_d3d11Duplication->ReleaseFrame();
-            Log("Map staging texture failed\n");
-            return false;
-        }
+            hr = m_commandList->Reset(out.commandAllocators[out.frameIndex], NULL);
+            CHECK_HR(hr, "Fallback command list reset failed");
 
-        UINT8* uploadData;
-        hr = m_d3d12UploadBuffer->Map(0, NULL, reinterpret_cast<void**>(&uploadData));
-        if (FAILED(hr)) {
-            m_d3d11Context->Unmap(m_d3d11StagingTexture, 0);
-            SAFE_RELEASE(d3d11Texture);
-            SAFE_RELEASE(desktopResource);
-            m_d3d11Duplication->ReleaseFrame();
-            Log("Map upload buffer failed\n");
-            return false;
-        }
+            CD3DX12_RESOURCE_BARRIER barrier = CD3DX12_RESOURCE_BARRIER::Transition(out.renderTargets[out.frameIndex], D3D12_RESOURCE_STATE_PRESENT, D3D12_RESOURCE_STATE_RENDER_TARGET);
+            m_commandList->ResourceBarrier(1, &barrier);
 
-        // Safe pitch-aware copy (use min of row sizes)
-        size_t rowBytes = SCREEN_WIDTH * 4;
-        for (UINT y = 0; y < SCREEN_HEIGHT; y++) {
-            uint8_t* src = static_cast<uint8_t*>(mappedResource.pData) + static_cast<size_t>(y) * mappedResource.RowPitch;
-            uint8_t* dst = uploadData + static_cast<size_t>(y) * rowBytes;
-            size_t copyBytes = (mappedResource.RowPitch < static_cast<UINT>(rowBytes)) ? mappedResource.RowPitch : rowBytes;
-            memcpy(dst, src, copyBytes);
-            if (copyBytes < rowBytes) {
-                // zero remaining bytes to avoid garbage
-                memset(dst + copyBytes, 0, rowBytes - copyBytes);
-            }
-        }
+            CD3DX12_CPU_DESCRIPTOR_HANDLE rtvHandle(out.rtvHeap->GetCPUDescriptorHandleForHeapStart(), out.frameIndex, m_rtvDescriptorSize);
+            m_commandList->OMSetRenderTargets(1, &rtvHandle, FALSE, NULL);
+            const float clearColor[] = { 0.5f, 0.0f, 0.0f, 1.0f };
+            m_commandList->ClearRenderTargetView(rtvHandle, clearColor, 0, NULL);
 
-        m_d3d12UploadBuffer->Unmap(0, NULL);
-        m_d3d11Context->Unmap(m_d3d11StagingTexture, 0);
+            barrier = CD3DX12_RESOURCE_BARRIER::Transition(out.renderTargets[out.frameIndex], D3D12_RESOURCE_STATE_RENDER_TARGET, D3D12_RESOURCE_STATE_PRESENT);
+            m_commandList->ResourceBarrier(1, &barrier);
 
-        CHECK_HR(m_commandList->Reset(m_commandAllocators[m_frameIndex], NULL), "Reset command list for capture failed");
-        CD3DX12_RESOURCE_BARRIER barrier = CD3DX12_RESOURCE_BARRIER::Transition(m_screenTexture, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE, D3D12_RESOURCE_STATE_COPY_DEST);
-        m_commandList->ResourceBarrier(1, &barrier);
-        D3D12_SUBRESOURCE_DATA subresourceData = { uploadData, static_cast<LONG_PTR>(rowBytes), static_cast<LONG_PTR>(rowBytes * SCREEN_HEIGHT) };
-        ::UpdateSubresources<1>(m_commandList, m_screenTexture, m_d3d12UploadBuffer, 0, 0, 1, &subresourceData);
-        barrier = CD3DX12_RESOURCE_BARRIER::Transition(m_screenTexture, D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
-        m_commandList->ResourceBarrier(1, &barrier);
-        CHECK_HR(m_commandList->Close(), "Close command list for capture failed");
+            CHECK_HR(m_commandList->Close(), "Fallback command list close failed");
 
-        ID3D12CommandList* cmdLists[] = { m_commandList };
-        m_commandQueue->ExecuteCommandLists(1, cmdLists);
-        WaitForGPU();
+            ID3D12CommandList* commandLists[] = { m_commandList };
+            m_commandQueue->ExecuteCommandLists(1, commandLists);
 
-        SAFE_RELEASE(d3d11Texture);
-        SAFE_RELEASE(desktopResource);
-        // Release the frame now that processing is complete
-        m_d3d11Duplication->ReleaseFrame();
-        Log("Desktop captured successfully\n");
+            hr = out.swapChain->Present(1, 0);
+            CHECK_HR(hr, "Fallback Present failed");
+            WaitForGPU();
+        }
+
+        Log("Fallback frame rendered\n");
         return true;
     }
 
-    bool Render() {
-        if (!ValidateResources()) {
-            Log("Render failed: Invalid resources\n");
-            if (m_fallbackMode) return RenderFallback();
-            return false;
+    // Render thread
+    void LogFrameAccounting() {
+        for (auto& out : m_outputs) {
+            FrameCounts counts = out->accounting.Counts();
+            SpanStats capture = out->accounting.Span(SpanCapture);
+            SpanStats age = out->accounting.Span(SpanAge);
+            char buffer[320];
+            sprintf_s(buffer, "Output %d frames: %llu presented, %llu of %llu captures shown, %llu reused, %llu dropped, "
+                "%llu desktop frames (%llu folded); capture to present %.1f / %.1f / %.1f ms p50 / p95 / p99, age %.1f ms p50\n",
+                out->index, counts.presented, counts.shown, counts.captured, counts.reused, counts.dropped,
+                counts.desktopFrames, counts.desktopSkipped, capture.p50Ms, capture.p95Ms, capture.p99Ms, age.p50Ms);
+            Log(buffer);
         }
+    }
 
-        Log("Rendering frame...\n");
-        m_frameIndex = m_swapChain->GetCurrentBackBufferIndex();
-        if (m_frameIndex >= FRAME_COUNT || !m_commandAllocators[m_frameIndex] || !m_renderTargets[m_frameIndex]) {
+private:
+    bool RenderOutput(OutputContext& out) {
+        out.frameIndex = out.swapChain->GetCurrentBackBufferIndex();
+        if (out.frameIndex >= FRAME_COUNT || !out.commandAllocators[out.frameIndex] || !out.renderTargets[out.frameIndex]) {
             Log("Invalid frame index or resources\n");
             return false;
         }
 
-        HRESULT hr = m_commandAllocators[m_frameIndex]->Reset();
+        HRESULT hr = out.commandAllocators[out.frameIndex]->Reset();
         CHECK_HR(hr, "Command allocator reset failed");
 
-        hr = m_commandList->Reset(m_commandAllocators[m_frameIndex], m_graphicsPso);
+        hr = m_commandList->Reset(out.commandAllocators[out.frameIndex], m_graphicsPso);
         CHECK_HR(hr, "Command list reset failed");
 
-        // Dispatch disparity compute if available and enabled
-        if (m_computePso && config.enable_volumetric_fog && m_disparityTexture) {
+        // Render only gets here once the output's last submission has completed
+        ReadTimestamps(out);
+        AccountPresentedFrame(out);
+        UpdateEffects(out);
+        if (out.timestampHeap) m_commandList->EndQuery(out.timestampHeap, D3D12_QUERY_TYPE_TIMESTAMP, 0);
+
+        // Upload the newest captured frame (both eye planes) for this output, if there is one
+        if (out.pendingSlot >= 0) {
+            ID3D12Resource* eyeTextures[2] = { out.screenTexture, out.rightEyeTexture };
+            CD3DX12_RESOURCE_BARRIER barriers[2];
+            for (int eye = 0; eye < 2; eye++) {
+                barriers[eye] = CD3DX12_RESOURCE_BARRIER::Transition(eyeTextures[eye], D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE, D3D12_RESOURCE_STATE_COPY_DEST);
+            }
+            m_commandList->ResourceBarrier(2, barriers);
+            for (int eye = 0; eye < 2; eye++) {
+                D3D12_PLACED_SUBRESOURCE_FOOTPRINT footprint = {};
+                // An interleaved slot feeds both eyes from its first plane
+                footprint.Offset = out.slotInterleaved[out.pendingSlot] ? 0 : eye * out.EyePlaneBytes();
+                footprint.Footprint.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+                footprint.Footprint.Width = out.width;
+                footprint.Footprint.Height = out.height;
+                footprint.Footprint.Depth = 1;
+                footprint.Footprint.RowPitch = out.uploadPitch;
+                CD3DX12_TEXTURE_COPY_LOCATION dst(eyeTextures[eye], 0);
+                CD3DX12_TEXTURE_COPY_LOCATION src(out.uploadBuffers[out.pendingSlot], footprint);
+                m_commandList->CopyTextureRegion(&dst, 0, 0, 0, &src, NULL);
+                barriers[eye] = CD3DX12_RESOURCE_BARRIER::Transition(eyeTextures[eye], D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+            }
+            if (m_mipPso) BuildEyeMips(out, eyeTextures);
+            else m_commandList->ResourceBarrier(2, barriers);
+            out.pendingSlot = -1;
+        }
+
+        ID3D12DescriptorHeap* heaps[] = { out.srvHeap, m_samplerHeap };
+
+        UpdateOutputConfig(out);
+        WriteConstants(out, out.frameIndex);
+
+        // Dispatch disparity compute if available and enabled. Never taken in this tree:
+        // m_disparityTexture is not created, heap slot 2 has no UAV, and the graphics root
+        // signature's SRV range stops at t1, so PSMain could not read the result either.
+        if (m_computePso && out.frameConfig.enable_volumetric_fog && m_disparityTexture) {
             // Transition disparity to UAV
             CD3DX12_RESOURCE_BARRIER toUav = CD3DX12_RESOURCE_BARRIER::Transition(m_disparityTexture, D3D12_RESOURCE_STATE_COMMON, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
             m_commandList->ResourceBarrier(1, &toUav);
@@ -881,19 +1661,21 @@ public:
             m_commandList->SetPipelineState(m_computePso);
             m_commandList->SetComputeRootSignature(m_computeRootSignature);
 
-            ID3D12DescriptorHeap* heaps[] = { m_srvHeap, m_samplerHeap };
             m_commandList->SetDescriptorHeaps(2, heaps);
 
             // Root descriptor tables: SRV table at slot 0 (t0,t1), UAV table at slot1 (u0)
-            CD3DX12_GPU_DESCRIPTOR_HANDLE gpuSrv(m_srvHeap->GetGPUDescriptorHandleForHeapStart());
+            CD3DX12_GPU_DESCRIPTOR_HANDLE gpuSrv(out.srvHeap->GetGPUDescriptorHandleForHeapStart());
             m_commandList->SetComputeRootDescriptorTable(0, gpuSrv);
             // UAV at descriptor index 2
-            CD3DX12_GPU_DESCRIPTOR_HANDLE gpuUav(m_srvHeap->GetGPUDescriptorHandleForHeapStart(), 2, m_device->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV));
+            CD3DX12_GPU_DESCRIPTOR_HANDLE gpuUav(out.srvHeap->GetGPUDescriptorHandleForHeapStart(), 2, m_device->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV));
             m_commandList->SetComputeRootDescriptorTable(1, gpuUav);
+            m_commandList->SetComputeRootConstantBufferView(2, out.constantBuffers[out.frameIndex]->GetGPUVirtualAddress());
 
-            // Dispatch compute at 16x16 threads
-            UINT threadsX = (SCREEN_WIDTH + 15) / 16;
-            UINT threadsY = (SCREEN_HEIGHT + 15) / 16;
+            // Dispatch compute at 16x16 threads over the fog texture, which is reduced by
+            // ProcessingScale; PixelShader.hlsl upsamples it guided by full-resolution luminance
+            int fogScale = ProcessingScale(out.frameConfig.processing_quality);
+            UINT threadsX = (ReducedSize(static_cast<int>(out.width), fogScale) + 15) / 16;
+            UINT threadsY = (ReducedSize(static_cast<int>(out.height), fogScale) + 15) / 16;
             m_commandList->Dispatch(threadsX, threadsY, 1);
 
             // Transition disparity to SRV for pixel shader use
@@ -904,23 +1686,17 @@ public:
             m_commandList->SetPipelineState(m_graphicsPso);
             m_commandList->SetGraphicsRootSignature(m_rootSignature);
             // rebind constant buffer root slot
-            m_commandList->SetGraphicsRootConstantBufferView(2, m_constantBuffers[m_frameIndex]->GetGPUVirtualAddress());
+            m_commandList->SetGraphicsRootConstantBufferView(2, out.constantBuffers[out.frameIndex]->GetGPUVirtualAddress());
             // rebind descriptor heaps
             m_commandList->SetDescriptorHeaps(2, heaps);
-            m_commandList->SetGraphicsRootDescriptorTable(0, m_srvHeap->GetGPUDescriptorHandleForHeapStart());
+            m_commandList->SetGraphicsRootDescriptorTable(0, out.srvHeap->GetGPUDescriptorHandleForHeapStart());
             m_commandList->SetGraphicsRootDescriptorTable(1, m_samplerHeap->GetGPUDescriptorHandleForHeapStart());
         }
 
-        m_time += 0.016f;
-        IllusionConfig frameConfig = config;
-        frameConfig.time = m_time;
-        // Write into per-frame mapped constant buffer
-        memcpy(m_mappedConstantData[m_frameIndex], &frameConfig, sizeof(IllusionConfig));
-
-        CD3DX12_RESOURCE_BARRIER barrier = CD3DX12_RESOURCE_BARRIER::Transition(m_renderTargets[m_frameIndex], D3D12_RESOURCE_STATE_PRESENT, D3D12_RESOURCE_STATE_RENDER_TARGET);
+        CD3DX12_RESOURCE_BARRIER barrier = CD3DX12_RESOURCE_BARRIER::Transition(out.renderTargets[out.frameIndex], D3D12_RESOURCE_STATE_PRESENT, D3D12_RESOURCE_STATE_RENDER_TARGET);
         m_commandList->ResourceBarrier(1, &barrier);
 
-        CD3DX12_CPU_DESCRIPTOR_HANDLE rtvHandle(m_rtvHeap->GetCPUDescriptorHandleForHeapStart(), m_frameIndex, m_rtvDescriptorSize);
+        CD3DX12_CPU_DESCRIPTOR_HANDLE rtvHandle(out.rtvHeap->GetCPUDescriptorHandleForHeapStart(), out.frameIndex, m_rtvDescriptorSize);
         m_commandList->OMSetRenderTargets(1, &rtvHandle, FALSE, NULL);
         const float clearColor[] = { 0.2f, 0.3f, 0.4f, 1.0f };
         m_commandList->ClearRenderTargetView(rtvHandle, clearColor, 0, NULL);
@@ -928,16 +1704,15 @@ public:
         m_commandList->SetPipelineState(m_graphicsPso);
         m_commandList->SetGraphicsRootSignature(m_rootSignature);
         // Use GPU virtual address of the per-frame constant buffer (must be 256-byte aligned)
-        m_commandList->SetGraphicsRootConstantBufferView(2, m_constantBuffers[m_frameIndex]->GetGPUVirtualAddress());
+        m_commandList->SetGraphicsRootConstantBufferView(2, out.constantBuffers[out.frameIndex]->GetGPUVirtualAddress());
 
-        ID3D12DescriptorHeap* heaps[] = { m_srvHeap, m_samplerHeap };
         m_commandList->SetDescriptorHeaps(2, heaps);
 
-        m_commandList->SetGraphicsRootDescriptorTable(0, m_srvHeap->GetGPUDescriptorHandleForHeapStart());
+        m_commandList->SetGraphicsRootDescriptorTable(0, out.srvHeap->GetGPUDescriptorHandleForHeapStart());
         m_commandList->SetGraphicsRootDescriptorTable(1, m_samplerHeap->GetGPUDescriptorHandleForHeapStart());
 
-        CD3DX12_VIEWPORT viewport(0.0f, 0.0f, static_cast<float>(SCREEN_WIDTH), static_cast<float>(SCREEN_HEIGHT));
-        CD3DX12_RECT scissorRect(0, 0, static_cast<LONG>(SCREEN_WIDTH), static_cast<LONG>(SCREEN_HEIGHT));
+        CD3DX12_VIEWPORT viewport(0.0f, 0.0f, static_cast<float>(out.width), static_cast<float>(out.height));
+        CD3DX12_RECT scissorRect(0, 0, static_cast<LONG>(out.width), static_cast<LONG>(out.height));
         m_commandList->RSSetViewports(1, &viewport);
         m_commandList->RSSetScissorRects(1, &scissorRect);
 
@@ -946,17 +1721,28 @@ public:
         m_commandList->IASetVertexBuffers(0, 1, &vbView);
         m_commandList->DrawInstanced(4, 1, 0, 0);
 
-        barrier = CD3DX12_RESOURCE_BARRIER::Transition(m_renderTargets[m_frameIndex], D3D12_RESOURCE_STATE_RENDER_TARGET, D3D12_RESOURCE_STATE_PRESENT);
+        barrier = CD3DX12_RESOURCE_BARRIER::Transition(out.renderTargets[out.frameIndex], D3D12_RESOURCE_STATE_RENDER_TARGET, D3D12_RESOURCE_STATE_PRESENT);
         m_commandList->ResourceBarrier(1, &barrier);
 
+        if (out.timestampHeap) {
+            m_commandList->EndQuery(out.timestampHeap, D3D12_QUERY_TYPE_TIMESTAMP, 1);
+            m_commandList->ResolveQueryData(out.timestampHeap, D3D12_QUERY_TYPE_TIMESTAMP, 0, 2, out.timestampReadback, 0);
+            out.timestampsPending = true;
+        }
+
         CHECK_HR(m_commandList->Close(), "Command list close failed");
 
         ID3D12CommandList* commandLists[] = { m_commandList };
         m_commandQueue->ExecuteCommandLists(1, commandLists);
+        out.fenceValue = ++m_fenceValue;
+        CHECK_HR(m_commandQueue->Signal(m_fence, out.fenceValue), "Signal fence failed");
 
-        hr = m_swapChain->Present(1, 0);
+        // Never block on one output's vsync; a full present queue just skips this output's frame
+        hr = out.swapChain->Present(1, DXGI_PRESENT_DO_NOT_WAIT);
+        double presentedMs = SteadyClockMs();
+        if (hr == DXGI_ERROR_WAS_STILL_DRAWING) return true;
         if (FAILED(hr)) {
-            if (hr == DXGI_ERROR_DEVICE_REMOVED || hr == DXGI_ERROR_DEVICE_HUNG) {
+            if (DeviceRecoveryMachine::IsDeviceLost(hr)) {
                 if (RecoverDevice()) {
                     Log("Device recovered, retrying render\n");
                     return Render();
@@ -970,48 +1756,382 @@ public:
             Log(buffer);
             return false;
         }
-        WaitForGPU();
-
-        Log("Frame rendered successfully\n");
+        out.presentedFrame = out.shownFrame;
+        out.presentedFrame.presentedMs = presentedMs;
+        out.presentedFresh = out.shownFresh;
+        out.presentedPending = true;
+        out.shownFresh = false;
         return true;
     }
 
-    bool RenderFallback() {
-        Log("Rendering in fallback mode...\n");
-        if (!m_swapChain || !m_commandQueue || !m_commandList || !m_rtvHeap) return false;
+    // Per-output copy of the global config. Pixel-sized parameters are scaled by the
+    // output's physical DPI relative to the primary output so they look the same on every screen.
+    void UpdateOutputConfig(OutputContext& out) {
+        out.frameConfig = config;
+        out.frameConfig.outline_width = config.outline_width * out.pixelScale;
+        out.frameConfig.eye_separation = config.eye_separation * out.pixelScale;
+        out.frameConfig.stripe_width_px = config.stripe_width_px * out.pixelScale;
+        out.frameConfig.stripe_offset_px = config.stripe_offset_px * out.pixelScale;
+        out.frameConfig.head_offset_x = config.head_offset_x * out.pixelScale;
+        out.frameConfig.time = m_time;
+        // What EffectGovernor shed; rank 0 is the config's own set
+        if (config.shed_effects && out.effects.Rank() > 0) {
+            const EffectSet& granted = out.effects.Granted();
+            if (granted.fogSteps == 0) out.frameConfig.enable_volumetric_fog = 0;
+            else out.frameConfig.processing_quality = (granted.fogSteps - EFFECT_MIN_FOG_STEPS) / EFFECT_FOG_STEP_DROP;
+            if (granted.outlineTaps == 0) out.frameConfig.outline_intensity = 0.0f;
+        }
+    }
 
-        m_frameIndex = m_swapChain->GetCurrentBackBufferIndex();
-        HRESULT hr = m_commandAllocators[m_frameIndex]->Reset();
-        CHECK_HR(hr, "Fallback allocator reset failed");
+    // Whether fog can run at all: PSMain samples the compute fog texture (t2), and nothing
+    // creates that texture or its views yet. Until something does, the overlay has no fog
+    // on any path and the tray's fog toggle does nothing; FogScatter, FogLut and the
+    // reduced-resolution fog are only run by Clean3dBench.
+    bool FogAvailable() const {
+        return m_computePso && m_disparityTexture;
+    }
 
-        hr = m_commandList->Reset(m_commandAllocators[m_frameIndex], NULL);
-        CHECK_HR(hr, "Fallback command list reset failed");
+    // frameConfig into the output's mapped constant buffer 'index'
+    void WriteConstants(OutputContext& out, UINT index) {
+        GpuConfig gpu = MakeGpuConfig(out.frameConfig, out.width, out.height);
+        // Rather than read an unbound slot
+        if (!FogAvailable()) gpu.enable_volumetric_fog = 0;
+        memcpy(out.mappedConstantData[index], &gpu, sizeof(gpu));
+    }
 
-        CD3DX12_RESOURCE_BARRIER barrier = CD3DX12_RESOURCE_BARRIER::Transition(m_renderTargets[m_frameIndex], D3D12_RESOURCE_STATE_PRESENT, D3D12_RESOURCE_STATE_RENDER_TARGET);
-        m_commandList->ResourceBarrier(1, &barrier);
+    // Two timestamps bracket each of the output's submissions. Without them the GPU
+    // domain goes unmeasured and EffectGovernor sheds for the CPU alone.
+    void CreateTimestampQueries(OutputContext& out) {
+        if (!m_timestampFrequency) return;
+        D3D12_QUERY_HEAP_DESC queryDesc = {};
+        queryDesc.Type = D3D12_QUERY_HEAP_TYPE_TIMESTAMP;
+        queryDesc.Count = 2;
+        D3D12_HEAP_PROPERTIES readbackHeapProps = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_READBACK);
+        D3D12_RESOURCE_DESC readbackDesc = CD3DX12_RESOURCE_DESC::Buffer(2 * sizeof(UINT64));
+        if (FAILED(m_device->CreateQueryHeap(&queryDesc, IID_PPV_ARGS(&out.timestampHeap))) ||
+            FAILED(m_device->CreateCommittedResource(&readbackHeapProps, D3D12_HEAP_FLAG_NONE, &readbackDesc, D3D12_RESOURCE_STATE_COPY_DEST, NULL, IID_PPV_ARGS(&out.timestampReadback)))) {
+            Log("Timestamp queries unavailable, GPU time unmeasured\n");
+            SAFE_RELEASE(out.timestampHeap);
+            SAFE_RELEASE(out.timestampReadback);
+        }
+        out.timestampsPending = false;
+    }
 
-        CD3DX12_CPU_DESCRIPTOR_HANDLE rtvHandle(m_rtvHeap->GetCPUDescriptorHandleForHeapStart(), m_frameIndex, m_rtvDescriptorSize);
-        m_commandList->OMSetRenderTargets(1, &rtvHandle, FALSE, NULL);
-        const float clearColor[] = { 0.5f, 0.0f, 0.0f, 1.0f };
-        m_commandList->ClearRenderTargetView(rtvHandle, clearColor, 0, NULL);
+    void ReadTimestamps(OutputContext& out) {
+        out.gpuDoneMs = 0.0;
+        if (!out.timestampsPending) return;
+        out.timestampsPending = false;
+        UINT64* ticks = NULL;
+        D3D12_RANGE readRange = { 0, 2 * sizeof(UINT64) };
+        if (FAILED(out.timestampReadback->Map(0, &readRange, reinterpret_cast<void**>(&ticks)))) return;
+        if (ticks[1] > ticks[0]) out.gpuFrameMs = static_cast<float>((ticks[1] - ticks[0]) * 1000.0 / m_timestampFrequency);
+        // The end tick on the CPU clock, from a GPU and QPC reading taken together
+        UINT64 gpuNow = 0, qpcNow = 0;
+        if (SUCCEEDED(m_commandQueue->GetClockCalibration(&gpuNow, &qpcNow))) {
+            double ticksBack = static_cast<double>(gpuNow) - static_cast<double>(ticks[1]);
+            out.gpuDoneMs = QpcToSteadyMs(static_cast<LONGLONG>(qpcNow)) - ticksBack * 1000.0 / m_timestampFrequency;
+        }
+        D3D12_RANGE writtenRange = { 0, 0 };
+        out.timestampReadback->Unmap(0, &writtenRange);
+    }
 
-        barrier = CD3DX12_RESOURCE_BARRIER::Transition(m_renderTargets[m_frameIndex], D3D12_RESOURCE_STATE_RENDER_TARGET, D3D12_RESOURCE_STATE_PRESENT);
-        m_commandList->ResourceBarrier(1, &barrier);
+    // The last submission is done and its GPU time read: its frame can be counted
+    void AccountPresentedFrame(OutputContext& out) {
+        if (!out.presentedPending) return;
+        out.presentedPending = false;
+        out.presentedFrame.gpuDoneMs = out.gpuDoneMs;
+        out.accounting.AddFrame(out.presentedFrame, out.presentedFresh);
+    }
 
-        CHECK_HR(m_commandList->Close(), "Fallback command list close failed");
+    // Requested effects follow the config; the governor weighs them against the output's
+    // share of the GPU frame and the capture thread's stage budget, both per TARGET_FPS frame.
+    // Fog that cannot run is not requested, so the model holds no cost nothing pays.
+    void UpdateEffects(OutputContext& out) {
+        EffectSet requested;
+        requested.fogSteps = config.enable_volumetric_fog && FogAvailable() ? FogStepCount(config.processing_quality) : 0;
+        requested.outlineTaps = config.outline_intensity > 0.0f ? OUTLINE_TAPS : 0;
+        requested.depthInterval = config.depth_update_interval > 1 ? config.depth_update_interval : 1;
+        if (!config.shed_effects) {
+            out.grantedDepthInterval.store(1);
+            return;
+        }
+        int viewCount = config.enable_lenticular ? config.lens_view_count : 2;
+        out.effects.SetModel(m_effectCosts, static_cast<double>(out.width) * out.height / 1e6, viewCount);
+        out.effects.SetBudget(EffectCpu, config.enable_parallax ? STAGE_BUDGET_SHARE * 1000.0 / TARGET_FPS : 0.0);
+        out.effects.SetBudget(EffectGpu, out.timestampHeap ? 1000.0 / TARGET_FPS / m_outputs.size() : 0.0);
+        out.effects.SetRequested(requested);
+        if (out.effects.Update(out.cpuFrameMs.load(), out.gpuFrameMs)) {
+            const EffectSet& granted = out.effects.Granted();
+            char buffer[160];
+            sprintf_s(buffer, "Output %d effects: fog %d steps, outline %d taps, depth 1/%d (CPU %.2f ms, GPU %.2f ms)\n", out.index,
+                granted.fogSteps, granted.outlineTaps, granted.depthInterval, out.effects.MeasuredMs(EffectCpu), out.effects.MeasuredMs(EffectGpu));
+            Log(buffer);
+        }
+        int interval = out.effects.Granted().depthInterval;
+        out.grantedDepthInterval.store(interval > requested.depthInterval ? interval : 1);
+    }
 
-        ID3D12CommandList* commandLists[] = { m_commandList };
-        m_commandQueue->ExecuteCommandLists(1, commandLists);
+    void StartShaderCompilation() {
+        m_fogShaderJob = std::async(std::launch::async, CompileShaderFile, L"FogCompute.hlsl", "FogCompute.hlsl", "FogCSMain", "cs_5_0", &m_fogShader);
+        m_mipShaderJob = std::async(std::launch::async, CompileShaderFile, L"MipCompute.hlsl", "MipCompute.hlsl", "CSMain", "cs_5_0", &m_mipShader);
+        m_vertexShaderJob = std::async(std::launch::async, CompileShaderFile, L"VertexShader.hlsl", "VertexShader.hlsl", "VSMain", "vs_5_0", &m_vertexShader);
+        m_pixelShaderJob = std::async(std::launch::async, CompileShaderFile, L"PixelShader.hlsl", "PixelShader.hlsl", "PSMain", "ps_5_0", &m_pixelShader);
+    }
 
-        hr = m_swapChain->Present(1, 0);
-        CHECK_HR(hr, "Fallback Present failed");
-        WaitForGPU();
+    void StartDuplicationSetup(OutputContext& out) {
+        OutputContext* target = &out;
+        out.duplicationJob = std::async(std::launch::async, [target]() { return target->SetupDuplication(); });
+    }
 
-        Log("Fallback frame rendered\n");
+    // Joins any outstanding init workers so Cleanup never races them
+    void WaitForAsyncInitialization() {
+        if (m_fogShaderJob.valid()) m_fogShaderJob.wait();
+        if (m_mipShaderJob.valid()) m_mipShaderJob.wait();
+        if (m_vertexShaderJob.valid()) m_vertexShaderJob.wait();
+        if (m_pixelShaderJob.valid()) m_pixelShaderJob.wait();
+        m_fogShaderJob = std::future<HRESULT>();
+        m_mipShaderJob = std::future<HRESULT>();
+        m_vertexShaderJob = std::future<HRESULT>();
+        m_pixelShaderJob = std::future<HRESULT>();
+        for (auto& out : m_outputs) {
+            if (out->duplicationJob.valid()) out->duplicationJob.wait();
+            out->duplicationJob = std::future<DuplicationStatus>();
+        }
+    }
+
+    void CreateOutputSwapChain(OutputContext& out) {
+        DXGI_SWAP_CHAIN_DESC1 swapChainDesc = {};
+        swapChainDesc.Width = out.width;
+        swapChainDesc.Height = out.height;
+        swapChainDesc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+        swapChainDesc.BufferCount = FRAME_COUNT;
+        swapChainDesc.BufferUsage = DXGI_USAGE_RENDER_TARGET_OUTPUT;
+        swapChainDesc.SwapEffect = DXGI_SWAP_EFFECT_FLIP_DISCARD;
+        swapChainDesc.SampleDesc.Count = 1;
+        IDXGISwapChain1* swapChain1 = nullptr;
+        HRESULT hr = m_factory->CreateSwapChainForHwnd(m_commandQueue, out.hwnd, &swapChainDesc, nullptr, nullptr, &swapChain1);
+        CHECK_HR(hr, "CreateSwapChainForHwnd failed");
+        hr = swapChain1->QueryInterface(IID_PPV_ARGS(&out.swapChain));
+        SAFE_RELEASE(swapChain1);
+        CHECK_HR(hr, "SwapChain QueryInterface failed");
+
+        D3D12_DESCRIPTOR_HEAP_DESC rtvHeapDesc = {};
+        rtvHeapDesc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_RTV;
+        rtvHeapDesc.NumDescriptors = FRAME_COUNT;
+        CHECK_HR(m_device->CreateDescriptorHeap(&rtvHeapDesc, IID_PPV_ARGS(&out.rtvHeap)), "Create RTV Heap failed");
+
+        D3D12_DESCRIPTOR_HEAP_DESC srvHeapDesc = {};
+        srvHeapDesc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV;
+        srvHeapDesc.NumDescriptors = MipDescriptorIndex(2, 1);   // eye SRVs, fog UAV, mip views of both eyes
+        srvHeapDesc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE;
+        CHECK_HR(m_device->CreateDescriptorHeap(&srvHeapDesc, IID_PPV_ARGS(&out.srvHeap)), "Create SRV Heap failed");
+
+        CreateRenderTargetViews(out);
+        for (UINT i = 0; i < FRAME_COUNT; i++) {
+            CHECK_HR(m_device->CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE_DIRECT, IID_PPV_ARGS(&out.commandAllocators[i])), "CreateCommandAllocator failed");
+        }
+    }
+
+    void CreateRenderTargetViews(OutputContext& out) {
+        CD3DX12_CPU_DESCRIPTOR_HANDLE rtvHandle(out.rtvHeap->GetCPUDescriptorHandleForHeapStart());
+        for (UINT i = 0; i < FRAME_COUNT; i++) {
+            CHECK_HR(out.swapChain->GetBuffer(i, IID_PPV_ARGS(&out.renderTargets[i])), "GetSwapChainBuffer failed");
+            m_device->CreateRenderTargetView(out.renderTargets[i], NULL, rtvHandle);
+            rtvHandle.Offset(1, m_rtvDescriptorSize);
+        }
+    }
+
+    bool ResizeSwapChain(OutputContext& out, UINT width, UINT height) {
+        WaitForGPU();
+        for (UINT i = 0; i < FRAME_COUNT; i++) SAFE_RELEASE(out.renderTargets[i]);
+        HRESULT hr = out.swapChain->ResizeBuffers(FRAME_COUNT, width, height, DXGI_FORMAT_UNKNOWN, 0);
+        if (FAILED(hr)) {
+            char buffer[128];
+            sprintf_s(buffer, "ResizeBuffers failed (HR: 0x%08X)\n", hr);
+            Log(buffer);
+            return false;
+        }
+        CreateRenderTargetViews(out);
+        out.frameIndex = out.swapChain->GetCurrentBackBufferIndex();
         return true;
     }
 
-private:
+    enum SurfaceKind {
+        SurfaceScreenTexture,
+        SurfaceUploadBuffer
+    };
+
+    // Eye textures and upload slots at the output's size, from the pool when possible.
+    // Textures are created in PIXEL_SHADER_RESOURCE, the state every upload path expects.
+    // Upload slots hold both eye planes and stay mapped while they belong to the output.
+    void AcquireOutputSurfaces(OutputContext& out) {
+        SurfaceKey textureKey = { out.width, out.height, SurfaceScreenTexture };
+        ID3D12Resource** eyeTextures[2] = { &out.screenTexture, &out.rightEyeTexture };
+        for (int eye = 0; eye < 2; eye++) {
+            *eyeTextures[eye] = m_surfacePool.Acquire(textureKey);
+            if (*eyeTextures[eye]) continue;
+            D3D12_HEAP_PROPERTIES defaultHeapProps = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT);
+            // Full mip chain, written by MipCompute.hlsl through UAVs
+            UINT16 levels = static_cast<UINT16>(MipLevelCount(static_cast<int>(out.width), static_cast<int>(out.height)));
+            D3D12_RESOURCE_DESC texDesc = CD3DX12_RESOURCE_DESC::Tex2D(DXGI_FORMAT_R8G8B8A8_UNORM, out.width, out.height, 1, levels,
+                1, 0, D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS);
+            CHECK_HR(m_device->CreateCommittedResource(&defaultHeapProps, D3D12_HEAP_FLAG_NONE, &texDesc, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE, NULL, IID_PPV_ARGS(eyeTextures[eye])), "Create screen texture failed");
+        }
+
+        out.uploadPitch = (out.width * 4 + D3D12_TEXTURE_DATA_PITCH_ALIGNMENT - 1) & ~(D3D12_TEXTURE_DATA_PITCH_ALIGNMENT - 1);
+        SurfaceKey uploadKey = { out.width, out.height, SurfaceUploadBuffer };
+        for (int i = 0; i < FRAME_SOURCE_SLOTS; i++) {
+            out.uploadBuffers[i] = m_surfacePool.Acquire(uploadKey);
+            if (!out.uploadBuffers[i]) {
+                D3D12_HEAP_PROPERTIES uploadHeapProps = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD);
+                D3D12_RESOURCE_DESC bufferDesc = CD3DX12_RESOURCE_DESC::Buffer(2 * static_cast<UINT64>(out.EyePlaneBytes()));
+                CHECK_HR(m_device->CreateCommittedResource(&uploadHeapProps, D3D12_HEAP_FLAG_NONE, &bufferDesc, D3D12_RESOURCE_STATE_GENERIC_READ, NULL, IID_PPV_ARGS(&out.uploadBuffers[i])), "Create D3D12 upload buffer failed");
+            }
+            CHECK_HR(out.uploadBuffers[i]->Map(0, NULL, reinterpret_cast<void**>(&out.mappedUpload[i])), "Map upload buffer failed");
+        }
+    }
+
+    // Hands the output's size-dependent surfaces back to the pool. The GPU must be idle
+    // and the output's capture paused.
+    void ReleaseOutputSurfaces(OutputContext& out) {
+        SurfaceKey textureKey = { out.width, out.height, SurfaceScreenTexture };
+        SurfaceKey uploadKey = { out.width, out.height, SurfaceUploadBuffer };
+        m_surfacePool.Release(textureKey, out.screenTexture);
+        m_surfacePool.Release(textureKey, out.rightEyeTexture);
+        out.screenTexture = nullptr;
+        out.rightEyeTexture = nullptr;
+        for (int i = 0; i < FRAME_SOURCE_SLOTS; i++) {
+            if (out.uploadBuffers[i]) out.uploadBuffers[i]->Unmap(0, NULL);
+            m_surfacePool.Release(uploadKey, out.uploadBuffers[i]);
+            out.uploadBuffers[i] = nullptr;
+            out.mappedUpload[i] = nullptr;
+        }
+        out.pendingSlot = -1;
+    }
+
+    void CreateScreenTextureView(OutputContext& out) {
+        CD3DX12_CPU_DESCRIPTOR_HANDLE srvHandle(out.srvHeap->GetCPUDescriptorHandleForHeapStart());
+        D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
+        srvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
+        srvDesc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+        srvDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2D;
+        srvDesc.Texture2D.MipLevels = static_cast<UINT>(-1);
+        m_device->CreateShaderResourceView(out.screenTexture, &srvDesc, srvHandle);
+        UINT increment = m_device->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+        srvHandle.Offset(1, increment);
+        m_device->CreateShaderResourceView(out.rightEyeTexture, &srvDesc, srvHandle);
+
+        // Per eye and level: the level above to read, the level to write
+        ID3D12Resource* eyeTextures[2] = { out.screenTexture, out.rightEyeTexture };
+        int levels = MipLevelCount(static_cast<int>(out.width), static_cast<int>(out.height));
+        for (int eye = 0; eye < 2; eye++) {
+            for (int level = 1; level < levels; level++) {
+                CD3DX12_CPU_DESCRIPTOR_HANDLE handle(out.srvHeap->GetCPUDescriptorHandleForHeapStart(), MipDescriptorIndex(eye, level), increment);
+                D3D12_SHADER_RESOURCE_VIEW_DESC levelSrv = srvDesc;
+                levelSrv.Texture2D.MostDetailedMip = level - 1;
+                levelSrv.Texture2D.MipLevels = 1;
+                m_device->CreateShaderResourceView(eyeTextures[eye], &levelSrv, handle);
+                D3D12_UNORDERED_ACCESS_VIEW_DESC uavDesc = {};
+                uavDesc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+                uavDesc.ViewDimension = D3D12_UAV_DIMENSION_TEXTURE2D;
+                uavDesc.Texture2D.MipSlice = level;
+                handle.Offset(1, increment);
+                m_device->CreateUnorderedAccessView(eyeTextures[eye], nullptr, &uavDesc, handle);
+            }
+        }
+    }
+
+    // Descriptors after the eye SRVs (0, 1) and the fog UAV (2): for each eye and mip
+    // level k >= 1, an SRV of level k - 1 followed by a UAV of level k
+    static UINT MipDescriptorIndex(int eye, int level) {
+        return 3 + 2 * (eye * (MAX_MIP_LEVELS - 1) + level - 1);
+    }
+
+    // Fills mip levels 1.. of both eye textures from level 0, one dispatch per level
+    // covering both eyes. The textures arrive in COPY_DEST, as the upload leaves them,
+    // and end in PIXEL_SHADER_RESOURCE.
+    void BuildEyeMips(OutputContext& out, ID3D12Resource* const* eyeTextures) {
+        const UINT groupSize = 8;   // MIP_GROUP_SIZE in MipCompute.hlsl
+        int levels = MipLevelCount(static_cast<int>(out.width), static_cast<int>(out.height));
+        UINT increment = m_device->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+        // On the stack: this runs for every uploaded frame, which must not touch the heap
+        CD3DX12_RESOURCE_BARRIER barriers[2 * MAX_MIP_LEVELS];
+        UINT barrierCount = 0;
+        for (int eye = 0; eye < 2; eye++) {
+            barriers[barrierCount++] = CD3DX12_RESOURCE_BARRIER::Transition(eyeTextures[eye], D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE, 0);
+            for (int level = 1; level < levels; level++) {
+                barriers[barrierCount++] = CD3DX12_RESOURCE_BARRIER::Transition(eyeTextures[eye], D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_UNORDERED_ACCESS, level);
+            }
+        }
+        m_commandList->ResourceBarrier(barrierCount, barriers);
+
+        ID3D12DescriptorHeap* heaps[] = { out.srvHeap };
+        m_commandList->SetDescriptorHeaps(1, heaps);
+        m_commandList->SetPipelineState(m_mipPso);
+        m_commandList->SetComputeRootSignature(m_mipRootSignature);
+        UINT width = out.width, height = out.height;
+        for (int level = 1; level < levels; level++) {
+            width = width > 1 ? width / 2 : 1;
+            height = height > 1 ? height / 2 : 1;
+            CD3DX12_RESOURCE_BARRIER written[2];
+            for (int eye = 0; eye < 2; eye++) {
+                CD3DX12_GPU_DESCRIPTOR_HANDLE views(out.srvHeap->GetGPUDescriptorHandleForHeapStart(), MipDescriptorIndex(eye, level), increment);
+                m_commandList->SetComputeRootDescriptorTable(0, views);
+                views.Offset(1, increment);
+                m_commandList->SetComputeRootDescriptorTable(1, views);
+                m_commandList->Dispatch((width + groupSize - 1) / groupSize, (height + groupSize - 1) / groupSize, 1);
+                written[eye] = CD3DX12_RESOURCE_BARRIER::Transition(eyeTextures[eye], D3D12_RESOURCE_STATE_UNORDERED_ACCESS, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE, level);
+            }
+            m_commandList->ResourceBarrier(2, written);
+        }
+
+        // Every level is NON_PIXEL_SHADER_RESOURCE now
+        CD3DX12_RESOURCE_BARRIER done[2];
+        for (int eye = 0; eye < 2; eye++) {
+            done[eye] = CD3DX12_RESOURCE_BARRIER::Transition(eyeTextures[eye], D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+        }
+        m_commandList->ResourceBarrier(2, done);
+    }
+
+    void ReleaseShaderBytecode() {
+        SAFE_RELEASE(m_fogShader);
+        SAFE_RELEASE(m_mipShader);
+        SAFE_RELEASE(m_vertexShader);
+        SAFE_RELEASE(m_pixelShader);
+    }
+
+    // Runs on a worker thread. D3DCompile is thread-safe, so the three shaders compile in parallel.
+    static HRESULT CompileShaderFile(const wchar_t* path, const char* name, const char* entry, const char* target, ID3DBlob** bytecode) {
+        auto begin = StartupProfiler::Now();
+        char buffer[256];
+        sprintf_s(buffer, "Loading %s...\n", name);
+        Log(buffer);
+        ID3DBlob* source = nullptr;
+        HRESULT hr = D3DReadFileToBlob(path, &source);
+        if (FAILED(hr)) {
+            sprintf_s(buffer, "Failed to load %s (HR: 0x%08X)\n", name, hr);
+            Log(buffer);
+            SAFE_RELEASE(source);
+            return hr;
+        }
+
+        ID3DBlob* error = nullptr;
+        hr = D3DCompile(source->GetBufferPointer(), source->GetBufferSize(), name, nullptr, nullptr, entry, target, 0, 0, bytecode, &error);
+        SAFE_RELEASE(source);
+        if (FAILED(hr)) {
+            sprintf_s(buffer, "%s compilation error: ", name);
+            Log(buffer);
+            if (error) Log(static_cast<const char*>(error->GetBufferPointer()));
+            SAFE_RELEASE(error);
+            return hr;
+        }
+        SAFE_RELEASE(error);
+        sprintf_s(buffer, "%s compiled successfully\n", name);
+        Log(buffer);
+        startupProfiler.Record(name, begin, true);
+        return S_OK;
+    }
+
     void WaitForGPU() {
         if (!m_commandQueue || !m_fence || !m_fenceEvent) return;
         HRESULT hr = m_commandQueue->Signal(m_fence, ++m_fenceValue);
@@ -1029,43 +2149,46 @@ private:
         }
     }
 
-    HWND m_hwnd;
     ID3D12Device* m_device;
     ID3D12CommandQueue* m_commandQueue;
-    IDXGISwapChain3* m_swapChain;
-    ID3D12DescriptorHeap* m_rtvHeap;
-    ID3D12DescriptorHeap* m_srvHeap;
     ID3D12DescriptorHeap* m_samplerHeap;
-    ID3D12Resource* m_renderTargets[FRAME_COUNT];
-    ID3D12CommandAllocator* m_commandAllocators[FRAME_COUNT];
     ID3D12GraphicsCommandList* m_commandList;
-    ID3D12Resource* m_screenTexture;
     ID3D12Resource* m_depthTexture;
-    ID3D12Resource* m_constantBuffers[FRAME_COUNT];
-    uint8_t* m_mappedConstantData[FRAME_COUNT];
     UINT64 m_constantBufferSize;
     ID3D12Resource* m_vertexBuffer;
-    IDXGIOutputDuplication* m_d3d11Duplication;
-    ID3D11Texture2D* m_d3d11StagingTexture;
-    ID3D12Resource* m_d3d12UploadBuffer;
     ID3D12RootSignature* m_rootSignature;
     ID3D12PipelineState* m_computePso;
     ID3D12PipelineState* m_graphicsPso;
     ID3D12Resource* m_disparityTexture; // added for compute output
     ID3D12RootSignature* m_computeRootSignature; // added compute root signature
+    ID3D12PipelineState* m_mipPso;                // eye texture mip chain, MipCompute.hlsl
+    ID3D12RootSignature* m_mipRootSignature;
     ID3D12Fence* m_fence;
     HANDLE m_fenceEvent;
-    UINT m_frameIndex;
     UINT64 m_fenceValue;
     UINT m_rtvDescriptorSize;
     D3D_FEATURE_LEVEL m_featureLevel;
     IDXGIAdapter1* m_adapter;
     IDXGIFactory6* m_factory;
-    ID3D11Device* m_d3d11Device;
-    ID3D11DeviceContext* m_d3d11Context;
+    ID3D12Device* m_probeDevice; // device created by SelectAdapter, adopted by CreateDeviceAndResources
+    D3D_FEATURE_LEVEL m_probeFeatureLevel;
+    int m_adapterFeatureRank;
+    ID3DBlob* m_fogShader;
+    ID3DBlob* m_mipShader;
+    ID3DBlob* m_vertexShader;
+    ID3DBlob* m_pixelShader;
+    std::future<HRESULT> m_fogShaderJob;
+    std::future<HRESULT> m_mipShaderJob;
+    std::future<HRESULT> m_vertexShaderJob;
+    std::future<HRESULT> m_pixelShaderJob;
     float m_time;
-    int m_recoveryCount;
     bool m_fallbackMode;
+    UINT64 m_timestampFrequency;   // ticks per second on m_commandQueue, 0 if unknown
+    EffectCostModel m_effectCosts;
+    DeviceRecoveryMachine m_recovery;
+    SurfacePool<ID3D12Resource*> m_surfacePool;      // size-dependent D3D12 surfaces from previous modes
+    std::vector<std::unique_ptr<OutputContext>> m_outputs;
+    OutputScheduler m_scheduler;
 };
 
 class LightWeight3DApp {
@@ -1084,6 +2207,8 @@ public:
     bool Initialize() {
         try {
             Log("Initializing LightWeight3DApp...\n");
+            startupProfiler.Reset();
+            auto phase = StartupProfiler::Now();
             WNDCLASSEX wc = {};
             wc.cbSize = sizeof(WNDCLASSEX);
             wc.style = CS_HREDRAW | CS_VREDRAW;
@@ -1093,29 +2218,53 @@ public:
             wc.lpszClassName = L"LightWeight3DClass";
             if (!RegisterClassEx(&wc)) throw ToolException("Window class registration failed");
 
-            HMONITOR hMonitor = MonitorFromWindow(GetDesktopWindow(), MONITOR_DEFAULTTOPRIMARY);
-            MONITORINFOEX monitorInfo = { sizeof(MONITORINFOEX) };
-            GetMonitorInfo(hMonitor, &monitorInfo);
-            SCREEN_WIDTH = monitorInfo.rcMonitor.right - monitorInfo.rcMonitor.left;
-            SCREEN_HEIGHT = monitorInfo.rcMonitor.bottom - monitorInfo.rcMonitor.top;
-
-            m_hwnd = CreateWindowEx(WS_EX_LAYERED | WS_EX_TRANSPARENT | WS_EX_TOPMOST, L"LightWeight3DClass",
-                L"LightWeight3D", WS_POPUP, monitorInfo.rcMonitor.left, monitorInfo.rcMonitor.top,
-                SCREEN_WIDTH, SCREEN_HEIGHT, NULL, NULL, GetModuleHandle(NULL), this);
-            if (!m_hwnd) throw ToolException("Window creation failed");
-            SetWindowLongPtr(m_hwnd, GWLP_USERDATA, reinterpret_cast<LONG_PTR>(this));
+            std::vector<MonitorTarget> monitors = EnumerateMonitors();
+            if (monitors.empty()) throw ToolException("No monitors found");
+            SCREEN_WIDTH = monitors[0].rect.right - monitors[0].rect.left;
+            SCREEN_HEIGHT = monitors[0].rect.bottom - monitors[0].rect.top;
+            startupProfiler.Record("Window class and monitor query", phase);
+
+            // Shader compilation and duplication setup overlap with everything below
+            m_d3dRenderer.BeginAsyncInitialization(monitors);
+
+            // One overlay window per monitor; the first (primary) one owns the tray icon and hotkeys
+            phase = StartupProfiler::Now();
+            for (const MonitorTarget& target : monitors) {
+                HWND hwnd = CreateWindowEx(WS_EX_LAYERED | WS_EX_TRANSPARENT | WS_EX_TOPMOST, L"LightWeight3DClass",
+                    L"LightWeight3D", WS_POPUP, target.rect.left, target.rect.top,
+                    target.rect.right - target.rect.left, target.rect.bottom - target.rect.top, NULL, NULL, GetModuleHandle(NULL), this);
+                if (!hwnd) {
+                    DestroyWindows();
+                    throw ToolException("Window creation failed");
+                }
+                SetWindowLongPtr(hwnd, GWLP_USERDATA, reinterpret_cast<LONG_PTR>(this));
+                m_windows.push_back(hwnd);
+            }
+            m_hwnd = m_windows[0];
+            startupProfiler.Record("CreateWindowEx", phase);
 
-            if (!m_d3dRenderer.Initialize(m_hwnd)) {
-                DestroyWindow(m_hwnd);
+            if (!m_d3dRenderer.Initialize(m_windows)) {
+                DestroyWindows();
                 throw ToolException("D3D12Renderer initialization failed");
             }
 
-            SetWindowPos(m_hwnd, HWND_TOPMOST, monitorInfo.rcMonitor.left, monitorInfo.rcMonitor.top, SCREEN_WIDTH, SCREEN_HEIGHT, SWP_SHOWWINDOW);
+            phase = StartupProfiler::Now();
+            for (size_t i = 0; i < m_windows.size(); ++i) {
+                const RECT& rect = monitors[i].rect;
+                SetWindowPos(m_windows[i], HWND_TOPMOST, rect.left, rect.top, rect.right - rect.left, rect.bottom - rect.top, SWP_SHOWWINDOW);
+                SetLayeredWindowAttributes(m_windows[i], 0, static_cast<BYTE>(config.alpha * 255), LWA_ALPHA);
+            }
             CreateTrayIcon();
-            SetLayeredWindowAttributes(m_hwnd, 0, static_cast<BYTE>(config.alpha * 255), LWA_ALPHA);
             SetClickThrough(m_isClickThrough);
-            ShowWindow(m_hwnd, SW_SHOW);
-            UpdateWindow(m_hwnd);
+            for (HWND hwnd : m_windows) {
+                ShowWindow(hwnd, SW_SHOW);
+                UpdateWindow(hwnd);
+            }
+            startupProfiler.Record("Show window and tray icon", phase);
+
+            char report[2048];
+            startupProfiler.Format(report, sizeof(report));
+            Log(report);
             Log("App initialized successfully\n");
             return true;
         }
@@ -1129,7 +2278,7 @@ public:
         Stop();
         RemoveTrayIcon();
         m_d3dRenderer.Cleanup();
-        if (m_hwnd) { DestroyWindow(m_hwnd); m_hwnd = NULL; }
+        DestroyWindows();
         Log("App cleanup completed\n");
     }
 
@@ -1165,7 +2314,7 @@ public:
 
     void ToggleVisibility() {
         m_isHidden = !m_isHidden;
-        ShowWindow(m_hwnd, m_isHidden ? SW_HIDE : SW_SHOW);
+        for (HWND hwnd : m_windows) ShowWindow(hwnd, m_isHidden ? SW_HIDE : SW_SHOW);
         Log(m_isHidden ? "Overlay hidden\n" : "Overlay shown\n");
     }
 
@@ -1174,10 +2323,18 @@ public:
         Log(enableLogging ? "Logging enabled\n" : "Logging disabled\n");
     }
 
+    // Counts reach the log with the pacing statistics, so they need logging on too
+    void ToggleAllocationTracking() {
+        EnableAllocationTracking(!AllocationTrackingEnabled());
+        Log(AllocationTrackingEnabled() ? "Allocation tracking enabled\n" : "Allocation tracking disabled\n");
+    }
+
     void SetClickThrough(bool enabled) {
-        LONG exStyle = GetWindowLong(m_hwnd, GWL_EXSTYLE);
-        exStyle = enabled ? (exStyle | WS_EX_TRANSPARENT) : (exStyle & ~WS_EX_TRANSPARENT);
-        SetWindowLong(m_hwnd, GWL_EXSTYLE, exStyle);
+        for (HWND hwnd : m_windows) {
+            LONG exStyle = GetWindowLong(hwnd, GWL_EXSTYLE);
+            exStyle = enabled ? (exStyle | WS_EX_TRANSPARENT) : (exStyle & ~WS_EX_TRANSPARENT);
+            SetWindowLong(hwnd, GWL_EXSTYLE, exStyle);
+        }
     }
 
     static LRESULT CALLBACK WindowProc(HWND hwnd, UINT message, WPARAM wParam, LPARAM lParam) {
@@ -1190,6 +2347,9 @@ public:
         case WM_USER + 1:
             if (app) return app->HandleTrayMessage(wParam, lParam);
             break;
+        case WM_DISPLAYCHANGE:
+            if (app) app->m_d3dRenderer.NotifyDisplayChange();
+            break;
         case WM_HOTKEY:
             if (app) {
                 switch (wParam) {
@@ -1213,7 +2373,15 @@ public:
             AppendMenu(menu, MF_STRING | (config.enable_parallax ? MF_CHECKED : MF_UNCHECKED), 3, L"Parallax Effect");
             AppendMenu(menu, MF_STRING | (config.enable_parallax_barrier ? MF_CHECKED : MF_UNCHECKED), 6, L"Parallax Barrier");
             AppendMenu(menu, MF_STRING | (config.enable_lenticular ? MF_CHECKED : MF_UNCHECKED), 7, L"Lenticular Sheet");
+            AppendMenu(menu, MF_STRING | (config.depth_layers ? MF_CHECKED : MF_UNCHECKED), 13, L"Layered Views (Faster)");
+            AppendMenu(menu, MF_STRING | (config.depth_update_interval ? MF_CHECKED : MF_UNCHECKED), 14, L"Temporal Depth");
+            AppendMenu(menu, MF_STRING | (config.depth_refine_radius ? MF_CHECKED : MF_UNCHECKED), 15, L"Smooth Depth");
+            AppendMenu(menu, MF_STRING | (config.enable_dof ? MF_CHECKED : MF_UNCHECKED), 16, L"Depth of Field");
+            AppendMenu(menu, MF_STRING | (config.enable_chromatic ? MF_CHECKED : MF_UNCHECKED), 17, L"Chromatic Separation");
+            AppendMenu(menu, MF_STRING | (config.adaptive_resolution ? MF_CHECKED : MF_UNCHECKED), 18, L"Adaptive Resolution");
+            AppendMenu(menu, MF_STRING | (config.shed_effects ? MF_CHECKED : MF_UNCHECKED), 19, L"Shed Effects Under Load");
             AppendMenu(menu, MF_STRING | (enableLogging ? MF_CHECKED : MF_UNCHECKED), 8, L"Logging");
+            AppendMenu(menu, MF_STRING | (AllocationTrackingEnabled() ? MF_CHECKED : MF_UNCHECKED), 20, L"Track Allocations");
             AppendMenu(menu, MF_SEPARATOR, 0, NULL);
 
             // Outline presets
@@ -1248,6 +2416,35 @@ public:
                 Log(config.enable_lenticular ? "Lenticular enabled\n" : "Lenticular disabled\n");
                 break;
             case 8: ToggleLogging(); break;
+            case 20: ToggleAllocationTracking(); break;
+            case 13:
+                config.depth_layers = config.depth_layers ? 0 : DEFAULT_DEPTH_LAYERS;
+                Log(config.depth_layers ? "Layered views enabled\n" : "Layered views disabled\n");
+                break;
+            case 14:
+                config.depth_update_interval = config.depth_update_interval ? 0 : DEFAULT_DEPTH_UPDATE_INTERVAL;
+                Log(config.depth_update_interval ? "Temporal depth enabled\n" : "Temporal depth disabled\n");
+                break;
+            case 15:
+                config.depth_refine_radius = config.depth_refine_radius ? 0 : DEFAULT_GUIDED_FILTER_RADIUS;
+                Log(config.depth_refine_radius ? "Depth smoothing enabled\n" : "Depth smoothing disabled\n");
+                break;
+            case 16:
+                config.enable_dof = !config.enable_dof;
+                Log(config.enable_dof ? "Depth of field enabled\n" : "Depth of field disabled\n");
+                break;
+            case 17:
+                config.enable_chromatic = !config.enable_chromatic;
+                Log(config.enable_chromatic ? "Chromatic separation enabled\n" : "Chromatic separation disabled\n");
+                break;
+            case 18:
+                config.adaptive_resolution = !config.adaptive_resolution;
+                Log(config.adaptive_resolution ? "Adaptive resolution enabled\n" : "Adaptive resolution disabled\n");
+                break;
+            case 19:
+                config.shed_effects = !config.shed_effects;
+                Log(config.shed_effects ? "Effect shedding enabled\n" : "Effect shedding disabled\n");
+                break;
             case 10: // Outline Off
                 config.outline_width = 0.0f;
                 config.outline_intensity = 0.0f;
@@ -1270,6 +2467,29 @@ public:
     }
 
 private:
+    static BOOL CALLBACK AddMonitor(HMONITOR monitor, HDC, LPRECT, LPARAM data) {
+        std::vector<MonitorTarget>* monitors = reinterpret_cast<std::vector<MonitorTarget>*>(data);
+        MONITORINFO info = { sizeof(MONITORINFO) };
+        if (!GetMonitorInfo(monitor, &info)) return TRUE;
+        MonitorTarget target = { monitor, info.rcMonitor };
+        if (info.dwFlags & MONITORINFOF_PRIMARY) monitors->insert(monitors->begin(), target);
+        else monitors->push_back(target);
+        return TRUE;
+    }
+
+    // All attached monitors, primary first
+    static std::vector<MonitorTarget> EnumerateMonitors() {
+        std::vector<MonitorTarget> monitors;
+        EnumDisplayMonitors(NULL, NULL, AddMonitor, reinterpret_cast<LPARAM>(&monitors));
+        return monitors;
+    }
+
+    void DestroyWindows() {
+        for (HWND hwnd : m_windows) DestroyWindow(hwnd);
+        m_windows.clear();
+        m_hwnd = NULL;
+    }
+
     void CreateTrayIcon() {
         NOTIFYICONDATA nid = {};
         nid.cbSize = sizeof(NOTIFYICONDATA);
@@ -1294,15 +2514,69 @@ private:
         UnregisterHotKey(m_hwnd, 2);
     }
 
+    // Busy share and steals of each thread in the CPU pixel passes since the last call
+    static void LogTaskScheduler() {
+        TaskScheduler& scheduler = TaskScheduler::Current();
+        std::vector<TaskParticipantStats> stats = scheduler.Stats();
+        std::string line = "Task pool:";
+        for (size_t i = 0; i < stats.size(); ++i) {
+            char entry[96];
+            sprintf_s(entry, " %s%zu %.0f%% %llu tasks %llu steals", stats[i].worker ? "worker" : "caller", i,
+                stats[i].utilisation * 100.0, stats[i].tasks, stats[i].steals);
+            line += entry;
+        }
+        line += "\n";
+        Log(line.c_str());
+        scheduler.ResetStats();
+    }
+
+    // Heap allocations made while rendering the frames since the last call, and each
+    // thread's total since tracking started. Once warm, Render should make none.
+    static void LogAllocations(AllocationWatch& watch) {
+        AllocationFrameStats stats = watch.Stats();
+        char buffer[256];
+        sprintf_s(buffer, "Heap: %llu of %llu frames allocated; render thread %llu allocations (%llu bytes), all threads %llu (%llu bytes), worst frame %llu\n",
+            stats.allocatingFrames, stats.frames, stats.thread.allocations, stats.thread.bytes, stats.all.allocations, stats.all.bytes,
+            stats.worst.allocations);
+        Log(buffer);
+        std::string line = "Heap by thread:";
+        for (int i = 0; i < AllocationThreadCount(); ++i) {
+            const char* name = nullptr;
+            AllocationCounts counts = AllocationThreadCounts(i, &name);
+            char entry[96];
+            sprintf_s(entry, " %s %llu (%llu bytes)", name ? name : "unnamed", counts.allocations, counts.bytes);
+            line += entry;
+        }
+        line += "\n";
+        Log(line.c_str());
+        watch.Reset();
+    }
+
+    // The overlay is composed by DWM, so its frames reach the screen on DWM's vblanks
+    static void PollVblank(FramePacer& pacer) {
+        DWM_TIMING_INFO timing = {};
+        timing.cbSize = sizeof(timing);
+        LARGE_INTEGER frequency;
+        if (FAILED(DwmGetCompositionTimingInfo(NULL, &timing)) || !QueryPerformanceFrequency(&frequency)) return;
+        pacer.OnVblank(QpcToSteadyMs(static_cast<LONGLONG>(timing.qpcVBlank)), timing.qpcRefreshPeriod * 1000.0 / frequency.QuadPart);
+    }
+
     void RenderLoop() {
+        NameAllocationThread("render");
+        FramePacer pacer(1000.0 / TARGET_FPS);
+        AllocationWatch allocations;
+        // 1 ms scheduler ticks keep the pacer's spin window short
+        timeBeginPeriod(1);
         while (m_isRunning) {
+            PollVblank(pacer);
+            // Wakes as late as the frame's predicted work allows, so Render takes the newest capture
+            pacer.WaitForFrame();
             auto frameStart = std::chrono::high_resolution_clock::now();
+            allocations.BeginFrame();
 
             try {
                 if (!m_isHidden) {
-                    if (!m_d3dRenderer.CaptureDesktop()) {
-                        Log("CaptureDesktop failed, using last frame\n");
-                    }
+                    // Desktop capture runs on the per-output capture threads
                     if (!m_d3dRenderer.Render()) {
                         Log("Render failed\n");
                         if (!m_d3dRenderer.RecoverDevice()) {
@@ -1324,26 +2598,36 @@ private:
                 }
             }
 
+            pacer.EndFrame();
+            allocations.EndFrame();
             auto frameEnd = std::chrono::high_resolution_clock::now();
             auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(frameEnd - frameStart);
-            auto targetFrameTime = std::chrono::microseconds(1000000 / TARGET_FPS);
-            if (elapsed < targetFrameTime) {
-                std::this_thread::sleep_for(targetFrameTime - elapsed);
-            }
 
             if (enableLogging) {
                 char buffer[64];
-                sprintf_s(buffer, "Frame %zu: %lld us\n", m_frameCount++, elapsed.count());
+                sprintf_s(buffer, "Frame %zu: %lld us\n", m_frameCount, elapsed.count());
                 Log(buffer);
+                if (m_frameCount % PACER_HISTORY == PACER_HISTORY - 1) {
+                    PacerStats stats = pacer.Stats();
+                    char statsBuffer[192];
+                    sprintf_s(statsBuffer, "Pacing: %.2f ms frames (jitter %.3f ms), wake error %.3f ms mean %.3f ms p99, %d missed, %s\n",
+                        stats.intervalMs, stats.intervalJitterMs, stats.meanErrorMs, stats.p99ErrorMs, stats.missed,
+                        pacer.VblankLocked() ? "on vblank" : "free running");
+                    Log(statsBuffer);
+                    pacer.ResetStats();
+                    m_d3dRenderer.LogFrameAccounting();
+                    LogTaskScheduler();
+                    if (AllocationTrackingEnabled()) LogAllocations(allocations);
+                }
             }
-            else {
-                m_frameCount++;
-            }
+            m_frameCount++;
         }
+        timeEndPeriod(1);
         Log("Render loop stopped\n");
     }
 
-    HWND m_hwnd;
+    HWND m_hwnd;                  // primary overlay window, owns the tray icon
+    std::vector<HWND> m_windows;  // one overlay window per monitor
     ULONG_PTR m_gdiplusToken;
     D3D12Renderer m_d3dRenderer;
     std::thread m_renderThread;
@@ -0,0 +1,27 @@
+// One mip level of an eye texture from the level above: 2x2 box mean, the GPU side of
+// MipPyramid.cpp. Dispatched once per level after upload, SourceMip viewing level k - 1
+// and DestinationMip level k. Mip sizes round down, so an odd last row or column of the
+// source is dropped unless the source is a single texel wide or high.
+
+#define MIP_GROUP_SIZE 8
+
+Texture2D<float4> SourceMip : register(t0);
+RWTexture2D<float4> DestinationMip : register(u0);
+
+[numthreads(MIP_GROUP_SIZE, MIP_GROUP_SIZE, 1)]
+void CSMain(uint3 dispatchThreadID : SV_DispatchThreadID)
+{
+    uint width, height;
+    DestinationMip.GetDimensions(width, height);
+    if (dispatchThreadID.x >= width || dispatchThreadID.y >= height)
+        return;
+
+    uint sourceWidth, sourceHeight;
+    SourceMip.GetDimensions(sourceWidth, sourceHeight);
+    int2 a = int2(dispatchThreadID.xy * 2);
+    int2 b = min(a + 1, int2(sourceWidth - 1, sourceHeight - 1));
+
+    float4 sum = SourceMip.Load(int3(a.x, a.y, 0)) + SourceMip.Load(int3(b.x, a.y, 0))
+               + SourceMip.Load(int3(a.x, b.y, 0)) + SourceMip.Load(int3(b.x, b.y, 0));
+    DestinationMip[dispatchThreadID.xy] = sum * 0.25f;
+}
@@ -0,0 +1,107 @@
+#include "MipPyramid.h"
+#include "ParallelFor.h"
+
+// Rows of level 0 per band. Levels 1 to MIP_BAND_LEVELS reduce rows of the band only,
+// so bands build them independently.
+static const int MIP_BAND_LEVELS = 5;
+static const int MIP_BAND_ROWS = 1 << MIP_BAND_LEVELS;
+
+// One row of the next level from rows a and b, 2x2 box mean, rounded. A source one pixel
+// wide repeats its column; otherwise an odd last column is dropped, as on the GPU.
+static void HalveRow(const uint32_t* a, const uint32_t* b, int srcWidth, uint32_t* out, int width) {
+    int x = 0;
+#ifdef CLEAN3D_SSE2
+    // 4 output pixels from 8 source pixels per row
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i two = _mm_set1_epi16(2);
+    for (; 2 * x + 8 <= srcWidth; x += 4) {
+        __m128i mean[2];
+        for (int half = 0; half < 2; ++half) {
+            __m128i ra = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + 2 * x + 4 * half));
+            __m128i rb = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + 2 * x + 4 * half));
+            // Vertical sums of pixels 0,1 and 2,3, then the two horizontal pairs side by side
+            __m128i s01 = _mm_add_epi16(_mm_unpacklo_epi8(ra, zero), _mm_unpacklo_epi8(rb, zero));
+            __m128i s23 = _mm_add_epi16(_mm_unpackhi_epi8(ra, zero), _mm_unpackhi_epi8(rb, zero));
+            __m128i sum = _mm_add_epi16(_mm_unpacklo_epi64(s01, s23), _mm_unpackhi_epi64(s01, s23));
+            mean[half] = _mm_srli_epi16(_mm_add_epi16(sum, two), 2);
+        }
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + x), _mm_packus_epi16(mean[0], mean[1]));
+    }
+#endif
+    for (; x < width; ++x) {
+        int x0 = 2 * x;
+        int x1 = x0 + 1 < srcWidth ? x0 + 1 : srcWidth - 1;
+        uint32_t pixel = 0;
+        for (int c = 0; c < 32; c += 8) {
+            uint32_t sum = ((a[x0] >> c) & 0xFF) + ((a[x1] >> c) & 0xFF) + ((b[x0] >> c) & 0xFF) + ((b[x1] >> c) & 0xFF);
+            pixel |= ((sum + 2) >> 2) << c;
+        }
+        out[x] = pixel;
+    }
+}
+
+MipPyramid::MipPyramid() : m_frame(), m_levelCount(0) {
+    for (int i = 0; i < MAX_MIP_LEVELS; ++i) m_levels[i] = ImagePlane<uint32_t>();
+}
+
+ImagePlane<const uint32_t> MipPyramid::Level(int level) const {
+    if (level <= 0 || m_levelCount <= 1) return m_frame;
+    const ImagePlane<uint32_t>& plane = m_levels[level < m_levelCount ? level : m_levelCount - 1];
+    ImagePlane<const uint32_t> view = { plane.data, plane.width, plane.height, plane.pitch };
+    return view;
+}
+
+void MipPyramid::Build(const ImagePlane<const uint32_t>& frame) {
+    m_frame = frame;
+    m_levelCount = frame.width > 0 && frame.height > 0 ? MipLevelCount(frame.width, frame.height) : 1;
+    if (m_levelCount == 1) return;
+
+    // Levels packed one after another, reallocated only when the frame size changes
+    size_t total = 0;
+    int width = frame.width, height = frame.height;
+    for (int level = 1; level < m_levelCount; ++level) {
+        width = width > 1 ? width / 2 : 1;
+        height = height > 1 ? height / 2 : 1;
+        m_levels[level].width = width;
+        m_levels[level].height = height;
+        m_levels[level].pitch = sizeof(uint32_t) * width;
+        total += static_cast<size_t>(width) * height;
+    }
+    if (m_pixels.size() != total) m_pixels.assign(total, 0u);
+    size_t offset = 0;
+    for (int level = 1; level < m_levelCount; ++level) {
+        m_levels[level].data = m_pixels.data() + offset;
+        offset += static_cast<size_t>(m_levels[level].width) * m_levels[level].height;
+    }
+
+    // Levels built inside the bands: their source has at least two rows, so no row is
+    // repeated and each pair of source rows lies in one band
+    int banded = 0;
+    while (banded < MIP_BAND_LEVELS && banded + 1 < m_levelCount &&
+        (banded == 0 ? frame.height : m_levels[banded].height) >= 2) banded++;
+
+    if (banded > 0) ParallelFor(0, (frame.height + MIP_BAND_ROWS - 1) / MIP_BAND_ROWS, [&](int firstBand, int lastBand) {
+        int firstRow = firstBand * (MIP_BAND_ROWS / 2);
+        int lastRow = lastBand * (MIP_BAND_ROWS / 2);
+        if (lastRow > m_levels[1].height) lastRow = m_levels[1].height;
+        for (int y = firstRow; y < lastRow; ++y) {
+            HalveRow(frame.Row(2 * y), frame.Row(2 * y + 1), frame.width, m_levels[1].Row(y), m_levels[1].width);
+            // Every odd row completes a pair for the level below
+            int row = y;
+            for (int level = 2; level <= banded && (row & 1); ++level) {
+                row >>= 1;
+                const ImagePlane<uint32_t>& src = m_levels[level - 1];
+                HalveRow(src.Row(2 * row), src.Row(2 * row + 1), src.width, m_levels[level].Row(row), m_levels[level].width);
+            }
+        }
+    });
+
+    for (int level = banded + 1; level < m_levelCount; ++level) {
+        ImagePlane<const uint32_t> src = Level(level - 1);
+        const ImagePlane<uint32_t>& dst = m_levels[level];
+        for (int y = 0; y < dst.height; ++y) {
+            int y1 = 2 * y + 1 < src.height ? 2 * y + 1 : src.height - 1;
+            HalveRow(src.Row(2 * y), src.Row(y1), src.width, dst.Row(y), dst.width);
+        }
+    }
+}
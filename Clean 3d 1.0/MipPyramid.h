@@ -0,0 +1,46 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include "CpuImage.h"
+
+// Mip chain of a captured frame, so blur-like stages can read the resolution they need
+// instead of the full frame. Level 0 is the frame itself; every further level is the 2x2
+// box mean of the one above, rounded. Sizes follow the Direct3D mip rules (halve, round
+// down, at least 1), so level k matches mip k of the eye textures, which MipCompute.hlsl
+// fills on the GPU.
+//
+// All levels come out of one pass over the frame. Each thread takes a band of rows and,
+// as soon as it has two rows of one level, reduces them into the next, so every row
+// below level 0 is read back while still cached. Levels smaller than a band are
+// finished on the calling thread.
+
+const int MAX_MIP_LEVELS = 16;
+
+// Levels in a full chain down to 1x1, level 0 included
+inline int MipLevelCount(int width, int height) {
+    int levels = 1;
+    while ((width > 1 || height > 1) && levels < MAX_MIP_LEVELS) {
+        width = width > 1 ? width / 2 : 1;
+        height = height > 1 ? height / 2 : 1;
+        levels++;
+    }
+    return levels;
+}
+
+class MipPyramid {
+public:
+    MipPyramid();
+
+    // Rebuilds the chain from 'frame', which becomes level 0 and is not copied: it must
+    // stay valid as long as Level(0) is used. Parallel across rows.
+    void Build(const ImagePlane<const uint32_t>& frame);
+
+    int LevelCount() const { return m_levelCount; }
+    ImagePlane<const uint32_t> Level(int level) const;
+
+private:
+    ImagePlane<const uint32_t> m_frame;
+    ImagePlane<uint32_t> m_levels[MAX_MIP_LEVELS];   // [0] unused
+    std::vector<uint32_t> m_pixels;
+    int m_levelCount;
+};
@@ -0,0 +1,138 @@
+#include "OutputScheduler.h"
+#include <chrono>
+#include "AllocationTracker.h"
+
+OutputScheduler::OutputScheduler(uint32_t captureTimeoutMs, uint32_t reopenRetryMs)
+    : m_captureTimeoutMs(captureTimeoutMs), m_reopenRetryMs(reopenRetryMs), m_running(false) {}
+
+OutputScheduler::~OutputScheduler() {
+    Stop();
+}
+
+int OutputScheduler::AddOutput(FrameSource* source) {
+    if (m_running || !source) return -1;
+    std::unique_ptr<Output> output(new Output());
+    output->source = source;
+    output->paused = false;
+    output->published = output->dropped = output->taken = 0;
+    output->timeouts = output->failures = output->lost = output->reopenFailures = 0;
+    m_outputs.push_back(std::move(output));
+    return static_cast<int>(m_outputs.size() - 1);
+}
+
+void OutputScheduler::Clear() {
+    Stop();
+    m_outputs.clear();
+}
+
+void OutputScheduler::Start() {
+    if (m_running) return;
+    m_running = true;
+    for (auto& output : m_outputs) {
+        output->mailbox.Reset();
+        output->thread = std::thread(&OutputScheduler::CaptureLoop, this, output.get());
+    }
+}
+
+void OutputScheduler::Stop() {
+    if (!m_running) return;
+    m_running = false;
+    for (auto& output : m_outputs) {
+        if (output->thread.joinable()) output->thread.join();
+    }
+}
+
+int OutputScheduler::TakeLatest(int output) {
+    if (output < 0 || output >= static_cast<int>(m_outputs.size())) return -1;
+    Output& o = *m_outputs[output];
+    if (o.paused) return -1;
+    int slot = o.mailbox.Take();
+    if (slot >= 0) o.taken++;
+    return slot;
+}
+
+void OutputScheduler::Pause(int output) {
+    if (output < 0 || output >= static_cast<int>(m_outputs.size())) return;
+    Output& o = *m_outputs[output];
+    o.paused = true;
+    // Wait out a capture that started before the flag was set
+    std::lock_guard<std::mutex> lock(o.captureMutex);
+}
+
+void OutputScheduler::Resume(int output) {
+    if (output < 0 || output >= static_cast<int>(m_outputs.size())) return;
+    Output& o = *m_outputs[output];
+    if (!o.paused) return;
+    o.mailbox.Reset();
+    o.paused = false;
+}
+
+void OutputScheduler::PauseAll() {
+    for (size_t i = 0; i < m_outputs.size(); ++i) Pause(static_cast<int>(i));
+}
+
+void OutputScheduler::ResumeAll() {
+    for (size_t i = 0; i < m_outputs.size(); ++i) Resume(static_cast<int>(i));
+}
+
+OutputStats OutputScheduler::Stats(int output) const {
+    OutputStats stats = {};
+    if (output < 0 || output >= static_cast<int>(m_outputs.size())) return stats;
+    const Output& o = *m_outputs[output];
+    stats.published = o.published;
+    stats.dropped = o.dropped;
+    stats.taken = o.taken;
+    stats.timeouts = o.timeouts;
+    stats.failures = o.failures;
+    stats.lost = o.lost;
+    stats.reopenFailures = o.reopenFailures;
+    return stats;
+}
+
+void OutputScheduler::CaptureLoop(Output* output) {
+    NameAllocationThread("capture");
+    while (m_running) {
+        if (output->paused) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            continue;
+        }
+
+        bool retryLater = false;
+        bool failed = false;
+        {
+            std::lock_guard<std::mutex> lock(output->captureMutex);
+            if (output->paused) continue;
+            switch (output->source->CaptureInto(output->mailbox.WriteSlot(), m_captureTimeoutMs)) {
+            case FrameReady:
+                output->published++;
+                if (output->mailbox.Publish()) output->dropped++;
+                break;
+            case FrameTimeout:
+                output->timeouts++;
+                break;
+            case FrameLost:
+                output->lost++;
+                if (!output->source->Reopen()) {
+                    output->reopenFailures++;
+                    retryLater = true;
+                }
+                break;
+            case FrameFailed:
+                output->failures++;
+                failed = true;
+                break;
+            }
+        }
+
+        if (failed) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        else if (retryLater) {
+            // Back off without holding the lock so Pause never waits on the sleep
+            auto until = std::chrono::steady_clock::now() + std::chrono::milliseconds(m_reopenRetryMs);
+            while (m_running && !output->paused && std::chrono::steady_clock::now() < until) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+        }
+    }
+}
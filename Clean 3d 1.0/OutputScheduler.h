@@ -0,0 +1,113 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "FrameSource.h"
+
+// Slot the reader owns after Reset. Nothing writes into it until the first Take, so
+// the consumer can stage a frame there (start-up pattern, warm restore).
+const int FRAME_MAILBOX_INITIAL_READ_SLOT = 2;
+
+// Latest-frame-wins triple buffer of slot indices. One writer (the capture thread)
+// and one reader (the render thread); neither side ever waits on the other.
+class FrameMailbox {
+public:
+    FrameMailbox() { Reset(); }
+
+    // Only while neither side is running.
+    void Reset() {
+        m_writeSlot = 0;
+        m_readSlot = FRAME_MAILBOX_INITIAL_READ_SLOT;
+        m_state.store(1);
+    }
+
+    int WriteSlot() const { return m_writeSlot; }
+    int ReadSlot() const { return m_readSlot; }
+
+    // Publishes the write slot. Returns true if an unread frame was overwritten.
+    bool Publish() {
+        uint32_t previous = m_state.exchange(static_cast<uint32_t>(m_writeSlot) | FRESH);
+        m_writeSlot = static_cast<int>(previous & SLOT_MASK);
+        return (previous & FRESH) != 0;
+    }
+
+    // Slot holding the newest published frame, or -1 if nothing new since the last take.
+    // The slot stays with the reader until the next successful Take.
+    int Take() {
+        if ((m_state.load() & FRESH) == 0) return -1;
+        uint32_t previous = m_state.exchange(static_cast<uint32_t>(m_readSlot));
+        m_readSlot = static_cast<int>(previous & SLOT_MASK);
+        return m_readSlot;
+    }
+
+private:
+    static const uint32_t SLOT_MASK = 3;
+    static const uint32_t FRESH = 4;
+
+    std::atomic<uint32_t> m_state;  // ready slot | FRESH
+    int m_writeSlot;
+    int m_readSlot;
+};
+
+struct OutputStats {
+    uint64_t published;
+    uint64_t dropped;    // published frames overwritten before the render thread took them
+    uint64_t taken;
+    uint64_t timeouts;
+    uint64_t failures;
+    uint64_t lost;
+    uint64_t reopenFailures;
+};
+
+// Runs one capture thread per output. Each thread pulls frames from its FrameSource
+// into the output's mailbox, so a slow or stalled output only delays itself. The
+// render thread picks up whatever is newest per output without blocking.
+class OutputScheduler {
+public:
+    explicit OutputScheduler(uint32_t captureTimeoutMs = 16, uint32_t reopenRetryMs = 250);
+    ~OutputScheduler();
+
+    // Outputs can only be added while stopped. Returns the output index.
+    int AddOutput(FrameSource* source);
+    void Clear();
+    size_t OutputCount() const { return m_outputs.size(); }
+
+    void Start();
+    void Stop();
+    bool IsRunning() const { return m_running; }
+
+    // Render thread: newest captured slot for the output, or -1 if nothing new.
+    int TakeLatest(int output);
+
+    // Stops capturing into the output and waits for an in-flight capture to finish,
+    // so its buffers can be reallocated. Resume resets the mailbox.
+    void Pause(int output);
+    void Resume(int output);
+    void PauseAll();
+    void ResumeAll();
+
+    OutputStats Stats(int output) const;
+
+private:
+    OutputScheduler(const OutputScheduler&);
+    OutputScheduler& operator=(const OutputScheduler&);
+
+    struct Output {
+        FrameSource* source;
+        FrameMailbox mailbox;
+        std::mutex captureMutex;   // held by the capture thread around CaptureInto
+        std::atomic<bool> paused;
+        std::atomic<uint64_t> published, dropped, taken, timeouts, failures, lost, reopenFailures;
+        std::thread thread;
+    };
+
+    void CaptureLoop(Output* output);
+
+    uint32_t m_captureTimeoutMs;
+    uint32_t m_reopenRetryMs;
+    std::atomic<bool> m_running;
+    std::vector<std::unique_ptr<Output>> m_outputs;
+};
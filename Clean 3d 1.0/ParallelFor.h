@@ -0,0 +1,44 @@
+#pragma once
+#include "TaskScheduler.h"
+
+// Calls fn(first, last) over contiguous pieces of [begin, end) on the TaskScheduler's
+// workers and the calling thread, returning once all have run. Used for row-parallel
+// image passes; pieces are contiguous so each walks its rows in memory order. The range
+// is cut into about TASK_SPLIT_FACTOR pieces per thread; maxThreads > 0 cuts it into
+// that many pieces at most, so no more threads can work on it at once.
+template <typename Fn>
+void ParallelFor(int begin, int end, Fn fn, unsigned maxThreads = 0) {
+    if (end <= begin) return;
+    TaskScheduler& scheduler = TaskScheduler::Current();
+    unsigned threads = scheduler.Concurrency();
+    unsigned pieces = threads * TASK_SPLIT_FACTOR;
+    if (maxThreads > 0 && pieces > maxThreads) pieces = maxThreads;
+    int count = end - begin;
+    if (pieces <= 1 || threads <= 1 || count == 1) {
+        fn(begin, end);
+        return;
+    }
+    // Pieces are halved until no longer than the grain, so there are a power of two of
+    // them: the largest power within 'pieces' sets the grain
+    unsigned parts = 1;
+    while (parts * 2 <= pieces) parts *= 2;
+    int grain = (count + static_cast<int>(parts) - 1) / static_cast<int>(parts);
+    scheduler.Run(begin, end, grain, [](void* context, int first, int last) { (*static_cast<Fn*>(context))(first, last); }, &fn);
+}
+
+// Tiles of tileWidth x tileHeight over a width x height plane, as fn(x0, y0, x1, y1) with
+// the far edges exclusive and clipped to the plane. Tiles are ordered row by row, so a
+// piece of the range is a band of tile rows, or part of one.
+template <typename Fn>
+void ParallelForTiles(int width, int height, int tileWidth, int tileHeight, Fn fn, unsigned maxThreads = 0) {
+    if (width <= 0 || height <= 0 || tileWidth <= 0 || tileHeight <= 0) return;
+    int tilesX = (width + tileWidth - 1) / tileWidth;
+    int tilesY = (height + tileHeight - 1) / tileHeight;
+    ParallelFor(0, tilesX * tilesY, [&](int first, int last) {
+        for (int tile = first; tile < last; ++tile) {
+            int x0 = (tile % tilesX) * tileWidth;
+            int y0 = (tile / tilesX) * tileHeight;
+            fn(x0, y0, x0 + tileWidth < width ? x0 + tileWidth : width, y0 + tileHeight < height ? y0 + tileHeight : height);
+        }
+    }, maxThreads);
+}
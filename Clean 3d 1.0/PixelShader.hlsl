@@ -4,6 +4,7 @@ Texture2D RightEyeTex : register(t1);
 Texture2D<float4> FogScatteringTex : register(t2);
 SamplerState Sampler : register(s0);
 
+// GpuConfig in Main.cpp, which pins these offsets; FogCompute.hlsl declares the same
 cbuffer IllusionConfig : register(b0)
 {
     float depth_intensity;
@@ -86,17 +87,17 @@ float3 GammaBlend(float3 src, float srcA, float3 dest)
 float EdgeSobel(float2 uv, float2 texel)
 {
     // Sample a 3x3 neighborhood (9 samples)
-    float3 c00 = LeftEyeTex.Sample(Sampler, uv + texel * float2(-1, -1)).rgb;
-    float3 c10 = LeftEyeTex.Sample(Sampler, uv + texel * float2(0, -1)).rgb;
-    float3 c20 = LeftEyeTex.Sample(Sampler, uv + texel * float2(1, -1)).rgb;
+    float3 c00 = LeftEyeTex.SampleLevel(Sampler, uv + texel * float2(-1, -1), 0).rgb;
+    float3 c10 = LeftEyeTex.SampleLevel(Sampler, uv + texel * float2(0, -1), 0).rgb;
+    float3 c20 = LeftEyeTex.SampleLevel(Sampler, uv + texel * float2(1, -1), 0).rgb;
 
-    float3 c01 = LeftEyeTex.Sample(Sampler, uv + texel * float2(-1, 0)).rgb;
-    float3 c11 = LeftEyeTex.Sample(Sampler, uv).rgb;
-    float3 c21 = LeftEyeTex.Sample(Sampler, uv + texel * float2(1, 0)).rgb;
+    float3 c01 = LeftEyeTex.SampleLevel(Sampler, uv + texel * float2(-1, 0), 0).rgb;
+    float3 c11 = LeftEyeTex.SampleLevel(Sampler, uv, 0).rgb;
+    float3 c21 = LeftEyeTex.SampleLevel(Sampler, uv + texel * float2(1, 0), 0).rgb;
 
-    float3 c02 = LeftEyeTex.Sample(Sampler, uv + texel * float2(-1, 1)).rgb;
-    float3 c12 = LeftEyeTex.Sample(Sampler, uv + texel * float2(0, 1)).rgb;
-    float3 c22 = LeftEyeTex.Sample(Sampler, uv + texel * float2(1, 1)).rgb;
+    float3 c02 = LeftEyeTex.SampleLevel(Sampler, uv + texel * float2(-1, 1), 0).rgb;
+    float3 c12 = LeftEyeTex.SampleLevel(Sampler, uv + texel * float2(0, 1), 0).rgb;
+    float3 c22 = LeftEyeTex.SampleLevel(Sampler, uv + texel * float2(1, 1), 0).rgb;
 
     float gx = -dot(c00, float3(0.299,0.587,0.114)) - 2.0*dot(c01, float3(0.299,0.587,0.114)) - dot(c02, float3(0.299,0.587,0.114))
                + dot(c20, float3(0.299,0.587,0.114)) + 2.0*dot(c21, float3(0.299,0.587,0.114)) + dot(c22, float3(0.299,0.587,0.114));
@@ -106,6 +107,46 @@ float EdgeSobel(float2 uv, float2 texel)
     return sqrt(gx*gx + gy*gy);
 }
 
+// Guide difference at which a fog texel's weight reaches the floor, as UPSAMPLE_RANGE
+// in ReducedResolution.h
+static const float FOG_UPSAMPLE_RANGE = 32.0f / 255.0f;
+
+// FogScatteringTex may be at half or quarter resolution. Not bound yet: Main.cpp keeps
+// enable_volumetric_fog at 0 here until the compute fog texture exists. Joint bilateral upsampling: the
+// four texels around uv are blended bilinearly, each weighted down as the screen
+// luminance at its centre moves away from this pixel's, so fog stops at edges.
+float4 SampleFogUpsampled(float2 uv)
+{
+    uint fogWidth, fogHeight;
+    FogScatteringTex.GetDimensions(fogWidth, fogHeight);
+    float2 size = float2(fogWidth, fogHeight);
+    float2 pos = uv * size - 0.5f;
+    float2 base = floor(pos);
+    float2 f = pos - base;
+    float guide = dot(LeftEyeTex.SampleLevel(Sampler, uv, 0).rgb, float3(0.299, 0.587, 0.114));
+    // Texel guides come from the eye texture's mip at the fog resolution: the mean of the
+    // screen under each texel, as DownsamplePlane gives the CPU path
+    uint screenWidth, screenHeight, screenLevels;
+    LeftEyeTex.GetDimensions(0, screenWidth, screenHeight, screenLevels);
+    float guideLevel = min(round(log2(screenWidth / size.x)), screenLevels - 1.0f);
+
+    float4 sum = 0.0f;
+    float total = 0.0f;
+    [unroll]
+    for (int i = 0; i < 4; i++)
+    {
+        int2 offset = int2(i & 1, i >> 1);
+        int2 texel = clamp(int2(base) + offset, int2(0, 0), int2(fogWidth - 1, fogHeight - 1));
+        float texelGuide = dot(LeftEyeTex.SampleLevel(Sampler, (texel + 0.5f) / size, guideLevel).rgb, float3(0.299, 0.587, 0.114));
+        float d = (guide - texelGuide) / FOG_UPSAMPLE_RANGE;
+        float2 bilinear = lerp(1.0f - f, f, float2(offset));
+        float w = (saturate(1.0f - d * d) + 1.0f / 64.0f) * bilinear.x * bilinear.y;
+        sum += w * FogScatteringTex.Load(int3(texel, 0));
+        total += w;
+    }
+    return sum / total;
+}
+
 // Overlay-only pixel shader. Enhanced parallax barrier effect for superior 3D depth.
 float4 PSMain(PSInput input) : SV_TARGET
 {
@@ -117,31 +158,39 @@ float4 PSMain(PSInput input) : SV_TARGET
     // Enhanced branchless selection with subpixel accuracy
     bool isLeft = ((bandIndex & 1) == 0); // true for left, false for right
 
-    // Sample left and right eye textures with enhanced filtering
-    float3 leftCol = LeftEyeTex.Sample(Sampler, uv).rgb;
-    float3 rightCol = RightEyeTex.Sample(Sampler, uv).rgb;
-
-    // Advanced color processing for better 3D perception
-    // Enhance contrast slightly for better depth perception
-    leftCol = pow(leftCol, 0.95f);
-    rightCol = pow(rightCol, 0.95f);
-    
-    // Choose color based on stripe parity
-    float3 outCol = isLeft ? leftCol : rightCol;
-
-    // Enhanced stripe blending with smooth transitions
-    float stripePhase = frac(px / w); // 0 to 1 within stripe
-    float edgeSoftness = 0.1f; // Soften stripe edges slightly
-    float stripeBlend = smoothstep(edgeSoftness, 1.0f - edgeSoftness, 
-                                  isLeft ? stripePhase : (1.0f - stripePhase));
-    
-    // Apply enhanced gamma correction for barrier opacity
-    float gamma = 2.2f;
-    float effective_opacity = pow(barrier_opacity, gamma);
-    
-    // Advanced stripe alpha calculation with smooth falloff
-    float baseAlpha = lerp(0.15f, 1.0f, effective_opacity);
-    float stripeAlpha = baseAlpha * stripeBlend;
+    // The lenticular capture path already wrote the subpixel-interleaved views into both
+    // eye textures: show it as is, with no barrier stripes over it
+    float3 outCol;
+    float stripeAlpha = 1.0f;
+    if (enable_lenticular != 0) {
+        outCol = pow(LeftEyeTex.SampleLevel(Sampler, uv, 0).rgb, 0.95f);
+    } else {
+        // Sample left and right eye textures with enhanced filtering
+        float3 leftCol = LeftEyeTex.SampleLevel(Sampler, uv, 0).rgb;
+        float3 rightCol = RightEyeTex.SampleLevel(Sampler, uv, 0).rgb;
+
+        // Advanced color processing for better 3D perception
+        // Enhance contrast slightly for better depth perception
+        leftCol = pow(leftCol, 0.95f);
+        rightCol = pow(rightCol, 0.95f);
+
+        // Choose color based on stripe parity
+        outCol = isLeft ? leftCol : rightCol;
+
+        // Enhanced stripe blending with smooth transitions
+        float stripePhase = frac(px / w); // 0 to 1 within stripe
+        float edgeSoftness = 0.1f; // Soften stripe edges slightly
+        float stripeBlend = smoothstep(edgeSoftness, 1.0f - edgeSoftness,
+                                      isLeft ? stripePhase : (1.0f - stripePhase));
+
+        // Apply enhanced gamma correction for barrier opacity
+        float gamma = 2.2f;
+        float effective_opacity = pow(barrier_opacity, gamma);
+
+        // Advanced stripe alpha calculation with smooth falloff
+        float baseAlpha = lerp(0.15f, 1.0f, effective_opacity);
+        stripeAlpha = baseAlpha * stripeBlend;
+    }
     
     // Enhanced depth-based color adjustment
     float depth = dot(outCol, float3(0.299f, 0.587f, 0.114f)); // Luminance
@@ -149,26 +198,30 @@ float4 PSMain(PSInput input) : SV_TARGET
     outCol *= depthBoost;
 
     // --- Iridescent outline based on Sobel edge detection and outline params ---
-    float2 texel = float2(1.0 / max(1.0, screen_width), 1.0 / max(1.0, screen_height));
-    // scale texel by outline_width (in pixels)
-    float2 scaledTexel = texel * max(1.0f, outline_width);
-
-    float edgeStrength = EdgeSobel(uv, scaledTexel);
-
-    // Map edgeStrength through edge_depth_influence and outline_intensity
-    float mask = saturate(edgeStrength * (edge_depth_influence * 0.01f) );
-    mask = smoothstep(0.02f, 0.8f, mask);
-    float hue = frac(time * 0.05 + sin((uv.x + uv.y) * 10.0 + time * wiggle_frequency) * 0.1);
-    float3 outlineColor = HSVtoRGB(hue, 0.85f, 0.9f);
-    float outlineAlpha = mask * outline_intensity;
-
-    // Composite outline using gamma-correct blend
-    float3 finalCol = GammaBlend(outlineColor, outlineAlpha * 0.6f, outCol);
+    // Skipped, taps and all, when off or shed under load (EffectGovernor.h)
+    float3 finalCol = outCol;
+    if (outline_intensity > 0.0f) {
+        float2 texel = float2(1.0 / max(1.0, screen_width), 1.0 / max(1.0, screen_height));
+        // scale texel by outline_width (in pixels)
+        float2 scaledTexel = texel * max(1.0f, outline_width);
+
+        float edgeStrength = EdgeSobel(uv, scaledTexel);
+
+        // Map edgeStrength through edge_depth_influence and outline_intensity
+        float mask = saturate(edgeStrength * (edge_depth_influence * 0.01f) );
+        mask = smoothstep(0.02f, 0.8f, mask);
+        float hue = frac(time * 0.05 + sin((uv.x + uv.y) * 10.0 + time * wiggle_frequency) * 0.1);
+        float3 outlineColor = HSVtoRGB(hue, 0.85f, 0.9f);
+        float outlineAlpha = mask * outline_intensity;
+
+        // Composite outline using gamma-correct blend
+        finalCol = GammaBlend(outlineColor, outlineAlpha * 0.6f, outCol);
+    }
 
     // --- Cheap luminance-based volumetric fog (screen-space proxy) ---
     if (enable_volumetric_fog != 0) {
-        // Sample precomputed FogScatteringTexture. It may be at a lower resolution, so sample using uv directly (sampler will handle it)
-        float4 fogSample = FogScatteringTex.Sample(Sampler, uv);
+        // Sample precomputed FogScatteringTexture, which may be at a lower resolution
+        float4 fogSample = SampleFogUpsampled(uv);
         float scatter = fogSample.w; // compute wrote scatter in alpha
         float3 fogColorFromTex = fogSample.rgb;
 
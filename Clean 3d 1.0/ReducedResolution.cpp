@@ -0,0 +1,213 @@
+#include "ReducedResolution.h"
+#include "FrameMemory.h"
+#include "ParallelFor.h"
+#include <cstring>
+
+// 2x2 box mean, rounded; the last row and column repeat when the size is odd
+static void HalvePlane(const ImagePlane<const uint8_t>& src, const ImagePlane<uint8_t>& dst) {
+    ParallelFor(0, dst.height, [&](int first, int last) {
+        for (int y = first; y < last; ++y) {
+            const uint8_t* a = src.Row(2 * y);
+            const uint8_t* b = src.Row(2 * y + 1 < src.height ? 2 * y + 1 : src.height - 1);
+            uint8_t* out = dst.Row(y);
+            int x = 0;
+#ifdef CLEAN3D_SSE2
+            const __m128i lowBytes = _mm_set1_epi16(0xFF);
+            const __m128i two = _mm_set1_epi16(2);
+            for (; 2 * x + 16 <= src.width; x += 8) {
+                __m128i ra = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + 2 * x));
+                __m128i rb = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + 2 * x));
+                // Horizontal pairs: even bytes plus odd bytes, per 16-bit lane
+                __m128i sa = _mm_add_epi16(_mm_and_si128(ra, lowBytes), _mm_srli_epi16(ra, 8));
+                __m128i sb = _mm_add_epi16(_mm_and_si128(rb, lowBytes), _mm_srli_epi16(rb, 8));
+                __m128i mean = _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(sa, sb), two), 2);
+                _mm_storel_epi64(reinterpret_cast<__m128i*>(out + x), _mm_packus_epi16(mean, mean));
+            }
+#endif
+            for (; x < dst.width; ++x) {
+                int x0 = 2 * x;
+                int x1 = x0 + 1 < src.width ? x0 + 1 : src.width - 1;
+                out[x] = static_cast<uint8_t>((a[x0] + a[x1] + b[x0] + b[x1] + 2) >> 2);
+            }
+        }
+    });
+}
+
+void DownsamplePlane(const ImagePlane<const uint8_t>& src, int factor, const ImagePlane<uint8_t>& dst) {
+    if (factor <= 1) {
+        for (int y = 0; y < src.height; ++y) memcpy(dst.Row(y), src.Row(y), src.width);
+        return;
+    }
+    if (factor == 2) {
+        HalvePlane(src, dst);
+        return;
+    }
+    // Quarter: two halvings, the intermediate rounding stays below half a level
+    int halfWidth = ReducedSize(src.width, 2), halfHeight = ReducedSize(src.height, 2);
+    FrameArena::Scope scope(FrameArena::ThreadArena());
+    uint8_t* half = FrameArena::ThreadArena().AllocateArray<uint8_t>(static_cast<size_t>(halfWidth) * halfHeight);
+    ImagePlane<uint8_t> halfPlane = { half, halfWidth, halfHeight, static_cast<size_t>(halfWidth) };
+    ImagePlane<const uint8_t> halfView = { half, halfWidth, halfHeight, static_cast<size_t>(halfWidth) };
+    HalvePlane(src, halfPlane);
+    HalvePlane(halfView, dst);
+}
+
+// Bilinear weights at factor 2 and 4 are odd multiples of 1 / (2 * factor). Along one
+// axis, output coordinate i lies between low samples LowTap(i) and LowTap(i) + 1, with
+// weight SecondWeight(i) / (2 * factor) on the second.
+static inline int LowTap(int i, int factor) {
+    int position = 2 * i + 1 - factor;
+    return position < 0 ? -1 : position / (2 * factor);
+}
+
+static inline int SecondWeight(int i, int factor) {
+    return ((2 * i + 1 - factor) % (2 * factor) + 2 * factor) % (2 * factor);
+}
+
+// Range weight in units of 1/512: 1 - (d / UPSAMPLE_RANGE)^2, plus a floor of 1/64 so that
+// where all four samples lie across an edge the result falls back to bilinear
+static_assert(UPSAMPLE_RANGE == 32, "RangeWeight scales UPSAMPLE_RANGE^2 to 512 with a shift");
+static const int UPSAMPLE_WEIGHT_FLOOR = 8;
+
+static inline int RangeWeight(int difference) {
+    int d = difference < 0 ? -difference : difference;
+    if (d > UPSAMPLE_RANGE) d = UPSAMPLE_RANGE;
+    return ((UPSAMPLE_RANGE * UPSAMPLE_RANGE - d * d) >> 1) + UPSAMPLE_WEIGHT_FLOOR;
+}
+
+// One low-resolution row of value and guide at output width, nearest neighbour, shifted by
+// half a block and padded: the left sample of output x is at [x], the right at [x + factor]
+struct ExpandedRow {
+    uint8_t* value;
+    uint8_t* guide;
+    int row;
+};
+
+static void ExpandRow(const uint8_t* low, const uint8_t* lowGuide, int width, int factor, ExpandedRow& expanded) {
+    int half = factor / 2;
+    int lowWidth = ReducedSize(width, factor);
+    uint8_t* value = expanded.value;
+    uint8_t* guide = expanded.guide;
+    for (int i = 0; i < half; ++i) {
+        value[i] = low[0];
+        guide[i] = lowGuide[0];
+    }
+    // Whole blocks; the last one may run past 'width' into the padding, which is what
+    // clamping to the last sample gives there as well
+    for (int j = 0; j < lowWidth; ++j) {
+        uint8_t* v = value + half + j * factor;
+        uint8_t* g = guide + half + j * factor;
+        for (int k = 0; k < factor; ++k) {
+            v[k] = low[j];
+            g[k] = lowGuide[j];
+        }
+    }
+    for (int i = half + lowWidth * factor; i < width + factor; ++i) {
+        value[i] = low[lowWidth - 1];
+        guide[i] = lowGuide[lowWidth - 1];
+    }
+}
+
+// rowWeight: weight of the bottom row in units of 1 / (2 * factor)
+static void UpsampleRow(const uint8_t* guide, const ExpandedRow& top, const ExpandedRow& bottom, int factor,
+    int rowWeight, int width, uint8_t* out) {
+    const uint8_t* values[4] = { top.value, top.value + factor, bottom.value, bottom.value + factor };
+    const uint8_t* guides[4] = { top.guide, top.guide + factor, bottom.guide, bottom.guide + factor };
+    int span = 2 * factor;
+    int rowWeights[2] = { span - rowWeight, rowWeight };
+    int x = 0;
+#ifdef CLEAN3D_SSE2
+    // 8 pixels per iteration. The column weights repeat every 'factor' pixels, so they are
+    // constant per lane. Spatial weight <= 49 times range weight <= 520 stays in int16 and
+    // the four weights sum to at most 64 * 520, within uint16.
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i limit = _mm_set1_epi16(UPSAMPLE_RANGE);
+    const __m128i range2 = _mm_set1_epi16(UPSAMPLE_RANGE * UPSAMPLE_RANGE);
+    const __m128i weightFloor = _mm_set1_epi16(UPSAMPLE_WEIGHT_FLOOR);
+    const __m128 half = _mm_set1_ps(0.5f);
+    __m128i spatial[4];
+    for (int tap = 0; tap < 4; ++tap) {
+        int16_t lanes[8];
+        for (int lane = 0; lane < 8; ++lane) {
+            int right = SecondWeight(lane, factor);
+            lanes[lane] = static_cast<int16_t>(rowWeights[tap >> 1] * ((tap & 1) ? right : span - right));
+        }
+        spatial[tap] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(lanes));
+    }
+    for (; x + 8 <= width; x += 8) {
+        __m128i g = _mm_unpacklo_epi8(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(guide + x)), zero);
+        __m128i w[4], v[4];
+        for (int tap = 0; tap < 4; ++tap) {
+            __m128i tapGuide = _mm_unpacklo_epi8(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(guides[tap] + x)), zero);
+            __m128i d = _mm_or_si128(_mm_subs_epu16(g, tapGuide), _mm_subs_epu16(tapGuide, g));
+            d = _mm_min_epi16(d, limit);
+            __m128i range = _mm_add_epi16(_mm_srli_epi16(_mm_sub_epi16(range2, _mm_mullo_epi16(d, d)), 1), weightFloor);
+            w[tap] = _mm_mullo_epi16(range, spatial[tap]);
+            v[tap] = _mm_unpacklo_epi8(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(values[tap] + x)), zero);
+        }
+        // Weighted sums in int32: madd pairs the weights and values of two taps
+        __m128i sumLo = _mm_add_epi32(_mm_madd_epi16(_mm_unpacklo_epi16(w[0], w[1]), _mm_unpacklo_epi16(v[0], v[1])),
+            _mm_madd_epi16(_mm_unpacklo_epi16(w[2], w[3]), _mm_unpacklo_epi16(v[2], v[3])));
+        __m128i sumHi = _mm_add_epi32(_mm_madd_epi16(_mm_unpackhi_epi16(w[0], w[1]), _mm_unpackhi_epi16(v[0], v[1])),
+            _mm_madd_epi16(_mm_unpackhi_epi16(w[2], w[3]), _mm_unpackhi_epi16(v[2], v[3])));
+        __m128i total = _mm_add_epi16(_mm_add_epi16(w[0], w[1]), _mm_add_epi16(w[2], w[3]));
+        __m128 lo = _mm_div_ps(_mm_cvtepi32_ps(sumLo), _mm_cvtepi32_ps(_mm_unpacklo_epi16(total, zero)));
+        __m128 hi = _mm_div_ps(_mm_cvtepi32_ps(sumHi), _mm_cvtepi32_ps(_mm_unpackhi_epi16(total, zero)));
+        __m128i packed = _mm_packs_epi32(_mm_cvttps_epi32(_mm_add_ps(lo, half)), _mm_cvttps_epi32(_mm_add_ps(hi, half)));
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(out + x), _mm_packus_epi16(packed, packed));
+    }
+#endif
+    for (; x < width; ++x) {
+        int right = SecondWeight(x, factor);
+        int columnWeights[2] = { span - right, right };
+        int sum = 0, total = 0;
+        for (int tap = 0; tap < 4; ++tap) {
+            int w = RangeWeight(guide[x] - guides[tap][x]) * rowWeights[tap >> 1] * columnWeights[tap & 1];
+            sum += w * values[tap][x];
+            total += w;
+        }
+        out[x] = static_cast<uint8_t>(static_cast<float>(sum) / total + 0.5f);
+    }
+}
+
+void JointBilateralUpsample(const ImagePlane<const uint8_t>& low, const ImagePlane<const uint8_t>& lowGuide,
+    const ImagePlane<const uint8_t>& guide, int factor, const ImagePlane<uint8_t>& output) {
+    int width = output.width, height = output.height;
+    if (width <= 0 || height <= 0) return;
+    factor = factor == 4 ? 4 : 2;
+
+    FrameArena& arena = FrameArena::ThreadArena();
+    FrameArena::Scope scope(arena);
+    ParallelFor(0, height, [&](int first, int last) {
+        // Output rows between the same two low rows share them, so each is expanded once
+        size_t stride = static_cast<size_t>(ReducedSize(width, factor)) * factor + factor;
+        uint8_t* scratch = arena.AllocateArray<uint8_t>(stride * 4);
+        ExpandedRow slots[2];
+        for (int s = 0; s < 2; ++s) {
+            slots[s].value = scratch + stride * 2 * s;
+            slots[s].guide = slots[s].value + stride;
+            slots[s].row = -1;
+        }
+        ExpandedRow* top = &slots[0];
+        ExpandedRow* bottom = &slots[1];
+        for (int y = first; y < last; ++y) {
+            int tap = LowTap(y, factor);
+            int topRow = tap < 0 ? 0 : (tap >= low.height ? low.height - 1 : tap);
+            int bottomRow = tap + 1 >= low.height ? low.height - 1 : tap + 1;
+            if (top->row != topRow && bottom->row == topRow) {
+                ExpandedRow* swap = top;
+                top = bottom;
+                bottom = swap;
+            }
+            if (top->row != topRow) {
+                ExpandRow(low.Row(topRow), lowGuide.Row(topRow), width, factor, *top);
+                top->row = topRow;
+            }
+            if (bottom->row != bottomRow) {
+                ExpandRow(low.Row(bottomRow), lowGuide.Row(bottomRow), width, factor, *bottom);
+                bottom->row = bottomRow;
+            }
+            UpsampleRow(guide.Row(y), *top, *bottom, factor, SecondWeight(y, factor), width, output.Row(y));
+        }
+    });
+}
@@ -0,0 +1,32 @@
+#pragma once
+#include <cstdint>
+#include "CpuImage.h"
+
+// Depth refinement and fog at half or quarter resolution. The low-resolution result is
+// brought back with a joint bilateral upsampler (Kopf et al.): every output pixel blends
+// the four nearest low-resolution samples with bilinear weights, each scaled down as the
+// sample's guide luminance moves away from the pixel's own. Results then stop at
+// luminance edges instead of bleeding a quarter or half block across them. The guide is
+// full-resolution luminance, which is the unrefined depth (see DepthEstimation.h).
+
+// Guide difference, in 8-bit luminance, at which a sample's weight reaches the floor
+const int UPSAMPLE_RANGE = 32;
+
+// Scale factor for a processing_quality level: 3 and up full, 2 half, 1 and below quarter
+inline int ProcessingScale(int quality) {
+    return quality >= 3 ? 1 : (quality == 2 ? 2 : 4);
+}
+
+// Size of one dimension after reduction by 'factor'
+inline int ReducedSize(int size, int factor) {
+    return (size + factor - 1) / factor;
+}
+
+// Box mean over factor x factor blocks, factor 1, 2 or 4. 'dst' is ReducedSize of 'src'
+// in both dimensions; blocks cut by the edge repeat the last row and column.
+void DownsamplePlane(const ImagePlane<const uint8_t>& src, int factor, const ImagePlane<uint8_t>& dst);
+
+// 'low' and 'lowGuide' are ReducedSize of 'output' and 'guide' by 'factor'; 'lowGuide'
+// is DownsamplePlane of 'guide'. Parallel across rows.
+void JointBilateralUpsample(const ImagePlane<const uint8_t>& low, const ImagePlane<const uint8_t>& lowGuide,
+    const ImagePlane<const uint8_t>& guide, int factor, const ImagePlane<uint8_t>& output);
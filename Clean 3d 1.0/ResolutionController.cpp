@@ -0,0 +1,194 @@
+#include "ResolutionController.h"
+#include <chrono>
+
+// Weight of a new sample in the stage averages: an exponential mean over about
+// RESOLUTION_SETTLE_FRAMES frames
+static const double RESOLUTION_SMOOTHING = 2.0 / (RESOLUTION_SETTLE_FRAMES + 1);
+// The short average: about 8 frames
+static const double RESOLUTION_RECENT_SMOOTHING = 2.0 / (8 + 1);
+// How far apart the two averages may be, as a share of the long one, for a steady frame
+static const double RESOLUTION_STEADY_SHARE = 0.2;
+
+double SteadyClockMs() {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static int ValidScale(int scale) {
+    return scale >= 4 ? 4 : (scale >= 2 ? 2 : 1);
+}
+
+// Cost at 'scale' relative to full resolution
+static double CostShape(double fixedShare, int scale) {
+    return fixedShare + (1.0 - fixedShare) / (static_cast<double>(scale) * scale);
+}
+
+ResolutionController::ResolutionController(ResolutionClock clock) : m_clock(clock), m_budgetMs(0.0), m_frameMs(0.0) {
+    for (Stage& stage : m_stages) {
+        stage.finest = 1;
+        stage.coarsest = RESOLUTION_MAX_SCALE;
+    }
+    Reset();
+}
+
+void ResolutionController::Reset() {
+    for (Stage& stage : m_stages) {
+        stage.scale = stage.finest;
+        stage.frameMs = 0.0;
+        stage.beginMs = 0.0;
+        stage.average = 0.0;
+        stage.samples = 0;
+        stage.recent = 0.0;
+        stage.steadySamples = 0;
+        stage.fixedShare = 0.0;
+        stage.fitted = false;
+        stage.beforeMs = 0.0;
+        stage.beforeScale = 0;
+    }
+    m_settle = RESOLUTION_SETTLE_FRAMES;
+    m_changes = 0;
+}
+
+void ResolutionController::SetStageLimits(ResolutionStage stage, int finest, int coarsest) {
+    Stage& s = m_stages[stage];
+    finest = ValidScale(finest);
+    coarsest = ValidScale(coarsest);
+    if (coarsest < finest) coarsest = finest;
+    if (s.finest == finest && s.coarsest == coarsest) return;
+    s.finest = finest;
+    s.coarsest = coarsest;
+    int scale = s.scale < finest ? finest : (s.scale > coarsest ? coarsest : s.scale);
+    if (scale != s.scale) {
+        // Not a decision of ours: nothing to fit from it
+        s.scale = scale;
+        s.samples = 0;
+        s.steadySamples = 0;
+        s.beforeScale = 0;
+    }
+}
+
+void ResolutionController::BeginStage(ResolutionStage stage) {
+    m_stages[stage].beginMs = m_clock();
+}
+
+void ResolutionController::EndStage(ResolutionStage stage) {
+    Stage& s = m_stages[stage];
+    s.frameMs += m_clock() - s.beginMs;
+}
+
+void ResolutionController::AddStageTime(ResolutionStage stage, double ms) {
+    m_stages[stage].frameMs += ms;
+}
+
+double ResolutionController::PredictedMs() const {
+    double total = 0.0;
+    for (const Stage& stage : m_stages) total += stage.average;
+    return total;
+}
+
+double ResolutionController::PredictMs(const Stage& stage, int scale) const {
+    return stage.average * CostShape(stage.fixedShare, scale) / CostShape(stage.fixedShare, stage.scale);
+}
+
+void ResolutionController::ChangeScale(Stage& stage, int scale) {
+    // An average still catching up with a new load would fit the load change, not the scale
+    stage.beforeMs = stage.average;
+    stage.beforeScale = stage.steadySamples >= RESOLUTION_SETTLE_FRAMES ? stage.scale : 0;
+    // Stands in for the new scale's average until its first sample
+    stage.average = PredictMs(stage, scale);
+    stage.scale = scale;
+    stage.samples = 0;
+    stage.steadySamples = 0;
+    m_changes++;
+}
+
+bool ResolutionController::EndFrame() {
+    m_frameMs = 0.0;
+    for (Stage& stage : m_stages) {
+        m_frameMs += stage.frameMs;
+        if (stage.samples == 0) {
+            stage.average = stage.frameMs;
+            stage.recent = stage.frameMs;
+        }
+        else {
+            stage.average += (stage.frameMs - stage.average) * RESOLUTION_SMOOTHING;
+            stage.recent += (stage.frameMs - stage.recent) * RESOLUTION_RECENT_SMOOTHING;
+        }
+        double apart = stage.recent > stage.average ? stage.recent - stage.average : stage.average - stage.recent;
+        stage.steadySamples = apart <= stage.average * RESOLUTION_STEADY_SHARE ? stage.steadySamples + 1 : 0;
+        stage.frameMs = 0.0;
+        stage.samples++;
+
+        // The new scale has settled at the load it started with: fit the fixed share to
+        // the costs on either side of the change. R = shape(b) / shape(a) solved for f.
+        if (stage.beforeScale && stage.samples == RESOLUTION_SETTLE_FRAMES) {
+            double ratio = stage.beforeMs > 0.0 ? stage.average / stage.beforeMs : 0.0;
+            // A finer scale that cost less, or a coarser one that cost more, is noise
+            bool plausible = stage.scale < stage.beforeScale ? ratio > 1.0 : ratio > 0.0 && ratio < 1.0;
+            if (plausible && stage.steadySamples >= RESOLUTION_SETTLE_FRAMES) {
+                double p = 1.0 / (static_cast<double>(stage.beforeScale) * stage.beforeScale);
+                double q = 1.0 / (static_cast<double>(stage.scale) * stage.scale);
+                double denominator = ratio * (1.0 - p) - (1.0 - q);
+                if (denominator > 1e-9 || denominator < -1e-9) {
+                    double share = (q - ratio * p) / denominator;
+                    stage.fixedShare = share < 0.0 ? 0.0 : (share > 1.0 ? 1.0 : share);
+                    stage.fitted = true;
+                }
+            }
+            stage.beforeScale = 0;
+        }
+    }
+
+    if (m_settle > 0) {
+        m_settle--;
+        return false;
+    }
+    // No budget set: hold
+    if (m_budgetMs <= 0.0) return false;
+
+    double total = PredictedMs();
+    Stage* pick = nullptr;
+    int pickScale = 0;
+    if (total > m_budgetMs) {
+        // Over: coarsen whichever stage saves the most. A stage that costs nothing is no
+        // help, but one the model says will not shrink is still tried, so a stale fit
+        // gets corrected.
+        double bestSaving = -1.0;
+        for (Stage& stage : m_stages) {
+            if (stage.scale >= stage.coarsest || stage.average <= 0.0) continue;
+            double saving = stage.average - PredictMs(stage, stage.scale * 2);
+            if (saving > bestSaving) {
+                bestSaving = saving;
+                pick = &stage;
+                pickScale = stage.scale * 2;
+            }
+        }
+    }
+    else {
+        // Under: refine the stage that adds the least, if the whole frame still leaves
+        // the hysteresis margin
+        double limit = m_budgetMs * RESOLUTION_UPGRADE_FRACTION;
+        double bestTotal = limit;
+        for (Stage& stage : m_stages) {
+            if (stage.scale <= stage.finest) continue;
+            double finer = total - stage.average + PredictMs(stage, stage.scale / 2);
+            if (finer <= limit && (!pick || finer < bestTotal)) {
+                bestTotal = finer;
+                pick = &stage;
+                pickScale = stage.scale / 2;
+            }
+        }
+        // None fits by the model: try a settled stage that has no fit yet, which gives it
+        // one. If the finer scale does not fit after all, the next decision steps back.
+        for (Stage& stage : m_stages) {
+            if (pick || total > limit) break;
+            if (stage.scale > stage.finest && !stage.fitted && stage.steadySamples >= RESOLUTION_SETTLE_FRAMES) {
+                pick = &stage;
+                pickScale = stage.scale / 2;
+            }
+        }
+    }
+    if (!pick) return false;
+    ChangeScale(*pick, pickScale);
+    m_settle = RESOLUTION_SETTLE_FRAMES;
+    return true;
+}
@@ -0,0 +1,103 @@
+#pragma once
+
+// Picks the internal resolution scale (1, 2 or 4, as ProcessingScale) of each stage so
+// that their summed cost holds a frame budget. Stage times are averaged over the last
+// frames; once the average overshoots the budget the stage whose coarser scale saves the
+// most steps down, and a stage only steps back up when the prediction for the finer
+// scale stays under RESOLUTION_UPGRADE_FRACTION of the budget. After every change the
+// controller waits for the new scale's average to settle before deciding again.
+//
+// A stage's cost is modelled as K * (f + (1 - f) / scale^2): f is the share that does not
+// shrink with the resolution. It starts at 0 and is re-fitted from the averages before
+// and after a change, so a stage whose cost does not follow its scale stops looking like
+// a saving. A fit needs both averages settled at a steady load, which a short average
+// agreeing with them for RESOLUTION_SETTLE_FRAMES frames shows; one that has the finer
+// scale cheaper is dropped. Until a stage has a fit its model overstates what a finer
+// scale costs, so a settled stage under the upgrade margin tries it anyway.
+//
+// Time comes only from the injected clock and from AddStageTime, so the decisions are a
+// pure function of the samples fed in.
+
+enum ResolutionStage {
+    ResolutionDepth,    // depth estimation and refinement (ViewSynthesizer::SetProcessingScale)
+    ResolutionFog,      // fog, timed by the caller; only Clean3dBench runs it
+    ResolutionViews     // depth of field and view synthesis
+};
+
+const int RESOLUTION_STAGE_COUNT = 3;
+
+const int RESOLUTION_MAX_SCALE = 4;
+
+// Frames after a change before the next one; also the span of the stage averages
+const int RESOLUTION_SETTLE_FRAMES = 30;
+
+// A finer scale is taken only if the prediction stays under this share of the budget
+const float RESOLUTION_UPGRADE_FRACTION = 0.8f;
+
+// Milliseconds on a monotonic clock
+typedef double (*ResolutionClock)();
+
+// std::chrono::steady_clock
+double SteadyClockMs();
+
+class ResolutionController {
+public:
+    explicit ResolutionController(ResolutionClock clock = SteadyClockMs);
+
+    // Back to each stage's finest scale, forgetting the averages and the fitted model
+    void Reset();
+
+    // What the stages together may take per frame. Scales hold until one is set.
+    void SetBudget(double budgetMs) { m_budgetMs = budgetMs; }
+    double Budget() const { return m_budgetMs; }
+
+    // Scales a stage may use, 1, 2 or 4; equal limits pin it. The current scale is
+    // clamped into the range.
+    void SetStageLimits(ResolutionStage stage, int finest, int coarsest);
+
+    // Stage timing against the clock. Several spans of one stage in a frame add up.
+    void BeginStage(ResolutionStage stage);
+    void EndStage(ResolutionStage stage);
+    // For a stage timed elsewhere, such as a GPU timestamp query
+    void AddStageTime(ResolutionStage stage, double ms);
+
+    // Closes the frame's stage times. Returns true if a stage's scale changed.
+    bool EndFrame();
+
+    int Scale(ResolutionStage stage) const { return m_stages[stage].scale; }
+    // Averaged cost of a stage at its current scale
+    double StageMs(ResolutionStage stage) const { return m_stages[stage].average; }
+    // Averaged cost of all stages
+    double PredictedMs() const;
+    // All stages of the last closed frame, unaveraged
+    double FrameMs() const { return m_frameMs; }
+    // Scale changes since Reset
+    int Changes() const { return m_changes; }
+
+private:
+    struct Stage {
+        int scale;
+        int finest;
+        int coarsest;
+        double frameMs;      // this frame so far
+        double beginMs;      // clock at BeginStage
+        double average;      // at the current scale
+        int samples;         // since the last change
+        double recent;       // a shorter average, against which 'average' is settled
+        int steadySamples;   // frames in a row that 'recent' agreed with 'average'
+        double fixedShare;   // f of the cost model
+        bool fitted;         // f has been fitted since Reset
+        double beforeMs;     // average at the scale before the last change
+        int beforeScale;     // 0 if the model has nothing to fit
+    };
+
+    double PredictMs(const Stage& stage, int scale) const;
+    void ChangeScale(Stage& stage, int scale);
+
+    ResolutionClock m_clock;
+    double m_budgetMs;
+    double m_frameMs;
+    Stage m_stages[RESOLUTION_STAGE_COUNT];
+    int m_settle;        // frames until the next decision
+    int m_changes;
+};
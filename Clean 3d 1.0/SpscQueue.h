@@ -0,0 +1,60 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+// Bounded lock-free queue for one producer thread and one consumer thread. Push and Pop
+// never block: they fail when the queue is full or empty, and the caller decides how to
+// wait. The two indices sit on their own cache lines so the sides do not share one.
+
+// Cache line size assumed for padding
+const size_t SPSC_CACHE_LINE = 64;
+
+template <typename T>
+class SpscQueue {
+public:
+    explicit SpscQueue(size_t capacity = 1) { Reset(capacity); }
+
+    // Empties the queue and sets how many items it holds. Only while neither side is running.
+    void Reset(size_t capacity) {
+        m_capacity = capacity > 0 ? capacity : 1;
+        size_t storage = 1;
+        while (storage < m_capacity) storage *= 2;
+        m_items.assign(storage, T());
+        m_mask = storage - 1;
+        m_head.store(0);
+        m_tail.store(0);
+    }
+
+    // Producer. Returns false if the queue holds Capacity() items.
+    bool Push(const T& item) {
+        size_t tail = m_tail.load(std::memory_order_relaxed);
+        if (tail - m_head.load(std::memory_order_acquire) >= m_capacity) return false;
+        m_items[tail & m_mask] = item;
+        m_tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer. Returns false if the queue is empty.
+    bool Pop(T* item) {
+        size_t head = m_head.load(std::memory_order_relaxed);
+        if (head == m_tail.load(std::memory_order_acquire)) return false;
+        *item = m_items[head & m_mask];
+        m_head.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Items queued; only a snapshot when the other side is running
+    size_t Size() const { return m_tail.load(std::memory_order_acquire) - m_head.load(std::memory_order_acquire); }
+    size_t Capacity() const { return m_capacity; }
+
+private:
+    SpscQueue(const SpscQueue&);
+    SpscQueue& operator=(const SpscQueue&);
+
+    alignas(SPSC_CACHE_LINE) std::atomic<size_t> m_head;   // next item to pop, written by the consumer
+    alignas(SPSC_CACHE_LINE) std::atomic<size_t> m_tail;   // next free place, written by the producer
+    alignas(SPSC_CACHE_LINE) std::vector<T> m_items;
+    size_t m_mask;
+    size_t m_capacity;
+};
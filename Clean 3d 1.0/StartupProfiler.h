@@ -0,0 +1,85 @@
+#pragma once
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <mutex>
+#include <vector>
+
+// Collects wall-clock timings for each start-up phase of the overlay.
+// Phases can be recorded from worker threads (shader compilation, duplication
+// setup) so they show up next to the main-thread phases they overlap with.
+class StartupProfiler {
+public:
+    typedef std::chrono::steady_clock Clock;
+
+    StartupProfiler() : m_origin(Clock::now()) {}
+
+    void Reset() {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_origin = Clock::now();
+        m_phases.clear();
+    }
+
+    static Clock::time_point Now() { return Clock::now(); }
+
+    // Record a phase that started at 'begin' and ends now.
+    void Record(const char* name, Clock::time_point begin, bool background = false) {
+        Record(name, begin, Clock::now(), background);
+    }
+
+    void Record(const char* name, Clock::time_point begin, Clock::time_point end, bool background) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        Phase phase = { name, begin, end, background };
+        m_phases.push_back(phase);
+    }
+
+    double ElapsedMs() const {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return ToMs(Clock::now() - m_origin);
+    }
+
+    // Writes a table of phases ordered by start time. Returns the number of characters written.
+    size_t Format(char* buffer, size_t size) const {
+        if (!buffer || size == 0) return 0;
+        std::lock_guard<std::mutex> lock(m_mutex);
+        std::vector<Phase> phases(m_phases);
+        std::sort(phases.begin(), phases.end(), [](const Phase& a, const Phase& b) { return a.begin < b.begin; });
+
+        double total = ToMs(Clock::now() - m_origin);
+        double serial = 0.0;
+        size_t used = 0;
+        Append(buffer, size, used, "Startup breakdown (wall %.2f ms):\n", total);
+        for (const Phase& phase : phases) {
+            double start = ToMs(phase.begin - m_origin);
+            double duration = ToMs(phase.end - phase.begin);
+            if (!phase.background) serial += duration;
+            Append(buffer, size, used, "  %-32s %9.2f ms  @ %9.2f ms%s\n", phase.name, duration, start,
+                phase.background ? "  [worker]" : "");
+        }
+        Append(buffer, size, used, "  main-thread phases %.2f ms, untracked %.2f ms\n", serial, std::max(0.0, total - serial));
+        return used;
+    }
+
+private:
+    struct Phase {
+        const char* name;
+        Clock::time_point begin;
+        Clock::time_point end;
+        bool background;
+    };
+
+    static double ToMs(Clock::duration d) {
+        return std::chrono::duration<double, std::milli>(d).count();
+    }
+
+    template <typename... Args>
+    static void Append(char* buffer, size_t size, size_t& used, const char* fmt, Args... args) {
+        if (used + 1 >= size) return;
+        int n = snprintf(buffer + used, size - used, fmt, args...);
+        if (n > 0) used = std::min(size - 1, used + static_cast<size_t>(n));
+    }
+
+    mutable std::mutex m_mutex;
+    Clock::time_point m_origin;
+    std::vector<Phase> m_phases;
+};
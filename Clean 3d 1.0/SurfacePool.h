@@ -0,0 +1,75 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Size-keyed pool for resolution-dependent surfaces (screen texture, upload buffer,
+// capture staging texture). A display mode change hands the current surfaces back
+// and takes ones of the new size, so flipping between two modes does not allocate.
+// Handles are opaque; the owner supplies the function used to free evicted entries.
+
+struct SurfaceKey {
+    uint32_t width;
+    uint32_t height;
+    uint32_t kind;    // owner-defined surface type
+};
+
+template <typename T>
+class SurfacePool {
+public:
+    typedef void (*ReleaseFn)(T);
+
+    SurfacePool(size_t capacity, ReleaseFn release) : m_capacity(capacity), m_release(release), m_hits(0), m_misses(0) {}
+    ~SurfacePool() { Clear(); }
+
+    // Removes and returns a pooled surface matching 'key', or T() if there is none.
+    // Newest entries are checked first.
+    T Acquire(const SurfaceKey& key) {
+        for (size_t i = m_entries.size(); i-- > 0;) {
+            const SurfaceKey& k = m_entries[i].key;
+            if (k.width == key.width && k.height == key.height && k.kind == key.kind) {
+                T surface = m_entries[i].surface;
+                m_entries.erase(m_entries.begin() + i);
+                m_hits++;
+                return surface;
+            }
+        }
+        m_misses++;
+        return T();
+    }
+
+    // Takes ownership of 'surface'. The oldest entries are freed once over capacity.
+    void Release(const SurfaceKey& key, T surface) {
+        if (!surface) return;
+        Entry entry = { key, surface };
+        m_entries.push_back(entry);
+        while (m_entries.size() > m_capacity) {
+            m_release(m_entries.front().surface);
+            m_entries.erase(m_entries.begin());
+        }
+    }
+
+    void Clear() {
+        for (Entry& entry : m_entries) m_release(entry.surface);
+        m_entries.clear();
+    }
+
+    size_t Size() const { return m_entries.size(); }
+    size_t Hits() const { return m_hits; }
+    size_t Misses() const { return m_misses; }
+
+private:
+    SurfacePool(const SurfacePool&);
+    SurfacePool& operator=(const SurfacePool&);
+
+    struct Entry {
+        SurfaceKey key;
+        T surface;
+    };
+
+    size_t m_capacity;
+    ReleaseFn m_release;
+    std::vector<Entry> m_entries;
+    size_t m_hits;
+    size_t m_misses;
+};
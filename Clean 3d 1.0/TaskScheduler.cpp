@@ -0,0 +1,270 @@
+#include "TaskScheduler.h"
+#include <chrono>
+#include "AllocationTracker.h"
+
+// Rounds of looking for work before a worker sleeps
+static const int TASK_IDLE_SPINS = 64;
+
+static thread_local TaskScheduler* currentScheduler = nullptr;
+// The scheduler this thread last took part in, and its participant there
+static thread_local const TaskScheduler* participantScheduler = nullptr;
+static thread_local int participantIndex = -1;
+
+// Every scheduler not yet destroyed, so an exiting thread never touches a dead one
+static std::mutex liveMutex;
+static TaskScheduler* liveSchedulers = nullptr;
+
+struct TaskScheduler::ThreadRelease {
+    ~ThreadRelease() {
+        std::thread::id id = std::this_thread::get_id();
+        std::lock_guard<std::mutex> lock(liveMutex);
+        for (TaskScheduler* scheduler = liveSchedulers; scheduler; scheduler = scheduler->m_nextLive) scheduler->Release(id);
+    }
+};
+
+static int64_t NowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+TaskScheduler::TaskScheduler(int workers) : m_participantCount(0), m_running(true), m_pending(0), m_sleeping(0),
+    m_statsSinceNs(NowNs()) {
+    if (workers < 0) {
+        int threads = static_cast<int>(std::thread::hardware_concurrency());
+        workers = threads > 1 ? threads - 1 : 0;
+    }
+    m_workerCount = static_cast<unsigned>(workers < TASK_MAX_PARTICIPANTS / 2 ? workers : TASK_MAX_PARTICIPANTS / 2);
+    for (Participant& participant : m_participants) {
+        participant.head = 0;
+        participant.count = 0;
+        participant.worker = false;
+        participant.active = false;
+        participant.taskCount = 0;
+        participant.steals = 0;
+        participant.busyNs = 0;
+    }
+    // Workers take the first slots, so they exist before any thread can steal from them
+    for (unsigned i = 0; i < m_workerCount; ++i) {
+        m_participants[i].worker = true;
+        m_participants[i].active = true;
+    }
+    m_participantCount = static_cast<int>(m_workerCount);
+    // Their thread ids are set here, not by the workers, so a caller's Participate never
+    // reads one being written
+    for (unsigned i = 0; i < m_workerCount; ++i) {
+        m_workers.push_back(std::thread(&TaskScheduler::WorkerLoop, this, static_cast<int>(i)));
+        m_participants[i].thread = m_workers.back().get_id();
+    }
+    std::lock_guard<std::mutex> lock(liveMutex);
+    m_nextLive = liveSchedulers;
+    liveSchedulers = this;
+}
+
+TaskScheduler::~TaskScheduler() {
+    {
+        std::lock_guard<std::mutex> lock(liveMutex);
+        TaskScheduler** link = &liveSchedulers;
+        while (*link != this) link = &(*link)->m_nextLive;
+        *link = m_nextLive;
+    }
+    {
+        std::lock_guard<std::mutex> lock(m_sleepMutex);
+        m_running = false;
+    }
+    m_wake.notify_all();
+    for (std::thread& worker : m_workers) worker.join();
+}
+
+TaskScheduler& TaskScheduler::Current() {
+    if (currentScheduler) return *currentScheduler;
+    static TaskScheduler processScheduler;
+    return processScheduler;
+}
+
+void TaskScheduler::SetCurrent(TaskScheduler* scheduler) {
+    currentScheduler = scheduler;
+}
+
+int TaskScheduler::Participate() {
+    std::thread::id id = std::this_thread::get_id();
+    // A scheduler at the address of a destroyed one has to be checked
+    if (participantScheduler == this && participantIndex < m_participantCount && m_participants[participantIndex].thread == id) {
+        return participantIndex;
+    }
+    std::lock_guard<std::mutex> lock(m_registerMutex);
+    int count = m_participantCount;
+    int index = -1;
+    int free = -1;
+    for (int i = static_cast<int>(m_workerCount); i < count && index < 0; ++i) {
+        if (m_participants[i].thread == id) index = i;
+        else if (free < 0 && !m_participants[i].active) free = i;
+    }
+    if (index < 0) {
+        if (free < 0 && count >= TASK_MAX_PARTICIPANTS) return -1;
+        // Registered before the slot is claimed, so the slot is freed however the thread ends
+        static thread_local ThreadRelease release;
+        (void)release;
+        index = free >= 0 ? free : count;
+        Participant& participant = m_participants[index];
+        participant.thread = id;
+        participant.taskCount = 0;
+        participant.steals = 0;
+        participant.busyNs = 0;
+        participant.active = true;
+        if (free < 0) m_participantCount = count + 1;
+    }
+    participantScheduler = this;
+    participantIndex = index;
+    return index;
+}
+
+void TaskScheduler::Release(std::thread::id thread) {
+    std::lock_guard<std::mutex> lock(m_registerMutex);
+    int count = m_participantCount;
+    for (int i = static_cast<int>(m_workerCount); i < count; ++i) {
+        Participant& participant = m_participants[i];
+        if (participant.thread != thread) continue;
+        // Pieces of another job it left in its deque stay for the others to steal
+        participant.thread = std::thread::id();
+        participant.active = false;
+    }
+}
+
+bool TaskScheduler::Push(int self, const Task& task) {
+    Participant& participant = m_participants[self];
+    {
+        std::lock_guard<std::mutex> lock(participant.mutex);
+        if (participant.count == TASK_DEQUE_CAPACITY) return false;
+        participant.tasks[(participant.head + participant.count) % TASK_DEQUE_CAPACITY] = task;
+        participant.count++;
+        m_pending++;
+    }
+    if (m_sleeping > 0) {
+        // A worker between finding no work and waiting holds the mutex: the notify cannot slip past it
+        { std::lock_guard<std::mutex> lock(m_sleepMutex); }
+        m_wake.notify_one();
+    }
+    return true;
+}
+
+bool TaskScheduler::PopNewest(int self, Task* task) {
+    Participant& participant = m_participants[self];
+    std::lock_guard<std::mutex> lock(participant.mutex);
+    if (participant.count == 0) return false;
+    participant.count--;
+    *task = participant.tasks[(participant.head + participant.count) % TASK_DEQUE_CAPACITY];
+    m_pending--;
+    return true;
+}
+
+bool TaskScheduler::StealOldest(int self, Task* task) {
+    int count = m_participantCount;
+    for (int offset = 1; offset < count; ++offset) {
+        Participant& victim = m_participants[(self + offset) % count];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (victim.count == 0) continue;
+        *task = victim.tasks[victim.head];
+        victim.head = (victim.head + 1) % TASK_DEQUE_CAPACITY;
+        victim.count--;
+        m_pending--;
+        m_participants[self].steals++;
+        return true;
+    }
+    return false;
+}
+
+bool TaskScheduler::FindTask(int self, Task* task) {
+    if (m_pending <= 0) return false;
+    return PopNewest(self, task) || StealOldest(self, task);
+}
+
+void TaskScheduler::Execute(int self, Task task) {
+    // Keep the lower half, offer the upper: thieves take the oldest and so the largest
+    while (task.last - task.first > task.job->grain) {
+        int middle = task.first + (task.last - task.first) / 2;
+        Task upper = { task.job, middle, task.last };
+        if (!Push(self, upper)) break;
+        task.last = middle;
+    }
+    Participant& participant = m_participants[self];
+    int64_t begin = NowNs();
+    task.job->fn(task.job->context, task.first, task.last);
+    participant.busyNs += static_cast<uint64_t>(NowNs() - begin);
+    participant.taskCount++;
+    // Last: the job may be gone as soon as its caller sees nothing remaining
+    task.job->remaining -= task.last - task.first;
+}
+
+void TaskScheduler::Run(int begin, int end, int grain, TaskRangeFn fn, void* context) {
+    if (end <= begin) return;
+    int self = Participate();
+    if (self < 0 || m_workerCount == 0) {
+        fn(context, begin, end);
+        return;
+    }
+    Job job;
+    job.fn = fn;
+    job.context = context;
+    job.grain = grain < 1 ? 1 : grain;
+    job.remaining = end - begin;
+    Task root = { &job, begin, end };
+    Execute(self, root);
+    // Help until every piece has run; what is found may belong to another job
+    Task task;
+    while (job.remaining > 0) {
+        if (FindTask(self, &task)) Execute(self, task);
+        else std::this_thread::yield();
+    }
+}
+
+void TaskScheduler::WorkerLoop(int self) {
+    currentScheduler = this;
+    participantScheduler = this;
+    participantIndex = self;
+    NameAllocationThread("task worker");
+    Task task;
+    int idle = 0;
+    while (m_running) {
+        if (FindTask(self, &task)) {
+            Execute(self, task);
+            idle = 0;
+            continue;
+        }
+        if (++idle < TASK_IDLE_SPINS) {
+            std::this_thread::yield();
+            continue;
+        }
+        std::unique_lock<std::mutex> lock(m_sleepMutex);
+        m_sleeping++;
+        m_wake.wait(lock, [this]() { return !m_running || m_pending > 0; });
+        m_sleeping--;
+        idle = 0;
+    }
+}
+
+std::vector<TaskParticipantStats> TaskScheduler::Stats() const {
+    double wallMs = (NowNs() - m_statsSinceNs) / 1e6;
+    std::vector<TaskParticipantStats> stats;
+    int count = m_participantCount;
+    for (int i = 0; i < count; ++i) {
+        const Participant& participant = m_participants[i];
+        if (!participant.active) continue;
+        TaskParticipantStats entry;
+        entry.worker = participant.worker;
+        entry.tasks = participant.taskCount;
+        entry.steals = participant.steals;
+        entry.busyMs = participant.busyNs / 1e6;
+        entry.utilisation = wallMs > 0.0 ? entry.busyMs / wallMs : 0.0;
+        stats.push_back(entry);
+    }
+    return stats;
+}
+
+void TaskScheduler::ResetStats() {
+    int count = m_participantCount;
+    for (int i = 0; i < count; ++i) {
+        m_participants[i].taskCount = 0;
+        m_participants[i].steals = 0;
+        m_participants[i].busyNs = 0;
+    }
+    m_statsSinceNs = NowNs();
+}
@@ -0,0 +1,119 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Work-stealing pool behind ParallelFor. Each participant, a worker or an outside thread
+// that has called Run, owns a deque of range tasks. Running a task halves its range
+// until it is no longer than the job's grain, pushing the upper halves onto the
+// participant's own deque; a participant takes its newest task first and steals the
+// oldest, largest, from the others when its own deque runs dry. The calling thread
+// works on its job until every piece is done, so a job makes progress even with every
+// worker busy on another output's frame.
+//
+// Tasks are ranges of a job that lives on the caller's stack: running one allocates
+// nothing. An outside thread keeps its participant until it exits, when the slot is
+// freed for the next thread to call Run.
+
+// Workers plus outside threads that have called Run and not yet exited
+const int TASK_MAX_PARTICIPANTS = 64;
+
+// Pending tasks a participant's deque holds; past it a task runs unsplit
+const int TASK_DEQUE_CAPACITY = 256;
+
+// ParallelFor cuts a range into about this many pieces per thread, so a thread that
+// finishes early has something to steal without splitting banded passes into slivers
+const int TASK_SPLIT_FACTOR = 2;
+
+typedef void (*TaskRangeFn)(void* context, int first, int last);
+
+struct TaskParticipantStats {
+    bool worker;           // false for an outside thread
+    uint64_t tasks;        // pieces run
+    uint64_t steals;       // pieces taken from another participant
+    double busyMs;         // running pieces
+    double utilisation;    // busyMs over the time since ResetStats
+};
+
+class TaskScheduler {
+public:
+    // 'workers' threads besides the callers; negative for one less than the hardware threads
+    explicit TaskScheduler(int workers = -1);
+    ~TaskScheduler();
+
+    // The pool ParallelFor uses on this thread: the one set by SetCurrent, the pool a
+    // worker belongs to, or the process-wide one
+    static TaskScheduler& Current();
+    // For this thread; null goes back to the process-wide pool
+    static void SetCurrent(TaskScheduler* scheduler);
+
+    // Threads that can run a job at once, the caller included
+    unsigned Concurrency() const { return m_workerCount + 1; }
+
+    // Calls fn over [begin, end) in contiguous pieces of at most 'grain' items, on this
+    // thread and the workers, and returns once all have run
+    void Run(int begin, int end, int grain, TaskRangeFn fn, void* context);
+
+    // The workers and the outside threads still registered
+    std::vector<TaskParticipantStats> Stats() const;
+    void ResetStats();
+
+private:
+    TaskScheduler(const TaskScheduler&);
+    TaskScheduler& operator=(const TaskScheduler&);
+
+    struct Job {
+        TaskRangeFn fn;
+        void* context;
+        int grain;
+        std::atomic<int> remaining;   // items not yet run
+    };
+
+    struct Task {
+        Job* job;
+        int first;
+        int last;
+    };
+
+    struct Participant {
+        std::mutex mutex;
+        Task tasks[TASK_DEQUE_CAPACITY];   // a ring: oldest at head, newest at head + count - 1
+        int head;
+        int count;
+        std::thread::id thread;            // none while the slot is free
+        bool worker;
+        std::atomic<bool> active;          // a worker, or an outside thread that has not exited
+        std::atomic<uint64_t> taskCount;
+        std::atomic<uint64_t> steals;
+        std::atomic<uint64_t> busyNs;
+    };
+
+    // Frees an exiting thread's participants in every live scheduler
+    struct ThreadRelease;
+
+    // This thread's participant, registering it on first use; -1 if there is no room
+    int Participate();
+    void Release(std::thread::id thread);
+    bool Push(int self, const Task& task);
+    bool PopNewest(int self, Task* task);
+    bool StealOldest(int self, Task* task);
+    bool FindTask(int self, Task* task);
+    void Execute(int self, Task task);
+    void WorkerLoop(int self);
+
+    unsigned m_workerCount;
+    Participant m_participants[TASK_MAX_PARTICIPANTS];
+    std::atomic<int> m_participantCount;
+    std::mutex m_registerMutex;
+    TaskScheduler* m_nextLive;     // the list ThreadRelease walks
+    std::vector<std::thread> m_workers;
+    std::atomic<bool> m_running;
+    std::atomic<int> m_pending;    // tasks in the deques
+    std::atomic<int> m_sleeping;
+    std::mutex m_sleepMutex;
+    std::condition_variable m_wake;
+    std::atomic<int64_t> m_statsSinceNs;
+};
@@ -0,0 +1,180 @@
+#include "TemporalDepth.h"
+#include "DepthEstimation.h"
+#include "FrameMemory.h"
+#include "ParallelFor.h"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+
+// Blends one row segment of fresh estimates into the history and returns the sum of
+// absolute differences between estimate and previous depth. In 8.8 fixed point,
+// h' = h * (256 - w) / 256 + estimate * w: both terms fit in 16 bits, and a history that
+// has converged on the estimate stays exactly on it.
+static int BlendRow(const uint8_t* estimate, int count, int weightQ8, uint16_t* history, uint8_t* depth) {
+    int drift = 0;
+    int x = 0;
+#ifdef CLEAN3D_SSE2
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i keep = _mm_set1_epi16(static_cast<short>((256 - weightQ8) << 8));
+    const __m128i weight = _mm_set1_epi16(static_cast<short>(weightQ8));
+    __m128i sad = zero;
+    for (; x + 16 <= count; x += 16) {
+        __m128i e = _mm_loadu_si128(reinterpret_cast<const __m128i*>(estimate + x));
+        __m128i d = _mm_loadu_si128(reinterpret_cast<const __m128i*>(depth + x));
+        sad = _mm_add_epi64(sad, _mm_sad_epu8(e, d));
+        __m128i* h = reinterpret_cast<__m128i*>(history + x);
+        __m128i lo = _mm_add_epi16(_mm_mulhi_epu16(_mm_loadu_si128(h), keep), _mm_mullo_epi16(_mm_unpacklo_epi8(e, zero), weight));
+        __m128i hi = _mm_add_epi16(_mm_mulhi_epu16(_mm_loadu_si128(h + 1), keep), _mm_mullo_epi16(_mm_unpackhi_epi8(e, zero), weight));
+        _mm_storeu_si128(h, lo);
+        _mm_storeu_si128(h + 1, hi);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(depth + x), _mm_packus_epi16(_mm_srli_epi16(lo, 8), _mm_srli_epi16(hi, 8)));
+    }
+    drift = _mm_cvtsi128_si32(sad) + _mm_cvtsi128_si32(_mm_srli_si128(sad, 8));
+#endif
+    for (; x < count; ++x) {
+        int diff = estimate[x] - depth[x];
+        drift += diff < 0 ? -diff : diff;
+        int blended = ((history[x] * (256 - weightQ8)) >> 8) + estimate[x] * weightQ8;
+        history[x] = static_cast<uint16_t>(blended);
+        depth[x] = static_cast<uint8_t>(blended >> 8);
+    }
+    return drift;
+}
+
+void TemporalDepth::Restart(const ImagePlane<const uint32_t>& frame) {
+    m_width = frame.width;
+    m_height = frame.height;
+    m_tilesX = (m_width + DEPTH_TILE_SIZE - 1) / DEPTH_TILE_SIZE;
+    m_tilesY = (m_height + DEPTH_TILE_SIZE - 1) / DEPTH_TILE_SIZE;
+    m_frame = 0;
+    m_rejectedTiles = m_tilesX * m_tilesY;
+    size_t pixels = static_cast<size_t>(m_width) * m_height;
+    m_depth.resize(pixels);
+    m_history.resize(pixels);
+    m_pending.assign(static_cast<size_t>(m_tilesX) * m_tilesY, 0);
+    ImagePlane<uint8_t> depth = { m_depth.data(), m_width, m_height, static_cast<size_t>(m_width) };
+    EstimateDepth(frame, depth);
+    for (size_t i = 0; i < pixels; ++i) m_history[i] = static_cast<uint16_t>(m_depth[i] << 8);
+}
+
+void TemporalDepth::ApplyMove(const DepthMove& move) {
+    // Clip the destination, and the source with it, to the frame
+    int dx = move.sourceX - move.destination.left;
+    int dy = move.sourceY - move.destination.top;
+    int left = move.destination.left, top = move.destination.top;
+    int right = move.destination.right, bottom = move.destination.bottom;
+    if (left < 0) left = 0;
+    if (top < 0) top = 0;
+    if (left + dx < 0) left = -dx;
+    if (top + dy < 0) top = -dy;
+    if (right > m_width) right = m_width;
+    if (bottom > m_height) bottom = m_height;
+    if (right + dx > m_width) right = m_width - dx;
+    if (bottom + dy > m_height) bottom = m_height - dy;
+    if (left >= right || top >= bottom) return;
+
+    // Rows in the order that does not overwrite source rows still to be copied
+    int count = right - left;
+    int first = dy < 0 ? bottom - 1 : top;
+    int step = dy < 0 ? -1 : 1;
+    for (int i = 0; i < bottom - top; ++i) {
+        int y = first + i * step;
+        size_t to = static_cast<size_t>(y) * m_width + left;
+        size_t from = static_cast<size_t>(y + dy) * m_width + left + dx;
+        memmove(&m_history[to], &m_history[from], sizeof(uint16_t) * count);
+        memmove(&m_depth[to], &m_depth[from], count);
+    }
+}
+
+void TemporalDepth::MarkPending(const FrameChanges* changes, int interval) {
+    // A dirty tile stays pending until every one of its rows has been sampled once
+    uint8_t frames = static_cast<uint8_t>(interval > 255 ? 255 : interval);
+    if (!changes || !changes->dirtyKnown) {
+        std::fill(m_pending.begin(), m_pending.end(), frames);
+        return;
+    }
+    for (const DepthRect& rect : changes->dirty) {
+        int tx0 = rect.left < 0 ? 0 : rect.left / DEPTH_TILE_SIZE;
+        int ty0 = rect.top < 0 ? 0 : rect.top / DEPTH_TILE_SIZE;
+        int tx1 = (rect.right + DEPTH_TILE_SIZE - 1) / DEPTH_TILE_SIZE;
+        int ty1 = (rect.bottom + DEPTH_TILE_SIZE - 1) / DEPTH_TILE_SIZE;
+        if (tx1 > m_tilesX) tx1 = m_tilesX;
+        if (ty1 > m_tilesY) ty1 = m_tilesY;
+        for (int ty = ty0; ty < ty1; ++ty) {
+            for (int tx = tx0; tx < tx1; ++tx) m_pending[static_cast<size_t>(ty) * m_tilesX + tx] = frames;
+        }
+    }
+}
+
+void TemporalDepth::Update(const ImagePlane<const uint32_t>& frame, const TemporalDepthParams& params, const FrameChanges* changes) {
+    if (frame.width != m_width || frame.height != m_height) {
+        Restart(frame);
+        return;
+    }
+    if (changes) {
+        for (const DepthMove& move : changes->moves) ApplyMove(move);
+    }
+    int interval = params.updateInterval < 1 ? 1 : params.updateInterval;
+    MarkPending(changes, interval);
+
+    int phase = static_cast<int>(m_frame++ % static_cast<unsigned>(interval));
+    int weightQ8 = static_cast<int>(std::lround(256.0f * (1.0f - params.historyWeight)));
+    weightQ8 = weightQ8 < 1 ? 1 : (weightQ8 > 256 ? 256 : weightQ8);
+    std::atomic<int> rejected(0);
+
+    FrameArena& arena = FrameArena::ThreadArena();
+    FrameArena::Scope scope(arena);
+    ParallelFor(0, m_tilesY, [&](int firstTile, int lastTile) {
+        uint8_t* estimate = arena.AllocateArray<uint8_t>(m_width);
+        uint8_t* drifted = arena.AllocateArray<uint8_t>(m_tilesX);
+        for (int ty = firstTile; ty < lastTile; ++ty) {
+            uint8_t* pending = &m_pending[static_cast<size_t>(ty) * m_tilesX];
+            int y0 = ty * DEPTH_TILE_SIZE;
+            int y1 = y0 + DEPTH_TILE_SIZE > m_height ? m_height : y0 + DEPTH_TILE_SIZE;
+            memset(drifted, 0, m_tilesX);
+
+            // Sampled rows: blend into the history and measure the drift of each tile's
+            // row segment, so that a change covering a few rows is not averaged away
+            for (int y = y0; y < y1; ++y) {
+                if (y % interval != phase) continue;
+                uint16_t* history = &m_history[static_cast<size_t>(y) * m_width];
+                uint8_t* depth = &m_depth[static_cast<size_t>(y) * m_width];
+                for (int tx = 0; tx < m_tilesX; ++tx) {
+                    if (!pending[tx]) continue;
+                    // Runs of neighbouring pending tiles go through EstimateDepthRow at once
+                    int runEnd = tx + 1;
+                    while (runEnd < m_tilesX && pending[runEnd]) ++runEnd;
+                    int runStart = tx * DEPTH_TILE_SIZE;
+                    int runStop = runEnd * DEPTH_TILE_SIZE > m_width ? m_width : runEnd * DEPTH_TILE_SIZE;
+                    EstimateDepthRow(frame.Row(y) + runStart, runStop - runStart, &estimate[runStart]);
+                    for (; tx < runEnd; ++tx) {
+                        int x0 = tx * DEPTH_TILE_SIZE;
+                        int x1 = x0 + DEPTH_TILE_SIZE > m_width ? m_width : x0 + DEPTH_TILE_SIZE;
+                        int drift = BlendRow(&estimate[x0], x1 - x0, weightQ8, history + x0, depth + x0);
+                        if (drift > params.changeThreshold * (x1 - x0)) drifted[tx] = 1;
+                    }
+                    tx = runEnd - 1;
+                }
+            }
+
+            // Drifted tiles hold new content: drop their history and estimate them in full
+            for (int tx = 0; tx < m_tilesX; ++tx) {
+                if (!pending[tx]) continue;
+                --pending[tx];
+                if (!drifted[tx]) continue;
+                pending[tx] = 0;
+                int x0 = tx * DEPTH_TILE_SIZE;
+                int x1 = x0 + DEPTH_TILE_SIZE > m_width ? m_width : x0 + DEPTH_TILE_SIZE;
+                for (int y = y0; y < y1; ++y) {
+                    uint8_t* depth = &m_depth[static_cast<size_t>(y) * m_width];
+                    uint16_t* history = &m_history[static_cast<size_t>(y) * m_width];
+                    EstimateDepthRow(frame.Row(y) + x0, x1 - x0, depth + x0);
+                    for (int x = x0; x < x1; ++x) history[x] = static_cast<uint16_t>(depth[x] << 8);
+                }
+                ++rejected;
+            }
+        }
+    });
+    m_rejectedTiles = rejected;
+}
@@ -0,0 +1,84 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include "CpuImage.h"
+
+// Depth accumulated over frames instead of estimated from scratch every frame (see
+// DepthEstimation.h). The history keeps 8 fractional bits so slow exponential blends
+// still converge. Each frame only every updateInterval-th row is re-estimated; those
+// rows are blended into the history and measure how far each tile has drifted from it.
+// Tiles that drifted past the threshold are treated as new content: their history is
+// dropped and they are estimated in full. Luminance flicker on unchanged content is
+// smoothed away, and the per-frame cost falls with the interval. When the capture
+// reports dirty rects, only tiles dirtied within the last interval frames are sampled.
+
+// Tile size for change detection, in pixels
+const int DEPTH_TILE_SIZE = 32;
+
+// Mean depth difference per pixel that counts as new content rather than flicker
+const int DEPTH_CHANGE_THRESHOLD = 12;
+
+// Interval the tray menu switches to; see Clean3dBench for the cost at other rates
+const int DEFAULT_DEPTH_UPDATE_INTERVAL = 4;
+
+struct DepthRect {
+    int left, top, right, bottom;   // right and bottom exclusive
+};
+
+// Content that moved (a scrolled window, a dragged one): 'destination' now shows what
+// was at (sourceX, sourceY). The history moves with it.
+struct DepthMove {
+    DepthRect destination;
+    int sourceX, sourceY;
+};
+
+// What changed between the previous frame and the next, as the capture reports it
+struct FrameChanges {
+    std::vector<DepthMove> moves;   // applied before 'dirty'
+    std::vector<DepthRect> dirty;
+    bool dirtyKnown;                // false: any tile may have changed
+
+    FrameChanges() : dirtyKnown(false) {}
+};
+
+struct TemporalDepthParams {
+    int updateInterval;     // rows re-estimated per frame = 1 / updateInterval
+    float historyWeight;    // weight of the history in each blend, 0 = no smoothing (temporal_blend)
+    int changeThreshold;    // mean absolute depth difference per pixel that rejects a tile's history
+};
+
+class TemporalDepth {
+public:
+    TemporalDepth() : m_width(0), m_height(0), m_tilesX(0), m_tilesY(0), m_frame(0), m_rejectedTiles(0) {}
+
+    // Next frame. 'changes' may be null; with changes.dirtyKnown only tiles touching a
+    // recent dirty rect are looked at. The first frame, and the first after Reset or a size
+    // change, is estimated in full.
+    void Update(const ImagePlane<const uint32_t>& frame, const TemporalDepthParams& params, const FrameChanges* changes);
+
+    // Drops the history, e.g. after frames went by without Update
+    void Reset() { m_width = 0; m_height = 0; }
+
+    ImagePlane<const uint8_t> Depth() const {
+        ImagePlane<const uint8_t> plane = { m_depth.data(), m_width, m_height, static_cast<size_t>(m_width) };
+        return plane;
+    }
+
+    // Tiles rejected by the last Update, for diagnostics
+    int RejectedTiles() const { return m_rejectedTiles; }
+
+private:
+    void Restart(const ImagePlane<const uint32_t>& frame);
+    void ApplyMove(const DepthMove& move);
+    void MarkPending(const FrameChanges* changes, int interval);
+
+    std::vector<uint16_t> m_history;   // depth in 8.8 fixed point
+    std::vector<uint8_t> m_depth;      // m_history rounded down, for view synthesis
+    std::vector<uint8_t> m_pending;    // per tile: frames left until all its rows were sampled
+    int m_width;
+    int m_height;
+    int m_tilesX;
+    int m_tilesY;
+    unsigned m_frame;
+    int m_rejectedTiles;
+};
@@ -0,0 +1,303 @@
+#include "ViewSynthesis.h"
+#include "DepthEstimation.h"
+#include "FrameMemory.h"
+#include "GuidedFilter.h"
+#include "LayeredViews.h"
+#include "LenticularInterleaver.h"
+#include "ParallelFor.h"
+#include "ReducedResolution.h"
+#include "ResolutionController.h"
+#include <cmath>
+#include <cstring>
+
+int DisparityScaleQ8(const ViewSynthesisParams& params) {
+    float disparity = params.eyeSeparationPx * params.parallaxStrength;
+    if (disparity < 0.0f) disparity = 0.0f;
+    if (disparity > MAX_VIEW_DISPARITY_PX) disparity = static_cast<float>(MAX_VIEW_DISPARITY_PX);
+    // 255 depth steps span 'disparity' pixels; 8 fractional bits
+    return static_cast<int>(std::lround(disparity * 256.0f / 255.0f));
+}
+
+void HalfDisparityRow(const uint8_t* depth, int width, int scaleQ8, int convergence, int16_t* shift) {
+    // |depth - convergence| <= 255 and scaleQ8 <= 64 * 256 / 255, so the product fits in 16 bits.
+    // The extra shift by one halves the disparity for each eye.
+    int x = 0;
+#ifdef CLEAN3D_SSE2
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i conv = _mm_set1_epi16(static_cast<short>(convergence));
+    const __m128i scale = _mm_set1_epi16(static_cast<short>(scaleQ8));
+    for (; x + 16 <= width; x += 16) {
+        __m128i d = _mm_loadu_si128(reinterpret_cast<const __m128i*>(depth + x));
+        __m128i lo = _mm_sub_epi16(_mm_unpacklo_epi8(d, zero), conv);
+        __m128i hi = _mm_sub_epi16(_mm_unpackhi_epi8(d, zero), conv);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(shift + x), _mm_srai_epi16(_mm_mullo_epi16(lo, scale), 9));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(shift + x + 8), _mm_srai_epi16(_mm_mullo_epi16(hi, scale), 9));
+    }
+#endif
+    for (; x < width; ++x) {
+        shift[x] = static_cast<int16_t>(((static_cast<int>(depth[x]) - convergence) * scaleQ8) >> 9);
+    }
+}
+
+void WarpRow(const uint32_t* src, const uint8_t* depth, const int16_t* shift, int direction, int width,
+    uint32_t* dst, int16_t* zrow) {
+    // Shift grows with nearness, so when two source pixels collide the nearer one is the
+    // one further from the eye's side: the left pixel for the left eye (which moves right),
+    // the right pixel for the right eye. Walking towards it makes it the last write, which
+    // resolves occlusion without a depth test per pixel.
+    if (direction > 0) {
+        for (int x = width - 1; x >= 0; --x) {
+            int target = x + shift[x];
+            if (static_cast<unsigned>(target) >= static_cast<unsigned>(width)) continue;
+            zrow[target] = depth[x];
+            dst[target] = src[x];
+        }
+    }
+    else {
+        for (int x = 0; x < width; ++x) {
+            int target = x - shift[x];
+            if (static_cast<unsigned>(target) >= static_cast<unsigned>(width)) continue;
+            zrow[target] = depth[x];
+            dst[target] = src[x];
+        }
+    }
+}
+
+void FillHolesRow(uint32_t* dst, const int16_t* zrow, int width) {
+    int x = 0;
+    while (x < width) {
+#ifdef CLEAN3D_SSE2
+        // Holes are rare; skip written pixels 8 at a time (a hole has its sign bit set)
+        while (x + 8 <= width && _mm_movemask_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(zrow + x))) == 0) x += 8;
+        if (x >= width) break;
+#endif
+        if (zrow[x] >= 0) { ++x; continue; }
+        int end = x + 1;
+        while (end < width && zrow[end] < 0) ++end;
+
+        // Disocclusions expose background, so take the farther of the two neighbours
+        bool hasLeft = x > 0, hasRight = end < width;
+        uint32_t fill = 0;
+        if (hasLeft && hasRight) fill = zrow[x - 1] <= zrow[end] ? dst[x - 1] : dst[end];
+        else if (hasLeft) fill = dst[x - 1];
+        else if (hasRight) fill = dst[end];
+        for (int i = x; i < end; ++i) dst[i] = fill;
+        x = end;
+    }
+}
+
+void SynthesizeStereo(const ImagePlane<const uint32_t>& frame, const ImagePlane<const uint8_t>& depth,
+    const ViewSynthesisParams& params, const ImagePlane<uint32_t>& left, const ImagePlane<uint32_t>& right) {
+    int scaleQ8 = DisparityScaleQ8(params);
+    int width = frame.width;
+    FrameArena& arena = FrameArena::ThreadArena();
+    FrameArena::Scope scope(arena);
+    ParallelFor(0, frame.height, [&](int first, int last) {
+        int16_t* shift = arena.AllocateArray<int16_t>(static_cast<size_t>(width) * 3);
+        int16_t* zLeft = shift + width;
+        int16_t* zRight = zLeft + width;
+        for (int y = first; y < last; ++y) {
+            const uint32_t* src = frame.Row(y);
+            const uint8_t* d = depth.Row(y);
+            HalfDisparityRow(d, width, scaleQ8, params.convergence, shift);
+            // -1 in every int16 is all bits set
+            memset(zLeft, 0xFF, sizeof(int16_t) * width * 2);
+            WarpRow(src, d, shift, 1, width, left.Row(y), zLeft);
+            WarpRow(src, d, shift, -1, width, right.Row(y), zRight);
+            FillHolesRow(left.Row(y), zLeft, width);
+            FillHolesRow(right.Row(y), zRight, width);
+        }
+    });
+}
+
+void BuildColumnViews(const InterleavePattern& pattern, int width, uint8_t* viewOfColumn) {
+    int views = pattern.viewCount < 1 ? 1 : (pattern.viewCount > MAX_INTERLEAVED_VIEWS ? MAX_INTERLEAVED_VIEWS : pattern.viewCount);
+    float stripe = pattern.stripeWidthPx < 0.1f ? 0.1f : pattern.stripeWidthPx;
+    for (int x = 0; x < width; ++x) {
+        int band = static_cast<int>(std::floor((x + pattern.phasePx) / stripe));
+        int view = band % views;
+        viewOfColumn[x] = static_cast<uint8_t>(view < 0 ? view + views : view);
+    }
+}
+
+static void BuildViewScales(int viewCount, int scaleQ8, int32_t* viewScale) {
+    for (int v = 0; v < MAX_INTERLEAVED_VIEWS; ++v) viewScale[v] = 0;
+    if (viewCount < 2) return;
+    for (int v = 0; v < viewCount && v < MAX_INTERLEAVED_VIEWS; ++v) {
+        // (N - 1 - 2v) / (2 (N - 1)) in Q8: +1/2 for the leftmost view, -1/2 for the rightmost
+        int q8 = static_cast<int>(std::lround(256.0 * (viewCount - 1 - 2 * v) / (2.0 * (viewCount - 1))));
+        viewScale[v] = scaleQ8 * q8;
+    }
+}
+
+void BuildColumnScales(const uint8_t* viewOfColumn, int width, int viewCount, int scaleQ8, int32_t* columnScale) {
+    int32_t viewScale[MAX_INTERLEAVED_VIEWS];
+    BuildViewScales(viewCount, scaleQ8, viewScale);
+    for (int x = 0; x < width; ++x) columnScale[x] = viewScale[viewOfColumn[x]];
+}
+
+// Shift for one pixel. Rounds the magnitude the same way for views on either side, so
+// the outermost views match WarpRow's +shift/-shift exactly.
+static inline int ColumnShift(int depth, int convergence, int32_t scale) {
+    int32_t magnitude = scale < 0 ? -scale : scale;
+    int shift = ((depth - convergence) * magnitude) >> 16;
+    return scale < 0 ? -shift : shift;
+}
+
+void SynthesizeInterleavedRow(const uint32_t* src, const uint8_t* depth, const int32_t* columnScale,
+    int convergence, int width, uint32_t* dst) {
+    int last = width - 1;
+    for (int x = 0; x < width; ++x) {
+        int32_t scale = columnScale[x];
+        int sx = x - ColumnShift(depth[x], convergence, scale);
+        sx = sx < 0 ? 0 : (sx > last ? last : sx);
+        sx = x - ColumnShift(depth[sx], convergence, scale);
+        sx = sx < 0 ? 0 : (sx > last ? last : sx);
+        dst[x] = src[sx];
+    }
+}
+
+void SynthesizeInterleaved(const ImagePlane<const uint32_t>& frame, const ImagePlane<const uint8_t>& depth,
+    const ViewSynthesisParams& params, const InterleavePattern& pattern, const ImagePlane<uint32_t>& out) {
+    int width = frame.width;
+    FrameArena& arena = FrameArena::ThreadArena();
+    FrameArena::Scope scope(arena);
+    uint8_t* viewOfColumn = arena.AllocateArray<uint8_t>(width);
+    int32_t* columnScale = arena.AllocateArray<int32_t>(width);
+    BuildColumnViews(pattern, width, viewOfColumn);
+    BuildColumnScales(viewOfColumn, width, pattern.viewCount, DisparityScaleQ8(params), columnScale);
+    ParallelFor(0, frame.height, [&](int first, int last) {
+        for (int y = first; y < last; ++y) {
+            SynthesizeInterleavedRow(frame.Row(y), depth.Row(y), columnScale, params.convergence, width, out.Row(y));
+        }
+    });
+}
+
+void SynthesizeLenticular(const ImagePlane<const uint32_t>& frame, const ImagePlane<const uint8_t>& depth,
+    const ViewSynthesisParams& params, const LenticularMap& map, const ImagePlane<uint32_t>& out) {
+    int width = frame.width;
+    int lastColumn = width - 1;
+    int32_t viewScale[MAX_INTERLEAVED_VIEWS];
+    BuildViewScales(map.ViewCount(), DisparityScaleQ8(params), viewScale);
+    FrameArena& arena = FrameArena::ThreadArena();
+    FrameArena::Scope scope(arena);
+    ParallelFor(0, frame.height, [&](int first, int last) {
+        uint8_t* view = arena.AllocateArray<uint8_t>(static_cast<size_t>(width) * 6);
+        uint8_t* weight = view + width * 3;
+        for (int y = first; y < last; ++y) {
+            map.ViewRow(y, view, weight);
+            const uint32_t* src = frame.Row(y);
+            const uint8_t* d = depth.Row(y);
+            uint32_t* dst = out.Row(y);
+            for (int x = 0; x < width; ++x) {
+                const uint8_t* subpixelView = view + x * 3;
+                if (subpixelView[0] == subpixelView[1] && subpixelView[1] == subpixelView[2]) {
+                    // Whole pixel under one view: same gather as SynthesizeInterleavedRow
+                    int32_t scale = viewScale[subpixelView[0]];
+                    int sx = x - ColumnShift(d[x], params.convergence, scale);
+                    sx = sx < 0 ? 0 : (sx > lastColumn ? lastColumn : sx);
+                    sx = x - ColumnShift(d[sx], params.convergence, scale);
+                    sx = sx < 0 ? 0 : (sx > lastColumn ? lastColumn : sx);
+                    dst[x] = src[sx] | 0xFF000000u;
+                    continue;
+                }
+                uint32_t px = 0xFF000000u;
+                for (int c = 0; c < 3; ++c) {
+                    int32_t scale = viewScale[subpixelView[c]];
+                    int sx = x - ColumnShift(d[x], params.convergence, scale);
+                    sx = sx < 0 ? 0 : (sx > lastColumn ? lastColumn : sx);
+                    sx = x - ColumnShift(d[sx], params.convergence, scale);
+                    sx = sx < 0 ? 0 : (sx > lastColumn ? lastColumn : sx);
+                    px |= src[sx] & (0xFFu << (c * 8));
+                }
+                dst[x] = px;
+            }
+        }
+    });
+}
+
+void ViewSynthesizer::UpdateDepth(const ImagePlane<const uint32_t>& frame) {
+    if (m_timer) m_timer->BeginStage(ResolutionDepth);
+    if (frame.width != m_width || frame.height != m_height) {
+        m_width = frame.width;
+        m_height = frame.height;
+        m_depth.assign(static_cast<size_t>(m_width) * m_height, 0);
+        m_refined.clear();
+    }
+    if (m_historyParams.updateInterval > 0) {
+        m_history.Update(frame, m_historyParams, m_changes);
+        m_changes = nullptr;
+        m_current = m_history.Depth();
+    }
+    else {
+        m_history.Reset();
+        ImagePlane<uint8_t> depth = { m_depth.data(), m_width, m_height, static_cast<size_t>(m_width) };
+        EstimateDepth(frame, depth);
+        m_current = Plane(m_depth);
+    }
+
+    if (m_refineParams.radius > 0) {
+        // The depth is luminance-derived, so it is its own guide
+        m_refined.resize(static_cast<size_t>(m_width) * m_height);
+        ImagePlane<uint8_t> refined = { m_refined.data(), m_width, m_height, static_cast<size_t>(m_width) };
+        int scale = m_scale == 2 || m_scale == 4 ? m_scale : 1;
+        if (scale == 1) {
+            GuidedFilter(m_current, m_current, m_refineParams, refined);
+        }
+        else {
+            int lowWidth = ReducedSize(m_width, scale), lowHeight = ReducedSize(m_height, scale);
+            size_t lowSize = static_cast<size_t>(lowWidth) * lowHeight;
+            m_lowDepth.resize(lowSize);
+            m_lowRefined.resize(lowSize);
+            ImagePlane<uint8_t> lowDepth = { m_lowDepth.data(), lowWidth, lowHeight, static_cast<size_t>(lowWidth) };
+            ImagePlane<uint8_t> lowRefined = { m_lowRefined.data(), lowWidth, lowHeight, static_cast<size_t>(lowWidth) };
+            ImagePlane<const uint8_t> lowDepthView = { m_lowDepth.data(), lowWidth, lowHeight, static_cast<size_t>(lowWidth) };
+            ImagePlane<const uint8_t> lowRefinedView = { m_lowRefined.data(), lowWidth, lowHeight, static_cast<size_t>(lowWidth) };
+            DownsamplePlane(m_current, scale, lowDepth);
+            // The window keeps its size on screen
+            GuidedFilterParams lowParams = m_refineParams;
+            lowParams.radius = (m_refineParams.radius + scale / 2) / scale;
+            if (lowParams.radius < 1) lowParams.radius = 1;
+            GuidedFilter(lowDepthView, lowDepthView, lowParams, lowRefined);
+            JointBilateralUpsample(lowRefinedView, lowDepthView, m_current, scale, refined);
+        }
+        m_current = Plane(m_refined);
+    }
+    if (m_timer) m_timer->EndStage(ResolutionDepth);
+}
+
+ImagePlane<const uint32_t> ViewSynthesizer::Focus(const ImagePlane<const uint32_t>& frame) {
+    if (m_focusParams.maxRadius <= 0 && m_focusParams.separation < 0.5f) return frame;
+    m_focused.resize(static_cast<size_t>(frame.width) * frame.height);
+    size_t pitch = frame.width * sizeof(uint32_t);
+    ImagePlane<uint32_t> focused = { m_focused.data(), frame.width, frame.height, pitch };
+    DepthOfField(frame, Depth(), m_focusParams, focused);
+    ImagePlane<const uint32_t> result = { m_focused.data(), frame.width, frame.height, pitch };
+    return result;
+}
+
+void ViewSynthesizer::Process(const ImagePlane<const uint32_t>& frame, const ViewSynthesisParams& params,
+    const ImagePlane<uint32_t>& left, const ImagePlane<uint32_t>& right) {
+    UpdateDepth(frame);
+    if (m_timer) m_timer->BeginStage(ResolutionViews);
+    ImagePlane<const uint32_t> source = Focus(frame);
+    if (params.layerCount > 0) SynthesizeLayeredStereo(source, Depth(), params, left, right);
+    else SynthesizeStereo(source, Depth(), params, left, right);
+    if (m_timer) m_timer->EndStage(ResolutionViews);
+}
+
+void ViewSynthesizer::ProcessInterleaved(const ImagePlane<const uint32_t>& frame, const ViewSynthesisParams& params,
+    const InterleavePattern& pattern, const ImagePlane<uint32_t>& out) {
+    UpdateDepth(frame);
+    if (m_timer) m_timer->BeginStage(ResolutionViews);
+    SynthesizeInterleaved(Focus(frame), Depth(), params, pattern, out);
+    if (m_timer) m_timer->EndStage(ResolutionViews);
+}
+
+void ViewSynthesizer::ProcessLenticular(const ImagePlane<const uint32_t>& frame, const ViewSynthesisParams& params,
+    const LenticularMap& map, const ImagePlane<uint32_t>& out) {
+    UpdateDepth(frame);
+    if (m_timer) m_timer->BeginStage(ResolutionViews);
+    SynthesizeLenticular(Focus(frame), Depth(), params, map, out);
+    if (m_timer) m_timer->EndStage(ResolutionViews);
+}
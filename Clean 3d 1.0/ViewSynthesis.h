@@ -0,0 +1,166 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include "CpuImage.h"
+#include "DepthOfField.h"
+#include "GuidedFilter.h"
+#include "TemporalDepth.h"
+
+class LenticularMap;
+class ResolutionController;
+
+// Depth-image-based rendering of a left/right pair from one captured frame plus its
+// depth (see DepthEstimation.h). Each source pixel is forward-warped horizontally by
+// half the disparity for its depth, left eye one way and right eye the other. Pixels
+// are splatted in occlusion-compatible order so that where several land on the same
+// target the nearest is written last, and disoccluded gaps are filled from the
+// background side.
+
+// Upper bound on the disparity between the two eyes, in pixels. Keeps the warp local
+// and the 16-bit fixed-point math in range.
+const int MAX_VIEW_DISPARITY_PX = 64;
+
+// Mid-range depth sits on the screen plane: nearer content pops out, farther recedes
+const uint8_t VIEW_CONVERGENCE_DEPTH = 128;
+
+struct ViewSynthesisParams {
+    float eyeSeparationPx;    // disparity between the eyes across the full depth range, in pixels
+    float parallaxStrength;   // gain on eyeSeparationPx, 1 = as configured
+    uint8_t convergence;      // depth that lands on the screen plane with no disparity
+    int layerCount;           // 0 = per-pixel warp, otherwise depth planes for SynthesizeLayeredStereo
+};
+
+// Disparity per depth step in 8-bit fixed point, clamped to MAX_VIEW_DISPARITY_PX.
+int DisparityScaleQ8(const ViewSynthesisParams& params);
+
+// Half the eye disparity for each pixel of a depth row, positive for pixels nearer than
+// the convergence depth. The left eye warps by +shift, the right eye by -shift.
+void HalfDisparityRow(const uint8_t* depth, int width, int scaleQ8, int convergence, int16_t* shift);
+
+// Forward-warps one row into 'dst' by direction * shift[x] (direction is +1 for the left
+// eye, -1 for the right). The nearest source pixel per target wins and its depth goes to
+// 'zrow'. 'zrow' must be filled with -1 beforehand; targets nobody lands on stay -1 and
+// are left for FillHolesRow.
+void WarpRow(const uint32_t* src, const uint8_t* depth, const int16_t* shift, int direction, int width,
+    uint32_t* dst, int16_t* zrow);
+
+// Fills each run of unwritten pixels with whichever neighbour of the run is farther away.
+void FillHolesRow(uint32_t* dst, const int16_t* zrow, int width);
+
+// Both eyes for a whole frame, parallel across rows. All planes share the frame's size.
+void SynthesizeStereo(const ImagePlane<const uint32_t>& frame, const ImagePlane<const uint8_t>& depth,
+    const ViewSynthesisParams& params, const ImagePlane<uint32_t>& left, const ImagePlane<uint32_t>& right);
+
+// Which view each output column shows behind a parallax barrier or lenticular sheet,
+// matching the stripe selection in PixelShader.hlsl: view = floor((x + phase) / stripe) mod N.
+struct InterleavePattern {
+    int viewCount;          // 2 for a left/right barrier
+    float stripeWidthPx;    // stripe_width_px
+    float phasePx;          // stripe_offset_px + head_offset_x
+};
+
+const int MAX_INTERLEAVED_VIEWS = 16;
+
+// View shown at each column of a row. The pattern is the same for every row.
+void BuildColumnViews(const InterleavePattern& pattern, int width, uint8_t* viewOfColumn);
+
+// Per-column disparity factor in 16-bit fixed point: the column's view position between
+// the leftmost view (+1/2 disparity) and the rightmost (-1/2), times DisparityScaleQ8.
+void BuildColumnScales(const uint8_t* viewOfColumn, int width, int viewCount, int scaleQ8, int32_t* columnScale);
+
+// One interleaved row: each column is gathered from the source for the view visible
+// there, so every pixel is computed for exactly one view. The source position comes
+// from a fixed-point iteration on the depth (disparity at the target, then at the
+// pixel it points to), which keeps foreground edges in place without a splat pass.
+void SynthesizeInterleavedRow(const uint32_t* src, const uint8_t* depth, const int32_t* columnScale,
+    int convergence, int width, uint32_t* dst);
+
+// The whole interleaved frame, parallel across rows. The result can go to both eye
+// textures: each column already holds the view the shader will select there.
+void SynthesizeInterleaved(const ImagePlane<const uint32_t>& frame, const ImagePlane<const uint8_t>& depth,
+    const ViewSynthesisParams& params, const InterleavePattern& pattern, const ImagePlane<uint32_t>& out);
+
+// Interleave-aware synthesis at subpixel granularity for slanted lenticular sheets: like
+// SynthesizeInterleaved, but each subpixel is gathered for the view the map assigns to
+// it (see LenticularInterleaver.h), so the cost does not grow with the view count. The
+// map must match the frame's size.
+void SynthesizeLenticular(const ImagePlane<const uint32_t>& frame, const ImagePlane<const uint8_t>& depth,
+    const ViewSynthesisParams& params, const LenticularMap& map, const ImagePlane<uint32_t>& out);
+
+// Depth estimation plus view synthesis for one output, reusing its depth buffer
+// across frames. Process warps per pixel, or by depth planes if params.layerCount is set.
+class ViewSynthesizer {
+public:
+    ViewSynthesizer() : m_width(0), m_height(0), m_changes(nullptr), m_timer(nullptr) {
+        m_historyParams.updateInterval = 0;
+        m_historyParams.historyWeight = 0.0f;
+        m_historyParams.changeThreshold = 0;
+        m_refineParams.radius = 0;
+        m_refineParams.epsilon = GUIDED_FILTER_EPSILON;
+        m_scale = 1;
+        m_focusParams.maxRadius = 0;
+        m_focusParams.separation = 0.0f;
+        m_focusParams.focus = VIEW_CONVERGENCE_DEPTH;
+        m_current = Plane(m_depth);
+    }
+
+    // With params.updateInterval > 0, depth for the following Process calls comes from a
+    // TemporalDepth history instead of a fresh estimate. 'changes' describes the next frame
+    // and must stay valid until it is processed; null if unknown.
+    void SetDepthHistory(const TemporalDepthParams& params, const FrameChanges* changes) {
+        m_historyParams = params;
+        m_changes = changes;
+    }
+    // Call when frames go by unprocessed, so the history does not miss their changes
+    void ResetDepthHistory() { m_history.Reset(); }
+
+    // With params.radius > 0, depth is smoothed with GuidedFilter before synthesis
+    void SetDepthRefinement(const GuidedFilterParams& params) { m_refineParams = params; }
+
+    // Refinement at 1/scale resolution (ProcessingScale), brought back to full resolution
+    // with JointBilateralUpsample guided by the unrefined depth
+    void SetProcessingScale(int scale) { m_scale = scale; }
+
+    // With a radius or separation set, the frame goes through DepthOfField, driven by the
+    // depth above, before the views are synthesized from it
+    void SetDepthOfField(const DepthOfFieldParams& params) { m_focusParams = params; }
+
+    // With a timer set, Process times depth as ResolutionDepth and the rest as
+    // ResolutionViews; the caller closes the frame
+    void SetStageTimer(ResolutionController* timer) { m_timer = timer; }
+
+    void Process(const ImagePlane<const uint32_t>& frame, const ViewSynthesisParams& params,
+        const ImagePlane<uint32_t>& left, const ImagePlane<uint32_t>& right);
+    void ProcessInterleaved(const ImagePlane<const uint32_t>& frame, const ViewSynthesisParams& params,
+        const InterleavePattern& pattern, const ImagePlane<uint32_t>& out);
+    void ProcessLenticular(const ImagePlane<const uint32_t>& frame, const ViewSynthesisParams& params,
+        const LenticularMap& map, const ImagePlane<uint32_t>& out);
+
+    // Depth of the last processed frame, as the synthesis used it
+    ImagePlane<const uint8_t> Depth() const { return m_current; }
+
+private:
+    void UpdateDepth(const ImagePlane<const uint32_t>& frame);
+    ImagePlane<const uint32_t> Focus(const ImagePlane<const uint32_t>& frame);
+
+    ImagePlane<const uint8_t> Plane(const std::vector<uint8_t>& pixels) const {
+        ImagePlane<const uint8_t> plane = { pixels.data(), m_width, m_height, static_cast<size_t>(m_width) };
+        return plane;
+    }
+
+    std::vector<uint8_t> m_depth;
+    int m_width;
+    int m_height;
+    TemporalDepth m_history;
+    TemporalDepthParams m_historyParams;
+    const FrameChanges* m_changes;
+    std::vector<uint8_t> m_refined;
+    GuidedFilterParams m_refineParams;
+    int m_scale;
+    std::vector<uint8_t> m_lowDepth;     // m_current at 1/m_scale, the upsampler's low guide
+    std::vector<uint8_t> m_lowRefined;
+    DepthOfFieldParams m_focusParams;
+    std::vector<uint32_t> m_focused;
+    ImagePlane<const uint8_t> m_current;
+    ResolutionController* m_timer;
+};
@@ -0,0 +1,1137 @@
+// Clean3dBench: CPU timings for the overlay's image passes at the default 4096x2160
+// screen size, without a device or a desktop to capture.
+//
+//   Clean3dBench [capture.rgba]
+//   Clean3dBench --sweep [capture.rgba]
+//   Clean3dBench --pipeline [capture.rgba]
+//
+// The optional argument is a raw 4096x2160 R8G8B8A8 dump of a real desktop, which
+// replaces the generated test frame in every pass. --sweep times the passes across
+// the effect settings instead and writes the fitted EffectCostModel to EFFECT_COSTS_FILE.
+// --pipeline runs FramePipeline from a FileFrameSource over the dump, which may hold
+// several frames back to back, or over the test frame written to PIPELINE_FRAMES_FILE.
+// The timing runs and --pipeline then check that a warmed-up frame loop allocates nothing
+// on the heap, and exit with 1 if it does.
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <thread>
+#include <vector>
+#include "AdapterSelection.h"
+#include "AllocationTracker.h"
+#include "BandPipeline.h"
+#include "DepthEstimation.h"
+#include "DepthOfField.h"
+#include "DepthPyramid.h"
+#include "DeviceRecovery.h"
+#include "EdgeOutline.h"
+#include "EffectGovernor.h"
+#include "FileFrameSource.h"
+#include "FogScatter.h"
+#include "FrameAccounting.h"
+#include "FramePacer.h"
+#include "FramePipeline.h"
+#include "GuidedFilter.h"
+#include "LayeredViews.h"
+#include "LenticularInterleaver.h"
+#include "MipPyramid.h"
+#include "OutputScheduler.h"
+#include "ParallelFor.h"
+#include "ReducedResolution.h"
+#include "ResolutionController.h"
+#include "TaskScheduler.h"
+#include "TemporalDepth.h"
+#include "ViewSynthesis.h"
+
+static const int BENCH_WIDTH = 4096;
+static const int BENCH_HEIGHT = 2160;
+static const int BENCH_ITERATIONS = 20;
+static const int SCALING_ITERATIONS = 5;
+
+// The sweep runs on a crop of the frame: its costs are per megapixel, and the full frame
+// would take minutes per pass of the grid
+static const int SWEEP_WIDTH = 1024;
+static const int SWEEP_HEIGHT = 540;
+static const int SWEEP_ITERATIONS = 5;
+static const char* EFFECT_COSTS_FILE = "effect_costs.txt";
+static const char* PIPELINE_FRAMES_FILE = "pipeline_frames.rgba";
+static const int PIPELINE_BENCH_FRAMES = 20;
+static const int STEADY_WARMUP_FRAMES = 3;
+static const int STEADY_FRAMES = 5;
+static const char* ADAPTER_CACHE_CHECK_FILE = "adapter_cache_check.txt";
+static const int SCHEDULER_OUTPUTS = 4;          // the last one is slow
+static const int SCHEDULER_FAST_FRAME_MS = 2;
+static const int SCHEDULER_SLOW_FRAME_MS = 250;
+static const int SCHEDULER_RUN_MS = 300;
+
+// Each thread's counts, to report the threads behind a failed steady-state check
+static void SnapshotThreads(AllocationCounts* counts) {
+    for (int i = 0; i < ALLOCATION_MAX_THREADS; ++i) {
+        counts[i] = i < AllocationThreadCount() ? AllocationThreadCounts(i, nullptr) : AllocationCounts{ 0, 0 };
+    }
+}
+
+static void PrintAllocatingThreads(const AllocationCounts* before) {
+    for (int i = 0; i < AllocationThreadCount(); ++i) {
+        const char* name = nullptr;
+        AllocationCounts counts = AllocationThreadCounts(i, &name);
+        uint64_t allocations = counts.allocations - before[i].allocations;
+        if (allocations == 0) continue;
+        printf("  thread %d (%s): %llu allocations, %llu bytes\n", i, name ? name : "unnamed",
+            static_cast<unsigned long long>(allocations), static_cast<unsigned long long>(counts.bytes - before[i].bytes));
+    }
+}
+
+// Desktop-like test frame: flat panels, a gradient and some high-contrast "text" rows
+static void FillTestFrame(std::vector<uint32_t>& pixels, int width, int height) {
+    uint32_t seed = 12345;
+    for (int y = 0; y < height; ++y) {
+        for (int x = 0; x < width; ++x) {
+            uint32_t r = (x * 255) / width, g = (y * 255) / height, b = 128;
+            if ((x / 256 + y / 256) % 3 == 0) r = g = b = 230;
+            if (y % 24 < 12 && (x / 8) % 5 < 3) {
+                seed = seed * 1664525u + 1013904223u;
+                r = g = b = (seed >> 24) & 0x3F;
+            }
+            pixels[static_cast<size_t>(y) * width + x] = 0xFF000000u | (b << 16) | (g << 8) | r;
+        }
+    }
+}
+
+static bool LoadCapture(const char* path, std::vector<uint32_t>& pixels) {
+    FILE* file = fopen(path, "rb");
+    if (!file) return false;
+    size_t read = fread(pixels.data(), sizeof(uint32_t), pixels.size(), file);
+    fclose(file);
+    return read == pixels.size();
+}
+
+// Advanced by the synthetic stage costs in the ResolutionController section
+static double fakeClockMs = 0.0;
+static double FakeClock() { return fakeClockMs; }
+
+// The frame pacing section's clock: each read costs a microsecond, so spinning advances
+// it, and sleeps overshoot by up to 1.5 ms as a 1 ms scheduler tick does
+static uint32_t pacingSeed = 1;
+static double PacingNoise() {
+    pacingSeed = pacingSeed * 1664525u + 1013904223u;
+    return (pacingSeed >> 8) / 16777216.0;
+}
+static double PacingClock() { return fakeClockMs += 0.001; }
+static void PacingSleep(double ms) { fakeClockMs += ms + 1.5 * PacingNoise(); }
+
+struct PacingResult {
+    double intervalMs, intervalJitterMs;
+    double latencyMs;   // from the start of a frame's work, when it takes the newest capture, to its vblank
+};
+
+// 'frames' frames of 2 to 4 ms work on a 144 Hz display, paced by FramePacer or, without
+// one, by sleeping out the rest of the period as RenderLoop used to
+static PacingResult SimulatePacing(FramePacer* pacer, int frames) {
+    const double refreshMs = 1000.0 / 144, phaseMs = 3.1, periodMs = 1000.0 / 140;
+    fakeClockMs = 1000.0;
+    double previousStart = 0.0, sum = 0.0, squares = 0.0, latency = 0.0;
+    for (int frame = 0; frame < frames; ++frame) {
+        double now = fakeClockMs;
+        if (pacer) {
+            pacer->OnVblank(phaseMs + std::floor((now - phaseMs) / refreshMs) * refreshMs, 0.0);
+            pacer->WaitForFrame();
+        }
+        double start = fakeClockMs;
+        fakeClockMs += 2.0 + 2.0 * PacingNoise();
+        double end = fakeClockMs;
+        if (pacer) pacer->EndFrame();
+        else if (end - start < periodMs) PacingSleep(periodMs - (end - start));
+        latency += phaseMs + std::ceil((end - phaseMs) / refreshMs) * refreshMs - start;
+        if (frame > 0) {
+            sum += start - previousStart;
+            squares += (start - previousStart) * (start - previousStart);
+        }
+        previousStart = start;
+    }
+    PacingResult result;
+    result.intervalMs = sum / (frames - 1);
+    result.intervalJitterMs = std::sqrt(std::max(0.0, squares / (frames - 1) - result.intervalMs * result.intervalMs));
+    result.latencyMs = latency / frames;
+    return result;
+}
+
+static void Report(const char* name, std::function<void()> pass) {
+    pass(); // warm-up
+    std::vector<double> times;
+    for (int i = 0; i < BENCH_ITERATIONS; ++i) {
+        auto begin = std::chrono::steady_clock::now();
+        pass();
+        times.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count());
+    }
+    std::sort(times.begin(), times.end());
+    printf("%-40s median %7.2f ms   min %7.2f ms\n", name, times[times.size() / 2], times[0]);
+}
+
+// One expectation of a headless check; prints it if it does not hold
+static bool Expect(bool holds, const char* what) {
+    if (!holds) printf("  FAILED: %s\n", what);
+    return holds;
+}
+
+// PSNR over the RGB channels, in dB; identical images report 99
+static double Psnr(const std::vector<uint32_t>& a, const std::vector<uint32_t>& b) {
+    double sum = 0.0;
+    for (size_t i = 0; i < a.size(); ++i) {
+        for (int c = 0; c < 24; c += 8) {
+            double diff = static_cast<double>((a[i] >> c) & 0xFF) - static_cast<double>((b[i] >> c) & 0xFF);
+            sum += diff * diff;
+        }
+    }
+    double mse = sum / (a.size() * 3.0);
+    return mse <= 0.0 ? 99.0 : 10.0 * std::log10(255.0 * 255.0 / mse);
+}
+
+// PSNR of one 8-bit plane, and the largest difference
+static double Psnr(const std::vector<uint8_t>& a, const std::vector<uint8_t>& b, int& maxError) {
+    double sum = 0.0;
+    maxError = 0;
+    for (size_t i = 0; i < a.size(); ++i) {
+        int diff = a[i] > b[i] ? a[i] - b[i] : b[i] - a[i];
+        if (diff > maxError) maxError = diff;
+        sum += static_cast<double>(diff) * diff;
+    }
+    double mse = sum / a.size();
+    return mse <= 0.0 ? 99.0 : 10.0 * std::log10(255.0 * 255.0 / mse);
+}
+
+// Every combination of processing_quality (fog steps), outline_width, fog on or off,
+// view count and depth interval, each frame running the CPU reference of every pass it
+// enables: TemporalDepth, SynthesizeLenticular, FogScatter and OutlineEdges.
+static void RunEffectSweep(const std::vector<uint32_t>& frame) {
+    const int width = SWEEP_WIDTH, height = SWEEP_HEIGHT;
+    const double megapixels = width * static_cast<double>(height) / 1e6;
+    ImagePlane<const uint32_t> framePlane = { frame.data(), width, height, BENCH_WIDTH * sizeof(uint32_t) };
+    std::vector<uint32_t> out(static_cast<size_t>(width) * height);
+    std::vector<uint8_t> fog(out.size()), outline(out.size());
+    ImagePlane<uint32_t> outPlane = { out.data(), width, height, width * sizeof(uint32_t) };
+    ImagePlane<uint8_t> fogPlane = { fog.data(), width, height, static_cast<size_t>(width) };
+    ImagePlane<uint8_t> outlinePlane = { outline.data(), width, height, static_cast<size_t>(width) };
+    ViewSynthesisParams params = { 24.0f, 1.0f, 128, 0 };
+
+    const float outlineWidths[] = { 0.0f, 1.5f, 5.5f };   // the tray's Off, Subtle and Strong
+    const int viewCounts[] = { 2, 4, 8 };
+    const int intervals[] = { 1, 2, 4, 8 };
+    std::vector<EffectSample> samples;
+    printf("Effect sweep on %dx%d, %d iterations per point\n", width, height, SWEEP_ITERATIONS);
+    for (int interval : intervals) {
+        TemporalDepth history;
+        TemporalDepthParams historyParams = { interval, 0.9f, DEPTH_CHANGE_THRESHOLD };
+        for (int views : viewCounts) {
+            LenticularParams lens = { views, 0.1f * views, 0.1f, 1.0f / 6.0f, SubpixelRGB, 0.0f };
+            LenticularMap lensMap;
+            lensMap.Build(lens, width, height);
+            for (int fogOn = 0; fogOn < 2; ++fogOn) {
+                for (int quality = 0; quality <= 4; ++quality) {
+                    // processing_quality only reaches the passes through the fog steps
+                    if (!fogOn && quality > 0) break;
+                    for (float outlineWidth : outlineWidths) {
+                        EffectSet effects = { fogOn ? FogStepCount(quality) : 0, outlineWidth > 0.0f ? OUTLINE_TAPS : 0, interval };
+                        FogParams fogParams = { 1.0f, effects.fogSteps, 0.6f, 1.0f };
+                        std::vector<double> times;
+                        for (int i = 0; i < SWEEP_ITERATIONS; ++i) {
+                            auto begin = std::chrono::steady_clock::now();
+                            history.Update(framePlane, historyParams, nullptr);
+                            SynthesizeLenticular(framePlane, history.Depth(), params, lensMap, outPlane);
+                            if (effects.fogSteps > 0) FogScatter(history.Depth(), fogParams, fogPlane);
+                            if (effects.outlineTaps > 0) OutlineEdges(framePlane, outlineWidth, 1000.0f, outlinePlane);
+                            times.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count());
+                        }
+                        // The fastest run: the first of an interval's also fills its history
+                        std::sort(times.begin(), times.end());
+                        EffectSample sample = { effects, views, times[0] / megapixels };
+                        samples.push_back(sample);
+                    }
+                }
+            }
+        }
+    }
+
+    EffectCostModel model;
+    if (!FitEffectCostModel(samples, &model)) {
+        printf("The sweep does not determine the model\n");
+        return;
+    }
+    double squares = 0.0;
+    for (const EffectSample& sample : samples) {
+        double error = EffectCostMs(model, sample.effects, sample.viewCount, EffectCpu) +
+            EffectCostMs(model, sample.effects, sample.viewCount, EffectGpu) - sample.msPerMegapixel;
+        error /= sample.msPerMegapixel;
+        squares += error * error;
+    }
+    printf("%zu points, ms per megapixel (rms relative error %.1f%%):\n", samples.size(), 100.0 * std::sqrt(squares / samples.size()));
+    printf("  base %.2f   per view %.2f   depth pass %.2f   fog %.2f   per fog step %.2f   per outline tap %.2f\n",
+        model.baseMs, model.viewMs, model.depthMs, model.fogMs, model.fogStepMs, model.outlineTapMs);
+    if (SaveEffectCostModel(EFFECT_COSTS_FILE, model)) printf("Written to %s\n", EFFECT_COSTS_FILE);
+}
+
+// PIPELINE_BENCH_FRAMES through FramePipeline with each stage's kernels on its own thread,
+// then on the shared TaskScheduler, then (with enough cores) pinned one stage per core.
+// The stage sum is what running the stages one after another would cost per frame. The
+// runs share one FrameBufferPool, so only the first allocates frames, and none of them
+// may allocate after STEADY_WARMUP_FRAMES; false if one did.
+static bool RunPipeline(const char* capturePath, const std::vector<uint32_t>& frame) {
+    const char* path = capturePath;
+    if (!path) {
+        FILE* file = fopen(PIPELINE_FRAMES_FILE, "wb");
+        bool written = file && fwrite(frame.data(), sizeof(uint32_t), frame.size(), file) == frame.size();
+        if (file) fclose(file);
+        if (!written) {
+            printf("Cannot write %s\n", PIPELINE_FRAMES_FILE);
+            return false;
+        }
+        path = PIPELINE_FRAMES_FILE;
+    }
+    FileFrameSource source(path, BENCH_WIDTH, BENCH_HEIGHT);
+    if (!source.IsOpen()) {
+        printf("Cannot read %dx%d frames from %s\n", BENCH_WIDTH, BENCH_HEIGHT, path);
+        return false;
+    }
+    FrameBufferPool pool;
+    bool steady = true;
+    static const char* stageNames[PIPELINE_STAGE_COUNT] = { "ingest", "analysis", "views", "composite" };
+    unsigned cores = std::thread::hardware_concurrency();
+    for (int run = 0; run < (cores >= PIPELINE_STAGE_COUNT ? 3 : 2); ++run) {
+        PipelineParams params = DefaultPipelineParams();
+        params.serialStages = run == 0;
+        for (int stage = 0; stage < PIPELINE_STAGE_COUNT && run == 2; ++stage) params.cores[stage] = stage;
+        FramePipeline pipeline(BENCH_WIDTH, BENCH_HEIGHT, params, &pool);
+        source.Bind(pipeline.IngestPlanes());
+        pipeline.Start(&source);
+        AllocationCounts threadsBefore[ALLOCATION_MAX_THREADS];
+        AllocationCounts before = { 0, 0 };
+        uint64_t steadyFrom = 0;
+        while (pipeline.Stats().frames < static_cast<uint64_t>(PIPELINE_BENCH_FRAMES)) {
+            uint64_t frames = pipeline.Stats().frames;
+            if (!AllocationTrackingEnabled() && frames >= static_cast<uint64_t>(STEADY_WARMUP_FRAMES)) {
+                SnapshotThreads(threadsBefore);
+                before = AllocationTotals();
+                steadyFrom = frames;
+                EnableAllocationTracking(true);
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+        bool counted = AllocationTrackingEnabled();
+        EnableAllocationTracking(false);
+        AllocationCounts after = AllocationTotals();
+        PipelineStats stats = pipeline.Stats();
+        pipeline.Stop();
+        const char* names[] = { "FramePipeline (serial stages)", "FramePipeline (stages on the pool)", "FramePipeline (pinned stages)" };
+        double stageSum = 0.0, slowest = 0.0;
+        for (const PipelineStageStats& stage : stats.stages) {
+            double ms = stage.frames > 0 ? stage.busyMs / stage.frames : 0.0;
+            stageSum += ms;
+            slowest = std::max(slowest, ms);
+        }
+        printf("%-40s %6.2f ms per frame, stage sum %.2f, slowest %.2f, latency %.2f ms, %d frames pooled\n", names[run],
+            1000.0 / stats.framesPerSecond, stageSum, slowest, stats.latencyMs, pipeline.FrameCount());
+        for (int stage = 0; stage < PIPELINE_STAGE_COUNT; ++stage) {
+            const PipelineStageStats& entry = stats.stages[stage];
+            double frames = entry.frames > 0 ? static_cast<double>(entry.frames) : 1.0;
+            printf("  %-10s busy %7.2f  starved %7.2f  blocked %7.2f ms per frame, queue %.2f, %5.1f%% busy\n", stageNames[stage],
+                entry.busyMs / frames, entry.starvedMs / frames, entry.blockedMs / frames, entry.occupancy, entry.utilisation * 100.0);
+        }
+        uint64_t allocations = after.allocations - before.allocations;
+        printf("  %llu heap allocations in %llu frames once steady, frame pool %zu hits, %zu misses\n",
+            static_cast<unsigned long long>(allocations), static_cast<unsigned long long>(counted ? stats.frames - steadyFrom : 0),
+            pool.Hits(), pool.Misses());
+        if (allocations > 0) {
+            printf("  FAILED: the pipeline allocates once warmed up\n");
+            PrintAllocatingThreads(threadsBefore);
+            steady = false;
+        }
+    }
+    if (!capturePath) remove(PIPELINE_FRAMES_FILE);
+    return steady;
+}
+
+// Interleave's table gather against InterleaveReference, on views whose every subpixel
+// names its view. The 16-bit phases may only pick another view than the reference's
+// doubles where a subpixel sits within their rounding of a view boundary. ViewRow (SSE2
+// blocks, then a scalar tail at this odd width) must match the plain Q16 arithmetic.
+static bool CheckInterleave(const char* name, const LenticularParams& lens) {
+    const int width = SWEEP_WIDTH - 1, height = SWEEP_HEIGHT;
+    const int viewCount = lens.viewCount;
+    std::vector<std::vector<uint32_t>> views(viewCount, std::vector<uint32_t>(static_cast<size_t>(width) * height));
+    ImagePlane<const uint32_t> planes[MAX_INTERLEAVED_VIEWS];
+    for (int v = 0; v < viewCount; ++v) {
+        for (int y = 0; y < height; ++y) {
+            for (int x = 0; x < width; ++x) {
+                uint32_t px = 0xFF000000u;
+                for (int c = 0; c < 3; ++c) px |= static_cast<uint32_t>(v * 16 + (x + 3 * y + c) % 16) << (c * 8);
+                views[v][static_cast<size_t>(y) * width + x] = px;
+            }
+        }
+        ImagePlane<const uint32_t> plane = { views[v].data(), width, height, width * sizeof(uint32_t) };
+        planes[v] = plane;
+    }
+    std::vector<uint32_t> gathered(static_cast<size_t>(width) * height), reference(gathered.size());
+    ImagePlane<uint32_t> gatheredPlane = { gathered.data(), width, height, width * sizeof(uint32_t) };
+    ImagePlane<uint32_t> referencePlane = { reference.data(), width, height, width * sizeof(uint32_t) };
+    LenticularMap map;
+    map.Build(lens, width, height);
+    Interleave(planes, map, false, gatheredPlane);
+    InterleaveReference(planes, lens, referencePlane);
+
+    // Three Q16 roundings (column, row, head phase) of half a step each, in views
+    const double tolerance = viewCount * 2.0 / 65536.0;
+    const double lensSubpixels = lens.lensPitchMm * 3.0 / lens.pixelPitchMm;
+    int differ = 0, offBoundary = 0;
+    for (int y = 0; y < height; ++y) {
+        for (int x = 0; x < width; ++x) {
+            uint32_t a = gathered[static_cast<size_t>(y) * width + x], b = reference[static_cast<size_t>(y) * width + x];
+            for (int c = 0; c < 3; ++c) {
+                if (((a ^ b) >> (c * 8) & 0xFF) == 0) continue;
+                ++differ;
+                int subpixel = lens.layout == SubpixelBGR ? 2 - c : c;
+                double position = (3 * x + subpixel + 0.5 - 3.0 * y * lens.slant + 3.0 * lens.phasePx) / lensSubpixels;
+                double scaled = (position - std::floor(position)) * viewCount;
+                if (std::fabs(scaled - std::floor(scaled + 0.5)) > tolerance) ++offBoundary;
+            }
+        }
+    }
+
+    std::vector<uint8_t> view(static_cast<size_t>(width) * 3), weight(view.size());
+    int tableErrors = 0;
+    for (int y = 0; y < height; ++y) {
+        map.ViewRow(y, view.data(), weight.data());
+        for (int s = 0; s < width * 3; ++s) {
+            uint32_t scaled = static_cast<uint16_t>(map.ColumnPhases()[s] + map.RowPhase(y)) * static_cast<uint32_t>(viewCount);
+            if (view[s] != (scaled >> 16) || weight[s] != static_cast<uint8_t>(scaled >> 8)) ++tableErrors;
+        }
+    }
+
+    bool matches = offBoundary == 0 && tableErrors == 0;
+    printf("  matches reference, %-19s %s, %d of %d subpixels differ, %d off a view boundary, %d table errors\n", name,
+        matches ? "yes" : "NO", differ, width * height * 3, offBoundary, tableErrors);
+    return matches;
+}
+
+// The overlay's CPU frame loop, every kernel it can run on a frame, on a SWEEP_WIDTH x
+// SWEEP_HEIGHT corner of the frame: STEADY_WARMUP_FRAMES size the planes, arenas and
+// thread pool, then STEADY_FRAMES must not touch the heap
+static bool CheckSteadyState(const std::vector<uint32_t>& frame) {
+    const int width = SWEEP_WIDTH, height = SWEEP_HEIGHT;
+    ImagePlane<const uint32_t> source = { frame.data(), width, height, BENCH_WIDTH * sizeof(uint32_t) };
+    std::vector<uint32_t> left(static_cast<size_t>(width) * height), right(left.size()), out(left.size());
+    std::vector<uint8_t> fog(left.size()), edges(left.size());
+    ImagePlane<uint32_t> leftPlane = { left.data(), width, height, width * sizeof(uint32_t) };
+    ImagePlane<uint32_t> rightPlane = { right.data(), width, height, width * sizeof(uint32_t) };
+    ImagePlane<uint32_t> outPlane = { out.data(), width, height, width * sizeof(uint32_t) };
+    ImagePlane<uint8_t> fogPlane = { fog.data(), width, height, static_cast<size_t>(width) };
+    ImagePlane<uint8_t> edgePlane = { edges.data(), width, height, static_cast<size_t>(width) };
+    ImagePlane<const uint32_t> views[2] = {
+        { left.data(), width, height, width * sizeof(uint32_t) },
+        { right.data(), width, height, width * sizeof(uint32_t) }
+    };
+
+    ViewSynthesisParams params = { 24.0f, 1.0f, 16, 0 };
+    TemporalDepthParams historyParams = { 2, 0.9f, DEPTH_CHANGE_THRESHOLD };
+    GuidedFilterParams refine = { DEFAULT_GUIDED_FILTER_RADIUS, GUIDED_FILTER_EPSILON };
+    DepthOfFieldParams focus = { DEFAULT_DOF_RADIUS, 12.0f, VIEW_CONVERGENCE_DEPTH };
+    FogParams fogParams = { 1.0f, FogStepCount(3), 0.6f, 1.0f };
+    InterleavePattern barrier = { 2, 1.0f, 0.0f };
+    LenticularParams lens = { 2, 0.8f, 0.1f, 1.0f / 6.0f, SubpixelRGB, 0.0f };
+    LenticularMap lensMap;
+    lensMap.Build(lens, width, height);
+    ViewSynthesizer synthesizer;
+    synthesizer.SetDepthHistory(historyParams, nullptr);
+    synthesizer.SetDepthRefinement(refine);
+    synthesizer.SetProcessingScale(2);
+    synthesizer.SetDepthOfField(focus);
+    BandPipeline bands;
+    BandParams bandParams = DefaultBandParams();
+    bandParams.sourceBgra = true;
+
+    AllocationCounts threadsBefore[ALLOCATION_MAX_THREADS];
+    AllocationWatch watch(STEADY_WARMUP_FRAMES);
+    EnableAllocationTracking(true);
+    for (int i = 0; i < STEADY_WARMUP_FRAMES + STEADY_FRAMES; ++i) {
+        if (i == STEADY_WARMUP_FRAMES) SnapshotThreads(threadsBefore);
+        watch.BeginFrame();
+        synthesizer.Process(source, params, leftPlane, rightPlane);
+        synthesizer.ProcessLenticular(source, params, lensMap, outPlane);
+        synthesizer.ProcessInterleaved(source, params, barrier, outPlane);
+        SynthesizeLayeredStereo(source, synthesizer.Depth(), params, leftPlane, rightPlane);
+        Interleave(views, lensMap, true, outPlane);
+        FogScatter(synthesizer.Depth(), fogParams, fogPlane);
+        OutlineEdges(source, 1.5f, 1000.0f, edgePlane);
+        bands.Process(source, bandParams, outPlane);
+        watch.EndFrame();
+    }
+    EnableAllocationTracking(false);
+    AllocationFrameStats stats = watch.Stats();
+    FrameArena& arena = FrameArena::ThreadArena();
+    printf("%-40s %llu heap allocations in %llu frames, %llu on this thread, arena %.1f of %.1f MB\n", "Steady-state frame loop",
+        static_cast<unsigned long long>(stats.all.allocations), static_cast<unsigned long long>(stats.steadyFrames),
+        static_cast<unsigned long long>(stats.thread.allocations), arena.HighWater() / 1e6, arena.Capacity() / 1e6);
+    if (watch.Failed()) {
+        printf("  FAILED: %llu of %llu frames allocate once warmed up, the worst %llu times (%llu bytes)\n",
+            static_cast<unsigned long long>(stats.allocatingFrames), static_cast<unsigned long long>(stats.steadyFrames),
+            static_cast<unsigned long long>(stats.worst.allocations), static_cast<unsigned long long>(stats.worst.bytes));
+        PrintAllocatingThreads(threadsBefore);
+    }
+    return !watch.Failed();
+}
+
+// AdapterSelection on fake adapter lists: the choice, a cache written and read back
+// that hits, misses once a driver is updated or an adapter added, and the override
+static bool CheckAdapterSelection() {
+    // A software adapter, a 12_0 card with 8 GB and a 12_1 card with 4 GB
+    std::vector<AdapterCandidate> adapters = {
+        { 0x100, 0, 0x1414, 0x8C, 0, 0, true, 0 },
+        { 0x200, 0, 0x10DE, 0x2484, 8ull << 30, 0x001F000E000A1234ull, false, 1 },
+        { 0x300, 0, 0x8086, 0x56A0, 4ull << 30, 0x001F000065A80000ull, false, 0 }
+    };
+    bool passed = Expect(SelectBestAdapter(adapters) == 2, "the best feature level wins over VRAM, software is skipped");
+    adapters[2].featureRank = 1;
+    passed = Expect(SelectBestAdapter(adapters) == 1, "VRAM breaks a feature level tie") && passed;
+    adapters[2].featureRank = 0;
+
+    AdapterCacheEntry saved = MakeAdapterCacheEntry(adapters, SelectBestAdapter(adapters));
+    AdapterCacheEntry loaded = {};
+    passed = Expect(SaveAdapterCache(ADAPTER_CACHE_CHECK_FILE, saved) && LoadAdapterCache(ADAPTER_CACHE_CHECK_FILE, &loaded),
+        "the cache is written and read back") && passed;
+    passed = Expect(loaded.luidLow == saved.luidLow && loaded.luidHigh == saved.luidHigh && loaded.featureRank == saved.featureRank &&
+        loaded.driverVersion == saved.driverVersion && loaded.adapterSetHash == saved.adapterSetHash, "the cache reads back unchanged") && passed;
+
+    // Next start: the same adapters, not probed yet
+    std::vector<AdapterCandidate> unprobed = adapters;
+    for (AdapterCandidate& a : unprobed) a.featureRank = ADAPTER_FEATURE_RANK_UNKNOWN;
+    passed = Expect(MatchAdapterCache(loaded, unprobed) == 2, "cache hit on the same adapters") && passed;
+    std::vector<AdapterCandidate> updated = unprobed;
+    updated[2].driverVersion++;
+    passed = Expect(MatchAdapterCache(loaded, updated) < 0, "cache miss once the chosen adapter's driver changes") && passed;
+    updated = unprobed;
+    updated[1].driverVersion++;
+    passed = Expect(MatchAdapterCache(loaded, updated) < 0, "cache miss once another adapter's driver changes") && passed;
+    updated = unprobed;
+    updated.push_back(adapters[1]);
+    updated.back().luidLow = 0x400;
+    passed = Expect(MatchAdapterCache(loaded, updated) < 0, "cache miss once an adapter is added") && passed;
+
+    FILE* stale = fopen(ADAPTER_CACHE_CHECK_FILE, "w");
+    if (stale) {
+        fputs("clean3d-adapter-cache 0\nfeature_rank=0\n", stale);
+        fclose(stale);
+    }
+    passed = Expect(!LoadAdapterCache(ADAPTER_CACHE_CHECK_FILE, &loaded), "another cache version is not read") && passed;
+    remove(ADAPTER_CACHE_CHECK_FILE);
+    passed = Expect(!LoadAdapterCache(ADAPTER_CACHE_CHECK_FILE, &loaded), "a missing cache is not read") && passed;
+
+    passed = Expect(UseSystemDefaultAdapter("1"), "CLEAN3D_USE_SYSTEM_DEFAULT_ADAPTER=1 takes the system default") && passed;
+    passed = Expect(!UseSystemDefaultAdapter("0") && !UseSystemDefaultAdapter("") && !UseSystemDefaultAdapter(nullptr),
+        "otherwise the adapter is selected") && passed;
+    printf("%-40s %s\n", "Adapter selection and cache", passed ? "ok" : "FAILED");
+    return passed;
+}
+
+// A device whose objects are rebuilt from a retained config, as the renderer's are.
+// Presenting reports DXGI_ERROR_DEVICE_REMOVED once 'removed' is set; each recovery
+// step costs a fixed time on fakeClockMs and can be made to fail.
+class MockRecoverableDevice : public IRecoverableDevice {
+public:
+    MockRecoverableDevice() : config(24.0f), deviceConfig(config), removed(false), failRebuild(false), failEverything(false),
+        warmRestores(0), fullRebuilds(0) {}
+
+    int32_t Present() const { return removed ? RECOVERY_HR_DEVICE_REMOVED : 0; }
+
+    void ReleaseDeviceObjects() override { fakeClockMs += 1.0; deviceConfig = -1.0f; }
+    bool RebuildDeviceObjects() override {
+        fakeClockMs += 5.0;
+        if (failRebuild) return false;
+        deviceConfig = config;
+        removed = false;
+        return true;
+    }
+    bool RestoreWarmState() override { fakeClockMs += 2.0; warmRestores++; return true; }
+    bool RebuildEverything() override {
+        fakeClockMs += 40.0;
+        if (failEverything) return false;
+        deviceConfig = config;
+        removed = false;
+        fullRebuilds++;
+        return true;
+    }
+
+    float config;         // kept across a device loss, like IllusionConfig
+    float deviceConfig;   // what the device objects were built from, -1 once released
+    bool removed;
+    bool failRebuild;
+    bool failEverything;
+    int warmRestores;
+    int fullRebuilds;
+};
+
+// DeviceRecoveryMachine against MockRecoverableDevice: an incremental recovery, one
+// that falls back to the full rebuild, the config kept through both, the step times
+// taken from the injected clock, and the fallback state once attempts run out
+static bool CheckDeviceRecovery() {
+    MockRecoverableDevice device;
+    DeviceRecoveryMachine recovery(device, 3, FakeClock);
+    fakeClockMs = 0.0;
+    device.config = 31.5f;
+    device.deviceConfig = device.config;
+    device.removed = true;
+    bool passed = Expect(DeviceRecoveryMachine::IsDeviceLost(device.Present()), "DXGI_ERROR_DEVICE_REMOVED is a device loss");
+    RecoveryOutcome outcome = recovery.Recover();
+    const RecoveryStats& stats = recovery.Stats();
+    passed = Expect(outcome == RecoveryIncremental && recovery.State() == RecoveryHealthy && device.Present() == 0,
+        "the incremental rebuild recovers") && passed;
+    passed = Expect(device.warmRestores == 1 && device.fullRebuilds == 0, "it restores the warm state, without a full rebuild") && passed;
+    passed = Expect(device.config == 31.5f && device.deviceConfig == device.config, "the config survives it") && passed;
+    passed = Expect(stats.lastReleaseMs == 1.0 && stats.lastRebuildMs == 5.0 && stats.lastWarmMs == 2.0 && stats.lastTotalMs == 8.0,
+        "its steps are timed on the injected clock") && passed;
+
+    device.removed = true;
+    device.failRebuild = true;
+    outcome = recovery.Recover();
+    passed = Expect(outcome == RecoveryFull && recovery.State() == RecoveryHealthy && device.Present() == 0,
+        "a failed incremental rebuild falls back to the full one") && passed;
+    passed = Expect(device.warmRestores == 1 && device.fullRebuilds == 1, "which does not restore the warm state") && passed;
+    passed = Expect(device.config == 31.5f && device.deviceConfig == device.config, "the config survives the full rebuild") && passed;
+    passed = Expect(stats.lastRebuildMs == 5.0 && stats.lastWarmMs == 0.0 && stats.lastTotalMs == 46.0 && stats.maxTotalMs == 46.0,
+        "the full rebuild is timed on the injected clock") && passed;
+
+    device.removed = true;
+    device.failEverything = true;
+    outcome = recovery.Recover();
+    passed = Expect(outcome == RecoveryFailed && recovery.State() == RecoveryLost, "a failed full rebuild leaves the device lost") && passed;
+    outcome = recovery.Recover();
+    passed = Expect(outcome == RecoveryFailed && recovery.State() == RecoveryFallback && stats.attempts == 4,
+        "past its attempts the machine stays on the fallback frame") && passed;
+    passed = Expect(stats.incremental == 1 && stats.full == 1 && stats.failed == 2, "every outcome is counted") && passed;
+    printf("%-40s %s\n", "Device recovery", passed ? "ok" : "FAILED");
+    return passed;
+}
+
+// A capture that takes a fixed time and writes its frame number into the slot
+class SyntheticFrameSource : public FrameSource {
+public:
+    explicit SyntheticFrameSource(int frameMs) : m_frameMs(frameMs), m_captured(0) {
+        for (int i = 0; i < FRAME_SOURCE_SLOTS; ++i) frameInSlot[i] = 0;
+    }
+
+    FrameStatus CaptureInto(int slot, uint32_t) override {
+        std::this_thread::sleep_for(std::chrono::milliseconds(m_frameMs));
+        frameInSlot[slot] = ++m_captured;
+        return FrameReady;
+    }
+    bool Reopen() override { return true; }
+
+    uint64_t Captured() const { return m_captured; }
+
+    uint64_t frameInSlot[FRAME_SOURCE_SLOTS];   // read by the render side once the mailbox hands the slot over
+
+private:
+    int m_frameMs;
+    std::atomic<uint64_t> m_captured;
+};
+
+// OutputScheduler with SCHEDULER_OUTPUTS synthetic sources on real threads, the last
+// one far slower than a frame: the others keep publishing and their newest frame keeps
+// reaching the render side, and a paused output captures nothing until resumed
+static bool CheckOutputScheduler() {
+    std::vector<std::unique_ptr<SyntheticFrameSource>> sources;
+    OutputScheduler scheduler;
+    for (int i = 0; i < SCHEDULER_OUTPUTS; ++i) {
+        sources.emplace_back(new SyntheticFrameSource(i == SCHEDULER_OUTPUTS - 1 ? SCHEDULER_SLOW_FRAME_MS : SCHEDULER_FAST_FRAME_MS));
+        scheduler.AddOutput(sources.back().get());
+    }
+    const int slow = SCHEDULER_OUTPUTS - 1;
+
+    // The render thread's loop: take whatever is newest, every few milliseconds
+    uint64_t lastFrame[SCHEDULER_OUTPUTS] = {};
+    int takes[SCHEDULER_OUTPUTS] = {};
+    bool newest = true;
+    auto render = [&](int ms) {
+        auto until = std::chrono::steady_clock::now() + std::chrono::milliseconds(ms);
+        while (std::chrono::steady_clock::now() < until) {
+            for (int i = 0; i < SCHEDULER_OUTPUTS; ++i) {
+                int slot = scheduler.TakeLatest(i);
+                if (slot < 0) continue;
+                uint64_t frame = sources[i]->frameInSlot[slot];
+                if (frame <= lastFrame[i]) newest = false;
+                lastFrame[i] = frame;
+                takes[i]++;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(4));
+        }
+    };
+
+    scheduler.Start();
+    render(SCHEDULER_RUN_MS);
+    int fastTakes = takes[0];
+    for (int i = 1; i < slow; ++i) fastTakes = std::min(fastTakes, takes[i]);
+    // At least a tenth of the frames a fast source could deliver, to allow for a loaded machine
+    bool passed = Expect(fastTakes >= SCHEDULER_RUN_MS / SCHEDULER_FAST_FRAME_MS / 10, "the fast outputs keep publishing beside the slow one");
+    passed = Expect(takes[slow] <= SCHEDULER_RUN_MS / SCHEDULER_SLOW_FRAME_MS + 1, "the slow output only delays itself") && passed;
+    passed = Expect(newest, "each take is a newer frame than the last") && passed;
+
+    scheduler.Pause(0);
+    uint64_t pausedAt = sources[0]->Captured();
+    uint64_t othersAt = sources[1]->Captured();
+    render(SCHEDULER_RUN_MS / 3);
+    passed = Expect(sources[0]->Captured() == pausedAt && scheduler.TakeLatest(0) < 0, "a paused output captures nothing") && passed;
+    passed = Expect(sources[1]->Captured() > othersAt, "the other outputs capture while it is paused") && passed;
+    scheduler.Resume(0);
+    lastFrame[0] = pausedAt;
+    int takenBefore = takes[0];
+    render(SCHEDULER_RUN_MS / 3);
+    passed = Expect(takes[0] > takenBefore, "a resumed output publishes again") && passed;
+    passed = Expect(newest, "and resumes from newer frames") && passed;
+    scheduler.Stop();
+
+    OutputStats slowStats = scheduler.Stats(slow);
+    printf("%-40s %s, %d fast takes, slow %llu published, %llu taken\n", "OutputScheduler", passed ? "ok" : "FAILED", fastTakes,
+        static_cast<unsigned long long>(slowStats.published), static_cast<unsigned long long>(slowStats.taken));
+    return passed;
+}
+
+int main(int argc, char** argv) {
+    const int width = BENCH_WIDTH, height = BENCH_HEIGHT;
+    bool sweep = argc > 1 && strcmp(argv[1], "--sweep") == 0;
+    bool pipelined = argc > 1 && strcmp(argv[1], "--pipeline") == 0;
+    int pathArg = sweep || pipelined ? 2 : 1;
+    const char* capturePath = argc > pathArg ? argv[pathArg] : nullptr;
+    std::vector<uint32_t> frame(static_cast<size_t>(width) * height);
+    std::vector<uint32_t> left(frame.size()), right(frame.size());
+    std::vector<uint8_t> depth(frame.size());
+    if (capturePath && LoadCapture(capturePath, frame)) {
+        printf("Frame: %s\n", capturePath);
+    }
+    else {
+        if (capturePath) printf("Cannot read %dx%d pixels from %s, using the test frame\n", width, height, capturePath);
+        FillTestFrame(frame, width, height);
+    }
+    if (sweep) {
+        RunEffectSweep(frame);
+        return 0;
+    }
+    if (pipelined) return RunPipeline(capturePath, frame) ? 0 : 1;
+
+    ImagePlane<const uint32_t> framePlane = { frame.data(), width, height, width * sizeof(uint32_t) };
+    ImagePlane<uint8_t> depthPlane = { depth.data(), width, height, static_cast<size_t>(width) };
+    ImagePlane<const uint8_t> depthView = { depth.data(), width, height, static_cast<size_t>(width) };
+    ImagePlane<uint32_t> leftPlane = { left.data(), width, height, width * sizeof(uint32_t) };
+    ImagePlane<uint32_t> rightPlane = { right.data(), width, height, width * sizeof(uint32_t) };
+    ViewSynthesisParams params = { 24.0f, 1.0f, 128, 0 };
+
+    printf("%dx%d, %u hardware threads, %d iterations\n", width, height, std::thread::hardware_concurrency(), BENCH_ITERATIONS);
+
+    Report("EstimateDepth (1 thread)", [&]() {
+        for (int y = 0; y < height; ++y) EstimateDepthRow(framePlane.Row(y), width, depthPlane.Row(y));
+    });
+    Report("EstimateDepth", [&]() { EstimateDepth(framePlane, depthPlane); });
+
+    // Whole mip chain against one plain pass over the frame: the chain reads the frame once
+    // and writes a third of its size, so it should cost about as much as a copy
+    Report("Frame copy (one full-resolution pass)", [&]() {
+        ParallelFor(0, height, [&](int first, int last) {
+            for (int y = first; y < last; ++y) memcpy(leftPlane.Row(y), framePlane.Row(y), width * sizeof(uint32_t));
+        });
+    });
+    MipPyramid pyramid;
+    char pyramidName[64];
+    snprintf(pyramidName, sizeof(pyramidName), "MipPyramid::Build (%d levels)", MipLevelCount(width, height));
+    Report(pyramidName, [&]() { pyramid.Build(framePlane); });
+
+    // Guided depth refinement: running sums make the cost flat across radii
+    std::vector<uint8_t> refined(depth.size());
+    ImagePlane<uint8_t> refinedPlane = { refined.data(), width, height, static_cast<size_t>(width) };
+    const int radii[] = { 1, 4, 8, 16, 32, 64 };
+    for (int radius : radii) {
+        GuidedFilterParams filter = { radius, GUIDED_FILTER_EPSILON };
+        char name[64];
+        snprintf(name, sizeof(name), "GuidedFilter (radius %d)", radius);
+        Report(name, [&]() { GuidedFilter(depthView, depthView, filter, refinedPlane); });
+    }
+
+    // Refinement and fog at half and quarter resolution (processing_quality 2 and 1),
+    // against the full-resolution result
+    GuidedFilterParams refine = { DEFAULT_GUIDED_FILTER_RADIUS, GUIDED_FILTER_EPSILON };
+    FogParams fog = { 1.0f, FogStepCount(3), 0.6f, 1.0f };
+    std::vector<uint8_t> fullRefined(depth.size()), fullFog(depth.size()), reduced(depth.size());
+    ImagePlane<uint8_t> fullRefinedPlane = { fullRefined.data(), width, height, static_cast<size_t>(width) };
+    ImagePlane<uint8_t> fullFogPlane = { fullFog.data(), width, height, static_cast<size_t>(width) };
+    ImagePlane<uint8_t> reducedPlane = { reduced.data(), width, height, static_cast<size_t>(width) };
+    Report("FogScatter (full resolution)", [&]() { FogScatter(depthView, fog, fullFogPlane); });
+
+    // The same fog from lookup tables: a table rebuild (only on a parameter change), then
+    // one blend of two table rows per row and two reads per pixel
+    FogLut fogLut;
+    FogParams changed = fog;
+    Report("FogLut::Update (rebuild)", [&]() {
+        changed.density = changed.density == fog.density ? 2.0f * fog.density : fog.density;
+        fogLut.Update(changed);
+    });
+    fogLut.Update(fog);
+    Report("FogLut::Scatter", [&]() { fogLut.Scatter(depthView, reducedPlane); });
+    {
+        int maxError = 0;
+        double psnr = Psnr(reduced, fullFog, maxError);
+        printf("%-40s %5.2f dB   max error %d\n", "  vs exp per step", psnr, maxError);
+    }
+    GuidedFilter(depthView, depthView, refine, fullRefinedPlane);
+    const int scales[] = { 2, 4 };
+    for (int scale : scales) {
+        int lowWidth = ReducedSize(width, scale), lowHeight = ReducedSize(height, scale);
+        std::vector<uint8_t> lowDepth(static_cast<size_t>(lowWidth) * lowHeight), lowResult(lowDepth.size());
+        ImagePlane<uint8_t> lowDepthPlane = { lowDepth.data(), lowWidth, lowHeight, static_cast<size_t>(lowWidth) };
+        ImagePlane<const uint8_t> lowDepthView = { lowDepth.data(), lowWidth, lowHeight, static_cast<size_t>(lowWidth) };
+        ImagePlane<uint8_t> lowResultPlane = { lowResult.data(), lowWidth, lowHeight, static_cast<size_t>(lowWidth) };
+        ImagePlane<const uint8_t> lowResultView = { lowResult.data(), lowWidth, lowHeight, static_cast<size_t>(lowWidth) };
+        GuidedFilterParams lowRefine = refine;
+        lowRefine.radius = (refine.radius + scale / 2) / scale;
+        const char* label = scale == 2 ? "1/2" : "1/4";
+        char name[64];
+        int maxError = 0;
+
+        snprintf(name, sizeof(name), "DownsamplePlane (%s)", label);
+        Report(name, [&]() { DownsamplePlane(depthView, scale, lowDepthPlane); });
+        snprintf(name, sizeof(name), "JointBilateralUpsample (%s)", label);
+        Report(name, [&]() { JointBilateralUpsample(lowDepthView, lowDepthView, depthView, scale, reducedPlane); });
+
+        snprintf(name, sizeof(name), "  GuidedFilter alone (%s)", label);
+        Report(name, [&]() { GuidedFilter(lowDepthView, lowDepthView, lowRefine, lowResultPlane); });
+        snprintf(name, sizeof(name), "Depth refinement (%s)", label);
+        Report(name, [&]() {
+            DownsamplePlane(depthView, scale, lowDepthPlane);
+            GuidedFilter(lowDepthView, lowDepthView, lowRefine, lowResultPlane);
+            JointBilateralUpsample(lowResultView, lowDepthView, depthView, scale, reducedPlane);
+        });
+        double psnr = Psnr(reduced, fullRefined, maxError);
+        printf("%-40s %5.2f dB   max error %d\n", "  vs full resolution", psnr, maxError);
+
+        snprintf(name, sizeof(name), "  FogScatter alone (%s)", label);
+        Report(name, [&]() { FogScatter(lowDepthView, fog, lowResultPlane); });
+        snprintf(name, sizeof(name), "Fog (%s)", label);
+        Report(name, [&]() {
+            DownsamplePlane(depthView, scale, lowDepthPlane);
+            FogScatter(lowDepthView, fog, lowResultPlane);
+            JointBilateralUpsample(lowResultView, lowDepthView, depthView, scale, reducedPlane);
+        });
+        psnr = Psnr(reduced, fullFog, maxError);
+        printf("%-40s %5.2f dB   max error %d\n", "  vs full resolution", psnr, maxError);
+    }
+
+    // Hi-Z: how much of the frame the tile classes let passes skip, and what that saves the
+    // fog march. Most telling on a real capture; the test frame's gradient and text rows
+    // leave few tiles flat.
+    DepthPyramid depthPyramid;
+    Report("DepthPyramid::Build", [&]() { depthPyramid.Build(depthView); });
+    for (int level = 3; level <= 5; ++level) {
+        ImagePlane<const uint8_t> minLevel = depthPyramid.MinLevel(level);
+        ImagePlane<const uint8_t> maxLevel = depthPyramid.MaxLevel(level);
+        int counts[3] = { 0, 0, 0 };
+        for (int y = 0; y < minLevel.height; ++y) {
+            for (int x = 0; x < minLevel.width; ++x) counts[ClassifyDepthTile(minLevel.Row(y)[x], maxLevel.Row(y)[x])]++;
+        }
+        double tiles = static_cast<double>(minLevel.width) * minLevel.height;
+        char name[64];
+        snprintf(name, sizeof(name), "  %dx%d tiles", 1 << level, 1 << level);
+        printf("%-40s empty %5.1f%%   uniform %5.1f%%   mixed %5.1f%%\n", name,
+            100.0 * counts[DepthTileEmpty] / tiles, 100.0 * counts[DepthTileUniform] / tiles, 100.0 * counts[DepthTileMixed] / tiles);
+    }
+    Report("FogScatterTiles (with pyramid build)", [&]() {
+        depthPyramid.Build(depthView);
+        FogScatterTiles(depthView, depthPyramid, fog, reducedPlane);
+    });
+    printf("%-40s %s\n", "  matches FogScatter", reduced == fullFog ? "yes" : "NO");
+
+    // Depth of field from a summed-area table: flat across radii; chromatic separation
+    // adds two more box lookups per pixel
+    std::vector<uint32_t> focused(frame.size());
+    ImagePlane<uint32_t> focusedPlane = { focused.data(), width, height, width * sizeof(uint32_t) };
+    const int dofRadii[] = { 2, 6, 16, 32 };
+    for (int radius : dofRadii) {
+        DepthOfFieldParams dof = { radius, 0.0f, VIEW_CONVERGENCE_DEPTH };
+        char name[64];
+        snprintf(name, sizeof(name), "DepthOfField (radius %d)", radius);
+        Report(name, [&]() { DepthOfField(framePlane, depthView, dof, focusedPlane); });
+    }
+    DepthOfFieldParams chromatic = { DEFAULT_DOF_RADIUS, 12.0f, VIEW_CONVERGENCE_DEPTH };
+    Report("  with chromatic separation", [&]() { DepthOfField(framePlane, depthView, chromatic, focusedPlane); });
+
+    Report("SynthesizeStereo (1 thread)", [&]() {
+        std::vector<int16_t> scratch(static_cast<size_t>(width) * 3);
+        int scaleQ8 = DisparityScaleQ8(params);
+        for (int y = 0; y < height; ++y) {
+            int16_t* shift = scratch.data();
+            int16_t* zLeft = shift + width;
+            int16_t* zRight = zLeft + width;
+            HalfDisparityRow(depthView.Row(y), width, scaleQ8, params.convergence, shift);
+            std::fill(zLeft, zLeft + width * 2, static_cast<int16_t>(-1));
+            WarpRow(framePlane.Row(y), depthView.Row(y), shift, 1, width, leftPlane.Row(y), zLeft);
+            WarpRow(framePlane.Row(y), depthView.Row(y), shift, -1, width, rightPlane.Row(y), zRight);
+            FillHolesRow(leftPlane.Row(y), zLeft, width);
+            FillHolesRow(rightPlane.Row(y), zRight, width);
+        }
+    });
+    Report("SynthesizeStereo", [&]() { SynthesizeStereo(framePlane, depthView, params, leftPlane, rightPlane); });
+
+    // Layered: quality against the per-pixel warp above and speed, over the plane count
+    std::vector<uint32_t> referenceLeft = left;
+    std::vector<uint32_t> referenceRight = right;
+    const int layerCounts[] = { 2, 4, 8, 16, 32, 64 };
+    for (int layers : layerCounts) {
+        ViewSynthesisParams layered = params;
+        layered.layerCount = layers;
+        char name[64];
+        snprintf(name, sizeof(name), "SynthesizeLayeredStereo (%d planes)", layers);
+        Report(name, [&]() { SynthesizeLayeredStereo(framePlane, depthView, layered, leftPlane, rightPlane); });
+        printf("%-40s left %5.2f dB   right %5.2f dB\n", "  PSNR vs per-pixel warp", Psnr(left, referenceLeft), Psnr(right, referenceRight));
+    }
+
+    // Interleave-aware: one output image, each column computed only for its visible view
+    InterleavePattern barrier = { 2, 1.0f, 0.0f };
+    Report("SynthesizeInterleaved (2 views)", [&]() { SynthesizeInterleaved(framePlane, depthView, params, barrier, leftPlane); });
+    InterleavePattern lenticular = { 8, 1.0f, 0.0f };
+    Report("SynthesizeInterleaved (8 views)", [&]() { SynthesizeInterleaved(framePlane, depthView, params, lenticular, leftPlane); });
+
+    // Slanted 8-view sheet on a 0.1 mm pixel pitch. The map is built once per geometry;
+    // head tracking only moves its phase.
+    LenticularParams lens = { 8, 0.8f, 0.1f, 1.0f / 6.0f, SubpixelRGB, 0.0f };
+    LenticularMap lensMap;
+    Report("LenticularMap::Build", [&]() { lensMap.Build(lens, width, height); });
+    float headPhase = 0.0f;
+    Report("LenticularMap::Update (head moved)", [&]() { lens.phasePx = headPhase += 0.25f; lensMap.Update(lens, width, height); });
+    ImagePlane<const uint32_t> lensViews[8];
+    for (int v = 0; v < 8; ++v) {
+        const std::vector<uint32_t>& source = v % 3 == 0 ? frame : (v % 3 == 1 ? left : right);
+        ImagePlane<const uint32_t> plane = { source.data(), width, height, width * sizeof(uint32_t) };
+        lensViews[v] = plane;
+    }
+    Report("InterleaveReference (per-subpixel math)", [&]() { InterleaveReference(lensViews, lens, leftPlane); });
+    Report("Interleave (table gather)", [&]() { Interleave(lensViews, lensMap, false, leftPlane); });
+    Report("Interleave (table gather, blended)", [&]() { Interleave(lensViews, lensMap, true, leftPlane); });
+    LenticularParams headMoved = { 5, 0.73f, 0.1f, 0.2f, SubpixelBGR, 1.3f };
+    LenticularParams barrierLens = { 2, 0.3f, 0.1f, 0.0f, SubpixelRGB, 0.5f };
+    bool interleaveMatches = CheckInterleave("8 views", lens);
+    interleaveMatches = CheckInterleave("5 views, BGR, head", headMoved) && interleaveMatches;
+    interleaveMatches = CheckInterleave("2 views, no slant", barrierLens) && interleaveMatches;
+    Report("SynthesizeLenticular (8 views)", [&]() { SynthesizeLenticular(framePlane, depthView, params, lensMap, leftPlane); });
+
+    // Temporal depth over a sequence: a 512x512 window moving 16 pixels per frame and
+    // +-2 luminance flicker everywhere else, the case the history is meant to absorb
+    const int sequenceLength = 4;
+    std::vector<std::vector<uint32_t>> sequence(sequenceLength, frame);
+    std::vector<FrameChanges> sequenceChanges(sequenceLength);
+    for (int i = 0; i < sequenceLength; ++i) {
+        uint32_t seed = 777u + i;
+        for (uint32_t& px : sequence[i]) {
+            seed = seed * 1664525u + 1013904223u;
+            int delta = static_cast<int>(seed >> 29) - 3;
+            uint32_t r = px & 0xFF;
+            r = static_cast<uint32_t>(std::min(255, std::max(0, static_cast<int>(r) + delta)));
+            px = (px & 0xFFFFFF00u) | r;
+        }
+        int left = 1024 + i * 16;
+        for (int y = 512; y < 1024; ++y) {
+            for (int x = left; x < left + 512; ++x) sequence[i][static_cast<size_t>(y) * width + x] = 0xFFF0F0F0u;
+        }
+        // What a duplication would report: the window's old and new position
+        DepthRect dirty = { left - 16, 512, left + 512, 1024 };
+        sequenceChanges[i].dirty.push_back(dirty);
+        sequenceChanges[i].dirtyKnown = true;
+    }
+    const int intervals[] = { 1, 2, 4, 8 };
+    for (int interval : intervals) {
+        TemporalDepth history;
+        TemporalDepthParams historyParams = { interval, 0.9f, DEPTH_CHANGE_THRESHOLD };
+        int next = 0;
+        char name[64];
+        snprintf(name, sizeof(name), "TemporalDepth::Update (1/%d rows)", interval);
+        Report(name, [&]() {
+            ImagePlane<const uint32_t> plane = { sequence[next].data(), width, height, width * sizeof(uint32_t) };
+            history.Update(plane, historyParams, nullptr);
+            next = (next + 1) % sequenceLength;
+        });
+        snprintf(name, sizeof(name), "  with dirty rects (1/%d rows)", interval);
+        Report(name, [&]() {
+            ImagePlane<const uint32_t> plane = { sequence[next].data(), width, height, width * sizeof(uint32_t) };
+            history.Update(plane, historyParams, &sequenceChanges[next]);
+            next = (next + 1) % sequenceLength;
+        });
+    }
+
+    ViewSynthesizer synthesizer;
+    Report("ViewSynthesizer::Process (depth+stereo)", [&]() { synthesizer.Process(framePlane, params, leftPlane, rightPlane); });
+
+    // Capture to output in L2-sized bands against the same steps a plane at a time; the
+    // traffic is FrameTrafficBytes' estimate, the bandwidth that over the fastest run
+    {
+        BandParams bandParams = DefaultBandParams();
+        bandParams.sourceBgra = true;
+        BandPipeline bands;
+        std::vector<uint32_t> staged(frame.size()), fused(frame.size());
+        ImagePlane<uint32_t> stagedPlane = { staged.data(), width, height, width * sizeof(uint32_t) };
+        ImagePlane<uint32_t> fusedPlane = { fused.data(), width, height, width * sizeof(uint32_t) };
+        Report("BandPipeline::ProcessStaged", [&]() { bands.ProcessStaged(framePlane, bandParams, stagedPlane); });
+        Report("BandPipeline::Process (fused)", [&]() { bands.Process(framePlane, bandParams, fusedPlane); });
+        printf("  matches staged                         %s, %d rows per band\n", staged == fused ? "yes" : "NO",
+            BandRows(bandParams, width));
+        for (int fusedRun = 0; fusedRun < 2; ++fusedRun) {
+            double best = 0.0;
+            for (int i = 0; i < SCALING_ITERATIONS; ++i) {
+                auto begin = std::chrono::steady_clock::now();
+                if (fusedRun) bands.Process(framePlane, bandParams, fusedPlane);
+                else bands.ProcessStaged(framePlane, bandParams, stagedPlane);
+                double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+                best = i == 0 || ms < best ? ms : best;
+            }
+            double megabytes = FrameTrafficBytes(bandParams, width, height, fusedRun != 0) / 1e6;
+            printf("  %-38s %6.1f MB per frame, %5.2f GB/s at %.2f ms\n", fusedRun ? "fused traffic" : "staged traffic", megabytes,
+                megabytes / best, best);
+        }
+        const int bandRowCounts[] = { 4, 64, 256 };
+        for (int rows : bandRowCounts) {
+            BandParams sized = bandParams;
+            sized.bandRows = rows;
+            char name[64];
+            snprintf(name, sizeof(name), "BandPipeline::Process (%d rows)", rows);
+            Report(name, [&]() { bands.Process(framePlane, sized, fusedPlane); });
+        }
+    }
+
+    // Strong scaling of the CPU pixel passes on pools of 1 to all hardware threads: the
+    // fastest of SCALING_ITERATIONS runs of each, and the pool's busy share and steals
+    std::vector<uint8_t> edges(depth.size());
+    ImagePlane<uint8_t> edgePlane = { edges.data(), width, height, static_cast<size_t>(width) };
+    auto fastestMs = [](std::function<void()> pass) {
+        double best = 0.0;
+        for (int i = 0; i < SCALING_ITERATIONS; ++i) {
+            auto begin = std::chrono::steady_clock::now();
+            pass();
+            double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+            best = i == 0 || ms < best ? ms : best;
+        }
+        return best;
+    };
+    printf("%-10s %9s %9s %9s %9s %9s %9s %8s\n", "Threads", "depth", "fog", "sobel", "composite", "copy", "total", "speedup");
+    unsigned hardwareThreads = std::thread::hardware_concurrency() > 0 ? std::thread::hardware_concurrency() : 1;
+    double serialMs = 0.0;
+    for (unsigned threads = 1; threads <= hardwareThreads; threads = threads * 2 <= hardwareThreads || threads == hardwareThreads ? threads * 2 : hardwareThreads) {
+        TaskScheduler pool(static_cast<int>(threads) - 1);
+        TaskScheduler::SetCurrent(&pool);
+        double stageMs[5] = {
+            fastestMs([&]() { EstimateDepth(framePlane, depthPlane); }),
+            fastestMs([&]() { FogScatter(depthView, fog, fullFogPlane); }),
+            fastestMs([&]() { OutlineEdges(framePlane, 1.5f, 1000.0f, edgePlane); }),
+            fastestMs([&]() { SynthesizeLenticular(framePlane, depthView, params, lensMap, leftPlane); }),
+            fastestMs([&]() {
+                ParallelFor(0, height, [&](int first, int last) {
+                    for (int y = first; y < last; ++y) memcpy(leftPlane.Row(y), framePlane.Row(y), width * sizeof(uint32_t));
+                });
+            })
+        };
+        double totalMs = stageMs[0] + stageMs[1] + stageMs[2] + stageMs[3] + stageMs[4];
+        if (threads == 1) serialMs = totalMs;
+        printf("%-10u %9.2f %9.2f %9.2f %9.2f %9.2f %9.2f %7.2fx\n", threads, stageMs[0], stageMs[1], stageMs[2], stageMs[3], stageMs[4],
+            totalMs, serialMs / totalMs);
+        if (threads == hardwareThreads) {
+            std::vector<TaskParticipantStats> stats = pool.Stats();
+            for (size_t i = 0; i < stats.size(); ++i) {
+                printf("  %s %zu: %5.1f%% busy, %llu pieces, %llu stolen\n", stats[i].worker ? "worker" : "caller", i,
+                    stats[i].utilisation * 100.0, static_cast<unsigned long long>(stats[i].tasks), static_cast<unsigned long long>(stats[i].steals));
+            }
+        }
+        TaskScheduler::SetCurrent(nullptr);
+        if (threads == hardwareThreads) break;
+    }
+
+    // Depth costs 1 ms plus a part that shrinks with the scale's area, views a fixed 1 ms,
+    // against the app's budget. The area part steps through light, heavy and light loads.
+    ResolutionController controller(FakeClock);
+    controller.SetBudget(0.75 * 1000.0 / 140);
+    controller.SetStageLimits(ResolutionFog, 1, 1);
+    controller.SetStageLimits(ResolutionViews, 1, 1);
+    const double loads[] = { 2.0, 12.0, 40.0, 2.0 };
+    const int phaseFrames = 600;
+    for (double load : loads) {
+        int changesBefore = controller.Changes();
+        int lastChange = -1;
+        for (int frame = 0; frame < phaseFrames; ++frame) {
+            int scale = controller.Scale(ResolutionDepth);
+            controller.BeginStage(ResolutionDepth);
+            fakeClockMs += 1.0 + load / (scale * scale);
+            controller.EndStage(ResolutionDepth);
+            controller.AddStageTime(ResolutionViews, 1.0);
+            if (controller.EndFrame()) lastChange = frame;
+        }
+        char name[64];
+        snprintf(name, sizeof(name), "ResolutionController (load %.0f ms)", load);
+        printf("%-40s depth 1/%d   %5.2f of %5.2f ms   %d changes, settled by frame %d\n", name,
+            controller.Scale(ResolutionDepth), controller.PredictedMs(), controller.Budget(),
+            controller.Changes() - changesBefore, lastChange + 1);
+    }
+    // The last load is the first one again, which full resolution held
+    bool resolutionRecovered = Expect(controller.Scale(ResolutionDepth) == 1, "the light load returns depth to full resolution");
+
+    const int pacingFrames = 2000;
+    PacingResult sleepPacing = SimulatePacing(nullptr, pacingFrames);
+    printf("%-40s %5.2f ms apart, jitter %.3f ms, %.2f ms work to vblank\n", "Sleep pacing (simulated)",
+        sleepPacing.intervalMs, sleepPacing.intervalJitterMs, sleepPacing.latencyMs);
+    FramePacer pacer(1000.0 / 140, PacingClock, PacingSleep);
+    PacingResult framePacing = SimulatePacing(&pacer, pacingFrames);
+    PacerStats pacerStats = pacer.Stats();
+    printf("%-40s %5.2f ms apart, jitter %.3f ms, %.2f ms work to vblank\n", "FramePacer (simulated)",
+        framePacing.intervalMs, framePacing.intervalJitterMs, framePacing.latencyMs);
+    printf("%-40s wake error %.3f ms mean, %.3f p99, spin %.2f ms, %d deadlines missed\n", "",
+        pacerStats.meanErrorMs, pacerStats.p99ErrorMs, pacerStats.spinMs, pacerStats.missed);
+
+    // A 165 Hz desktop captured in 5 to 9 ms, shown at 140 Hz, where every frame takes the
+    // newest finished capture: stamps as the overlay makes them
+    FrameAccounting accounting;
+    const double desktopMs = 1000.0 / 165, renderMs = 1000.0 / 140;
+    FrameRecord captured = {}, latest = {};
+    double captureFree = 0.0;   // the capture thread is busy until then
+    uint64_t lastShown = 0;
+    for (int frame = 1; frame <= pacingFrames; ++frame) {
+        double renderAt = frame * renderMs;
+        // Captures that finish by this frame; a busy capture thread folds the desktop frames it misses
+        for (;;) {
+            double present = std::max(captureFree, (captured.desktopFrames + 1) * desktopMs);
+            uint64_t accumulated = static_cast<uint64_t>(std::floor(present / desktopMs)) - captured.desktopFrames;
+            double uploaded = present + 0.2 + 5.0 + 4.0 * PacingNoise();
+            if (uploaded > renderAt) break;
+            captured.sequence++;
+            captured.desktopFrames += accumulated;
+            captured.desktopCaptures++;
+            captured.desktopPresentMs = captured.desktopFrames * desktopMs;
+            captured.acquiredMs = present + 0.2;
+            captured.uploadedMs = uploaded;
+            captureFree = uploaded;
+            latest = captured;
+        }
+        FrameRecord shown = latest;
+        shown.presentedMs = renderAt + 1.0;
+        shown.gpuDoneMs = renderAt + 2.5;
+        accounting.AddFrame(shown, shown.sequence != lastShown);
+        lastShown = shown.sequence;
+    }
+    FrameCounts counts = accounting.Counts();
+    SpanStats capture = accounting.Span(SpanCapture);
+    printf("%-40s %llu presented, %llu reused, %llu dropped, %llu desktop frames folded\n", "FrameAccounting (simulated)",
+        static_cast<unsigned long long>(counts.presented), static_cast<unsigned long long>(counts.reused),
+        static_cast<unsigned long long>(counts.dropped), static_cast<unsigned long long>(counts.desktopSkipped));
+    printf("%-40s capture to present %.2f / %.2f / %.2f ms p50 / p99 / max, age %.2f ms p50\n", "",
+        capture.p50Ms, capture.p99Ms, capture.maxMs, accounting.Span(SpanAge).p50Ms);
+
+    bool passed = CheckSteadyState(frame) && interleaveMatches && resolutionRecovered;
+    passed = CheckAdapterSelection() && passed;
+    passed = CheckDeviceRecovery() && passed;
+    passed = CheckOutputScheduler() && passed;
+    return passed ? 0 : 1;
+}